@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// This file selects the algorithm profile of the build. A profile removes the
+// asymmetric algorithms that a device never uses from Implementation.h, which
+// takes their members out of the TPMU unions in TpmTypes.h (and so shrinks
+// TPM2B_PUBLIC, TPMT_SIGNATURE, TPMT_SENSITIVE and TPM2B_ENCRYPTED_SECRET) and
+// their (un)marshaling code out of Marshal.c.
+//
+// The profiles are:
+//  UTPM_ALG_PROFILE_FULL       every algorithm of Implementation.h (default)
+//  UTPM_ALG_PROFILE_ECC_ONLY   no RSA
+//  UTPM_ALG_PROFILE_HMAC_ONLY  no RSA and no ECC; keyed hash and symmetric
+//                              objects only
+//
+// The profile is set on the command line (the utpm_alg_profile cmake setting)
+// or here. The objects built against one profile can only exchange these types
+// with objects built against the same profile.
+
+#ifndef _ALGORITHM_PROFILE_H_
+#define _ALGORITHM_PROFILE_H_
+
+#if defined UTPM_ALG_PROFILE_ECC_ONLY && defined UTPM_ALG_PROFILE_HMAC_ONLY
+#   error Only one of UTPM_ALG_PROFILE_ECC_ONLY and UTPM_ALG_PROFILE_HMAC_ONLY can be defined
+#endif
+
+#if defined UTPM_ALG_PROFILE_ECC_ONLY
+#   define  PROFILE_RSA     NO
+#   define  PROFILE_ECC     YES
+#elif defined UTPM_ALG_PROFILE_HMAC_ONLY
+#   define  PROFILE_RSA     NO
+#   define  PROFILE_ECC     NO
+#else
+#   ifndef UTPM_ALG_PROFILE_FULL
+#       define UTPM_ALG_PROFILE_FULL
+#   endif
+#   define  PROFILE_RSA     YES
+#   define  PROFILE_ECC     YES
+#endif
+
+#endif // _ALGORITHM_PROFILE_H_
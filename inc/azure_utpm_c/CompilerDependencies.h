@@ -26,10 +26,29 @@
 #   define REVERSE_ENDIAN_16(_Number) _byteswap_ushort(_Number)
 #   define REVERSE_ENDIAN_32(_Number) _byteswap_ulong(_Number)
 #   define REVERSE_ENDIAN_64(_Number) _byteswap_uint64(_Number)
+// Atomic operations used by the TPM command dispatcher. All of them are full barriers.
+#   include <intrin.h>
+#   define ATOMIC_EXCHANGE_PTR(_Target, _Value)                                 \
+    _InterlockedExchangePointer((void* volatile*)(_Target), (void*)(_Value))
+#   define ATOMIC_LOAD_PTR(_Source)                                             \
+    _InterlockedCompareExchangePointer((void* volatile*)(_Source), NULL, NULL)
+#   define ATOMIC_EXCHANGE_32(_Target, _Value)                                  \
+    ((uint32_t)_InterlockedExchange((volatile long*)(_Target), (long)(_Value)))
+#   define ATOMIC_LOAD_32(_Source)                                              \
+    ((uint32_t)_InterlockedOr((volatile long*)(_Source), 0))
+#   define ATOMIC_COMPARE_EXCHANGE_32(_Target, _Expected, _Desired)             \
+    (_InterlockedCompareExchange((volatile long*)(_Target), (long)(_Desired),   \
+                                 (long)(_Expected)) == (long)(_Expected))
+#   define ATOMIC_AND_32(_Target, _Mask)                                        \
+    ((void)_InterlockedAnd((volatile long*)(_Target), (long)(_Mask)))
 // Handling of INLINE macro
 #   ifdef INLINE_FUNCTIONS
 #    define INLINE   static __inline
 #   endif
+// Always in-line, independent of INLINE_FUNCTIONS
+#   define STATIC_INLINE    static __inline
+// The REVERSE_ENDIAN macros are compiler intrinsics
+#   define BYTE_SWAP_BUILTINS
 
 // Avoid compiler warning for in line of stdio (or not)
 //#define _NO_CRT_STDIO_INLINE
@@ -74,9 +93,25 @@ __pragma(warning(pop))
 #   define REVERSE_ENDIAN_16(_Number) __builtin_bswap16(_Number)
 #   define REVERSE_ENDIAN_32(_Number) __builtin_bswap32(_Number)
 #   define REVERSE_ENDIAN_64(_Number) __builtin_bswap64(_Number)
+#   define ATOMIC_EXCHANGE_PTR(_Target, _Value)                                 \
+    __atomic_exchange_n((_Target), (_Value), __ATOMIC_SEQ_CST)
+#   define ATOMIC_LOAD_PTR(_Source)                                             \
+    __atomic_load_n((_Source), __ATOMIC_SEQ_CST)
+#   define ATOMIC_EXCHANGE_32(_Target, _Value)                                  \
+    __atomic_exchange_n((_Target), (_Value), __ATOMIC_SEQ_CST)
+#   define ATOMIC_LOAD_32(_Source)                                              \
+    __atomic_load_n((_Source), __ATOMIC_SEQ_CST)
+#   define ATOMIC_COMPARE_EXCHANGE_32(_Target, _Expected, _Desired)             \
+    __sync_bool_compare_and_swap((_Target), (_Expected), (_Desired))
+#   define ATOMIC_AND_32(_Target, _Mask)                                        \
+    ((void)__atomic_and_fetch((_Target), (_Mask), __ATOMIC_SEQ_CST))
 #   ifdef INLINE_FUNCTIONS
 #   define INLINE static inline
 #endif
+#   define STATIC_INLINE    static inline
+#   if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)
+#       define BYTE_SWAP_BUILTINS
+#   endif
 
 #if defined(__GNUC__)
 #   define NORETURN                     __attribute__((noreturn))
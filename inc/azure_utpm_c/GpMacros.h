@@ -80,8 +80,14 @@
 #define PCR_SELECT_MIN          ((PLATFORM_PCR+7)/8)
 #define PCR_SELECT_MAX          ((IMPLEMENTATION_PCR+7)/8)
 #define MAX_ORDERLY_COUNT       ((1 << ORDERLY_BITS) - 1)
+#if ALG_RSA
 #define PRIVATE_VENDOR_SPECIFIC_BYTES                            \
                 ((MAX_RSA_KEY_BYTES/2) * (3 + CRT_FORMAT_RSA * 2))
+#else
+// Without RSA the vendor specific area does not need to exceed the other
+// members of TPMU_SENSITIVE_COMPOSITE
+#define PRIVATE_VENDOR_SPECIFIC_BYTES   MAX_SYM_DATA
+#endif
 
 //** Compile-time Checks
 // In some cases, the relationship between two values may be dependent
@@ -7,6 +7,7 @@
 #include    "TpmBuildSwitches.h"
 #include    "BaseTypes.h"
 #include    "TPMB.h"
+#include    "AlgorithmProfile.h"
 
 #if defined (_MSC_VER)
 #pragma warning(disable: 4710)
@@ -60,7 +61,8 @@ dbgDumpMemBlock(const char* label, BYTE* buf, int size)
 
 
 // Table 0:2 - Defines for Implemented Algorithms (ImplementedDefines)
-#define  ALG_RSA               ALG_YES
+// ALG_RSA and ALG_ECC follow the algorithm profile (AlgorithmProfile.h)
+#define  ALG_RSA               (ALG_YES*PROFILE_RSA)
 #define  ALG_SHA1              ALG_YES
 #define  ALG_HMAC              ALG_YES
 #define  ALG_TDES              ALG_YES
@@ -77,7 +79,7 @@ dbgDumpMemBlock(const char* label, BYTE* buf, int size)
 #define  ALG_RSAES             (ALG_YES*ALG_RSA)
 #define  ALG_RSAPSS            (ALG_YES*ALG_RSA)
 #define  ALG_OAEP              (ALG_YES*ALG_RSA)
-#define  ALG_ECC               ALG_YES
+#define  ALG_ECC               (ALG_YES*PROFILE_ECC)
 #define  ALG_ECDH              (ALG_YES*ALG_ECC)
 #define  ALG_ECDSA             (ALG_YES*ALG_ECC)
 #define  ALG_ECDAA             (ALG_YES*ALG_ECC)
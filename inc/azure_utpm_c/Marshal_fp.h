@@ -11,6 +11,12 @@ extern "C"
 {
 #endif
 
+// Exact number of bytes 'source' marshals to, computed without writing it. Every
+// Type_Marshal() function only counts the bytes when 'buffer' and 'size' are NULL,
+// so this is defined for all the types with a marshaler, e.g.
+// TPM_MARSHAL_SIZE(TPM2B_PUBLIC, &inPublic).
+#define TPM_MARSHAL_SIZE(Type, source)  ((INT32)Type##_Marshal((source), NULL, NULL))
+
 // Table 2:3 - Definition of Base Types (BaseTypes)
 //   UINT8 definition from table 2:3
 MOCKABLE_FUNCTION(, TPM_RC, UINT8_Unmarshal, UINT8*, target, BYTE**, buffer, INT32*, size);
@@ -1508,8 +1514,7 @@ TPMS_ECC_PARMS_Marshal(TPMS_ECC_PARMS *source, BYTE** buffer, INT32 *size);
 
 
 // Table 2:188 - Definition of TPMU_PUBLIC_PARMS Union  (UnionTable)
-TPM_RC
-TPMU_PUBLIC_PARMS_Unmarshal(TPMU_PUBLIC_PARMS *target, BYTE** buffer, INT32 *size, UINT32 selector);
+MOCKABLE_FUNCTION(, TPM_RC, TPMU_PUBLIC_PARMS_Unmarshal, TPMU_PUBLIC_PARMS*, target, BYTE**, buffer, INT32*, size, UINT32, selector);
 UINT16
 TPMU_PUBLIC_PARMS_Marshal(TPMU_PUBLIC_PARMS *source, BYTE** buffer, INT32 *size, UINT32 selector);
 
@@ -1663,6 +1668,24 @@ MOCKABLE_FUNCTION(, UINT16, TPM2B_CREATION_DATA_Marshal, TPM2B_CREATION_DATA*, s
 MOCKABLE_FUNCTION(, TPM_RC, BYTE_Array_Unmarshal, BYTE*, target, BYTE**, buffer, INT32*, size, INT32, count);
 MOCKABLE_FUNCTION(, UINT16, BYTE_Array_Marshal, BYTE*, source, BYTE**, buffer, INT32*, size, INT32, count);
 
+// Skip functions advance the buffer past a marshaled value without decoding it
+MOCKABLE_FUNCTION(, TPM_RC, TPM2B_Skip, BYTE**, buffer, INT32*, size, UINT16, maxSize);
+MOCKABLE_FUNCTION(, TPM_RC, TPM2B_CREATION_DATA_Skip, BYTE**, buffer, INT32*, size);
+MOCKABLE_FUNCTION(, TPM_RC, TPMT_TK_Skip, BYTE**, buffer, INT32*, size);
+
+#define TPM2B_DIGEST_Skip(buffer, size) \
+            TPM2B_Skip(buffer, size, sizeof(TPMU_HA))
+#define TPM2B_IV_Skip(buffer, size) \
+            TPM2B_Skip(buffer, size, MAX_SYM_BLOCK_SIZE)
+#define TPM2B_NAME_Skip(buffer, size) \
+            TPM2B_Skip(buffer, size, sizeof(TPMU_NAME))
+#define TPMT_TK_CREATION_Skip(buffer, size) \
+            TPMT_TK_Skip(buffer, size)
+#define TPMT_TK_AUTH_Skip(buffer, size) \
+            TPMT_TK_Skip(buffer, size)
+#define TPMT_TK_HASHCHECK_Skip(buffer, size) \
+            TPMT_TK_Skip(buffer, size)
+
 // Array Marshal/Unmarshal for TPM2B_DIGEST
 TPM_RC
 TPM2B_DIGEST_Array_Unmarshal(TPM2B_DIGEST *target, BYTE** buffer, INT32 *size, INT32 count);
@@ -123,6 +123,14 @@ UINT32 ByteArrayToUint32(
 // Function to write an integer to a byte array
 UINT64 ByteArrayToUint64(BYTE* a);
 
+//*** ByteArrayToUint32Array()
+// Function to read 'count' consecutive integers from a byte array
+void ByteArrayToUint32Array(
+    UINT32              *target,
+    const BYTE          *a,
+    INT32                count
+    );
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,17 +26,23 @@ extern "C"
 
 #if defined(GB_DEBUG_FILEDESCRIPT)
 
+struct pollfd;
+
 MOCKABLE_FUNCTION(, ssize_t, gbfiledesc_write, int, fd, const void*, buff, size_t, count);
 MOCKABLE_FUNCTION(, ssize_t, gbfiledesc_read, int, fd, void*, buf, size_t, len);
 MOCKABLE_FUNCTION(, int, gbfiledesc_access, const char*, s, int, mode);
 MOCKABLE_FUNCTION(, int, gbfiledesc_close, int, fd);
 MOCKABLE_FUNCTION(, int, gbfiledesc_open, const char*, path, int, flags);
+MOCKABLE_FUNCTION(, int, gbfiledesc_fcntl, int, fd, int, cmd, int, arg);
+MOCKABLE_FUNCTION(, int, gbfiledesc_poll, struct pollfd*, fds, unsigned long, nfds, int, timeout);
 
 #define open  gbfiledesc_open
 #define write gbfiledesc_write
 #define read gbfiledesc_read
 #define access gbfiledesc_access
 #define close gbfiledesc_close
+#define fcntl gbfiledesc_fcntl
+#define poll gbfiledesc_poll
 
 #endif /* GB_DEBUG_FILEDESCRIPT */
 
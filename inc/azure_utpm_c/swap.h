@@ -28,13 +28,70 @@
 // Aggregate bytes into an UINT
 
 #define BYTE_ARRAY_TO_UINT8(b)  (uint8_t)((b)[0])
+#define UINT8_TO_BYTE_ARRAY(i, b) ((b)[0] = (uint8_t)(i))
+
+#ifdef BYTE_SWAP_BUILTINS
+// The compiler has byte swap intrinsics, so the conversions are done in-line. A
+// memcpy() of a constant size compiles to a single load or store on targets that
+// allow unaligned access, and to byte accesses on the others.
+#include <stdint.h>
+#include <string.h>
+
+STATIC_INLINE uint16_t LoadUint16BigEndian(const void *b)
+{
+    uint16_t    i;
+    memcpy(&i, b, sizeof(i));
+    return FROM_BIG_ENDIAN_UINT16(i);
+}
+
+STATIC_INLINE uint32_t LoadUint32BigEndian(const void *b)
+{
+    uint32_t    i;
+    memcpy(&i, b, sizeof(i));
+    return FROM_BIG_ENDIAN_UINT32(i);
+}
+
+STATIC_INLINE uint64_t LoadUint64BigEndian(const void *b)
+{
+    uint64_t    i;
+    memcpy(&i, b, sizeof(i));
+    return FROM_BIG_ENDIAN_UINT64(i);
+}
+
+STATIC_INLINE void StoreUint16BigEndian(uint16_t i, void *b)
+{
+    i = TO_BIG_ENDIAN_UINT16(i);
+    memcpy(b, &i, sizeof(i));
+}
+
+STATIC_INLINE void StoreUint32BigEndian(uint32_t i, void *b)
+{
+    i = TO_BIG_ENDIAN_UINT32(i);
+    memcpy(b, &i, sizeof(i));
+}
+
+STATIC_INLINE void StoreUint64BigEndian(uint64_t i, void *b)
+{
+    i = TO_BIG_ENDIAN_UINT64(i);
+    memcpy(b, &i, sizeof(i));
+}
+
+#define BYTE_ARRAY_TO_UINT16(b) LoadUint16BigEndian(b)
+#define BYTE_ARRAY_TO_UINT32(b) LoadUint32BigEndian(b)
+#define BYTE_ARRAY_TO_UINT64(b) LoadUint64BigEndian(b)
+#define UINT16_TO_BYTE_ARRAY(i, b)  StoreUint16BigEndian((uint16_t)(i), (b))
+#define UINT32_TO_BYTE_ARRAY(i, b)  StoreUint32BigEndian((uint32_t)(i), (b))
+#define UINT64_TO_BYTE_ARRAY(i, b)  StoreUint64BigEndian((uint64_t)(i), (b))
+
+#else // BYTE_SWAP_BUILTINS
+
 #define BYTE_ARRAY_TO_UINT16(b) ByteArrayToUint16((BYTE *)(b))
 #define BYTE_ARRAY_TO_UINT32(b) ByteArrayToUint32((BYTE *)(b))
 #define BYTE_ARRAY_TO_UINT64(b) ByteArrayToUint64((BYTE *)(b))
-#define UINT8_TO_BYTE_ARRAY(i, b) ((b)[0] = (uint8_t)(i))
 #define UINT16_TO_BYTE_ARRAY(i, b)  Uint16ToByteArray((i), (BYTE *)(b))
 #define UINT32_TO_BYTE_ARRAY(i, b)  Uint32ToByteArray((i), (BYTE *)(b))
 #define UINT64_TO_BYTE_ARRAY(i, b)  Uint64ToByteArray((i), (BYTE *)(b))
+#endif // BYTE_SWAP_BUILTINS
 
 
 #else // AUTO_ALIGN
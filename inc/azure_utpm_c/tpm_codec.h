@@ -13,7 +13,9 @@ extern "C" {
 
 #include "Tpm.h"
 #include "tpm_comm.h"
+#include "tpm_dispatcher.h"
 #include "umock_c/umock_c_prod.h"
+#include "azure_c_shared_utility/lock.h"
 
 // TSS status codes
 
@@ -32,6 +34,7 @@ typedef enum
     TSS_E_COMM = 0x80280100,
     TSS_E_TPM_TRANSACTION = TSS_E_COMM + 0x0001,
     TSS_E_TPM_SIM_BAD_ACK = TSS_E_COMM + 0x0002,
+    TSS_E_TPM_PENDING = TSS_E_COMM + 0x0003,
     TSS_E_BAD_RESPONSE = TSS_E_COMM + 0x0010,
     TSS_E_BAD_RESPONSE_LEN = TSS_E_COMM + 0x0011
 }
@@ -52,6 +55,34 @@ typedef enum
 }
 TSS_TPM_CONN_INFO;
 
+// Capacity of the response buffers, including TSS_RESP_BUFFER
+#define TSS_MAX_RESPONSE_SIZE           4096
+
+// Default and maximal number of command contexts preallocated for a TSS_DEVICE
+#define TSS_DEFAULT_CMD_CTX_POOL_SIZE   2
+#define TSS_MAX_CMD_CTX_POOL_SIZE       32
+
+// Number of properties in the TPM_PT_FIXED and TPM_PT_VAR groups cached by TSS_DEVICE
+#define TSS_PT_FIXED_COUNT              (TPM_PT_MAX_CAP_BUFFER - PT_FIXED + 1)
+#define TSS_PT_VAR_COUNT                (TPM_PT_AUDIT_COUNTER_1 - PT_VAR + 1)
+
+typedef struct TSS_CMD_CONTEXT_TAG* TSS_CMD_CONTEXT_HANDLE;
+
+typedef struct TSS_CMD_CONTEXT_POOL_TAG* TSS_CMD_CONTEXT_POOL_HANDLE;
+
+typedef struct TSS_PREPARED_CMD_TAG* TSS_PREPARED_CMD_HANDLE;
+
+typedef struct TSS_BATCH_TAG* TSS_BATCH_HANDLE;
+
+// Maximum number of commands in a batch
+#define TSS_MAX_BATCH_STEPS             8
+
+// Placeholder for the handle returned by step 'step' of a batch. It is resolved when
+// the batch is executed.
+#define TSS_BATCH_HANDLE_REF            0xFF000000
+#define TSS_BATCH_STEP_HANDLE(step)     ((TPM_HANDLE)(TSS_BATCH_HANDLE_REF | (UINT32)(step)))
+#define TSS_IS_BATCH_STEP_HANDLE(h)     (((h) & 0xFF000000) == TSS_BATCH_HANDLE_REF)
+
 typedef struct
 {
     // A set of TSS_TPM_CONN_INFO flags
@@ -64,7 +95,44 @@ typedef struct
     // Raw response code returned by the last command executed by the given TPM device
     TPM_RC              LastRawResponse;
 
+    // Endpoint of the TPM passed to tpm_comm_create(), NULL for the default one of the
+    // backend. The linux backend takes device:, tcti:, mssim: and unix: URIs.
     const char* comms_endpoint;
+
+    // Backend of the connection to the TPM, NULL for the default one. Only builds with
+    // USE_TPM_COMM_RUNTIME have several backends, see tpm_comm.h.
+    const TPM_COMM_OPS* CommBackend;
+
+    // Number of command contexts preallocated by Initialize_TPM_Codec().
+    // 0 means TSS_DEFAULT_CMD_CTX_POOL_SIZE. See TSS_SetCmdContextPoolSize().
+    UINT32              CmdCtxPoolSize;
+
+    // Preallocated command contexts reused by the TPM2_* commands. If no pool is
+    // available (the device was not initialized), each command allocates its own.
+    TSS_CMD_CONTEXT_POOL_HANDLE CmdCtxPool;
+
+    // TPM_PT_FIXED property values indexed by (property - PT_FIXED). Read with a
+    // single batched TPM2_GetCapability by the first TSS_GetTpmProperty() call for
+    // a fixed property.
+    BOOL                FixedPropsValid;
+    UINT32              FixedProps[TSS_PT_FIXED_COUNT];
+
+    // TPM_PT_VAR property values indexed by (property - PT_VAR), as of the first
+    // TSS_GetTpmProperty() call for a variable property or the last
+    // TSS_RefreshTpmProperties() call. While the dispatcher is running they are only
+    // accessed under VarPropsLock.
+    BOOL                VarPropsValid;
+    UINT32              VarProps[TSS_PT_VAR_COUNT];
+    LOCK_HANDLE         VarPropsLock;
+
+    // If not NULL, commands are executed by the dispatcher thread, and the device may be
+    // used by several threads at once. See TSS_StartDispatcher().
+    TPM_DISPATCHER_HANDLE Dispatcher;
+
+    // Command submitted by one of the TPM2_*Submit() functions and not completed yet by
+    // the matching TPM2_*Complete(), with the command context it keeps checked out
+    TSS_CMD_CONTEXT_HANDLE PendingCmdCtx;
+    TPM_CC              PendingCmdCode;
 }
 TSS_DEVICE;
 
@@ -86,6 +154,11 @@ MOCKABLE_FUNCTION(, TPM_RC, TPM2_SequenceUpdate, TSS_DEVICE*, tpm, TSS_SESSION*,
 
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_Sign, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_DH_OBJECT, keyHandle, TPM2B_DIGEST*, digest, TPMT_SIG_SCHEME*, inScheme, TPMT_TK_HASHCHECK*, validation, TPMT_SIGNATURE*, signature);
 
+// Asynchronous TPM2_Sign. TPM2_SignComplete() returns TSS_E_TPM_PENDING until the
+// response is available, see TSS_PreparedHMACSubmit().
+MOCKABLE_FUNCTION(, TPM_RC, TPM2_SignSubmit, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_DH_OBJECT, keyHandle, TPM2B_DIGEST*, digest, TPMT_SIG_SCHEME*, inScheme, TPMT_TK_HASHCHECK*, validation);
+MOCKABLE_FUNCTION(, TPM_RC, TPM2_SignComplete, TSS_DEVICE*, tpm, TPMT_SIGNATURE*, signature);
+
 MOCKABLE_FUNCTION(, TPM_RC, TSS_StartHmacAuthSession, TSS_DEVICE*, tpm, TPM_SE, sessionType, TPMI_ALG_HASH, authHash, TPMA_SESSION, sessAttrs, TSS_SESSION*, session);
 
 MOCKABLE_FUNCTION(, TPM_RC, TSS_CreatePrimary, TSS_DEVICE*, tpm, TSS_SESSION*, sess, TPM_HANDLE, hierarchy, TPM2B_PUBLIC*, inPub, TPM_HANDLE*, outHandle, TPM2B_PUBLIC*, outPub);
@@ -94,6 +167,9 @@ MOCKABLE_FUNCTION(, TPM_RC, TSS_Create, TSS_DEVICE*, tpm, TSS_SESSION*, sess, TP
 
 MOCKABLE_FUNCTION(, UINT32, TSS_GetTpmProperty, TSS_DEVICE*, tpm, TPM_PT, prop);
 
+// Re-reads the cached TPM_PT_VAR properties from the TPM
+MOCKABLE_FUNCTION(, TPM_RC, TSS_RefreshTpmProperties, TSS_DEVICE*, tpm);
+
 MOCKABLE_FUNCTION(, TPM_HANDLE, TSS_CreatePersistentKey, TSS_DEVICE*, tpm_device, TPM_HANDLE, request_handle, TSS_SESSION*, sess, TPMI_DH_OBJECT, hierarchy, TPM2B_PUBLIC*, inPub, TPM2B_PUBLIC*, outPub);
 
 TPM_RC TSS_Hash(
@@ -156,6 +232,102 @@ MOCKABLE_FUNCTION(, TPM_RC, Initialize_TPM_Codec, TSS_DEVICE*, tpm);
 
 MOCKABLE_FUNCTION(, void, Deinit_TPM_Codec, TSS_DEVICE*, tpm);
 
+// Sets the number of command contexts kept by the TPM device (0 - use the default).
+// If the device is already initialized, its pool is reallocated, which is only
+// allowed while no command is in progress and no dispatcher is running.
+MOCKABLE_FUNCTION(, TPM_RC, TSS_SetCmdContextPoolSize, TSS_DEVICE*, tpm, UINT32, poolSize);
+
+// Starts a dispatcher thread that performs the TPM I/O of all commands sent to 'tpm',
+// so that the TPM2_* and TSS_* functions may be called on it from several threads at
+// once. Marshaling and unmarshaling stay on the calling threads. In this mode
+// LastRawResponse reflects whichever command completed last, and the asynchronous
+// *Submit()/*Complete() pairs are not available. The fixed TPM properties are read
+// before the thread starts, so that TSS_GetTpmProperty() never fills them concurrently.
+MOCKABLE_FUNCTION(, TPM_RC, TSS_StartDispatcher, TSS_DEVICE*, tpm);
+// Waits for the queued commands and stops the dispatcher thread. No command may be in
+// progress on other threads. Called by Deinit_TPM_Codec().
+MOCKABLE_FUNCTION(, void, TSS_StopDispatcher, TSS_DEVICE*, tpm);
+
+// Prepared commands marshal the command header, handles and authorization area once,
+// so that each execution only marshals the parameters and patches the command size.
+// The sessions' SessIn is captured at preparation time, so only sessions whose
+// authorization does not change between commands (e.g. password sessions) may be used.
+// A prepared command may be executed by one thread at a time.
+MOCKABLE_FUNCTION(, TSS_PREPARED_CMD_HANDLE, TSS_PrepareCommand, TPM_CC, cmdCode, TPM_HANDLE*, handles, INT32, numHandles, TSS_SESSION**, sessions, INT32, numSessions);
+MOCKABLE_FUNCTION(, void, TSS_DestroyPreparedCommand, TSS_PREPARED_CMD_HANDLE, preparedCmd);
+
+// Executes TPM2_HMAC prepared with TSS_PrepareCommand(TPM_CC_HMAC, ...)
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PreparedHMAC, TSS_DEVICE*, tpm, TSS_PREPARED_CMD_HANDLE, preparedCmd, BYTE*, data, UINT32, dataSize, TPM2B_DIGEST*, outHMAC);
+
+// Asynchronous execution of a prepared TPM2_HMAC. TSS_PreparedHMACComplete() returns
+// TSS_E_TPM_PENDING until the response is available; TSS_GetPollFd() returns a
+// descriptor that becomes readable at that point, or -1 if the transport cannot be
+// polled (the command then executes in TSS_PreparedHMACComplete()). Only one command
+// may be outstanding per TPM device, including the asynchronous TPM2_SignSubmit() and
+// TPM2_CreatePrimarySubmit(), and no other command may be sent to it meanwhile.
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PreparedHMACSubmit, TSS_DEVICE*, tpm, TSS_PREPARED_CMD_HANDLE, preparedCmd, BYTE*, data, UINT32, dataSize);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PreparedHMACComplete, TSS_DEVICE*, tpm, TSS_PREPARED_CMD_HANDLE, preparedCmd, TPM2B_DIGEST*, outHMAC);
+MOCKABLE_FUNCTION(, int, TSS_GetPollFd, TSS_DEVICE*, tpm);
+
+// Command batches execute a sequence of commands with a single command context. The
+// handles of a step may refer to the handle returned by an earlier step of the same
+// batch (TSS_BATCH_STEP_HANDLE). Parameters are marshaled when the batch is executed,
+// so the buffers passed to TSS_Batch*() must stay valid until TSS_ExecuteBatch()
+// returns. Execution stops at the first failing step, and the steps that were not
+// executed report TPM_RC_NOT_USED.
+MOCKABLE_FUNCTION(, TSS_BATCH_HANDLE, TSS_CreateBatch);
+MOCKABLE_FUNCTION(, void, TSS_DestroyBatch, TSS_BATCH_HANDLE, batch);
+
+// Steps are numbered from 0 in the order they are added
+MOCKABLE_FUNCTION(, TPM_RC, TSS_BatchReadPublic, TSS_BATCH_HANDLE, batch, TPMI_DH_OBJECT, objectHandle, TPM2B_PUBLIC*, outPublic, TPM2B_NAME*, name, TPM2B_NAME*, qualifiedName);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_BatchCreatePrimary, TSS_BATCH_HANDLE, batch, TSS_SESSION*, sess, TPMI_DH_OBJECT, hierarchy, TPM2B_PUBLIC*, inPub, TPM2B_PUBLIC*, outPub);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_BatchEvictControl, TSS_BATCH_HANDLE, batch, TSS_SESSION*, session, TPMI_RH_PROVISION, auth, TPMI_DH_OBJECT, objectHandle, TPMI_DH_PERSISTENT, persistentHandle);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_BatchFlushContext, TSS_BATCH_HANDLE, batch, TPMI_DH_CONTEXT, flushHandle);
+
+// Returns the result of the first failing step, or TPM_RC_SUCCESS
+MOCKABLE_FUNCTION(, TPM_RC, TSS_ExecuteBatch, TSS_DEVICE*, tpm, TSS_BATCH_HANDLE, batch);
+// Returns the result of the given step of the last execution, and the handle it returned (opt)
+MOCKABLE_FUNCTION(, TPM_RC, TSS_GetBatchStepResult, TSS_BATCH_HANDLE, batch, UINT32, step, TPM_HANDLE*, retHandle);
+
+// Views refer to the variable size outputs of TPM2_ReadPublicView(),
+// TPM2_CreatePrimaryView() and TPM2_LoadView() in their marshaled form, instead of
+// unmarshaling them into TPM2B_PUBLIC/TPM2B_NAME structures. The response parameters
+// are kept in a TSS_RESP_BUFFER owned by the caller, and the views are only valid
+// until that buffer is reused or released.
+typedef struct
+{
+    // Number of bytes of response parameters in 'Buffer'
+    UINT32      Size;
+    BYTE        Buffer[TSS_MAX_RESPONSE_SIZE];
+}
+TSS_RESP_BUFFER;
+
+// Contents of a marshaled TPM2B, without its size field
+typedef struct
+{
+    const BYTE *Ptr;
+    UINT16      Size;
+}
+TSS_BYTES_VIEW;
+
+// Marshaled TPMT_PUBLIC of a TPM2B_PUBLIC. Use the TSS_PublicViewGet*() accessors
+// to read its fields.
+typedef struct
+{
+    TSS_BYTES_VIEW  Area;
+}
+TSS_PUBLIC_VIEW;
+
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PublicViewGetType, const TSS_PUBLIC_VIEW*, view, TPMI_ALG_PUBLIC*, type);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PublicViewGetNameAlg, const TSS_PUBLIC_VIEW*, view, TPMI_ALG_HASH*, nameAlg);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PublicViewGetAttributes, const TSS_PUBLIC_VIEW*, view, TPMA_OBJECT*, objectAttributes);
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PublicViewGetAuthPolicy, const TSS_PUBLIC_VIEW*, view, TSS_BYTES_VIEW*, authPolicy);
+// Only the parameters are unmarshaled, as they are small compared to the unique field
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PublicViewGetParameters, const TSS_PUBLIC_VIEW*, view, TPMU_PUBLIC_PARMS*, parameters);
+// 'unique' receives the RSA modulus, the keyed hash or symmetric cipher digest, or the
+// x coordinate of an ECC point, whose y coordinate goes to 'eccY' (opt)
+MOCKABLE_FUNCTION(, TPM_RC, TSS_PublicViewGetUnique, const TSS_PUBLIC_VIEW*, view, TSS_BYTES_VIEW*, unique, TSS_BYTES_VIEW*, eccY);
+
 // TPM 2.0 command interafce
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_ActivateCredential, TSS_DEVICE*, tpm, TSS_SESSION*, activateSess, TSS_SESSION*, keySess, TPMI_DH_OBJECT, activateHandle, TPMI_DH_OBJECT, keyHandle, TPM2B_ID_OBJECT*, credentialBlob, TPM2B_ENCRYPTED_SECRET*, secret, TPM2B_DIGEST*, certInfo);
 
@@ -189,6 +361,42 @@ TPM_RC TPM2_CreatePrimary(
     TPMT_TK_CREATION         *creationTicket    // OUT
 );
 
+// TPM2_CreatePrimary() returning a view of the public area. The creation data, hash
+// and ticket are not returned.
+TPM_RC TPM2_CreatePrimaryView(
+    TSS_DEVICE               *tpm,              // IN/OUT
+    TSS_SESSION              *session,          // IN/OUT
+    TPMI_DH_OBJECT            primaryHandle,    // IN
+    TPM2B_SENSITIVE_CREATE   *inSensitive,      // IN
+    TPM2B_PUBLIC             *inPublic,         // IN
+    TPM2B_DATA               *outsideInfo,      // IN
+    TPML_PCR_SELECTION       *creationPCR,      // IN
+    TSS_RESP_BUFFER          *respBuffer,       // OUT: Buffer the views point into
+    TPM_HANDLE               *objectHandle,     // OUT
+    TSS_PUBLIC_VIEW          *outPublic         // OUT
+);
+
+// Asynchronous TPM2_CreatePrimary(). TPM2_CreatePrimaryComplete() returns
+// TSS_E_TPM_PENDING until the response is available, see TSS_PreparedHMACSubmit().
+TPM_RC TPM2_CreatePrimarySubmit(
+    TSS_DEVICE               *tpm,              // IN/OUT
+    TSS_SESSION              *session,          // IN/OUT
+    TPMI_DH_OBJECT            primaryHandle,    // IN
+    TPM2B_SENSITIVE_CREATE   *inSensitive,      // IN
+    TPM2B_PUBLIC             *inPublic,         // IN
+    TPM2B_DATA               *outsideInfo,      // IN
+    TPML_PCR_SELECTION       *creationPCR       // IN
+);
+
+TPM_RC TPM2_CreatePrimaryComplete(
+    TSS_DEVICE               *tpm,              // IN/OUT
+    TPM_HANDLE               *objectHandle,     // OUT
+    TPM2B_PUBLIC             *outPublic,        // OUT
+    TPM2B_CREATION_DATA      *creationData,     // OUT [opt]
+    TPM2B_DIGEST             *creationHash,     // OUT [opt]
+    TPMT_TK_CREATION         *creationTicket    // OUT [opt]
+);
+
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_EncryptDecrypt, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_DH_OBJECT, keyHandle, TPMI_YES_NO, decrypt, TPM_ALG_ID, cipherMode, TPM2B_IV*, ivIn, TPM2B_MAX_BUFFER*, inData, TPM2B_MAX_BUFFER*, outData, TPM2B_IV*, ivOut);
 
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_EvictControl, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_RH_PROVISION, auth, TPMI_DH_OBJECT, objectHandle, TPMI_DH_PERSISTENT, persistentHandle);
@@ -238,6 +446,7 @@ TPM2_HMAC_Start(
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_Import, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_DH_OBJECT, parentHandle, TPM2B_DATA*, encryptionKey, TPM2B_PUBLIC*, objectPublic, TPM2B_PRIVATE*, duplicate, TPM2B_ENCRYPTED_SECRET*, inSymSeed, TPMT_SYM_DEF_OBJECT*, symmetricAlg, TPM2B_PRIVATE*, outPrivate);
 
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_Load, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_DH_OBJECT, parentHandle, TPM2B_PRIVATE*, inPrivate, TPM2B_PUBLIC*, inPublic, TPM_HANDLE*, objectHandle, TPM2B_NAME*, name);
+MOCKABLE_FUNCTION(, TPM_RC, TPM2_LoadView, TSS_DEVICE*, tpm, TSS_SESSION*, session, TPMI_DH_OBJECT, parentHandle, TPM2B_PRIVATE*, inPrivate, TPM2B_PUBLIC*, inPublic, TSS_RESP_BUFFER*, respBuffer, TPM_HANDLE*, objectHandle, TSS_BYTES_VIEW*, name);
 
 TPM_RC
 TPM2_PolicySecret(
@@ -254,6 +463,7 @@ TPM2_PolicySecret(
 );
 
 MOCKABLE_FUNCTION(, TPM_RC, TPM2_ReadPublic, TSS_DEVICE*, tpm, TPMI_DH_OBJECT, objectHandle, TPM2B_PUBLIC*, outPublic, TPM2B_NAME*, name, TPM2B_NAME*, qualifiedName);
+MOCKABLE_FUNCTION(, TPM_RC, TPM2_ReadPublicView, TSS_DEVICE*, tpm, TPMI_DH_OBJECT, objectHandle, TSS_RESP_BUFFER*, respBuffer, TSS_PUBLIC_VIEW*, outPublic, TSS_BYTES_VIEW*, name, TSS_BYTES_VIEW*, qualifiedName);
 
 TPM_RC
 TPM2_StartAuthSession(
@@ -293,6 +503,20 @@ TSS_BuildCommand(
     INT32            bufCapacity    // IN: Capacity of 'cmdBuffer' in bytes
 );
 
+TPM_RC
+TSS_BuildCommandInPlace(
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    BYTE            *params,        // IN: Marshaled command parameters
+    INT32            paramsSize,    // IN: Size of 'params' in bytes
+    INT32            reservedSize,  // IN: Number of bytes available in front of 'params'
+    BYTE           **cmdBuffer,     // OUT: Beginning of the command ready for sending to TPM
+    UINT32          *cmdSize        // OUT: Size of the command in bytes
+);
+
 TSS_STATUS
 TSS_SendCommand(
     TSS_DEVICE  *tpm,               // IN: TPM device
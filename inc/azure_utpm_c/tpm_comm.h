@@ -18,7 +18,8 @@ extern "C" {
 #define TPM_COMM_TYPE_VALUES    \
     TPM_COMM_TYPE_EMULATOR,     \
     TPM_COMM_TYPE_WINDOW,       \
-    TPM_COMM_TYPE_LINUX
+    TPM_COMM_TYPE_LINUX,        \
+    TPM_COMM_TYPE_LOOPBACK
 
 MU_DEFINE_ENUM(TPM_COMM_TYPE, TPM_COMM_TYPE_VALUES);
 
@@ -30,6 +31,68 @@ MOCKABLE_FUNCTION(, void, tpm_comm_destroy, TPM_COMM_HANDLE, handle);
 MOCKABLE_FUNCTION(, TPM_COMM_TYPE, tpm_comm_get_type, TPM_COMM_HANDLE, handle);
 MOCKABLE_FUNCTION(, int, tpm_comm_submit_command, TPM_COMM_HANDLE, handle, const unsigned char*, cmd_bytes, uint32_t, bytes_len, unsigned char*, response, uint32_t*, resp_len);
 
+// Returned by tpm_comm_complete_command() while the TPM is still executing the command
+#define TPM_COMM_PENDING        (-1)
+
+// Asynchronous command submission. Only one command may be outstanding per handle, and
+// the command buffer must stay valid until tpm_comm_complete_command() returns something
+// other than TPM_COMM_PENDING.
+MOCKABLE_FUNCTION(, int, tpm_comm_submit_command_async, TPM_COMM_HANDLE, handle, const unsigned char*, cmd_bytes, uint32_t, bytes_len);
+MOCKABLE_FUNCTION(, int, tpm_comm_complete_command, TPM_COMM_HANDLE, handle, unsigned char*, response, uint32_t*, resp_len);
+
+// Returns a descriptor that becomes readable when the response to the outstanding command
+// is available, or -1 if the transport cannot be polled (tpm_comm_complete_command() then
+// blocks until the command is executed).
+MOCKABLE_FUNCTION(, int, tpm_comm_get_poll_fd, TPM_COMM_HANDLE, handle);
+
+// Operations of a backend. By default the library is built with a single backend that
+// implements the functions above directly. Built with USE_TPM_COMM_RUNTIME (the
+// use_tpm_comm_runtime cmake option) the functions above dispatch to the operations of
+// the backend that created the handle, so several backends can be used by one binary.
+//
+// The asynchronous operations are optional: without them tpm_comm_submit_command_async()
+// and tpm_comm_complete_command() fail, and tpm_comm_get_poll_fd() returns -1.
+// The handles returned by 'create' must start with a 'const TPM_COMM_OPS*' member, which
+// tpm_comm sets to the operations of the backend.
+typedef struct TPM_COMM_OPS_TAG
+{
+    const char* name;
+    TPM_COMM_HANDLE(*create)(const char* endpoint);
+    void(*destroy)(TPM_COMM_HANDLE handle);
+    TPM_COMM_TYPE(*get_type)(TPM_COMM_HANDLE handle);
+    int(*submit_command)(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len);
+    int(*submit_command_async)(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len);
+    int(*complete_command)(TPM_COMM_HANDLE handle, unsigned char* response, uint32_t* resp_len);
+    int(*get_poll_fd)(TPM_COMM_HANDLE handle);
+} TPM_COMM_OPS;
+
+#ifdef USE_TPM_COMM_RUNTIME
+#define TPM_COMM_MAX_BACKENDS   8
+
+// Adds a backend that tpm_comm_find_backend() can find by its name. A backend of the
+// same name is replaced. Not thread safe, backends are registered at startup.
+MOCKABLE_FUNCTION(, int, tpm_comm_register_backend, const TPM_COMM_OPS*, ops);
+
+// Returns the registered backend called 'name', or the default backend of the build if
+// it has that name, NULL otherwise
+MOCKABLE_FUNCTION(, const TPM_COMM_OPS*, tpm_comm_find_backend, const char*, name);
+
+// Creates a handle on the backend 'ops', NULL for the default backend of the build
+// (the one tpm_comm_create() uses)
+MOCKABLE_FUNCTION(, TPM_COMM_HANDLE, tpm_comm_create_with_backend, const TPM_COMM_OPS*, ops, const char*, endpoint);
+
+// Operations of the backends of the library, available when they are built in
+MOCKABLE_FUNCTION(, const TPM_COMM_OPS*, tpm_comm_emulator_get_ops);
+MOCKABLE_FUNCTION(, const TPM_COMM_OPS*, tpm_comm_linux_get_ops);
+MOCKABLE_FUNCTION(, const TPM_COMM_OPS*, tpm_comm_win32_get_ops);
+MOCKABLE_FUNCTION(, const TPM_COMM_OPS*, tpm_comm_loopback_get_ops);
+
+// First member of the handles of the backends of the library
+#define TPM_COMM_OPS_MEMBER     const TPM_COMM_OPS* ops;
+#else
+#define TPM_COMM_OPS_MEMBER
+#endif // USE_TPM_COMM_RUNTIME
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
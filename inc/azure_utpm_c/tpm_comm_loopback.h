@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TPM_COMM_LOOPBACK_H
+#define TPM_COMM_LOOPBACK_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif /* __cplusplus */
+
+#include "umock_c/umock_c_prod.h"
+#include "azure_utpm_c/tpm_comm.h"
+
+// The loopback backend (TPM_COMM_TYPE_LOOPBACK) answers the commands in process
+// instead of sending them to a TPM, so that the client side cost of the codec can
+// be measured without the latency of a device. By default the commands are answered
+// with canned responses: GetCapability (TPM_CAP_TPM_PROPERTIES), HMAC, HMAC_Start,
+// HashSequenceStart, SequenceUpdate, SequenceComplete, Hash, ReadPublic,
+// CreatePrimary, Load, EvictControl, FlushContext, StartAuthSession, PolicySecret,
+// ActivateCredential, Sign, GetRandom and Startup. Other commands succeed without
+// response parameters.
+
+// Answers the command 'cmd_bytes' with the response in 'response' (of *resp_len bytes
+// on input, set to the size of the response on output). Returns 0 on success,
+// TPM_LOOPBACK_USE_CANNED to answer the command with the canned response instead, or
+// any other value to fail the command submission.
+typedef int(*TPM_LOOPBACK_RESPONDER)(void* context, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len);
+
+#define TPM_LOOPBACK_USE_CANNED     1
+
+// The functions below only apply to a loopback handle. With USE_TPM_COMM_RUNTIME,
+// the setters fail and the counters are 0 for the handle of another backend.
+
+// Installs the responder of the commands, NULL restores the canned responses
+MOCKABLE_FUNCTION(, int, tpm_comm_loopback_set_responder, TPM_COMM_HANDLE, handle, TPM_LOOPBACK_RESPONDER, responder, void*, context);
+
+// Delays every response by 'latency_us' microseconds, to model the execution time of a TPM
+MOCKABLE_FUNCTION(, int, tpm_comm_loopback_set_latency, TPM_COMM_HANDLE, handle, uint32_t, latency_us);
+
+// Controls whether the canned TPM2_ReadPublic finds the object (otherwise it fails with
+// TPM_RC_HANDLE until the object is persisted by TPM2_EvictControl). Set by default.
+MOCKABLE_FUNCTION(, int, tpm_comm_loopback_set_key_present, TPM_COMM_HANDLE, handle, bool, present);
+
+// Number of commands answered since the handle was created
+MOCKABLE_FUNCTION(, uint32_t, tpm_comm_loopback_get_command_count, TPM_COMM_HANDLE, handle);
+
+// Number of command and response bytes exchanged since the handle was created
+MOCKABLE_FUNCTION(, uint64_t, tpm_comm_loopback_get_byte_count, TPM_COMM_HANDLE, handle);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // TPM_COMM_LOOPBACK_H
@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TPM_DISPATCHER_H
+#define TPM_DISPATCHER_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif /* __cplusplus */
+
+#include "umock_c/umock_c_prod.h"
+#include "azure_utpm_c/tpm_comm.h"
+
+// The dispatcher owns a thread that executes the commands submitted from any number of
+// threads against a single TPM_COMM_HANDLE, one at a time and in submission order.
+// Submission does not take a lock; callers only marshal their command before and
+// unmarshal the response after, so the TPM I/O is the only serialized part.
+
+typedef struct TPM_DISPATCHER_TAG* TPM_DISPATCHER_HANDLE;
+
+// Invoked on the dispatcher thread with the result of tpm_comm_submit_command()
+typedef void(*TPM_DISPATCH_COMPLETE)(void* context, int result);
+
+typedef struct TPM_DISPATCH_REQUEST_TAG
+{
+    const unsigned char* cmd_bytes;
+    uint32_t cmd_len;
+    unsigned char* response;
+    // IN: capacity of 'response', OUT: size of the response
+    uint32_t* resp_len;
+
+    TPM_DISPATCH_COMPLETE on_complete;
+    void* context;
+
+    // Link in the dispatcher queue
+    struct TPM_DISPATCH_REQUEST_TAG* next;
+} TPM_DISPATCH_REQUEST;
+
+MOCKABLE_FUNCTION(, TPM_DISPATCHER_HANDLE, tpm_dispatcher_create, TPM_COMM_HANDLE, comm_handle);
+// Executes the requests still queued and stops the dispatcher thread. No request may be
+// submitted concurrently with or after this call.
+MOCKABLE_FUNCTION(, void, tpm_dispatcher_destroy, TPM_DISPATCHER_HANDLE, handle);
+
+// Queues 'request', which must stay valid until its on_complete callback is invoked
+MOCKABLE_FUNCTION(, int, tpm_dispatcher_submit, TPM_DISPATCHER_HANDLE, handle, TPM_DISPATCH_REQUEST*, request);
+
+// Queues the command and blocks the calling thread until it is executed
+MOCKABLE_FUNCTION(, int, tpm_dispatcher_execute, TPM_DISPATCHER_HANDLE, handle, const unsigned char*, cmd_bytes, uint32_t, bytes_len, unsigned char*, response, uint32_t*, resp_len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // TPM_DISPATCHER_H
@@ -17,12 +17,30 @@ extern "C" {
 
 typedef struct TPM_SOCKET_INFO_TAG* TPM_SOCKET_HANDLE;
 
+// Maximum number of buffers sent by one tpm_socket_send_vector call
+#define TPM_SOCKET_MAX_BUFFERS      8
+
+typedef struct TPM_SOCKET_BUFFER_TAG
+{
+    const unsigned char* bytes;
+    uint32_t length;
+} TPM_SOCKET_BUFFER;
+
+// Prefix of the addresses of unix domain sockets, e.g. "unix:/run/tpm/sim.sock"
+#define TPM_SOCKET_UNIX_PREFIX      "unix:"
+
+// Connects to 'address':'port' over TCP, or to the unix domain socket of an address
+// starting with TPM_SOCKET_UNIX_PREFIX, in which case 'port' is ignored
 MOCKABLE_FUNCTION(, TPM_SOCKET_HANDLE, tpm_socket_create, const char*, address, unsigned short, port);
 MOCKABLE_FUNCTION(, void, tpm_socket_destroy, TPM_SOCKET_HANDLE, handle);
 
 MOCKABLE_FUNCTION(, int, tpm_socket_read, TPM_SOCKET_HANDLE, handle, unsigned char*, tpm_bytes, uint32_t, bytes_len);
 MOCKABLE_FUNCTION(, int, tpm_socket_send, TPM_SOCKET_HANDLE, handle, const unsigned char*, cmd_val, uint32_t, byte_len);
 
+// Sends the 'count' buffers, in order, with a single gathering write, so that a framed
+// message leaves in as few segments as possible
+MOCKABLE_FUNCTION(, int, tpm_socket_send_vector, TPM_SOCKET_HANDLE, handle, const TPM_SOCKET_BUFFER*, buffers, size_t, count);
+
 
 #ifdef __cplusplus
 }
@@ -25,4 +25,46 @@ cmake --build . -- --jobs=$(nproc)
 ctest -C "debug" -V
 
 popd
+
+# Library built with the table driven marshaling engine
+schema_build_folder=$build_root"/cmake/utpm_linux_schema"
+rm -r -f $schema_build_folder
+mkdir -p $schema_build_folder
+pushd $schema_build_folder
+cmake ../.. -Drun_unittests:BOOL=ON -Drun_valgrind:BOOL=ON -Duse_marshal_schema:BOOL=ON
+cmake --build . -- --jobs=$(nproc)
+ctest -C "debug" -V
+
+popd
+
+# Library built with the smaller algorithm profiles, with the warnings as errors
+for profile in ECC_ONLY HMAC_ONLY
+do
+    profile_build_folder=$build_root"/cmake/utpm_linux_"$profile
+    rm -r -f $profile_build_folder
+    mkdir -p $profile_build_folder
+    pushd $profile_build_folder
+    cmake ../.. -Dutpm_alg_profile:STRING=$profile -Dutpm_warnings_as_errors:BOOL=ON
+    cmake --build . -- --jobs=$(nproc)
+    popd
+done
+
+# Library built with every tpm_comm backend selected at runtime, defaulting to the
+# platform backend and to the loopback backend, with the warnings as errors
+for default_backend in platform loopback
+do
+    runtime_build_folder=$build_root"/cmake/utpm_linux_runtime_"$default_backend
+    runtime_options="-Duse_tpm_comm_runtime:BOOL=ON -Dutpm_warnings_as_errors:BOOL=ON"
+    if [ "$default_backend" = "loopback" ]
+    then
+        runtime_options="$runtime_options -Duse_loopback_tpm:BOOL=ON"
+    fi
+    rm -r -f $runtime_build_folder
+    mkdir -p $runtime_build_folder
+    pushd $runtime_build_folder
+    cmake ../.. $runtime_options
+    cmake --build . -- --jobs=$(nproc)
+    popd
+done
+
 :
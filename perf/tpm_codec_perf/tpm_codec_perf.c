@@ -0,0 +1,305 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Measures the client side cost of the codec: time per operation and peak stack
+// usage of SignData() and TSS_CreatePersistentKey(), and compares ad-hoc TSS_HMAC()
+// with the prepared TPM2_HMAC command and TPM2_ReadPublic() with its view variant,
+// also with the TPM I/O going through the dispatcher thread. The TPM is replaced by
+// the loopback tpm_comm backend (tpm_comm_loopback.c), which can delay every
+// response by a given number of microseconds to model the execution time of a TPM:
+//
+//   tpm_codec_perf [iterations] [latency_us]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#endif
+
+#include "azure_utpm_c/tpm_codec.h"
+#include "azure_utpm_c/tpm_comm_loopback.h"
+
+#define DEFAULT_ITERATIONS      20000
+#define PERF_STACK_SIZE         (256 * 1024)
+#define PERF_STACK_FILL         0xA5
+#define SRK_HANDLE              (HR_PERSISTENT | 0x00000001)
+#define DPS_ID_KEY_HANDLE       (HR_PERSISTENT | 0x00000100)
+#define HMAC_DATA_SIZE          64
+
+typedef int(*PERF_OPERATION)(TSS_DEVICE* tpm);
+
+typedef struct PERF_TEST_TAG
+{
+    const char* name;
+    PERF_OPERATION operation;
+} PERF_TEST;
+
+static TSS_SESSION g_null_pw_session;
+static BYTE g_token[2048];
+static BYTE g_signature[64];
+static TPM2B_PUBLIC g_srk_template;
+static TSS_PREPARED_CMD_HANDLE g_prepared_hmac;
+
+static double get_time_ns(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+static int sign_short_token(TSS_DEVICE* tpm)
+{
+    return SignData(tpm, &g_null_pw_session, g_token, 64, g_signature, sizeof(g_signature)) == 32 ? 0 : __LINE__;
+}
+
+static int sign_long_token(TSS_DEVICE* tpm)
+{
+    return SignData(tpm, &g_null_pw_session, g_token, sizeof(g_token), g_signature, sizeof(g_signature)) == 32 ? 0 : __LINE__;
+}
+
+static int hmac_ad_hoc(TSS_DEVICE* tpm)
+{
+    TPM2B_DIGEST digest;
+    return TSS_HMAC(tpm, &g_null_pw_session, DPS_ID_KEY_HANDLE, g_token, HMAC_DATA_SIZE, &digest) == TPM_RC_SUCCESS ? 0 : __LINE__;
+}
+
+static int hmac_prepared(TSS_DEVICE* tpm)
+{
+    TPM2B_DIGEST digest;
+    return TSS_PreparedHMAC(tpm, g_prepared_hmac, g_token, HMAC_DATA_SIZE, &digest) == TPM_RC_SUCCESS ? 0 : __LINE__;
+}
+
+static int read_persistent_key(TSS_DEVICE* tpm)
+{
+    TPM2B_PUBLIC outPub;
+    (void)tpm_comm_loopback_set_key_present(tpm->tpm_comm_handle, true);
+    return TSS_CreatePersistentKey(tpm, SRK_HANDLE, &g_null_pw_session, TPM_RH_OWNER, &g_srk_template, &outPub) == SRK_HANDLE ? 0 : __LINE__;
+}
+
+static int create_persistent_key(TSS_DEVICE* tpm)
+{
+    TPM2B_PUBLIC outPub;
+    (void)tpm_comm_loopback_set_key_present(tpm->tpm_comm_handle, false);
+    return TSS_CreatePersistentKey(tpm, SRK_HANDLE, &g_null_pw_session, TPM_RH_OWNER, &g_srk_template, &outPub) == SRK_HANDLE ? 0 : __LINE__;
+}
+
+static int read_public_decoded(TSS_DEVICE* tpm)
+{
+    TPM2B_PUBLIC outPub;
+    TPM2B_NAME name;
+    TPM2B_NAME qualifiedName;
+    (void)tpm_comm_loopback_set_key_present(tpm->tpm_comm_handle, true);
+    return TPM2_ReadPublic(tpm, SRK_HANDLE, &outPub, &name, &qualifiedName) == TPM_RC_SUCCESS ? 0 : __LINE__;
+}
+
+static int read_public_view(TSS_DEVICE* tpm)
+{
+    TSS_RESP_BUFFER respBuffer;
+    TSS_PUBLIC_VIEW outPub;
+    TSS_BYTES_VIEW name;
+    TSS_BYTES_VIEW qualifiedName;
+    TSS_BYTES_VIEW unique;
+    (void)tpm_comm_loopback_set_key_present(tpm->tpm_comm_handle, true);
+    return TPM2_ReadPublicView(tpm, SRK_HANDLE, &respBuffer, &outPub, &name, &qualifiedName) == TPM_RC_SUCCESS &&
+           TSS_PublicViewGetUnique(&outPub, &unique, NULL) == TPM_RC_SUCCESS ? 0 : __LINE__;
+}
+
+static int no_operation(TSS_DEVICE* tpm)
+{
+    (void)tpm;
+    return 0;
+}
+
+static const PERF_TEST g_tests[] =
+{
+    { "SignData (64 byte token)", sign_short_token },
+    { "SignData (2048 byte token)", sign_long_token },
+    { "TSS_HMAC (64 bytes, ad hoc)", hmac_ad_hoc },
+    { "TSS_PreparedHMAC (64 bytes)", hmac_prepared },
+    { "TSS_CreatePersistentKey (existing)", read_persistent_key },
+    { "TSS_CreatePersistentKey (new)", create_persistent_key },
+    { "TPM2_ReadPublic (decoded)", read_public_decoded },
+    { "TPM2_ReadPublicView (+ unique)", read_public_view }
+};
+
+#ifndef WIN32
+typedef struct STACK_PROBE_TAG
+{
+    TSS_DEVICE* tpm;
+    PERF_OPERATION operation;
+    int result;
+} STACK_PROBE;
+
+static void* run_stack_probe(void* context)
+{
+    STACK_PROBE* probe = (STACK_PROBE*)context;
+    probe->result = probe->operation(probe->tpm);
+    return NULL;
+}
+
+// Runs the operation on a thread whose stack is pre-filled with a known pattern,
+// and returns the number of bytes of the stack that were overwritten.
+static size_t measure_stack(TSS_DEVICE* tpm, PERF_OPERATION operation)
+{
+    size_t result = 0;
+    unsigned char* stack = (unsigned char*)malloc(PERF_STACK_SIZE);
+    if (stack != NULL)
+    {
+        pthread_attr_t attr;
+        pthread_t thread;
+        STACK_PROBE probe;
+
+        memset(stack, PERF_STACK_FILL, PERF_STACK_SIZE);
+        probe.tpm = tpm;
+        probe.operation = operation;
+        probe.result = 0;
+
+        if (pthread_attr_init(&attr) == 0)
+        {
+            if (pthread_attr_setstack(&attr, stack, PERF_STACK_SIZE) == 0 &&
+                pthread_create(&thread, &attr, run_stack_probe, &probe) == 0)
+            {
+                size_t untouched = 0;
+                (void)pthread_join(thread, NULL);
+
+                // The stack grows down, so the untouched part is at the start of the buffer
+                while (untouched < PERF_STACK_SIZE && stack[untouched] == PERF_STACK_FILL)
+                {
+                    untouched++;
+                }
+                result = PERF_STACK_SIZE - untouched;
+            }
+            (void)pthread_attr_destroy(&attr);
+        }
+        free(stack);
+    }
+    return result;
+}
+#endif
+
+static int run_tests(const char* title, TSS_DEVICE* tpm, size_t iterations)
+{
+    int result = 0;
+    size_t index;
+#ifndef WIN32
+    // Stack used by the thread start up, subtracted from the measurements
+    size_t baseline_stack = measure_stack(tpm, no_operation);
+#endif
+
+    (void)printf("%s\n", title);
+    for (index = 0; index < sizeof(g_tests) / sizeof(g_tests[0]) && result == 0; index++)
+    {
+        size_t iter;
+        uint32_t commands = tpm_comm_loopback_get_command_count(tpm->tpm_comm_handle);
+        double start = get_time_ns();
+        for (iter = 0; iter < iterations && result == 0; iter++)
+        {
+            result = g_tests[index].operation(tpm);
+        }
+        if (result != 0)
+        {
+            (void)printf("  %-36s FAILED (line %d)\n", g_tests[index].name, result);
+        }
+        else
+        {
+            double elapsed = get_time_ns() - start;
+            (void)printf("  %-36s %10.1f ns/op %8.1f ns/cmd", g_tests[index].name,
+                elapsed / (double)iterations,
+                elapsed / (double)(tpm_comm_loopback_get_command_count(tpm->tpm_comm_handle) - commands));
+#ifndef WIN32
+            (void)printf("   peak stack %6lu bytes", (unsigned long)(measure_stack(tpm, g_tests[index].operation) - baseline_stack));
+#endif
+            (void)printf("\n");
+        }
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    int result;
+    size_t iterations = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : DEFAULT_ITERATIONS;
+    uint32_t latency_us = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 0;
+    TPM2B_AUTH null_auth = { 0 };
+    TSS_DEVICE tpm_device = { 0 };
+    TPM_HANDLE hmac_key = DPS_ID_KEY_HANDLE;
+    TSS_SESSION* hmac_sessions[] = { &g_null_pw_session };
+
+    memset(g_token, 0x42, sizeof(g_token));
+    memset(&g_srk_template, 0, sizeof(g_srk_template));
+    g_srk_template.publicArea.type = TPM_ALG_RSA;
+    g_srk_template.publicArea.nameAlg = TPM_ALG_SHA256;
+    g_srk_template.publicArea.objectAttributes = ToTpmaObject(FixedTPM | FixedParent | SensitiveDataOrigin | UserWithAuth | NoDA | Restricted | Decrypt);
+    g_srk_template.publicArea.parameters.rsaDetail.symmetric.algorithm = TPM_ALG_AES;
+    g_srk_template.publicArea.parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    g_srk_template.publicArea.parameters.rsaDetail.symmetric.mode.aes = TPM_ALG_CFB;
+    g_srk_template.publicArea.parameters.rsaDetail.scheme.scheme = TPM_ALG_NULL;
+    g_srk_template.publicArea.parameters.rsaDetail.keyBits = 2048;
+
+    if (iterations == 0)
+    {
+        (void)printf("usage: %s [iterations] [latency_us]\n", argv[0]);
+        result = __LINE__;
+    }
+    else if (TSS_CreatePwAuthSession(&null_auth, &g_null_pw_session) != TPM_RC_SUCCESS)
+    {
+        (void)printf("Failure creating password session\n");
+        result = __LINE__;
+    }
+    else if ((g_prepared_hmac = TSS_PrepareCommand(TPM_CC_HMAC, &hmac_key, 1, hmac_sessions, 1)) == NULL)
+    {
+        (void)printf("Failure preparing HMAC command\n");
+        result = __LINE__;
+    }
+    else if (Initialize_TPM_Codec(&tpm_device) != TPM_RC_SUCCESS)
+    {
+        (void)printf("Failure initializing the codec\n");
+        TSS_DestroyPreparedCommand(g_prepared_hmac);
+        result = __LINE__;
+    }
+    else
+    {
+        TSS_CMD_CONTEXT_POOL_HANDLE pool = tpm_device.CmdCtxPool;
+
+        (void)tpm_comm_loopback_set_latency(tpm_device.tpm_comm_handle, latency_us);
+        (void)printf("%lu iterations, %lu us TPM latency\n", (unsigned long)iterations, (unsigned long)latency_us);
+        result = run_tests("Pooled command contexts", &tpm_device, iterations);
+        if (result == 0)
+        {
+            // Without a pool every command allocates its context from the heap
+            tpm_device.CmdCtxPool = NULL;
+            result = run_tests("Per command contexts", &tpm_device, iterations);
+            tpm_device.CmdCtxPool = pool;
+        }
+        if (result == 0)
+        {
+            // The TPM I/O is handed off to the dispatcher thread and back
+            if (TSS_StartDispatcher(&tpm_device) != TPM_RC_SUCCESS)
+            {
+                (void)printf("Failure starting the dispatcher\n");
+                result = __LINE__;
+            }
+            else
+            {
+                result = run_tests("Dispatcher thread", &tpm_device, iterations);
+            }
+        }
+        Deinit_TPM_Codec(&tpm_device);
+        TSS_DestroyPreparedCommand(g_prepared_hmac);
+    }
+    return result;
+}
@@ -0,0 +1,624 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Microbenchmarks of the marshaling code: marshal and unmarshal of full
+// TPM_CAP_TPM_PROPERTIES and TPM_CAP_HANDLES capability lists, RSA and ECC public
+// areas and signatures, and complete TPM2_HMAC commands through the codec (with
+// the loopback tpm_comm backend in place of a TPM). The wire images
+// are produced once by the marshalers of the same build.
+//
+// Every case is run several times and the fastest run is reported, in ns/op and in
+// bytes/s of wire data (command and response bytes for the HMAC commands). The
+// results can be written as JSON and a saved JSON report can be used as the
+// baseline of a later run:
+//
+//   utpm_marshal_bench --json > baseline.json
+//   ... change Marshal.c or tpm_codec.c ...
+//   utpm_marshal_bench --compare baseline.json
+//
+// In compare mode the program fails if a case is slower than the baseline by more
+// than the threshold (--threshold, 10% by default).
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "azure_utpm_c/tpm_codec.h"
+#include "azure_utpm_c/Marshal_fp.h"
+#include "azure_utpm_c/tpm_comm_loopback.h"
+
+#define DEFAULT_ITERATIONS      100000
+#define DEFAULT_RUNS            5
+#define DEFAULT_THRESHOLD       10.0
+#define MAX_BASELINE_SIZE       (64 * 1024)
+#define DPS_ID_KEY_HANDLE       (HR_PERSISTENT | 0x00000100)
+#define HMAC_DATA_SIZE          64
+
+typedef int(*BENCH_OPERATION)(void);
+
+typedef struct BENCH_CASE_TAG
+{
+    const char* name;
+    BENCH_OPERATION operation;
+
+    // Wire bytes processed by one operation, NULL if they are counted by the responder
+    const INT32* bytes;
+} BENCH_CASE;
+
+typedef struct BENCH_RESULT_TAG
+{
+    double ns_per_op;
+    double bytes_per_op;
+    double baseline_ns_per_op;
+} BENCH_RESULT;
+
+typedef struct BENCH_OPTIONS_TAG
+{
+    size_t iterations;
+    size_t runs;
+    bool json;
+    const char* baseline;
+    double threshold;
+} BENCH_OPTIONS;
+
+static TPMS_CAPABILITY_DATA g_capability;
+static TPMS_CAPABILITY_DATA g_handles;
+static TPM2B_PUBLIC g_rsa_public;
+static TPM2B_PUBLIC g_ecc_public;
+static TPMT_SIGNATURE g_rsa_signature;
+static TPMT_SIGNATURE g_ecc_signature;
+
+static BYTE g_capability_image[sizeof(TPMS_CAPABILITY_DATA)];
+static INT32 g_capability_size;
+static BYTE g_handles_image[sizeof(TPMS_CAPABILITY_DATA)];
+static INT32 g_handles_size;
+static BYTE g_rsa_public_image[sizeof(TPM2B_PUBLIC)];
+static INT32 g_rsa_public_size;
+static BYTE g_ecc_public_image[sizeof(TPM2B_PUBLIC)];
+static INT32 g_ecc_public_size;
+static BYTE g_rsa_signature_image[sizeof(TPMT_SIGNATURE)];
+static INT32 g_rsa_signature_size;
+static BYTE g_ecc_signature_image[sizeof(TPMT_SIGNATURE)];
+static INT32 g_ecc_signature_size;
+
+static BYTE g_output[sizeof(TPMS_CAPABILITY_DATA)];
+
+static TSS_DEVICE g_tpm;
+static TSS_SESSION g_null_pw_session;
+static TSS_PREPARED_CMD_HANDLE g_prepared_hmac;
+static BYTE g_hmac_data[HMAC_DATA_SIZE];
+
+// Keeps the compiler from discarding the decoded values
+static volatile UINT32 g_sink;
+
+static double get_time_ns(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+static int decode_capability_data(BYTE* image, INT32 imageSize)
+{
+    TPMS_CAPABILITY_DATA capData;
+    BYTE* buffer = image;
+    INT32 size = imageSize;
+    int result = TPMS_CAPABILITY_DATA_Unmarshal(&capData, &buffer, &size) == TPM_RC_SUCCESS && size == 0 ? 0 : __LINE__;
+    g_sink += capData.data.handles.count;
+    return result;
+}
+
+static int decode_properties(void)
+{
+    return decode_capability_data(g_capability_image, g_capability_size);
+}
+
+static int decode_handles(void)
+{
+    return decode_capability_data(g_handles_image, g_handles_size);
+}
+
+static int decode_public(BYTE* image, INT32 imageSize)
+{
+    TPM2B_PUBLIC outPublic;
+    BYTE* buffer = image;
+    INT32 size = imageSize;
+    int result = TPM2B_PUBLIC_Unmarshal(&outPublic, &buffer, &size, FALSE) == TPM_RC_SUCCESS && size == 0 ? 0 : __LINE__;
+    g_sink += outPublic.publicArea.unique.rsa.t.size;
+    return result;
+}
+
+static int decode_rsa_public(void)
+{
+    return decode_public(g_rsa_public_image, g_rsa_public_size);
+}
+
+static int decode_ecc_public(void)
+{
+    return decode_public(g_ecc_public_image, g_ecc_public_size);
+}
+
+static int decode_signature(BYTE* image, INT32 imageSize)
+{
+    TPMT_SIGNATURE signature;
+    BYTE* buffer = image;
+    INT32 size = imageSize;
+    int result = TPMT_SIGNATURE_Unmarshal(&signature, &buffer, &size, FALSE) == TPM_RC_SUCCESS && size == 0 ? 0 : __LINE__;
+    g_sink += signature.sigAlg;
+    return result;
+}
+
+static int decode_rsa_signature(void)
+{
+    return decode_signature(g_rsa_signature_image, g_rsa_signature_size);
+}
+
+static int decode_ecc_signature(void)
+{
+    return decode_signature(g_ecc_signature_image, g_ecc_signature_size);
+}
+
+// The marshal cases write into a bounded buffer, as the codec does
+static int encode_properties(void)
+{
+    BYTE* buffer = g_output;
+    INT32 size = sizeof(g_output);
+    return TPMS_CAPABILITY_DATA_Marshal(&g_capability, &buffer, &size) == g_capability_size ? 0 : __LINE__;
+}
+
+static int encode_handles(void)
+{
+    BYTE* buffer = g_output;
+    INT32 size = sizeof(g_output);
+    return TPMS_CAPABILITY_DATA_Marshal(&g_handles, &buffer, &size) == g_handles_size ? 0 : __LINE__;
+}
+
+static int encode_rsa_public(void)
+{
+    BYTE* buffer = g_output;
+    INT32 size = sizeof(g_output);
+    return TPM2B_PUBLIC_Marshal(&g_rsa_public, &buffer, &size) == g_rsa_public_size ? 0 : __LINE__;
+}
+
+static int encode_ecc_public(void)
+{
+    BYTE* buffer = g_output;
+    INT32 size = sizeof(g_output);
+    return TPM2B_PUBLIC_Marshal(&g_ecc_public, &buffer, &size) == g_ecc_public_size ? 0 : __LINE__;
+}
+
+static int encode_rsa_signature(void)
+{
+    BYTE* buffer = g_output;
+    INT32 size = sizeof(g_output);
+    return TPMT_SIGNATURE_Marshal(&g_rsa_signature, &buffer, &size) == g_rsa_signature_size ? 0 : __LINE__;
+}
+
+static int encode_ecc_signature(void)
+{
+    BYTE* buffer = g_output;
+    INT32 size = sizeof(g_output);
+    return TPMT_SIGNATURE_Marshal(&g_ecc_signature, &buffer, &size) == g_ecc_signature_size ? 0 : __LINE__;
+}
+
+static int hmac_ad_hoc(void)
+{
+    TPM2B_DIGEST digest;
+    return TSS_HMAC(&g_tpm, &g_null_pw_session, DPS_ID_KEY_HANDLE, g_hmac_data, HMAC_DATA_SIZE, &digest) == TPM_RC_SUCCESS ? 0 : __LINE__;
+}
+
+static int hmac_prepared(void)
+{
+    TPM2B_DIGEST digest;
+    return TSS_PreparedHMAC(&g_tpm, g_prepared_hmac, g_hmac_data, HMAC_DATA_SIZE, &digest) == TPM_RC_SUCCESS ? 0 : __LINE__;
+}
+
+static const BENCH_CASE g_cases[] =
+{
+    { "unmarshal TPMS_CAPABILITY_DATA (properties)", decode_properties, &g_capability_size },
+    { "marshal TPMS_CAPABILITY_DATA (properties)", encode_properties, &g_capability_size },
+    { "unmarshal TPMS_CAPABILITY_DATA (handles)", decode_handles, &g_handles_size },
+    { "marshal TPMS_CAPABILITY_DATA (handles)", encode_handles, &g_handles_size },
+    { "unmarshal TPM2B_PUBLIC (RSA 2048)", decode_rsa_public, &g_rsa_public_size },
+    { "marshal TPM2B_PUBLIC (RSA 2048)", encode_rsa_public, &g_rsa_public_size },
+    { "unmarshal TPM2B_PUBLIC (ECC P256)", decode_ecc_public, &g_ecc_public_size },
+    { "marshal TPM2B_PUBLIC (ECC P256)", encode_ecc_public, &g_ecc_public_size },
+    { "unmarshal TPMT_SIGNATURE (RSASSA 2048)", decode_rsa_signature, &g_rsa_signature_size },
+    { "marshal TPMT_SIGNATURE (RSASSA 2048)", encode_rsa_signature, &g_rsa_signature_size },
+    { "unmarshal TPMT_SIGNATURE (ECDSA P256)", decode_ecc_signature, &g_ecc_signature_size },
+    { "marshal TPMT_SIGNATURE (ECDSA P256)", encode_ecc_signature, &g_ecc_signature_size },
+    { "TPM2_HMAC command (64 bytes, ad hoc)", hmac_ad_hoc, NULL },
+    { "TPM2_HMAC command (64 bytes, prepared)", hmac_prepared, NULL }
+};
+
+#define BENCH_CASE_COUNT    (sizeof(g_cases) / sizeof(g_cases[0]))
+
+static void init_capability_data(TPMS_CAPABILITY_DATA* capData, TPM_CAP capability)
+{
+    UINT32 index;
+
+    memset(capData, 0, sizeof(*capData));
+    capData->capability = capability;
+    if (capability == TPM_CAP_TPM_PROPERTIES)
+    {
+        capData->data.tpmProperties.count = MAX_TPM_PROPERTIES;
+        for (index = 0; index < MAX_TPM_PROPERTIES; index++)
+        {
+            capData->data.tpmProperties.tpmProperty[index].property = PT_FIXED + index;
+            capData->data.tpmProperties.tpmProperty[index].value = 0x01000000 + index;
+        }
+    }
+    else
+    {
+        capData->data.handles.count = MAX_CAP_HANDLES;
+        for (index = 0; index < MAX_CAP_HANDLES; index++)
+        {
+            capData->data.handles.handle[index] = HR_PERSISTENT + index;
+        }
+    }
+}
+
+static void init_public(TPM2B_PUBLIC* inPublic, TPMI_ALG_PUBLIC type)
+{
+    TPMT_PUBLIC* area = &inPublic->publicArea;
+
+    memset(inPublic, 0, sizeof(*inPublic));
+    area->type = type;
+    area->nameAlg = TPM_ALG_SHA256;
+    area->objectAttributes.fixedTPM = 1;
+    area->objectAttributes.fixedParent = 1;
+    area->objectAttributes.sensitiveDataOrigin = 1;
+    area->objectAttributes.userWithAuth = 1;
+    area->objectAttributes.restricted = 1;
+    area->objectAttributes.decrypt = 1;
+    if (type == TPM_ALG_RSA)
+    {
+        area->parameters.rsaDetail.symmetric.algorithm = TPM_ALG_AES;
+        area->parameters.rsaDetail.symmetric.keyBits.aes = 128;
+        area->parameters.rsaDetail.symmetric.mode.aes = TPM_ALG_CFB;
+        area->parameters.rsaDetail.scheme.scheme = TPM_ALG_NULL;
+        area->parameters.rsaDetail.keyBits = 2048;
+        area->unique.rsa.t.size = 256;
+        memset(area->unique.rsa.t.buffer, 0x5A, 256);
+    }
+    else
+    {
+        area->parameters.eccDetail.symmetric.algorithm = TPM_ALG_AES;
+        area->parameters.eccDetail.symmetric.keyBits.aes = 128;
+        area->parameters.eccDetail.symmetric.mode.aes = TPM_ALG_CFB;
+        area->parameters.eccDetail.scheme.scheme = TPM_ALG_NULL;
+        area->parameters.eccDetail.curveID = TPM_ECC_NIST_P256;
+        area->parameters.eccDetail.kdf.scheme = TPM_ALG_NULL;
+        area->unique.ecc.x.t.size = 32;
+        memset(area->unique.ecc.x.t.buffer, 0x5A, 32);
+        area->unique.ecc.y.t.size = 32;
+        memset(area->unique.ecc.y.t.buffer, 0xA5, 32);
+    }
+}
+
+static void init_signature(TPMT_SIGNATURE* signature, TPMI_ALG_SIG_SCHEME sigAlg)
+{
+    memset(signature, 0, sizeof(*signature));
+    signature->sigAlg = sigAlg;
+    if (sigAlg == TPM_ALG_RSASSA)
+    {
+        signature->signature.rsassa.hash = TPM_ALG_SHA256;
+        signature->signature.rsassa.sig.t.size = 256;
+        memset(signature->signature.rsassa.sig.t.buffer, 0x5A, 256);
+    }
+    else
+    {
+        signature->signature.ecdsa.hash = TPM_ALG_SHA256;
+        signature->signature.ecdsa.signatureR.t.size = 32;
+        memset(signature->signature.ecdsa.signatureR.t.buffer, 0x5A, 32);
+        signature->signature.ecdsa.signatureS.t.size = 32;
+        memset(signature->signature.ecdsa.signatureS.t.buffer, 0xA5, 32);
+    }
+}
+
+static void init_images(void)
+{
+    BYTE* buffer;
+
+    init_capability_data(&g_capability, TPM_CAP_TPM_PROPERTIES);
+    init_capability_data(&g_handles, TPM_CAP_HANDLES);
+    init_public(&g_rsa_public, TPM_ALG_RSA);
+    init_public(&g_ecc_public, TPM_ALG_ECC);
+    init_signature(&g_rsa_signature, TPM_ALG_RSASSA);
+    init_signature(&g_ecc_signature, TPM_ALG_ECDSA);
+
+    buffer = g_capability_image;
+    g_capability_size = TPMS_CAPABILITY_DATA_Marshal(&g_capability, &buffer, NULL);
+    buffer = g_handles_image;
+    g_handles_size = TPMS_CAPABILITY_DATA_Marshal(&g_handles, &buffer, NULL);
+    buffer = g_rsa_public_image;
+    g_rsa_public_size = TPM2B_PUBLIC_Marshal(&g_rsa_public, &buffer, NULL);
+    buffer = g_ecc_public_image;
+    g_ecc_public_size = TPM2B_PUBLIC_Marshal(&g_ecc_public, &buffer, NULL);
+    buffer = g_rsa_signature_image;
+    g_rsa_signature_size = TPMT_SIGNATURE_Marshal(&g_rsa_signature, &buffer, NULL);
+    buffer = g_ecc_signature_image;
+    g_ecc_signature_size = TPMT_SIGNATURE_Marshal(&g_ecc_signature, &buffer, NULL);
+    memset(g_hmac_data, 0x42, sizeof(g_hmac_data));
+}
+
+// Runs the case 'runs' times and keeps the fastest run
+static int run_case(const BENCH_CASE* benchCase, const BENCH_OPTIONS* options, BENCH_RESULT* benchResult)
+{
+    int result = 0;
+    size_t run;
+
+    benchResult->ns_per_op = 0;
+    benchResult->bytes_per_op = 0;
+    for (run = 0; run < options->runs && result == 0; run++)
+    {
+        size_t iter;
+        uint64_t bytes = tpm_comm_loopback_get_byte_count(g_tpm.tpm_comm_handle);
+        double start = get_time_ns();
+        double elapsed;
+
+        for (iter = 0; iter < options->iterations && result == 0; iter++)
+        {
+            result = benchCase->operation();
+        }
+        elapsed = (get_time_ns() - start) / (double)options->iterations;
+        if (run == 0 || elapsed < benchResult->ns_per_op)
+        {
+            benchResult->ns_per_op = elapsed;
+        }
+        benchResult->bytes_per_op = (benchCase->bytes != NULL) ? (double)*benchCase->bytes
+            : (double)(tpm_comm_loopback_get_byte_count(g_tpm.tpm_comm_handle) - bytes) / (double)options->iterations;
+    }
+    return result;
+}
+
+// Returns the ns/op of the case 'name' in the JSON report 'baseline', or 0 if the
+// case is not in the report. Only the reports written by print_json() are understood.
+static double find_baseline(const char* baseline, const char* name)
+{
+    double result = 0;
+    const char* entry = baseline;
+    size_t nameLength = strlen(name);
+
+    while ((entry = strstr(entry, "\"name\": \"")) != NULL)
+    {
+        entry += sizeof("\"name\": \"") - 1;
+        if (strncmp(entry, name, nameLength) == 0 && entry[nameLength] == '"')
+        {
+            const char* value = strstr(entry, "\"ns_per_op\": ");
+            if (value != NULL)
+            {
+                result = strtod(value + sizeof("\"ns_per_op\": ") - 1, NULL);
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+static char* load_baseline(const char* path)
+{
+    char* result;
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        (void)fprintf(stderr, "Failure opening baseline %s\n", path);
+        result = NULL;
+    }
+    else
+    {
+        if ((result = (char*)malloc(MAX_BASELINE_SIZE + 1)) == NULL)
+        {
+            (void)fprintf(stderr, "Failure allocating baseline buffer\n");
+        }
+        else
+        {
+            size_t length = fread(result, 1, MAX_BASELINE_SIZE, file);
+            result[length] = '\0';
+        }
+        (void)fclose(file);
+    }
+    return result;
+}
+
+// Change against the baseline in percent, positive when slower
+static double get_change(const BENCH_RESULT* benchResult)
+{
+    return (benchResult->ns_per_op / benchResult->baseline_ns_per_op - 1.0) * 100.0;
+}
+
+static void print_json(const BENCH_OPTIONS* options, const BENCH_RESULT* benchResults)
+{
+    size_t index;
+
+    (void)printf("{\n");
+    (void)printf("  \"benchmark\": \"utpm_marshal_bench\",\n");
+    (void)printf("  \"iterations\": %lu,\n", (unsigned long)options->iterations);
+    (void)printf("  \"runs\": %lu,\n", (unsigned long)options->runs);
+    (void)printf("  \"results\": [\n");
+    for (index = 0; index < BENCH_CASE_COUNT; index++)
+    {
+        const BENCH_RESULT* benchResult = &benchResults[index];
+
+        (void)printf("    { \"name\": \"%s\", \"ns_per_op\": %.2f, \"bytes_per_op\": %.0f, \"bytes_per_sec\": %.0f",
+            g_cases[index].name, benchResult->ns_per_op, benchResult->bytes_per_op,
+            benchResult->bytes_per_op * 1e9 / benchResult->ns_per_op);
+        if (benchResult->baseline_ns_per_op > 0)
+        {
+            (void)printf(", \"baseline_ns_per_op\": %.2f, \"change_percent\": %.1f",
+                benchResult->baseline_ns_per_op, get_change(benchResult));
+        }
+        (void)printf(" }%s\n", (index + 1 < BENCH_CASE_COUNT) ? "," : "");
+    }
+    (void)printf("  ]\n");
+    (void)printf("}\n");
+}
+
+static void print_text(const BENCH_OPTIONS* options, const BENCH_RESULT* benchResults)
+{
+    size_t index;
+
+    (void)printf("%lu iterations, best of %lu runs\n", (unsigned long)options->iterations, (unsigned long)options->runs);
+    for (index = 0; index < BENCH_CASE_COUNT; index++)
+    {
+        const BENCH_RESULT* benchResult = &benchResults[index];
+
+        (void)printf("  %-46s %10.1f ns/op %10.1f MB/s", g_cases[index].name, benchResult->ns_per_op,
+            benchResult->bytes_per_op * 1e3 / benchResult->ns_per_op);
+        if (benchResult->baseline_ns_per_op > 0)
+        {
+            (void)printf("   baseline %10.1f ns/op %+7.1f%%", benchResult->baseline_ns_per_op, get_change(benchResult));
+        }
+        (void)printf("\n");
+    }
+}
+
+static int parse_options(int argc, char* argv[], BENCH_OPTIONS* options)
+{
+    int result = 0;
+    int index;
+
+    options->iterations = DEFAULT_ITERATIONS;
+    options->runs = DEFAULT_RUNS;
+    options->json = false;
+    options->baseline = NULL;
+    options->threshold = DEFAULT_THRESHOLD;
+    for (index = 1; index < argc && result == 0; index++)
+    {
+        if (strcmp(argv[index], "--json") == 0)
+        {
+            options->json = true;
+        }
+        else if (index + 1 >= argc)
+        {
+            result = __LINE__;
+        }
+        else if (strcmp(argv[index], "--iterations") == 0)
+        {
+            options->iterations = (size_t)strtoul(argv[++index], NULL, 10);
+        }
+        else if (strcmp(argv[index], "--runs") == 0)
+        {
+            options->runs = (size_t)strtoul(argv[++index], NULL, 10);
+        }
+        else if (strcmp(argv[index], "--compare") == 0)
+        {
+            options->baseline = argv[++index];
+        }
+        else if (strcmp(argv[index], "--threshold") == 0)
+        {
+            options->threshold = strtod(argv[++index], NULL);
+        }
+        else
+        {
+            result = __LINE__;
+        }
+    }
+    if (result == 0 && (options->iterations == 0 || options->runs == 0 || options->threshold <= 0))
+    {
+        result = __LINE__;
+    }
+    if (result != 0)
+    {
+        (void)fprintf(stderr, "usage: %s [--iterations N] [--runs N] [--json] [--compare baseline.json] [--threshold percent]\n", argv[0]);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    int result;
+    BENCH_OPTIONS options;
+    BENCH_RESULT benchResults[BENCH_CASE_COUNT];
+    TPM2B_AUTH null_auth = { 0 };
+    TPM_HANDLE hmac_key = DPS_ID_KEY_HANDLE;
+    TSS_SESSION* hmac_sessions[] = { &g_null_pw_session };
+    char* baseline = NULL;
+
+    memset(benchResults, 0, sizeof(benchResults));
+    if ((result = parse_options(argc, argv, &options)) != 0)
+    {
+        // The usage has been printed
+    }
+    else if (options.baseline != NULL && (baseline = load_baseline(options.baseline)) == NULL)
+    {
+        result = __LINE__;
+    }
+    else if (TSS_CreatePwAuthSession(&null_auth, &g_null_pw_session) != TPM_RC_SUCCESS)
+    {
+        (void)fprintf(stderr, "Failure creating password session\n");
+        result = __LINE__;
+    }
+    else if ((g_prepared_hmac = TSS_PrepareCommand(TPM_CC_HMAC, &hmac_key, 1, hmac_sessions, 1)) == NULL)
+    {
+        (void)fprintf(stderr, "Failure preparing HMAC command\n");
+        result = __LINE__;
+    }
+    else if (Initialize_TPM_Codec(&g_tpm) != TPM_RC_SUCCESS)
+    {
+        (void)fprintf(stderr, "Failure initializing the codec\n");
+        TSS_DestroyPreparedCommand(g_prepared_hmac);
+        result = __LINE__;
+    }
+    else
+    {
+        size_t index;
+        size_t regressions = 0;
+
+        init_images();
+        for (index = 0; index < BENCH_CASE_COUNT && result == 0; index++)
+        {
+            if ((result = run_case(&g_cases[index], &options, &benchResults[index])) != 0)
+            {
+                (void)fprintf(stderr, "%s FAILED (line %d)\n", g_cases[index].name, result);
+            }
+            else if (baseline != NULL)
+            {
+                benchResults[index].baseline_ns_per_op = find_baseline(baseline, g_cases[index].name);
+                if (benchResults[index].baseline_ns_per_op > 0 && get_change(&benchResults[index]) > options.threshold)
+                {
+                    regressions++;
+                }
+            }
+        }
+
+        if (result == 0)
+        {
+            if (options.json)
+            {
+                print_json(&options, benchResults);
+            }
+            else
+            {
+                print_text(&options, benchResults);
+            }
+            if (regressions != 0)
+            {
+                (void)fprintf(stderr, "%lu case(s) slower than the baseline by more than %.1f%%\n", (unsigned long)regressions, options.threshold);
+                result = __LINE__;
+            }
+        }
+        Deinit_TPM_Codec(&g_tpm);
+        TSS_DestroyPreparedCommand(g_prepared_hmac);
+    }
+    free(baseline);
+
+    // The line numbers used as failure codes could be truncated to 0 by the exit status
+    return (result == 0) ? 0 : 1;
+}
@@ -29,33 +29,20 @@ void TpmFail(
 }
 
 // Table 2:3 - Definition of Base Types (BaseTypes)
-//   UINT8 definition from table 2:3
-TPM_RC UINT8_Unmarshal(UINT8 *target, BYTE **buffer, INT32 *size)
+// The integer primitives are defined in-line and the rest of this file uses them
+// through the macros that follow the exported definitions, so that they are
+// in-lined in the structure (un)marshalers. The exported functions are kept for
+// the callers outside of this file.
+STATIC_INLINE TPM_RC UINT8_UnmarshalInline(UINT8 *target, BYTE **buffer, INT32 *size)
 {
-    TPM_RC result;
-    if (target == NULL || buffer == NULL || size == NULL)
-    {
-        LogError("invalid paramer specified");
-        result = TPM_RC_INSUFFICIENT;
-    }
-    else
-    {
-        if ((*size -= 1) < 0)
-        {
-            LogError("invalid paramer specified");
-            result = TPM_RC_INSUFFICIENT;
-        }
-        else
-        {
-            *target = BYTE_ARRAY_TO_UINT8(*buffer);
-            *buffer += 1;
-            result = TPM_RC_SUCCESS;
-        }
-    }
-    return result;
+    if ((*size -= 1) < 0)
+        return TPM_RC_INSUFFICIENT;
+    *target = BYTE_ARRAY_TO_UINT8(*buffer);
+    *buffer += 1;
+    return TPM_RC_SUCCESS;
 }
 
-UINT16 UINT8_Marshal(UINT8 *source, BYTE **buffer, INT32 *size)
+STATIC_INLINE UINT16 UINT8_MarshalInline(UINT8 *source, BYTE **buffer, INT32 *size)
 {
     if (buffer != 0)
     {
@@ -69,30 +56,16 @@ UINT16 UINT8_Marshal(UINT8 *source, BYTE **buffer, INT32 *size)
     return (1);
 }
 
-//   BYTE definition from table 2:3
-//   BYTE_Unmarshal changed to #define
-//   BYTE_Marshal changed to #define
-//   INT8 definition from table 2:3
-//   INT8_Unmarshal changed to #define
-//   INT8_Marshal changed to #define
-//   UINT16 definition from table 2:3
-TPM_RC UINT16_Unmarshal(UINT16 *target, BYTE **buffer, INT32 *size)
+STATIC_INLINE TPM_RC UINT16_UnmarshalInline(UINT16 *target, BYTE **buffer, INT32 *size)
 {
-    TPM_RC result;
     if ((*size -= 2) < 0)
-    {
-        result = TPM_RC_INSUFFICIENT;
-    }
-    else
-    {
-        *target = BYTE_ARRAY_TO_UINT16(*buffer);
-        *buffer += 2;
-        result = TPM_RC_SUCCESS;
-    }
-    return result;
+        return TPM_RC_INSUFFICIENT;
+    *target = BYTE_ARRAY_TO_UINT16(*buffer);
+    *buffer += 2;
+    return TPM_RC_SUCCESS;
 }
 
-UINT16 UINT16_Marshal(UINT16 *source, BYTE **buffer, INT32 *size)
+STATIC_INLINE UINT16 UINT16_MarshalInline(UINT16 *source, BYTE **buffer, INT32 *size)
 {
     if (buffer != 0)
     {
@@ -106,27 +79,16 @@ UINT16 UINT16_Marshal(UINT16 *source, BYTE **buffer, INT32 *size)
     return (2);
 }
 
-//   INT16 definition from table 2:3
-//   INT16_Unmarshal changed to #define
-//   INT16_Marshal changed to #define
-//   UINT32 definition from table 2:3
-TPM_RC UINT32_Unmarshal(UINT32 *target, BYTE **buffer, INT32 *size)
+STATIC_INLINE TPM_RC UINT32_UnmarshalInline(UINT32 *target, BYTE **buffer, INT32 *size)
 {
-    TPM_RC result;
     if ((*size -= 4) < 0)
-    {
-        result = TPM_RC_INSUFFICIENT;
-    }
-    else
-    {
-        *target = BYTE_ARRAY_TO_UINT32(*buffer);
-        *buffer += 4;
-        result = TPM_RC_SUCCESS;
-    }
-    return result;
+        return TPM_RC_INSUFFICIENT;
+    *target = BYTE_ARRAY_TO_UINT32(*buffer);
+    *buffer += 4;
+    return TPM_RC_SUCCESS;
 }
 
-UINT16 UINT32_Marshal(UINT32 *source, BYTE **buffer, INT32 *size)
+STATIC_INLINE UINT16 UINT32_MarshalInline(UINT32 *source, BYTE **buffer, INT32 *size)
 {
     if (buffer != 0)
     {
@@ -140,22 +102,16 @@ UINT16 UINT32_Marshal(UINT32 *source, BYTE **buffer, INT32 *size)
     return (4);
 }
 
-//   INT32 definition from table 2:3
-//   INT32_Unmarshal changed to #define
-//   INT32_Marshal changed to #define
-//   UINT64 definition from table 2:3
-TPM_RC
-UINT64_Unmarshal(UINT64 *target, BYTE **buffer, INT32 *size)
+STATIC_INLINE TPM_RC UINT64_UnmarshalInline(UINT64 *target, BYTE **buffer, INT32 *size)
 {
-    if((*size -= 8) < 0)
+    if ((*size -= 8) < 0)
         return TPM_RC_INSUFFICIENT;
     *target = BYTE_ARRAY_TO_UINT64(*buffer);
     *buffer += 8;
     return TPM_RC_SUCCESS;
 }
 
-UINT16
-UINT64_Marshal(UINT64 *source, BYTE **buffer, INT32 *size)
+STATIC_INLINE UINT16 UINT64_MarshalInline(UINT64 *source, BYTE **buffer, INT32 *size)
 {
     if (buffer != 0)
     {
@@ -169,6 +125,90 @@ UINT64_Marshal(UINT64 *source, BYTE **buffer, INT32 *size)
     return (8);
 }
 
+//   UINT8 definition from table 2:3
+TPM_RC UINT8_Unmarshal(UINT8 *target, BYTE **buffer, INT32 *size)
+{
+    return UINT8_UnmarshalInline(target, buffer, size);
+}
+
+UINT16 UINT8_Marshal(UINT8 *source, BYTE **buffer, INT32 *size)
+{
+    return UINT8_MarshalInline(source, buffer, size);
+}
+
+//   BYTE definition from table 2:3
+//   BYTE_Unmarshal changed to #define
+//   BYTE_Marshal changed to #define
+//   INT8 definition from table 2:3
+//   INT8_Unmarshal changed to #define
+//   INT8_Marshal changed to #define
+//   UINT16 definition from table 2:3
+TPM_RC UINT16_Unmarshal(UINT16 *target, BYTE **buffer, INT32 *size)
+{
+    return UINT16_UnmarshalInline(target, buffer, size);
+}
+
+UINT16 UINT16_Marshal(UINT16 *source, BYTE **buffer, INT32 *size)
+{
+    return UINT16_MarshalInline(source, buffer, size);
+}
+
+//   INT16 definition from table 2:3
+//   INT16_Unmarshal changed to #define
+//   INT16_Marshal changed to #define
+//   UINT32 definition from table 2:3
+TPM_RC UINT32_Unmarshal(UINT32 *target, BYTE **buffer, INT32 *size)
+{
+    return UINT32_UnmarshalInline(target, buffer, size);
+}
+
+UINT16 UINT32_Marshal(UINT32 *source, BYTE **buffer, INT32 *size)
+{
+    return UINT32_MarshalInline(source, buffer, size);
+}
+
+//   INT32 definition from table 2:3
+//   INT32_Unmarshal changed to #define
+//   INT32_Marshal changed to #define
+//   UINT64 definition from table 2:3
+TPM_RC
+UINT64_Unmarshal(UINT64 *target, BYTE **buffer, INT32 *size)
+{
+    return UINT64_UnmarshalInline(target, buffer, size);
+}
+
+UINT16
+UINT64_Marshal(UINT64 *source, BYTE **buffer, INT32 *size)
+{
+    return UINT64_MarshalInline(source, buffer, size);
+}
+
+#define UINT8_Unmarshal     UINT8_UnmarshalInline
+#define UINT8_Marshal       UINT8_MarshalInline
+#define UINT16_Unmarshal    UINT16_UnmarshalInline
+#define UINT16_Marshal      UINT16_MarshalInline
+#define UINT32_Unmarshal    UINT32_UnmarshalInline
+#define UINT32_Marshal      UINT32_MarshalInline
+#define UINT64_Unmarshal    UINT64_UnmarshalInline
+#define UINT64_Marshal      UINT64_MarshalInline
+
+// Structures and arrays with a fixed wire size check the remaining size once, for
+// all of their fields, and then decode the fields with the unchecked primitives.
+// Consumes 'count' elements of 'elementSize' bytes from the remaining size.
+STATIC_INLINE BOOL FixedSizeConsume(INT32 *size, INT32 count, INT32 elementSize)
+{
+    if((count < 0) || ((*size / elementSize) < count))
+        return FALSE;
+    *size -= count * elementSize;
+    return TRUE;
+}
+
+STATIC_INLINE void UINT32_UnmarshalUnchecked(UINT32 *target, BYTE **buffer)
+{
+    *target = BYTE_ARRAY_TO_UINT32(*buffer);
+    *buffer += 4;
+}
+
 //   INT64 definition from table 2:3
 //   INT64_Unmarshal changed to #define
 //   INT64_Marshal changed to #define
@@ -1821,6 +1861,7 @@ TPMT_TK_HASHCHECK_Marshal(TPMT_TK_HASHCHECK *source, BYTE **buffer, INT32 *size)
 
 
 // Table 2:93 - Definition of TPMS_ALG_PROPERTY Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMS_ALG_PROPERTY_Unmarshal(TPMS_ALG_PROPERTY *target, BYTE **buffer, INT32 *size)
 {
@@ -1840,18 +1881,27 @@ TPMS_ALG_PROPERTY_Marshal(TPMS_ALG_PROPERTY *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPMA_ALGORITHM_Marshal((TPMA_ALGORITHM *)&(source->algProperties), buffer, size));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:94 - Definition of TPMS_TAGGED_PROPERTY Structure  (StructureTable)
+#define TPMS_TAGGED_PROPERTY_WIRE_SIZE  (sizeof(TPM_PT) + sizeof(UINT32))
+
+STATIC_INLINE void
+TPMS_TAGGED_PROPERTY_UnmarshalUnchecked(TPMS_TAGGED_PROPERTY *target, BYTE **buffer)
+{
+    UINT32_UnmarshalUnchecked((UINT32 *)&(target->property), buffer);
+    UINT32_UnmarshalUnchecked((UINT32 *)&(target->value), buffer);
+}
+
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMS_TAGGED_PROPERTY_Unmarshal(TPMS_TAGGED_PROPERTY *target, BYTE **buffer, INT32 *size)
 {
-    TPM_RC    result;
-    result = TPM_PT_Unmarshal((TPM_PT *)&(target->property), buffer, size);
-    if(result != TPM_RC_SUCCESS)
-        return result;
-    result = UINT32_Unmarshal((UINT32 *)&(target->value), buffer, size);
-    return result;
+    if(!FixedSizeConsume(size, 1, TPMS_TAGGED_PROPERTY_WIRE_SIZE))
+        return TPM_RC_INSUFFICIENT;
+    TPMS_TAGGED_PROPERTY_UnmarshalUnchecked(target, buffer);
+    return TPM_RC_SUCCESS;
 }
 
 UINT16
@@ -1862,6 +1912,7 @@ TPMS_TAGGED_PROPERTY_Marshal(TPMS_TAGGED_PROPERTY *source, BYTE **buffer, INT32
     result = (UINT16)(result + UINT32_Marshal((UINT32 *)&(source->value), buffer, size));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:95 - Definition of TPMS_TAGGED_PCR_SELECT Structure  (StructureTable)
@@ -1917,6 +1968,7 @@ TPMS_TAGGED_POLICY_Marshal(TPMS_TAGGED_POLICY *source, BYTE **buffer, INT32 *siz
 
 
 // Table 2:97 - Definition of TPML_CC Structure (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_CC_Unmarshal(TPML_CC *target, BYTE **buffer, INT32 *size)
 {
@@ -1938,9 +1990,11 @@ TPML_CC_Marshal(TPML_CC *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPM_CC_Array_Marshal((TPM_CC *)(source->commandCodes), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:98 - Definition of TPML_CCA Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_CCA_Unmarshal(TPML_CCA *target, BYTE **buffer, INT32 *size)
 {
@@ -1962,6 +2016,7 @@ TPML_CCA_Marshal(TPML_CCA *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPMA_CC_Array_Marshal((TPMA_CC *)(source->commandAttributes), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:99 - Definition of TPML_ALG Structure (StructureTable)
@@ -1989,6 +2044,7 @@ TPML_ALG_Marshal(TPML_ALG *source, BYTE **buffer, INT32 *size)
 
 
 // Table 2:100 - Definition of TPML_HANDLE Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_HANDLE_Unmarshal(TPML_HANDLE *target, BYTE **buffer, INT32 *size)
 {
@@ -2010,6 +2066,7 @@ TPML_HANDLE_Marshal(TPML_HANDLE *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPM_HANDLE_Array_Marshal((TPM_HANDLE *)(source->handle), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:101 - Definition of TPML_DIGEST Structure (StructureTable)
@@ -2063,6 +2120,7 @@ TPML_DIGEST_VALUES_Marshal(TPML_DIGEST_VALUES *source, BYTE **buffer, INT32 *siz
 
 
 // Table 2:103 - Definition of TPML_PCR_SELECTION Structure (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_PCR_SELECTION_Unmarshal(TPML_PCR_SELECTION *target, BYTE **buffer, INT32 *size)
 {
@@ -2084,9 +2142,11 @@ TPML_PCR_SELECTION_Marshal(TPML_PCR_SELECTION *source, BYTE **buffer, INT32 *siz
     result = (UINT16)(result + TPMS_PCR_SELECTION_Array_Marshal((TPMS_PCR_SELECTION *)(source->pcrSelections), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:104 - Definition of TPML_ALG_PROPERTY Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_ALG_PROPERTY_Unmarshal(TPML_ALG_PROPERTY *target, BYTE **buffer, INT32 *size)
 {
@@ -2108,9 +2168,11 @@ TPML_ALG_PROPERTY_Marshal(TPML_ALG_PROPERTY *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPMS_ALG_PROPERTY_Array_Marshal((TPMS_ALG_PROPERTY *)(source->algProperties), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:105 - Definition of TPML_TAGGED_TPM_PROPERTY Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_TAGGED_TPM_PROPERTY_Unmarshal(TPML_TAGGED_TPM_PROPERTY *target, BYTE **buffer, INT32 *size)
 {
@@ -2132,9 +2194,11 @@ TPML_TAGGED_TPM_PROPERTY_Marshal(TPML_TAGGED_TPM_PROPERTY *source, BYTE **buffer
     result = (UINT16)(result + TPMS_TAGGED_PROPERTY_Array_Marshal((TPMS_TAGGED_PROPERTY *)(source->tpmProperty), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:106 - Definition of TPML_TAGGED_PCR_PROPERTY Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_TAGGED_PCR_PROPERTY_Unmarshal(TPML_TAGGED_PCR_PROPERTY *target, BYTE **buffer, INT32 *size)
 {
@@ -2156,10 +2220,12 @@ TPML_TAGGED_PCR_PROPERTY_Marshal(TPML_TAGGED_PCR_PROPERTY *source, BYTE **buffer
     result = (UINT16)(result + TPMS_TAGGED_PCR_SELECT_Array_Marshal((TPMS_TAGGED_PCR_SELECT *)(source->pcrProperty), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:107 - Definition of TPML_ECC_CURVE Structure  (StructureTable)
 #if         ALG_ECC
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_ECC_CURVE_Unmarshal(TPML_ECC_CURVE *target, BYTE **buffer, INT32 *size)
 {
@@ -2181,11 +2247,13 @@ TPML_ECC_CURVE_Marshal(TPML_ECC_CURVE *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPM_ECC_CURVE_Array_Marshal((TPM_ECC_CURVE *)(source->eccCurves), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 #endif // ALG_ECC
 
 
 // Table 2:108 - Definition of TPML_TAGGED_POLICY Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPML_TAGGED_POLICY_Unmarshal(TPML_TAGGED_POLICY *target, BYTE **buffer, INT32 *size)
 {
@@ -2207,9 +2275,11 @@ TPML_TAGGED_POLICY_Marshal(TPML_TAGGED_POLICY *source, BYTE **buffer, INT32 *siz
     result = (UINT16)(result + TPMS_TAGGED_POLICY_Array_Marshal((TPMS_TAGGED_POLICY *)(source->policies), buffer, size, (INT32)(source->count)));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:109 - Definition of TPMU_CAPABILITIES Union  (UnionTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMU_CAPABILITIES_Unmarshal(TPMU_CAPABILITIES *target, BYTE **buffer, INT32 *size, UINT32 selector)
 {
@@ -2269,9 +2339,11 @@ TPMU_CAPABILITIES_Marshal(TPMU_CAPABILITIES *source, BYTE **buffer, INT32 *size,
     }
     return 0;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:110 - Definition of TPMS_CAPABILITY_DATA Structure  (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMS_CAPABILITY_DATA_Unmarshal(TPMS_CAPABILITY_DATA *target, BYTE **buffer, INT32 *size)
 {
@@ -2291,6 +2363,7 @@ TPMS_CAPABILITY_DATA_Marshal(TPMS_CAPABILITY_DATA *source, BYTE **buffer, INT32
     result = (UINT16)(result + TPMU_CAPABILITIES_Marshal((TPMU_CAPABILITIES *)&(source->data), buffer, size, (UINT32)source->capability));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:111 - Definition of TPMS_CLOCK_INFO Structure (StructureTable)
@@ -3137,13 +3210,14 @@ UINT16
 TPM2B_SENSITIVE_CREATE_Marshal(TPM2B_SENSITIVE_CREATE *source, BYTE **buffer, INT32 *size)
 {
     UINT16    result = 0;
-    BYTE      *sizeField = *buffer;
+    BYTE      *sizeField = (buffer != 0) ? *buffer : 0;
     // Advance buffer pointer by canonical size of a UINT16
-    *buffer += 2;
+    if (buffer != 0)
+        *buffer += 2;
     // Marshal the structure
     result = (UINT16)(result + TPMS_SENSITIVE_CREATE_Marshal((TPMS_SENSITIVE_CREATE *)&(source->sensitive), buffer, size));
     // Marshal the size
-    result = (UINT16)(result + UINT16_Marshal(&result, &sizeField, size));
+    result = (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
     return result;
 }
 
@@ -3657,6 +3731,12 @@ TPMU_ASYM_SCHEME_Unmarshal(TPMU_ASYM_SCHEME *target, BYTE **buffer, INT32 *size,
         case TPM_ALG_NULL:
             return TPM_RC_SUCCESS;
     }
+#if         !ALG_RSA && !ALG_ECC
+    // No member is left in this profile
+    NOT_REFERENCED(target);
+    NOT_REFERENCED(buffer);
+    NOT_REFERENCED(size);
+#endif // !ALG_RSA && !ALG_ECC
     return TPM_RC_SELECTOR;
 }
 
@@ -3707,6 +3787,12 @@ TPMU_ASYM_SCHEME_Marshal(TPMU_ASYM_SCHEME *source, BYTE **buffer, INT32 *size, U
         case TPM_ALG_NULL:
             return 0;
     }
+#if         !ALG_RSA && !ALG_ECC
+    // No member is left in this profile
+    NOT_REFERENCED(source);
+    NOT_REFERENCED(buffer);
+    NOT_REFERENCED(size);
+#endif // !ALG_RSA && !ALG_ECC
     return 0;
 }
 
@@ -3963,6 +4049,7 @@ TPM2B_ECC_PARAMETER_Marshal(TPM2B_ECC_PARAMETER *source, BYTE **buffer, INT32 *s
 
 // Table 2:168 - Definition of TPMS_ECC_POINT Structure (StructureTable)
 #if         ALG_ECC
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMS_ECC_POINT_Unmarshal(TPMS_ECC_POINT *target, BYTE **buffer, INT32 *size)
 {
@@ -3982,6 +4069,7 @@ TPMS_ECC_POINT_Marshal(TPMS_ECC_POINT *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPM2B_ECC_PARAMETER_Marshal((TPM2B_ECC_PARAMETER *)&(source->y), buffer, size));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 #endif // ALG_ECC
 
@@ -4011,13 +4099,14 @@ UINT16
 TPM2B_ECC_POINT_Marshal(TPM2B_ECC_POINT *source, BYTE **buffer, INT32 *size)
 {
     UINT16    result = 0;
-    BYTE      *sizeField = *buffer;
+    BYTE      *sizeField = (buffer != 0) ? *buffer : 0;
     // Advance buffer pointer by canonical size of a UINT16
-    *buffer += 2;
+    if (buffer != 0)
+        *buffer += 2;
     // Marshal the structure
     result = (UINT16)(result + TPMS_ECC_POINT_Marshal((TPMS_ECC_POINT *)&(source->point), buffer, size));
     // Marshal the size
-    result = (UINT16)(result + UINT16_Marshal(&result, &sizeField, size));
+    result = (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
     return result;
 }
 
@@ -4501,6 +4590,7 @@ TPMI_ALG_PUBLIC_Unmarshal(TPMI_ALG_PUBLIC *target, BYTE **buffer, INT32 *size)
 
 
 // Table 2:183 - Definition of TPMU_PUBLIC_ID Union  (UnionTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMU_PUBLIC_ID_Unmarshal(TPMU_PUBLIC_ID *target, BYTE **buffer, INT32 *size, UINT32 selector)
 {
@@ -4548,6 +4638,7 @@ TPMU_PUBLIC_ID_Marshal(TPMU_PUBLIC_ID *source, BYTE **buffer, INT32 *size, UINT3
     }
     return 0;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:184 - Definition of TPMS_KEYEDHASH_PARMS Structure (StructureTable)
@@ -4579,6 +4670,7 @@ TPMS_ASYM_PARMS_Marshal(TPMS_ASYM_PARMS *source, BYTE **buffer, INT32 *size)
 
 // Table 2:186 - Definition of TPMS_RSA_PARMS Structure (StructureTable)
 #if         ALG_RSA
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMS_RSA_PARMS_Unmarshal(TPMS_RSA_PARMS *target, BYTE **buffer, INT32 *size)
 {
@@ -4606,12 +4698,14 @@ TPMS_RSA_PARMS_Marshal(TPMS_RSA_PARMS *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + UINT32_Marshal((UINT32 *)&(source->exponent), buffer, size));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 #endif // ALG_RSA
 
 
 // Table 2:187 - Definition of TPMS_ECC_PARMS Structure (StructureTable)
 #if         ALG_ECC
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMS_ECC_PARMS_Unmarshal(TPMS_ECC_PARMS *target, BYTE **buffer, INT32 *size)
 {
@@ -4639,11 +4733,13 @@ TPMS_ECC_PARMS_Marshal(TPMS_ECC_PARMS *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPMT_KDF_SCHEME_Marshal((TPMT_KDF_SCHEME *)&(source->kdf), buffer, size));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 #endif // ALG_ECC
 
 
 // Table 2:188 - Definition of TPMU_PUBLIC_PARMS Union  (UnionTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMU_PUBLIC_PARMS_Unmarshal(TPMU_PUBLIC_PARMS *target, BYTE **buffer, INT32 *size, UINT32 selector)
 {
@@ -4691,6 +4787,7 @@ TPMU_PUBLIC_PARMS_Marshal(TPMU_PUBLIC_PARMS *source, BYTE **buffer, INT32 *size,
     }
     return 0;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:189 - Definition of TPMT_PUBLIC_PARMS Structure (StructureTable)
@@ -4716,6 +4813,7 @@ TPMT_PUBLIC_PARMS_Marshal(TPMT_PUBLIC_PARMS *source, BYTE **buffer, INT32 *size)
 
 
 // Table 2:190 - Definition of TPMT_PUBLIC Structure (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPMT_PUBLIC_Unmarshal(TPMT_PUBLIC *target, BYTE **buffer, INT32 *size, BOOL flag)
 {
@@ -4751,9 +4849,11 @@ TPMT_PUBLIC_Marshal(TPMT_PUBLIC *source, BYTE **buffer, INT32 *size)
     result = (UINT16)(result + TPMU_PUBLIC_ID_Marshal((TPMU_PUBLIC_ID *)&(source->unique), buffer, size, (UINT32)source->type));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:191 - Definition of TPM2B_PUBLIC Structure (StructureTable)
+#ifndef USE_MARSHAL_SCHEMA
 TPM_RC
 TPM2B_PUBLIC_Unmarshal(TPM2B_PUBLIC *target, BYTE **buffer, INT32 *size, BOOL flag)
 {
@@ -4777,15 +4877,17 @@ UINT16
 TPM2B_PUBLIC_Marshal(TPM2B_PUBLIC *source, BYTE **buffer, INT32 *size)
 {
     UINT16    result = 0;
-    BYTE      *sizeField = *buffer;
+    BYTE      *sizeField = (buffer != 0) ? *buffer : 0;
     // Advance buffer pointer by canonical size of a UINT16
-    *buffer += 2;
+    if (buffer != 0)
+        *buffer += 2;
     // Marshal the structure
     result = (UINT16)(result + TPMT_PUBLIC_Marshal((TPMT_PUBLIC *)&(source->publicArea), buffer, size));
     // Marshal the size
-    result = (UINT16)(result + UINT16_Marshal(&result, &sizeField, size));
+    result = (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
     return result;
 }
+#endif // USE_MARSHAL_SCHEMA
 
 
 // Table 2:192 - Definition of TPM2B_TEMPLATE Structure (StructureTable)
@@ -4946,13 +5048,14 @@ UINT16
 TPM2B_SENSITIVE_Marshal(TPM2B_SENSITIVE *source, BYTE **buffer, INT32 *size)
 {
     UINT16    result = 0;
-    BYTE      *sizeField = *buffer;
+    BYTE      *sizeField = (buffer != 0) ? *buffer : 0;
     // Advance buffer pointer by canonical size of a UINT16
-    *buffer += 2;
+    if (buffer != 0)
+        *buffer += 2;
     // Marshal the structure
     result = (UINT16)(result + TPMT_SENSITIVE_Marshal((TPMT_SENSITIVE *)&(source->sensitiveArea), buffer, size));
     // Marshal the size
-    result = (UINT16)(result + UINT16_Marshal(&result, &sizeField, size));
+    result = (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
     return result;
 }
 
@@ -5164,13 +5267,14 @@ UINT16
 TPM2B_NV_PUBLIC_Marshal(TPM2B_NV_PUBLIC *source, BYTE **buffer, INT32 *size)
 {
     UINT16    result = 0;
-    BYTE      *sizeField = *buffer;
+    BYTE      *sizeField = (buffer != 0) ? *buffer : 0;
     // Advance buffer pointer by canonical size of a UINT16
-    *buffer += 2;
+    if (buffer != 0)
+        *buffer += 2;
     // Marshal the structure
     result = (UINT16)(result + TPMS_NV_PUBLIC_Marshal((TPMS_NV_PUBLIC *)&(source->nvPublic), buffer, size));
     // Marshal the size
-    result = (UINT16)(result + UINT16_Marshal(&result, &sizeField, size));
+    result = (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
     return result;
 }
 
@@ -5347,13 +5451,14 @@ UINT16
 TPM2B_CREATION_DATA_Marshal(TPM2B_CREATION_DATA *source, BYTE **buffer, INT32 *size)
 {
     UINT16    result = 0;
-    BYTE      *sizeField = *buffer;
+    BYTE      *sizeField = (buffer != 0) ? *buffer : 0;
     // Advance buffer pointer by canonical size of a UINT16
-    *buffer += 2;
+    if (buffer != 0)
+        *buffer += 2;
     // Marshal the structure
     result = (UINT16)(result + TPMS_CREATION_DATA_Marshal((TPMS_CREATION_DATA *)&(source->creationData), buffer, size));
     // Marshal the size
-    result = (UINT16)(result + UINT16_Marshal(&result, &sizeField, size));
+    result = (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
     return result;
 }
 
@@ -5385,6 +5490,55 @@ BYTE_Array_Marshal(BYTE *source, BYTE **buffer, INT32 *size, INT32 count)
     return ((UINT16)count);
 }
 
+// Skip functions advance past a marshaled structure using only its size fields,
+// for response parameters the caller does not want decoded.
+TPM_RC
+TPM2B_Skip(BYTE **buffer, INT32 *size, UINT16 maxSize)
+{
+    TPM_RC    result;
+    UINT16    bufSize;
+    result = UINT16_Unmarshal(&bufSize, buffer, size);
+    if(result != TPM_RC_SUCCESS)
+        return result;
+    if(bufSize > maxSize)
+        return TPM_RC_SIZE;
+    if(*size < bufSize)
+        return TPM_RC_INSUFFICIENT;
+    *size -= bufSize;
+    *buffer += bufSize;
+    return TPM_RC_SUCCESS;
+}
+
+TPM_RC
+TPM2B_CREATION_DATA_Skip(BYTE **buffer, INT32 *size)
+{
+    TPM_RC    result;
+    UINT16    dataSize;
+    result = UINT16_Unmarshal(&dataSize, buffer, size);
+    if(result != TPM_RC_SUCCESS)
+        return result;
+    // if size is zero, then the required structure is missing
+    if(dataSize == 0 || dataSize > sizeof(TPMS_CREATION_DATA))
+        return TPM_RC_SIZE;
+    if(*size < dataSize)
+        return TPM_RC_INSUFFICIENT;
+    *size -= dataSize;
+    *buffer += dataSize;
+    return TPM_RC_SUCCESS;
+}
+
+// All ticket types are a TPM_ST tag and a TPMI_RH_HIERARCHY followed by a TPM2B_DIGEST
+TPM_RC
+TPMT_TK_Skip(BYTE **buffer, INT32 *size)
+{
+    INT32     fixedSize = sizeof(TPM_ST) + sizeof(TPMI_RH_HIERARCHY);
+    if(*size < fixedSize)
+        return TPM_RC_INSUFFICIENT;
+    *size -= fixedSize;
+    *buffer += fixedSize;
+    return TPM2B_Skip(buffer, size, sizeof(TPMU_HA));
+}
+
 // Array Marshal/Unmarshal for TPM2B_DIGEST
 TPM_RC
 TPM2B_DIGEST_Array_Unmarshal(TPM2B_DIGEST *target, BYTE **buffer, INT32 *size, INT32 count)
@@ -5539,12 +5693,17 @@ TPMS_TAGGED_POLICY_Array_Marshal(TPMS_TAGGED_POLICY *source, BYTE **buffer, INT3
 TPM_RC
 TPMS_TAGGED_PROPERTY_Array_Unmarshal(TPMS_TAGGED_PROPERTY *target, BYTE **buffer, INT32 *size, INT32 count)
 {
-    TPM_RC    result;
     INT32 i;
+    if(!FixedSizeConsume(size, count, TPMS_TAGGED_PROPERTY_WIRE_SIZE))
+        return TPM_RC_INSUFFICIENT;
+    // Without padding the list is laid out in memory as on the wire, two words per element
+    if(sizeof(TPMS_TAGGED_PROPERTY) == TPMS_TAGGED_PROPERTY_WIRE_SIZE) {
+        ByteArrayToUint32Array((UINT32 *)target, *buffer, count * 2);
+        *buffer += count * TPMS_TAGGED_PROPERTY_WIRE_SIZE;
+        return TPM_RC_SUCCESS;
+    }
     for(i = 0; i < count; i++) {
-        result = TPMS_TAGGED_PROPERTY_Unmarshal(&target[i], buffer, size);
-        if(result != TPM_RC_SUCCESS)
-            return result;
+        TPMS_TAGGED_PROPERTY_UnmarshalUnchecked(&target[i], buffer);
     }
     return TPM_RC_SUCCESS;
 }
@@ -5614,13 +5773,10 @@ TPM_ALG_ID_Array_Marshal(TPM_ALG_ID *source, BYTE **buffer, INT32 *size, INT32 c
 TPM_RC
 TPM_CC_Array_Unmarshal(TPM_CC *target, BYTE **buffer, INT32 *size, INT32 count)
 {
-    TPM_RC    result;
-    INT32 i;
-    for(i = 0; i < count; i++) {
-        result = TPM_CC_Unmarshal(&target[i], buffer, size);
-        if(result != TPM_RC_SUCCESS)
-            return result;
-    }
+    if(!FixedSizeConsume(size, count, sizeof(TPM_CC)))
+        return TPM_RC_INSUFFICIENT;
+    ByteArrayToUint32Array((UINT32 *)target, *buffer, count);
+    *buffer += count * sizeof(TPM_CC);
     return TPM_RC_SUCCESS;
 }
 
@@ -5666,13 +5822,10 @@ TPM_ECC_CURVE_Array_Marshal(TPM_ECC_CURVE *source, BYTE **buffer, INT32 *size, I
 TPM_RC
 TPM_HANDLE_Array_Unmarshal(TPM_HANDLE *target, BYTE **buffer, INT32 *size, INT32 count)
 {
-    TPM_RC    result;
-    INT32 i;
-    for(i = 0; i < count; i++) {
-        result = TPM_HANDLE_Unmarshal(&target[i], buffer, size);
-        if(result != TPM_RC_SUCCESS)
-            return result;
-    }
+    if(!FixedSizeConsume(size, count, sizeof(TPM_HANDLE)))
+        return TPM_RC_INSUFFICIENT;
+    ByteArrayToUint32Array((UINT32 *)target, *buffer, count);
+    *buffer += count * sizeof(TPM_HANDLE);
     return TPM_RC_SUCCESS;
 }
 
@@ -0,0 +1,670 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Table driven (un)marshaling of the composite structures that the client
+// decodes most often: TPM2B_PUBLIC and TPMS_CAPABILITY_DATA with everything
+// below them. Each structure is described by a table of fields and a single
+// interpreter walks the tables, replacing the per-type functions of Marshal.c.
+// Leaf types that carry their own value checks (TPMI_*, TPMA_*, TPMT_*_SCHEME,
+// ...) are still handled by the Marshal.c functions through a MARSHAL_LEAF.
+//
+// The engine is only compiled when USE_MARSHAL_SCHEMA is defined, in which case
+// Marshal.c leaves out the functions that are defined here.
+
+#include <stddef.h>
+
+#include "azure_utpm_c/Tpm.h"
+
+#include "azure_utpm_c/Marshal_fp.h"
+#include "azure_utpm_c/Memory_fp.h"
+
+#ifdef USE_MARSHAL_SCHEMA
+
+typedef enum MARSHAL_KIND_TAG
+{
+    MARSHAL_KIND_UINT8,
+    MARSHAL_KIND_UINT16,
+    MARSHAL_KIND_UINT32,
+    MARSHAL_KIND_TPM2B,      // UINT16 size followed by at most Limit bytes
+    MARSHAL_KIND_SIZED,      // UINT16 size followed by a structure (Detail: MARSHAL_SIZED)
+    MARSHAL_KIND_STRUCT,     // nested structure (Detail: MARSHAL_SCHEMA)
+    MARSHAL_KIND_LIST,       // UINT32 count followed by at most Limit elements (Detail: MARSHAL_LIST)
+    MARSHAL_KIND_UNION,      // union selected by a field of the enclosing structure (Detail: MARSHAL_UNION)
+    MARSHAL_KIND_LEAF        // Marshal.c function (Detail: MARSHAL_LEAF)
+} MARSHAL_KIND;
+
+// How the 'flag' parameter of the generated functions is passed on to a field
+#define MARSHAL_FLAG_FALSE      0
+#define MARSHAL_FLAG_TRUE       1
+#define MARSHAL_FLAG_INHERIT    2
+
+typedef struct MARSHAL_FIELD_TAG
+{
+    UINT8           Kind;       // MARSHAL_KIND
+    UINT8           Flag;       // MARSHAL_FLAG_*
+    UINT16          Offset;     // Offset of the field in the enclosing structure
+    UINT16          Limit;      // TPM2B: maximum size, list: maximum count
+    UINT16          LimitRc;    // Returned when Limit is exceeded
+    const void     *Detail;
+} MARSHAL_FIELD;
+
+typedef struct MARSHAL_SCHEMA_TAG
+{
+    const MARSHAL_FIELD    *Fields;
+    UINT16                  FieldCount;
+} MARSHAL_SCHEMA;
+
+typedef struct MARSHAL_SIZED_TAG
+{
+    const MARSHAL_SCHEMA   *Schema;
+    UINT16                  ValueOffset;    // Offset of the structure from the size field
+} MARSHAL_SIZED;
+
+typedef struct MARSHAL_LIST_TAG
+{
+    const MARSHAL_FIELD    *Element;        // Element description at offset 0
+    UINT16                  ArrayOffset;    // Offset of the array from the count field
+    UINT16                  Stride;         // In-memory size of an element
+    UINT16                  Words;          // Non-zero when an element is that many UINT32 with
+                                            // no padding and no checks, so that the whole
+                                            // array is unmarshaled with one byte swap
+} MARSHAL_LIST;
+
+typedef struct MARSHAL_CASE_TAG
+{
+    UINT32                  Selector;
+    const MARSHAL_FIELD    *Member;         // Offset relative to the union
+} MARSHAL_CASE;
+
+typedef struct MARSHAL_UNION_TAG
+{
+    const MARSHAL_CASE     *Cases;
+    UINT16                  CaseCount;
+    UINT16                  SelectorOffset; // Offset of the selector in the enclosing structure
+    UINT16                  SelectorSize;   // sizeof the selector
+} MARSHAL_UNION;
+
+typedef struct MARSHAL_LEAF_TAG
+{
+    TPM_RC  (*Unmarshal)(void *target, BYTE **buffer, INT32 *size, BOOL flag);
+    UINT16  (*Marshal)(void *source, BYTE **buffer, INT32 *size);
+} MARSHAL_LEAF;
+
+#define SCHEMA_COUNT(a)     ((UINT16)(sizeof(a) / sizeof((a)[0])))
+
+#define SCHEMA_FIELD(kind, flag, Type, member, limit, rc, detail) \
+    { (UINT8)(kind), (UINT8)(flag), (UINT16)offsetof(Type, member), (UINT16)(limit), (UINT16)(rc), (detail) }
+
+#define SCHEMA_UINT(bits, Type, member) \
+    SCHEMA_FIELD(MARSHAL_KIND_UINT##bits, MARSHAL_FLAG_FALSE, Type, member, 0, 0, NULL)
+#define SCHEMA_TPM2B(Type, member, maxSize) \
+    SCHEMA_FIELD(MARSHAL_KIND_TPM2B, MARSHAL_FLAG_FALSE, Type, member, maxSize, TPM_RC_SIZE, NULL)
+#define SCHEMA_LEAF_FIELD(Type, member, LeafType, flag) \
+    SCHEMA_FIELD(MARSHAL_KIND_LEAF, flag, Type, member, 0, 0, &LeafType##_Leaf)
+#define SCHEMA_UNION_FIELD(Type, member, Union, flag) \
+    SCHEMA_FIELD(MARSHAL_KIND_UNION, flag, Type, member, 0, 0, &Union##_Union)
+#define SCHEMA_LIST_FIELD(List, maxCount, rc) \
+    { MARSHAL_KIND_LIST, MARSHAL_FLAG_FALSE, 0, (UINT16)(maxCount), (UINT16)(rc), &List##_List }
+
+// Element and union member descriptions live at offset 0 of their container
+#define SCHEMA_AT_0(kind, flag, detail) \
+    { (UINT8)(kind), (UINT8)(flag), 0, 0, 0, (detail) }
+#define SCHEMA_TPM2B_AT_0(maxSize) \
+    { MARSHAL_KIND_TPM2B, MARSHAL_FLAG_FALSE, 0, (UINT16)(maxSize), (UINT16)TPM_RC_SIZE, NULL }
+
+// Adapters from the Marshal.c functions to MARSHAL_LEAF
+#define SCHEMA_LEAF(Type)                                                                   \
+    static TPM_RC Type##_LeafUnmarshal(void *target, BYTE **buffer, INT32 *size, BOOL flag) \
+    {                                                                                       \
+        (void)flag;                                                                         \
+        return Type##_Unmarshal((Type *)target, buffer, size);                              \
+    }                                                                                       \
+    static UINT16 Type##_LeafMarshal(void *source, BYTE **buffer, INT32 *size)              \
+    {                                                                                       \
+        return Type##_Marshal((Type *)source, buffer, size);                                \
+    }                                                                                       \
+    static const MARSHAL_LEAF Type##_Leaf = { Type##_LeafUnmarshal, Type##_LeafMarshal }
+
+#define SCHEMA_LEAF_WITH_FLAG(Type)                                                         \
+    static TPM_RC Type##_LeafUnmarshal(void *target, BYTE **buffer, INT32 *size, BOOL flag) \
+    {                                                                                       \
+        return Type##_Unmarshal((Type *)target, buffer, size, flag);                        \
+    }                                                                                       \
+    static UINT16 Type##_LeafMarshal(void *source, BYTE **buffer, INT32 *size)              \
+    {                                                                                       \
+        return Type##_Marshal((Type *)source, buffer, size);                                \
+    }                                                                                       \
+    static const MARSHAL_LEAF Type##_Leaf = { Type##_LeafUnmarshal, Type##_LeafMarshal }
+
+static TPM_RC SchemaUnmarshalField(const MARSHAL_FIELD *field, BYTE *base, BYTE **buffer, INT32 *size, BOOL flag);
+static UINT16 SchemaMarshalField(const MARSHAL_FIELD *field, BYTE *base, BYTE **buffer, INT32 *size);
+
+static BOOL SchemaFlag(const MARSHAL_FIELD *field, BOOL flag)
+{
+    return (field->Flag == MARSHAL_FLAG_INHERIT) ? flag : (BOOL)field->Flag;
+}
+
+static UINT32 SchemaSelector(const MARSHAL_UNION *unionDef, const BYTE *base)
+{
+    const BYTE *selector = base + unionDef->SelectorOffset;
+    if (unionDef->SelectorSize == sizeof(UINT16))
+        return *(const UINT16 *)selector;
+    return *(const UINT32 *)selector;
+}
+
+static const MARSHAL_FIELD *SchemaCase(const MARSHAL_UNION *unionDef, UINT32 selector)
+{
+    UINT16 i;
+    for (i = 0; i < unionDef->CaseCount; i++)
+    {
+        if (unionDef->Cases[i].Selector == selector)
+            return unionDef->Cases[i].Member;
+    }
+    return NULL;
+}
+
+static TPM_RC SchemaUnmarshalStruct(const MARSHAL_SCHEMA *schema, BYTE *target, BYTE **buffer, INT32 *size, BOOL flag)
+{
+    TPM_RC result = TPM_RC_SUCCESS;
+    UINT16 i;
+    for (i = 0; i < schema->FieldCount && result == TPM_RC_SUCCESS; i++)
+    {
+        result = SchemaUnmarshalField(&schema->Fields[i], target, buffer, size, flag);
+    }
+    return result;
+}
+
+static UINT16 SchemaMarshalStruct(const MARSHAL_SCHEMA *schema, BYTE *source, BYTE **buffer, INT32 *size)
+{
+    UINT16 result = 0;
+    UINT16 i;
+    for (i = 0; i < schema->FieldCount; i++)
+    {
+        result = (UINT16)(result + SchemaMarshalField(&schema->Fields[i], source, buffer, size));
+    }
+    return result;
+}
+
+static TPM_RC SchemaUnmarshalUnion(const MARSHAL_UNION *unionDef, BYTE *target, UINT32 selector, BYTE **buffer, INT32 *size, BOOL flag)
+{
+    const MARSHAL_FIELD *member = SchemaCase(unionDef, selector);
+    if (member == NULL)
+        return TPM_RC_SELECTOR;
+    return SchemaUnmarshalField(member, target, buffer, size, flag);
+}
+
+static UINT16 SchemaMarshalUnion(const MARSHAL_UNION *unionDef, BYTE *source, UINT32 selector, BYTE **buffer, INT32 *size)
+{
+    const MARSHAL_FIELD *member = SchemaCase(unionDef, selector);
+    if (member == NULL)
+        return 0;
+    return SchemaMarshalField(member, source, buffer, size);
+}
+
+static TPM_RC SchemaUnmarshalList(const MARSHAL_FIELD *field, BYTE *target, BYTE **buffer, INT32 *size)
+{
+    const MARSHAL_LIST *list = (const MARSHAL_LIST *)field->Detail;
+    UINT32 count;
+    BYTE *element = target + list->ArrayOffset;
+    UINT32 i;
+
+    if ((*size -= 4) < 0)
+        return TPM_RC_INSUFFICIENT;
+    count = BYTE_ARRAY_TO_UINT32(*buffer);
+    *buffer += 4;
+    *(UINT32 *)target = count;
+    if (count > field->Limit)
+        return field->LimitRc;
+    if (list->Words != 0)
+    {
+        INT32 words = (INT32)count * list->Words;
+        if (*size / (INT32)sizeof(UINT32) < words)
+            return TPM_RC_INSUFFICIENT;
+        *size -= words * (INT32)sizeof(UINT32);
+        ByteArrayToUint32Array((UINT32 *)element, *buffer, words);
+        *buffer += words * sizeof(UINT32);
+        return TPM_RC_SUCCESS;
+    }
+    for (i = 0; i < count; i++, element += list->Stride)
+    {
+        TPM_RC result = SchemaUnmarshalField(list->Element, element, buffer, size, FALSE);
+        if (result != TPM_RC_SUCCESS)
+            return result;
+    }
+    return TPM_RC_SUCCESS;
+}
+
+static UINT16 SchemaMarshalList(const MARSHAL_FIELD *field, BYTE *source, BYTE **buffer, INT32 *size)
+{
+    const MARSHAL_LIST *list = (const MARSHAL_LIST *)field->Detail;
+    UINT32 count = *(UINT32 *)source;
+    BYTE *element = source + list->ArrayOffset;
+    UINT16 result = UINT32_Marshal((UINT32 *)source, buffer, size);
+    UINT32 i;
+    for (i = 0; i < count; i++, element += list->Stride)
+    {
+        result = (UINT16)(result + SchemaMarshalField(list->Element, element, buffer, size));
+    }
+    return result;
+}
+
+static TPM_RC SchemaUnmarshalField(const MARSHAL_FIELD *field, BYTE *base, BYTE **buffer, INT32 *size, BOOL flag)
+{
+    BYTE *target = base + field->Offset;
+    switch (field->Kind)
+    {
+        case MARSHAL_KIND_UINT8:
+            if ((*size -= 1) < 0)
+                return TPM_RC_INSUFFICIENT;
+            *target = **buffer;
+            *buffer += 1;
+            return TPM_RC_SUCCESS;
+        case MARSHAL_KIND_UINT16:
+            if ((*size -= 2) < 0)
+                return TPM_RC_INSUFFICIENT;
+            *(UINT16 *)target = BYTE_ARRAY_TO_UINT16(*buffer);
+            *buffer += 2;
+            return TPM_RC_SUCCESS;
+        case MARSHAL_KIND_UINT32:
+            if ((*size -= 4) < 0)
+                return TPM_RC_INSUFFICIENT;
+            *(UINT32 *)target = BYTE_ARRAY_TO_UINT32(*buffer);
+            *buffer += 4;
+            return TPM_RC_SUCCESS;
+        case MARSHAL_KIND_TPM2B:
+        {
+            UINT16 count;
+            if ((*size -= 2) < 0)
+                return TPM_RC_INSUFFICIENT;
+            count = BYTE_ARRAY_TO_UINT16(*buffer);
+            *buffer += 2;
+            *(UINT16 *)target = count;
+            if (count > field->Limit)
+                return field->LimitRc;
+            return BYTE_Array_Unmarshal(target + sizeof(UINT16), buffer, size, count);
+        }
+        case MARSHAL_KIND_SIZED:
+        {
+            const MARSHAL_SIZED *sized = (const MARSHAL_SIZED *)field->Detail;
+            UINT16 expected;
+            INT32 startSize;
+            TPM_RC result;
+            if ((*size -= 2) < 0)
+                return TPM_RC_INSUFFICIENT;
+            expected = BYTE_ARRAY_TO_UINT16(*buffer);
+            *buffer += 2;
+            *(UINT16 *)target = expected;
+            // if size is zero, then the required structure is missing
+            if (expected == 0)
+                return TPM_RC_SIZE;
+            startSize = *size;
+            result = SchemaUnmarshalStruct(sized->Schema, target + sized->ValueOffset, buffer, size, SchemaFlag(field, flag));
+            if (result != TPM_RC_SUCCESS)
+                return result;
+            return (expected != (startSize - *size)) ? TPM_RC_SIZE : TPM_RC_SUCCESS;
+        }
+        case MARSHAL_KIND_STRUCT:
+            return SchemaUnmarshalStruct((const MARSHAL_SCHEMA *)field->Detail, target, buffer, size, SchemaFlag(field, flag));
+        case MARSHAL_KIND_LIST:
+            return SchemaUnmarshalList(field, target, buffer, size);
+        case MARSHAL_KIND_UNION:
+        {
+            const MARSHAL_UNION *unionDef = (const MARSHAL_UNION *)field->Detail;
+            return SchemaUnmarshalUnion(unionDef, target, SchemaSelector(unionDef, base), buffer, size, SchemaFlag(field, flag));
+        }
+        case MARSHAL_KIND_LEAF:
+            return ((const MARSHAL_LEAF *)field->Detail)->Unmarshal(target, buffer, size, SchemaFlag(field, flag));
+    }
+    return TPM_RC_FAILURE;
+}
+
+static UINT16 SchemaMarshalField(const MARSHAL_FIELD *field, BYTE *base, BYTE **buffer, INT32 *size)
+{
+    BYTE *source = base + field->Offset;
+    switch (field->Kind)
+    {
+        case MARSHAL_KIND_UINT8:
+            return UINT8_Marshal(source, buffer, size);
+        case MARSHAL_KIND_UINT16:
+            return UINT16_Marshal((UINT16 *)source, buffer, size);
+        case MARSHAL_KIND_UINT32:
+            return UINT32_Marshal((UINT32 *)source, buffer, size);
+        case MARSHAL_KIND_TPM2B:
+        {
+            UINT16 result = UINT16_Marshal((UINT16 *)source, buffer, size);
+            // if size equal to 0, the rest of the structure is a zero buffer.  Stop processing
+            if (*(UINT16 *)source == 0)
+                return result;
+            return (UINT16)(result + BYTE_Array_Marshal(source + sizeof(UINT16), buffer, size, *(UINT16 *)source));
+        }
+        case MARSHAL_KIND_SIZED:
+        {
+            const MARSHAL_SIZED *sized = (const MARSHAL_SIZED *)field->Detail;
+            BYTE *sizeField = (buffer != 0) ? *buffer : 0;
+            UINT16 result;
+            if (buffer != 0)
+                *buffer += 2;
+            result = SchemaMarshalStruct(sized->Schema, source + sized->ValueOffset, buffer, size);
+            return (UINT16)(result + UINT16_Marshal(&result, (buffer != 0) ? &sizeField : 0, size));
+        }
+        case MARSHAL_KIND_STRUCT:
+            return SchemaMarshalStruct((const MARSHAL_SCHEMA *)field->Detail, source, buffer, size);
+        case MARSHAL_KIND_LIST:
+            return SchemaMarshalList(field, source, buffer, size);
+        case MARSHAL_KIND_UNION:
+        {
+            const MARSHAL_UNION *unionDef = (const MARSHAL_UNION *)field->Detail;
+            return SchemaMarshalUnion(unionDef, source, SchemaSelector(unionDef, base), buffer, size);
+        }
+        case MARSHAL_KIND_LEAF:
+            return ((const MARSHAL_LEAF *)field->Detail)->Marshal(source, buffer, size);
+    }
+    return 0;
+}
+
+// Leaf types
+SCHEMA_LEAF(TPMI_ALG_PUBLIC);
+SCHEMA_LEAF_WITH_FLAG(TPMI_ALG_HASH);
+SCHEMA_LEAF(TPMA_OBJECT);
+SCHEMA_LEAF_WITH_FLAG(TPMT_SYM_DEF_OBJECT);
+SCHEMA_LEAF_WITH_FLAG(TPMT_KEYEDHASH_SCHEME);
+#if         ALG_RSA
+SCHEMA_LEAF_WITH_FLAG(TPMT_RSA_SCHEME);
+SCHEMA_LEAF(TPMI_RSA_KEY_BITS);
+#endif // ALG_RSA
+#if         ALG_ECC
+SCHEMA_LEAF_WITH_FLAG(TPMT_ECC_SCHEME);
+SCHEMA_LEAF(TPMI_ECC_CURVE);
+SCHEMA_LEAF_WITH_FLAG(TPMT_KDF_SCHEME);
+#endif // ALG_ECC
+SCHEMA_LEAF(TPM_CAP);
+SCHEMA_LEAF(TPMA_ALGORITHM);
+SCHEMA_LEAF(TPMA_CC);
+SCHEMA_LEAF(TPMS_PCR_SELECTION);
+SCHEMA_LEAF(TPMS_TAGGED_PCR_SELECT);
+SCHEMA_LEAF(TPMS_TAGGED_POLICY);
+
+// Table 2:186 - Definition of TPMS_RSA_PARMS Structure
+#if         ALG_RSA
+static const MARSHAL_FIELD TPMS_RSA_PARMS_Fields[] =
+{
+    SCHEMA_LEAF_FIELD(TPMS_RSA_PARMS, symmetric, TPMT_SYM_DEF_OBJECT, MARSHAL_FLAG_TRUE),
+    SCHEMA_LEAF_FIELD(TPMS_RSA_PARMS, scheme, TPMT_RSA_SCHEME, MARSHAL_FLAG_TRUE),
+    SCHEMA_LEAF_FIELD(TPMS_RSA_PARMS, keyBits, TPMI_RSA_KEY_BITS, MARSHAL_FLAG_FALSE),
+    SCHEMA_UINT(32, TPMS_RSA_PARMS, exponent)
+};
+static const MARSHAL_SCHEMA TPMS_RSA_PARMS_Schema = { TPMS_RSA_PARMS_Fields, SCHEMA_COUNT(TPMS_RSA_PARMS_Fields) };
+#endif // ALG_RSA
+
+// Table 2:187 - Definition of TPMS_ECC_PARMS Structure
+#if         ALG_ECC
+static const MARSHAL_FIELD TPMS_ECC_PARMS_Fields[] =
+{
+    SCHEMA_LEAF_FIELD(TPMS_ECC_PARMS, symmetric, TPMT_SYM_DEF_OBJECT, MARSHAL_FLAG_TRUE),
+    SCHEMA_LEAF_FIELD(TPMS_ECC_PARMS, scheme, TPMT_ECC_SCHEME, MARSHAL_FLAG_TRUE),
+    SCHEMA_LEAF_FIELD(TPMS_ECC_PARMS, curveID, TPMI_ECC_CURVE, MARSHAL_FLAG_FALSE),
+    SCHEMA_LEAF_FIELD(TPMS_ECC_PARMS, kdf, TPMT_KDF_SCHEME, MARSHAL_FLAG_TRUE)
+};
+static const MARSHAL_SCHEMA TPMS_ECC_PARMS_Schema = { TPMS_ECC_PARMS_Fields, SCHEMA_COUNT(TPMS_ECC_PARMS_Fields) };
+
+// Table 2:168 - Definition of TPMS_ECC_POINT Structure
+static const MARSHAL_FIELD TPMS_ECC_POINT_Fields[] =
+{
+    SCHEMA_TPM2B(TPMS_ECC_POINT, x, MAX_ECC_KEY_BYTES),
+    SCHEMA_TPM2B(TPMS_ECC_POINT, y, MAX_ECC_KEY_BYTES)
+};
+static const MARSHAL_SCHEMA TPMS_ECC_POINT_Schema = { TPMS_ECC_POINT_Fields, SCHEMA_COUNT(TPMS_ECC_POINT_Fields) };
+#endif // ALG_ECC
+
+// Table 2:188 - Definition of TPMU_PUBLIC_PARMS Union
+#if         ALG_KEYEDHASH
+static const MARSHAL_FIELD TPMS_KEYEDHASH_PARMS_Member = SCHEMA_AT_0(MARSHAL_KIND_LEAF, MARSHAL_FLAG_TRUE, &TPMT_KEYEDHASH_SCHEME_Leaf);
+#endif // ALG_KEYEDHASH
+#if         ALG_SYMCIPHER
+static const MARSHAL_FIELD TPMS_SYMCIPHER_PARMS_Member = SCHEMA_AT_0(MARSHAL_KIND_LEAF, MARSHAL_FLAG_FALSE, &TPMT_SYM_DEF_OBJECT_Leaf);
+#endif // ALG_SYMCIPHER
+#if         ALG_RSA
+static const MARSHAL_FIELD TPMS_RSA_PARMS_Member = SCHEMA_AT_0(MARSHAL_KIND_STRUCT, MARSHAL_FLAG_FALSE, &TPMS_RSA_PARMS_Schema);
+#endif // ALG_RSA
+#if         ALG_ECC
+static const MARSHAL_FIELD TPMS_ECC_PARMS_Member = SCHEMA_AT_0(MARSHAL_KIND_STRUCT, MARSHAL_FLAG_FALSE, &TPMS_ECC_PARMS_Schema);
+#endif // ALG_ECC
+
+static const MARSHAL_CASE TPMU_PUBLIC_PARMS_Cases[] =
+{
+#if         ALG_KEYEDHASH
+    { TPM_ALG_KEYEDHASH, &TPMS_KEYEDHASH_PARMS_Member },
+#endif // ALG_KEYEDHASH
+#if         ALG_SYMCIPHER
+    { TPM_ALG_SYMCIPHER, &TPMS_SYMCIPHER_PARMS_Member },
+#endif // ALG_SYMCIPHER
+#if         ALG_RSA
+    { TPM_ALG_RSA, &TPMS_RSA_PARMS_Member },
+#endif // ALG_RSA
+#if         ALG_ECC
+    { TPM_ALG_ECC, &TPMS_ECC_PARMS_Member },
+#endif // ALG_ECC
+};
+static const MARSHAL_UNION TPMU_PUBLIC_PARMS_Union =
+{
+    TPMU_PUBLIC_PARMS_Cases, SCHEMA_COUNT(TPMU_PUBLIC_PARMS_Cases),
+    (UINT16)offsetof(TPMT_PUBLIC, type), sizeof(TPMI_ALG_PUBLIC)
+};
+
+// Table 2:183 - Definition of TPMU_PUBLIC_ID Union
+static const MARSHAL_FIELD TPM2B_DIGEST_Member = SCHEMA_TPM2B_AT_0(sizeof(TPMU_HA));
+#if         ALG_RSA
+static const MARSHAL_FIELD TPM2B_PUBLIC_KEY_RSA_Member = SCHEMA_TPM2B_AT_0(MAX_RSA_KEY_BYTES);
+#endif // ALG_RSA
+#if         ALG_ECC
+static const MARSHAL_FIELD TPMS_ECC_POINT_Member = SCHEMA_AT_0(MARSHAL_KIND_STRUCT, MARSHAL_FLAG_FALSE, &TPMS_ECC_POINT_Schema);
+#endif // ALG_ECC
+
+static const MARSHAL_CASE TPMU_PUBLIC_ID_Cases[] =
+{
+#if         ALG_KEYEDHASH
+    { TPM_ALG_KEYEDHASH, &TPM2B_DIGEST_Member },
+#endif // ALG_KEYEDHASH
+#if         ALG_SYMCIPHER
+    { TPM_ALG_SYMCIPHER, &TPM2B_DIGEST_Member },
+#endif // ALG_SYMCIPHER
+#if         ALG_RSA
+    { TPM_ALG_RSA, &TPM2B_PUBLIC_KEY_RSA_Member },
+#endif // ALG_RSA
+#if         ALG_ECC
+    { TPM_ALG_ECC, &TPMS_ECC_POINT_Member },
+#endif // ALG_ECC
+};
+static const MARSHAL_UNION TPMU_PUBLIC_ID_Union =
+{
+    TPMU_PUBLIC_ID_Cases, SCHEMA_COUNT(TPMU_PUBLIC_ID_Cases),
+    (UINT16)offsetof(TPMT_PUBLIC, type), sizeof(TPMI_ALG_PUBLIC)
+};
+
+// Table 2:190 - Definition of TPMT_PUBLIC Structure
+static const MARSHAL_FIELD TPMT_PUBLIC_Fields[] =
+{
+    SCHEMA_LEAF_FIELD(TPMT_PUBLIC, type, TPMI_ALG_PUBLIC, MARSHAL_FLAG_FALSE),
+    SCHEMA_LEAF_FIELD(TPMT_PUBLIC, nameAlg, TPMI_ALG_HASH, MARSHAL_FLAG_INHERIT),
+    SCHEMA_LEAF_FIELD(TPMT_PUBLIC, objectAttributes, TPMA_OBJECT, MARSHAL_FLAG_FALSE),
+    SCHEMA_TPM2B(TPMT_PUBLIC, authPolicy, sizeof(TPMU_HA)),
+    SCHEMA_UNION_FIELD(TPMT_PUBLIC, parameters, TPMU_PUBLIC_PARMS, MARSHAL_FLAG_FALSE),
+    SCHEMA_UNION_FIELD(TPMT_PUBLIC, unique, TPMU_PUBLIC_ID, MARSHAL_FLAG_FALSE)
+};
+static const MARSHAL_SCHEMA TPMT_PUBLIC_Schema = { TPMT_PUBLIC_Fields, SCHEMA_COUNT(TPMT_PUBLIC_Fields) };
+
+// Table 2:191 - Definition of TPM2B_PUBLIC Structure
+static const MARSHAL_SIZED TPM2B_PUBLIC_Sized = { &TPMT_PUBLIC_Schema, (UINT16)offsetof(TPM2B_PUBLIC, publicArea) };
+static const MARSHAL_FIELD TPM2B_PUBLIC_Field = SCHEMA_FIELD(MARSHAL_KIND_SIZED, MARSHAL_FLAG_INHERIT, TPM2B_PUBLIC, size, 0, 0, &TPM2B_PUBLIC_Sized);
+
+// Table 2:93 - Definition of TPMS_ALG_PROPERTY Structure
+static const MARSHAL_FIELD TPMS_ALG_PROPERTY_Fields[] =
+{
+    SCHEMA_UINT(16, TPMS_ALG_PROPERTY, alg),
+    SCHEMA_LEAF_FIELD(TPMS_ALG_PROPERTY, algProperties, TPMA_ALGORITHM, MARSHAL_FLAG_FALSE)
+};
+static const MARSHAL_SCHEMA TPMS_ALG_PROPERTY_Schema = { TPMS_ALG_PROPERTY_Fields, SCHEMA_COUNT(TPMS_ALG_PROPERTY_Fields) };
+
+// Table 2:94 - Definition of TPMS_TAGGED_PROPERTY Structure
+static const MARSHAL_FIELD TPMS_TAGGED_PROPERTY_Fields[] =
+{
+    SCHEMA_UINT(32, TPMS_TAGGED_PROPERTY, property),
+    SCHEMA_UINT(32, TPMS_TAGGED_PROPERTY, value)
+};
+static const MARSHAL_SCHEMA TPMS_TAGGED_PROPERTY_Schema = { TPMS_TAGGED_PROPERTY_Fields, SCHEMA_COUNT(TPMS_TAGGED_PROPERTY_Fields) };
+
+// List elements
+static const MARSHAL_FIELD TPMS_ALG_PROPERTY_Element = SCHEMA_AT_0(MARSHAL_KIND_STRUCT, MARSHAL_FLAG_FALSE, &TPMS_ALG_PROPERTY_Schema);
+static const MARSHAL_FIELD TPMS_TAGGED_PROPERTY_Element = SCHEMA_AT_0(MARSHAL_KIND_STRUCT, MARSHAL_FLAG_FALSE, &TPMS_TAGGED_PROPERTY_Schema);
+static const MARSHAL_FIELD TPMS_PCR_SELECTION_Element = SCHEMA_AT_0(MARSHAL_KIND_LEAF, MARSHAL_FLAG_FALSE, &TPMS_PCR_SELECTION_Leaf);
+static const MARSHAL_FIELD TPMS_TAGGED_PCR_SELECT_Element = SCHEMA_AT_0(MARSHAL_KIND_LEAF, MARSHAL_FLAG_FALSE, &TPMS_TAGGED_PCR_SELECT_Leaf);
+static const MARSHAL_FIELD TPMS_TAGGED_POLICY_Element = SCHEMA_AT_0(MARSHAL_KIND_LEAF, MARSHAL_FLAG_FALSE, &TPMS_TAGGED_POLICY_Leaf);
+static const MARSHAL_FIELD TPMA_CC_Element = SCHEMA_AT_0(MARSHAL_KIND_LEAF, MARSHAL_FLAG_FALSE, &TPMA_CC_Leaf);
+static const MARSHAL_FIELD UINT32_Element = SCHEMA_AT_0(MARSHAL_KIND_UINT32, MARSHAL_FLAG_FALSE, NULL);
+#if         ALG_ECC
+static const MARSHAL_FIELD UINT16_Element = SCHEMA_AT_0(MARSHAL_KIND_UINT16, MARSHAL_FLAG_FALSE, NULL);
+#endif // ALG_ECC
+
+#define SCHEMA_LIST(List, Element, member, ElementType, words) \
+    static const MARSHAL_LIST List##_List = \
+    { &Element, (UINT16)offsetof(List, member), (UINT16)sizeof(ElementType), (UINT16)(words) }
+
+// Table 2:97 - Table 2:108 - Definitions of the TPML_ Structures used by TPMU_CAPABILITIES
+SCHEMA_LIST(TPML_ALG_PROPERTY, TPMS_ALG_PROPERTY_Element, algProperties, TPMS_ALG_PROPERTY, 0);
+SCHEMA_LIST(TPML_HANDLE, UINT32_Element, handle, TPM_HANDLE, 1);
+SCHEMA_LIST(TPML_CCA, TPMA_CC_Element, commandAttributes, TPMA_CC, 0);
+SCHEMA_LIST(TPML_CC, UINT32_Element, commandCodes, TPM_CC, 1);
+SCHEMA_LIST(TPML_PCR_SELECTION, TPMS_PCR_SELECTION_Element, pcrSelections, TPMS_PCR_SELECTION, 0);
+SCHEMA_LIST(TPML_TAGGED_TPM_PROPERTY, TPMS_TAGGED_PROPERTY_Element, tpmProperty, TPMS_TAGGED_PROPERTY,
+            (sizeof(TPMS_TAGGED_PROPERTY) == 2 * sizeof(UINT32)) ? 2 : 0);
+SCHEMA_LIST(TPML_TAGGED_PCR_PROPERTY, TPMS_TAGGED_PCR_SELECT_Element, pcrProperty, TPMS_TAGGED_PCR_SELECT, 0);
+#if         ALG_ECC
+SCHEMA_LIST(TPML_ECC_CURVE, UINT16_Element, eccCurves, TPM_ECC_CURVE, 0);
+#endif // ALG_ECC
+SCHEMA_LIST(TPML_TAGGED_POLICY, TPMS_TAGGED_POLICY_Element, policies, TPMS_TAGGED_POLICY, 0);
+
+static const MARSHAL_FIELD TPML_ALG_PROPERTY_Field = SCHEMA_LIST_FIELD(TPML_ALG_PROPERTY, MAX_CAP_ALGS, TPM_RC_VALUE);
+static const MARSHAL_FIELD TPML_HANDLE_Field = SCHEMA_LIST_FIELD(TPML_HANDLE, MAX_CAP_HANDLES, TPM_RC_SIZE);
+static const MARSHAL_FIELD TPML_CCA_Field = SCHEMA_LIST_FIELD(TPML_CCA, MAX_CAP_CC, TPM_RC_VALUE);
+static const MARSHAL_FIELD TPML_CC_Field = SCHEMA_LIST_FIELD(TPML_CC, MAX_CAP_CC, TPM_RC_SIZE);
+static const MARSHAL_FIELD TPML_PCR_SELECTION_Field = SCHEMA_LIST_FIELD(TPML_PCR_SELECTION, HASH_COUNT, TPM_RC_SIZE);
+static const MARSHAL_FIELD TPML_TAGGED_TPM_PROPERTY_Field = SCHEMA_LIST_FIELD(TPML_TAGGED_TPM_PROPERTY, MAX_TPM_PROPERTIES, TPM_RC_VALUE);
+static const MARSHAL_FIELD TPML_TAGGED_PCR_PROPERTY_Field = SCHEMA_LIST_FIELD(TPML_TAGGED_PCR_PROPERTY, MAX_PCR_PROPERTIES, TPM_RC_VALUE);
+#if         ALG_ECC
+static const MARSHAL_FIELD TPML_ECC_CURVE_Field = SCHEMA_LIST_FIELD(TPML_ECC_CURVE, MAX_ECC_CURVES, TPM_RC_VALUE);
+#endif // ALG_ECC
+static const MARSHAL_FIELD TPML_TAGGED_POLICY_Field = SCHEMA_LIST_FIELD(TPML_TAGGED_POLICY, MAX_TAGGED_POLICIES, TPM_RC_VALUE);
+
+// Table 2:109 - Definition of TPMU_CAPABILITIES Union
+static const MARSHAL_CASE TPMU_CAPABILITIES_Cases[] =
+{
+    { TPM_CAP_ALGS, &TPML_ALG_PROPERTY_Field },
+    { TPM_CAP_HANDLES, &TPML_HANDLE_Field },
+    { TPM_CAP_COMMANDS, &TPML_CCA_Field },
+    { TPM_CAP_PP_COMMANDS, &TPML_CC_Field },
+    { TPM_CAP_AUDIT_COMMANDS, &TPML_CC_Field },
+    { TPM_CAP_PCRS, &TPML_PCR_SELECTION_Field },
+    { TPM_CAP_TPM_PROPERTIES, &TPML_TAGGED_TPM_PROPERTY_Field },
+    { TPM_CAP_PCR_PROPERTIES, &TPML_TAGGED_PCR_PROPERTY_Field },
+#if         ALG_ECC
+    { TPM_CAP_ECC_CURVES, &TPML_ECC_CURVE_Field },
+#endif // ALG_ECC
+    { TPM_CAP_AUTH_POLICIES, &TPML_TAGGED_POLICY_Field }
+};
+static const MARSHAL_UNION TPMU_CAPABILITIES_Union =
+{
+    TPMU_CAPABILITIES_Cases, SCHEMA_COUNT(TPMU_CAPABILITIES_Cases),
+    (UINT16)offsetof(TPMS_CAPABILITY_DATA, capability), sizeof(TPM_CAP)
+};
+
+// Table 2:110 - Definition of TPMS_CAPABILITY_DATA Structure
+static const MARSHAL_FIELD TPMS_CAPABILITY_DATA_Fields[] =
+{
+    SCHEMA_LEAF_FIELD(TPMS_CAPABILITY_DATA, capability, TPM_CAP, MARSHAL_FLAG_FALSE),
+    SCHEMA_UNION_FIELD(TPMS_CAPABILITY_DATA, data, TPMU_CAPABILITIES, MARSHAL_FLAG_FALSE)
+};
+static const MARSHAL_SCHEMA TPMS_CAPABILITY_DATA_Schema = { TPMS_CAPABILITY_DATA_Fields, SCHEMA_COUNT(TPMS_CAPABILITY_DATA_Fields) };
+
+// Exported entry points, with the same signatures as the Marshal.c functions
+// they replace
+#define SCHEMA_EXPORT_STRUCT(Type)                                                  \
+    TPM_RC Type##_Unmarshal(Type *target, BYTE **buffer, INT32 *size)               \
+    {                                                                               \
+        return SchemaUnmarshalStruct(&Type##_Schema, (BYTE *)target, buffer, size, FALSE); \
+    }                                                                               \
+    UINT16 Type##_Marshal(Type *source, BYTE **buffer, INT32 *size)                 \
+    {                                                                               \
+        return SchemaMarshalStruct(&Type##_Schema, (BYTE *)source, buffer, size);   \
+    }
+
+#define SCHEMA_EXPORT_FIELD(Type)                                                   \
+    TPM_RC Type##_Unmarshal(Type *target, BYTE **buffer, INT32 *size)               \
+    {                                                                               \
+        return SchemaUnmarshalField(&Type##_Field, (BYTE *)target, buffer, size, FALSE); \
+    }                                                                               \
+    UINT16 Type##_Marshal(Type *source, BYTE **buffer, INT32 *size)                 \
+    {                                                                               \
+        return SchemaMarshalField(&Type##_Field, (BYTE *)source, buffer, size);     \
+    }
+
+#define SCHEMA_EXPORT_UNION(Type)                                                   \
+    TPM_RC Type##_Unmarshal(Type *target, BYTE **buffer, INT32 *size, UINT32 selector) \
+    {                                                                               \
+        return SchemaUnmarshalUnion(&Type##_Union, (BYTE *)target, selector, buffer, size, FALSE); \
+    }                                                                               \
+    UINT16 Type##_Marshal(Type *source, BYTE **buffer, INT32 *size, UINT32 selector) \
+    {                                                                               \
+        return SchemaMarshalUnion(&Type##_Union, (BYTE *)source, selector, buffer, size); \
+    }
+
+#if         ALG_RSA
+SCHEMA_EXPORT_STRUCT(TPMS_RSA_PARMS)
+#endif // ALG_RSA
+#if         ALG_ECC
+SCHEMA_EXPORT_STRUCT(TPMS_ECC_PARMS)
+SCHEMA_EXPORT_STRUCT(TPMS_ECC_POINT)
+#endif // ALG_ECC
+SCHEMA_EXPORT_UNION(TPMU_PUBLIC_PARMS)
+SCHEMA_EXPORT_UNION(TPMU_PUBLIC_ID)
+
+TPM_RC
+TPMT_PUBLIC_Unmarshal(TPMT_PUBLIC *target, BYTE **buffer, INT32 *size, BOOL flag)
+{
+    return SchemaUnmarshalStruct(&TPMT_PUBLIC_Schema, (BYTE *)target, buffer, size, flag);
+}
+
+UINT16
+TPMT_PUBLIC_Marshal(TPMT_PUBLIC *source, BYTE **buffer, INT32 *size)
+{
+    return SchemaMarshalStruct(&TPMT_PUBLIC_Schema, (BYTE *)source, buffer, size);
+}
+
+TPM_RC
+TPM2B_PUBLIC_Unmarshal(TPM2B_PUBLIC *target, BYTE **buffer, INT32 *size, BOOL flag)
+{
+    return SchemaUnmarshalField(&TPM2B_PUBLIC_Field, (BYTE *)target, buffer, size, flag);
+}
+
+UINT16
+TPM2B_PUBLIC_Marshal(TPM2B_PUBLIC *source, BYTE **buffer, INT32 *size)
+{
+    return SchemaMarshalField(&TPM2B_PUBLIC_Field, (BYTE *)source, buffer, size);
+}
+
+SCHEMA_EXPORT_STRUCT(TPMS_ALG_PROPERTY)
+SCHEMA_EXPORT_STRUCT(TPMS_TAGGED_PROPERTY)
+SCHEMA_EXPORT_FIELD(TPML_ALG_PROPERTY)
+SCHEMA_EXPORT_FIELD(TPML_HANDLE)
+SCHEMA_EXPORT_FIELD(TPML_CCA)
+SCHEMA_EXPORT_FIELD(TPML_CC)
+SCHEMA_EXPORT_FIELD(TPML_PCR_SELECTION)
+SCHEMA_EXPORT_FIELD(TPML_TAGGED_TPM_PROPERTY)
+SCHEMA_EXPORT_FIELD(TPML_TAGGED_PCR_PROPERTY)
+#if         ALG_ECC
+SCHEMA_EXPORT_FIELD(TPML_ECC_CURVE)
+#endif // ALG_ECC
+SCHEMA_EXPORT_FIELD(TPML_TAGGED_POLICY)
+SCHEMA_EXPORT_UNION(TPMU_CAPABILITIES)
+SCHEMA_EXPORT_STRUCT(TPMS_CAPABILITY_DATA)
+
+#endif // USE_MARSHAL_SCHEMA
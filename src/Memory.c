@@ -251,3 +251,77 @@ UINT64 ByteArrayToUint64(BYTE* a)
     return retVal;
 }
 #endif // INLINE_FUNCTIONS
+
+//*** ByteArrayToUint32Array()
+// Converts 'count' consecutive big-endian 32-bit words from 'a' into 'target'. The
+// caller has checked that 'a' holds 4 * 'count' bytes. 'target' and 'a' may not
+// overlap. The words are swapped 16 at a time with SSSE3 (selected at run time) or
+// NEON when available, and the rest one at a time.
+#if LITTLE_ENDIAN_TPM == YES && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#   define BULK_SWAP_SSSE3
+#   include <tmmintrin.h>
+#elif LITTLE_ENDIAN_TPM == YES && defined(__ARM_NEON)
+#   define BULK_SWAP_NEON
+#   include <arm_neon.h>
+#endif
+
+#ifdef BULK_SWAP_SSSE3
+__attribute__((target("ssse3")))
+static INT32 ByteArrayToUint32ArraySsse3(UINT32 *target, const BYTE *a, INT32 count)
+{
+    const __m128i   swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    INT32           i;
+    for (i = 0; i + 16 <= count; i += 16)
+    {
+        __m128i w0 = _mm_loadu_si128((const __m128i *)(a + 4 * i));
+        __m128i w1 = _mm_loadu_si128((const __m128i *)(a + 4 * i + 16));
+        __m128i w2 = _mm_loadu_si128((const __m128i *)(a + 4 * i + 32));
+        __m128i w3 = _mm_loadu_si128((const __m128i *)(a + 4 * i + 48));
+        _mm_storeu_si128((__m128i *)(target + i), _mm_shuffle_epi8(w0, swap));
+        _mm_storeu_si128((__m128i *)(target + i + 4), _mm_shuffle_epi8(w1, swap));
+        _mm_storeu_si128((__m128i *)(target + i + 8), _mm_shuffle_epi8(w2, swap));
+        _mm_storeu_si128((__m128i *)(target + i + 12), _mm_shuffle_epi8(w3, swap));
+    }
+    return i;
+}
+#endif // BULK_SWAP_SSSE3
+
+#ifdef BULK_SWAP_NEON
+static INT32 ByteArrayToUint32ArrayNeon(UINT32 *target, const BYTE *a, INT32 count)
+{
+    INT32           i;
+    for (i = 0; i + 16 <= count; i += 16)
+    {
+        uint8x16_t w0 = vld1q_u8(a + 4 * i);
+        uint8x16_t w1 = vld1q_u8(a + 4 * i + 16);
+        uint8x16_t w2 = vld1q_u8(a + 4 * i + 32);
+        uint8x16_t w3 = vld1q_u8(a + 4 * i + 48);
+        vst1q_u8((uint8_t *)(target + i), vrev32q_u8(w0));
+        vst1q_u8((uint8_t *)(target + i + 4), vrev32q_u8(w1));
+        vst1q_u8((uint8_t *)(target + i + 8), vrev32q_u8(w2));
+        vst1q_u8((uint8_t *)(target + i + 12), vrev32q_u8(w3));
+    }
+    return i;
+}
+#endif // BULK_SWAP_NEON
+
+void ByteArrayToUint32Array(
+    UINT32              *target,
+    const BYTE          *a,
+    INT32                count
+    )
+{
+    INT32       i = 0;
+#if defined(BULK_SWAP_SSSE3)
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        i = ByteArrayToUint32ArraySsse3(target, a, count);
+    }
+#elif defined(BULK_SWAP_NEON)
+    i = ByteArrayToUint32ArrayNeon(target, a, count);
+#endif
+    for (; i < count; i++)
+    {
+        target[i] = BYTE_ARRAY_TO_UINT32(a + 4 * i);
+    }
+}
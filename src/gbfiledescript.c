@@ -12,6 +12,7 @@
 #else // WIN32
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #ifdef __APPLE__
 #include <string.h>
 #endif // __APPLE__
@@ -74,3 +75,27 @@ int gbfiledesc_open(const char* path, int flags)
     return open(path, flags);
 #endif
 }
+
+int gbfiledesc_fcntl(int fd, int cmd, int arg)
+{
+#ifdef WIN32
+    (void)fd;
+    (void)cmd;
+    (void)arg;
+    return 0;
+#else
+    return fcntl(fd, cmd, arg);
+#endif
+}
+
+int gbfiledesc_poll(struct pollfd* fds, unsigned long nfds, int timeout)
+{
+#ifdef WIN32
+    (void)fds;
+    (void)nfds;
+    (void)timeout;
+    return 0;
+#else
+    return poll(fds, (nfds_t)nfds, timeout);
+#endif
+}
@@ -18,15 +18,31 @@
 #include "azure_utpm_c/Marshal_fp.h"
 
 #define MAX_COMMAND_BUFFER      4096
-#define MAX_RESPONSE_BUFFER     MAX_COMMAND_BUFFER
+#define MAX_RESPONSE_BUFFER     TSS_MAX_RESPONSE_SIZE
 #define USE_HMAC_SEQ            0
 #define TSS_BAD_PROPERTY        ((UINT32)-1)
+#define TSS_CACHE_LINE_SIZE     64
+
+// Space reserved in the command buffer for the largest possible command header,
+// handles and authorization area
+#define TSS_CMD_HEADER_RESERVE  (STD_RESPONSE_HEADER                            \
+                                 + MAX_HANDLE_NUM * sizeof(TPM_HANDLE)          \
+                                 + sizeof(UINT32)                               \
+                                 + MAX_SESSION_NUM * sizeof(TPMS_AUTH_COMMAND))
+
+// Space left for the command parameters, as the header takes at least
+// STD_RESPONSE_HEADER bytes of MAX_COMMAND_BUFFER
+#define TSS_MAX_CMD_PARAMS_SIZE (MAX_COMMAND_BUFFER - STD_RESPONSE_HEADER)
+
+#define TSS_CMD_PARAMS(cmdCtx)  ((cmdCtx)->CmdBuffer + TSS_CMD_HEADER_RESERVE)
 
 // Forward Declarations
 static UINT16              NullSize = 0;
 static TPMT_SYM_DEF        NullSymDef = { TPM_ALG_NULL , {0}, { TPM_ALG_NULL } };
 static TPMT_SYM_DEF_OBJECT NullSymDefObject = { TPM_ALG_NULL, {0}, {TPM_ALG_NULL} };
-static TPMT_SIG_SCHEME     NullSigScheme = { TPM_ALG_NULL, { {TPM_ALG_NULL} } };
+// The first member of TPMU_SIG_SCHEME depends on the algorithm profile, so the
+// scheme independent one is named
+static TPMT_SIG_SCHEME     NullSigScheme = { TPM_ALG_NULL, { .any = { TPM_ALG_NULL } } };
 static TPMT_TK_HASHCHECK   NullHashTk = { TPM_ST_HASHCHECK, TPM_RH_NULL, {{0}} };
 static const UINT32 DPS_ID_KEY_HANDLE = HR_PERSISTENT | 0x00000100;
 
@@ -34,19 +50,21 @@ typedef const char* (*ErrCodeMsgFnPtr)(UINT32 msgID);
 
 static const char* TSS_StatusValueName(UINT32 rc);
 
-typedef struct
+typedef struct TSS_CMD_CONTEXT_TAG
 {
-    // IN: Size of parameters buffer (bytes)
+    // IN: Size of parameters marshaled at TSS_CMD_PARAMS(cmdCtx) (bytes)
     UINT32      ParamSize;
 
-    // IN: Parameters buffer (in TPM representation)
-    BYTE        ParamBuffer[MAX_COMMAND_BUFFER];
-
     // OUT: Comamnd buffer size (bytes)
     UINT32      CmdSize;
 
-    // OUT: Comamnd buffer (in TPM representation)
-    BYTE        CmdBuffer[MAX_COMMAND_BUFFER];
+    // OUT: Beginning of the command in CmdBuffer
+    BYTE       *CmdStart;
+
+    // IN/OUT: Comamnd buffer (in TPM representation). Parameters are marshaled in
+    //      place after the first TSS_CMD_HEADER_RESERVE bytes, and the header,
+    //      handles and authorization area are marshaled right in front of them.
+    BYTE        CmdBuffer[TSS_CMD_HEADER_RESERVE + TSS_MAX_CMD_PARAMS_SIZE];
 
     // OUT: Total size of the response buffer (bytes)
     UINT32      RespSize;
@@ -68,6 +86,257 @@ typedef struct
     UINT32      RespParamSize;
 } TSS_CMD_CONTEXT;
 
+// Distance between the contexts in the pool, rounded up to a whole number of cache lines
+#define TSS_CMD_CTX_STRIDE  \
+    ((sizeof(TSS_CMD_CONTEXT) + TSS_CACHE_LINE_SIZE - 1) & ~((size_t)TSS_CACHE_LINE_SIZE - 1))
+
+typedef struct TSS_CMD_CONTEXT_POOL_TAG
+{
+    // Number of contexts in the pool
+    UINT32      Size;
+
+    // Bit mask of the contexts currently used by a command
+    UINT32      InUse;
+
+    // Cache line aligned array of 'Size' contexts located TSS_CMD_CTX_STRIDE bytes apart
+    BYTE       *Contexts;
+} TSS_CMD_CONTEXT_POOL;
+
+typedef struct TSS_PREPARED_CMD_TAG
+{
+    // Command code of the prepared command
+    TPM_CC          CmdCode;
+
+    // Size of the header, handles and authorization area marshaled at CmdCtx.CmdStart
+    UINT32          HeaderSize;
+
+    // Context owned by the prepared command. Its header part is marshaled once by
+    // TSS_PrepareCommand(), and only the parameters and the command size change later.
+    TSS_CMD_CONTEXT CmdCtx;
+} TSS_PREPARED_CMD;
+
+typedef struct TSS_BATCH_STEP_TAG
+{
+    // Command code of the step
+    TPM_CC          CmdCode;
+
+    // Handles used by the command. TSS_BATCH_STEP_HANDLE() placeholders are replaced
+    // with the handles returned by the earlier steps when the step is executed.
+    TPM_HANDLE      Handles[MAX_HANDLE_NUM];
+    INT32           NumHandles;
+
+    // Authorization session, if the command takes one
+    TSS_SESSION    *Session;
+
+    // Command specific parameters and output buffers
+    union
+    {
+        struct
+        {
+            TPM2B_PUBLIC   *outPublic;
+            TPM2B_NAME     *name;
+            TPM2B_NAME     *qualifiedName;
+        } ReadPublic;
+        struct
+        {
+            TPM2B_PUBLIC   *inPublic;
+            TPM2B_PUBLIC   *outPublic;
+        } CreatePrimary;
+        struct
+        {
+            TPMI_DH_PERSISTENT persistentHandle;
+        } EvictControl;
+    } Args;
+
+    // OUT: Result of the step, or TPM_RC_NOT_USED if it was not executed
+    TPM_RC          Result;
+
+    // OUT: Handle returned by the step, or TPM_RH_UNASSIGNED
+    TPM_HANDLE      RetHandle;
+} TSS_BATCH_STEP;
+
+typedef struct TSS_BATCH_TAG
+{
+    UINT32          NumSteps;
+    TSS_BATCH_STEP  Steps[TSS_MAX_BATCH_STEPS];
+} TSS_BATCH;
+
+// Range of the TPM 2.0 command codes
+#define TPM_CC_FIRST            (TPM_CC)(0x0000011f)
+#define TPM_CC_LAST             (TPM_CC)(0x00000193)
+
+// TSS_CMD_DESC flags
+#define TSS_CMD_DEFINED         0x01    // The command code is assigned
+#define TSS_CMD_RET_HANDLE      0x02    // The response has a handle area with one handle
+
+typedef struct
+{
+    // Number of handles in the handle area of the command
+    BYTE    NumHandles;
+
+    // Number of those handles that require an authorization session
+    BYTE    NumAuthHandles;
+
+    // A set of TSS_CMD_* flags
+    BYTE    Flags;
+} TSS_CMD_DESC;
+
+#define TSS_CMD(cmdName, numHandles, numAuthHandles, flags) \
+    [TPM_CC_##cmdName - TPM_CC_FIRST] = { numHandles, numAuthHandles, TSS_CMD_DEFINED | (flags) }
+
+// Command descriptors indexed by (cmdCode - TPM_CC_FIRST), see TSS_GetCmdDesc().
+// The gaps between the assigned command codes, and the commands disabled in
+// Implementation.h (field upgrade, and the RSA or ECC commands left out by the
+// algorithm profile), are left zeroed.
+static const TSS_CMD_DESC TSS_CmdDescs[TPM_CC_LAST - TPM_CC_FIRST + 1] =
+{
+    TSS_CMD(NV_UndefineSpaceSpecial,    2, 2, 0),
+    TSS_CMD(EvictControl,               2, 1, 0),
+    TSS_CMD(HierarchyControl,           1, 1, 0),
+    TSS_CMD(NV_UndefineSpace,           2, 1, 0),
+    TSS_CMD(ChangeEPS,                  1, 1, 0),
+    TSS_CMD(ChangePPS,                  1, 1, 0),
+    TSS_CMD(Clear,                      1, 1, 0),
+    TSS_CMD(ClearControl,               1, 1, 0),
+    TSS_CMD(ClockSet,                   1, 1, 0),
+    TSS_CMD(HierarchyChangeAuth,        1, 1, 0),
+    TSS_CMD(NV_DefineSpace,             1, 1, 0),
+    TSS_CMD(PCR_Allocate,               1, 1, 0),
+    TSS_CMD(PCR_SetAuthPolicy,          1, 1, 0),
+    TSS_CMD(PP_Commands,                1, 1, 0),
+    TSS_CMD(SetPrimaryPolicy,           1, 1, 0),
+    TSS_CMD(ClockRateAdjust,            1, 1, 0),
+    TSS_CMD(CreatePrimary,              1, 1, TSS_CMD_RET_HANDLE),
+    TSS_CMD(NV_GlobalWriteLock,         1, 1, 0),
+    TSS_CMD(GetCommandAuditDigest,      2, 2, 0),
+    TSS_CMD(NV_Increment,               2, 1, 0),
+    TSS_CMD(NV_SetBits,                 2, 1, 0),
+    TSS_CMD(NV_Extend,                  2, 1, 0),
+    TSS_CMD(NV_Write,                   2, 1, 0),
+    TSS_CMD(NV_WriteLock,               2, 1, 0),
+    TSS_CMD(DictionaryAttackLockReset,  1, 1, 0),
+    TSS_CMD(DictionaryAttackParameters, 1, 1, 0),
+    TSS_CMD(NV_ChangeAuth,              1, 1, 0),
+    TSS_CMD(PCR_Event,                  1, 1, 0),
+    TSS_CMD(PCR_Reset,                  1, 1, 0),
+    TSS_CMD(SequenceComplete,           1, 1, 0),
+    TSS_CMD(SetAlgorithmSet,            1, 1, 0),
+    TSS_CMD(SetCommandCodeAuditStatus,  1, 1, 0),
+    TSS_CMD(IncrementalSelfTest,        0, 0, 0),
+    TSS_CMD(SelfTest,                   0, 0, 0),
+    TSS_CMD(Startup,                    0, 0, 0),
+    TSS_CMD(Shutdown,                   0, 0, 0),
+    TSS_CMD(StirRandom,                 0, 0, 0),
+    TSS_CMD(ActivateCredential,         2, 2, 0),
+    TSS_CMD(Certify,                    2, 2, 0),
+    TSS_CMD(PolicyNV,                   3, 1, 0),
+    TSS_CMD(CertifyCreation,            2, 1, 0),
+    TSS_CMD(Duplicate,                  2, 1, 0),
+    TSS_CMD(GetTime,                    2, 2, 0),
+    TSS_CMD(GetSessionAuditDigest,      3, 2, 0),
+    TSS_CMD(NV_Read,                    2, 1, 0),
+    TSS_CMD(NV_ReadLock,                2, 1, 0),
+    TSS_CMD(ObjectChangeAuth,           2, 1, 0),
+    TSS_CMD(PolicySecret,               2, 1, 0),
+    TSS_CMD(Rewrap,                     2, 1, 0),
+    TSS_CMD(Create,                     1, 1, 0),
+#if CC_ECDH_ZGen
+    TSS_CMD(ECDH_ZGen,                  1, 1, 0),
+#endif
+    TSS_CMD(HMAC,                       1, 1, 0),
+    TSS_CMD(Import,                     1, 1, 0),
+    TSS_CMD(Load,                       1, 1, TSS_CMD_RET_HANDLE),
+    TSS_CMD(Quote,                      1, 1, 0),
+#if CC_RSA_Decrypt
+    TSS_CMD(RSA_Decrypt,                1, 1, 0),
+#endif
+    TSS_CMD(HMAC_Start,                 1, 1, TSS_CMD_RET_HANDLE),
+    TSS_CMD(SequenceUpdate,             1, 1, 0),
+    TSS_CMD(Sign,                       1, 1, 0),
+    TSS_CMD(Unseal,                     1, 1, 0),
+    TSS_CMD(PolicySigned,               2, 0, 0),
+    TSS_CMD(ContextLoad,                0, 0, TSS_CMD_RET_HANDLE),
+    TSS_CMD(ContextSave,                1, 0, 0),
+#if CC_ECDH_KeyGen
+    TSS_CMD(ECDH_KeyGen,                1, 0, 0),
+#endif
+    TSS_CMD(EncryptDecrypt,             1, 1, 0),
+    // The flushed handle is a parameter, but it is marshaled the same way as a handle
+    TSS_CMD(FlushContext,               1, 0, 0),
+    TSS_CMD(LoadExternal,               0, 0, TSS_CMD_RET_HANDLE),
+    TSS_CMD(MakeCredential,             1, 0, 0),
+    TSS_CMD(NV_ReadPublic,              1, 0, 0),
+    TSS_CMD(PolicyAuthorize,            1, 0, 0),
+    TSS_CMD(PolicyAuthValue,            1, 0, 0),
+    TSS_CMD(PolicyCommandCode,          1, 0, 0),
+    TSS_CMD(PolicyCounterTimer,         1, 0, 0),
+    TSS_CMD(PolicyCpHash,               1, 0, 0),
+    TSS_CMD(PolicyLocality,             1, 0, 0),
+    TSS_CMD(PolicyNameHash,             1, 0, 0),
+    TSS_CMD(PolicyOR,                   1, 0, 0),
+    TSS_CMD(PolicyTicket,               1, 0, 0),
+    TSS_CMD(ReadPublic,                 1, 0, 0),
+#if CC_RSA_Encrypt
+    TSS_CMD(RSA_Encrypt,                1, 0, 0),
+#endif
+    TSS_CMD(StartAuthSession,           2, 0, TSS_CMD_RET_HANDLE),
+    TSS_CMD(VerifySignature,            1, 0, 0),
+#if CC_ECC_Parameters
+    TSS_CMD(ECC_Parameters,             0, 0, 0),
+#endif
+    TSS_CMD(GetCapability,              0, 0, 0),
+    TSS_CMD(GetRandom,                  0, 0, 0),
+    TSS_CMD(GetTestResult,              0, 0, 0),
+    TSS_CMD(Hash,                       0, 0, 0),
+    TSS_CMD(PCR_Read,                   0, 0, 0),
+    TSS_CMD(PolicyPCR,                  1, 0, 0),
+    TSS_CMD(PolicyRestart,              1, 0, 0),
+    TSS_CMD(ReadClock,                  0, 0, 0),
+    TSS_CMD(PCR_Extend,                 1, 1, 0),
+    TSS_CMD(PCR_SetAuthValue,           1, 1, 0),
+    TSS_CMD(NV_Certify,                 3, 2, 0),
+    TSS_CMD(EventSequenceComplete,      2, 2, 0),
+    TSS_CMD(HashSequenceStart,          0, 0, TSS_CMD_RET_HANDLE),
+    TSS_CMD(PolicyPhysicalPresence,     1, 0, 0),
+    TSS_CMD(PolicyDuplicationSelect,    1, 0, 0),
+    TSS_CMD(PolicyGetDigest,            1, 0, 0),
+    TSS_CMD(TestParms,                  0, 0, 0),
+#if CC_Commit
+    TSS_CMD(Commit,                     1, 1, 0),
+#endif
+    TSS_CMD(PolicyPassword,             1, 0, 0),
+#if CC_ZGen_2Phase
+    TSS_CMD(ZGen_2Phase,                1, 1, 0),
+#endif
+#if CC_EC_Ephemeral
+    TSS_CMD(EC_Ephemeral,               0, 0, 0),
+#endif
+    TSS_CMD(PolicyNvWritten,            1, 0, 0),
+    TSS_CMD(PolicyTemplate,             1, 0, 0),
+    TSS_CMD(CreateLoaded,               1, 1, TSS_CMD_RET_HANDLE),
+    TSS_CMD(PolicyAuthorizeNV,          3, 1, 0),
+    TSS_CMD(EncryptDecrypt2,            1, 1, 0),
+};
+
+// Returns the descriptor of the command, or NULL if the command code is not assigned
+static const TSS_CMD_DESC*
+TSS_GetCmdDesc(
+    TPM_CC           cmdCode        // IN: Command code
+)
+{
+    const TSS_CMD_DESC* result = NULL;
+    if (cmdCode >= TPM_CC_FIRST && cmdCode <= TPM_CC_LAST
+        && (TSS_CmdDescs[cmdCode - TPM_CC_FIRST].Flags & TSS_CMD_DEFINED) != 0)
+    {
+        result = &TSS_CmdDescs[cmdCode - TPM_CC_FIRST];
+    }
+    return result;
+}
+
+static TSS_CMD_CONTEXT* TSS_AcquireCmdContext(TSS_DEVICE* tpm);
+static void TSS_ReleaseCmdContext(TSS_DEVICE* tpm, TSS_CMD_CONTEXT* cmdCtx);
+static TPM_RC TSS_FillFixedProperties(TSS_DEVICE* tpm);
+
 TPM_RC
 TSS_DispatchCmd(
     TSS_DEVICE      *tpm,           // IN
@@ -80,24 +349,145 @@ TSS_DispatchCmd(
                                     //     On output contains complete command and response buffers
 );
 
+// Asynchronous counterpart of TSS_ExecuteCmd() for a command handed to the TPM with
+// TSS_SubmitCmd(). Returns TSS_E_TPM_PENDING until the TPM response is available, and
+// then parses it the same way TSS_DispatchCmd() does. 'cmdCtx' must stay untouched in
+// between.
+static TPM_RC
+TSS_CompleteCmdAsync(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode,       // IN: Command code
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: Context the command was dispatched from
+                                    //     On output contains response buffer
+);
+
+static TPM_RC
+TSS_DispatchPreparedCmd(
+    TSS_DEVICE         *tpm,        // IN
+    TSS_PREPARED_CMD   *preparedCmd // IN/OUT: Prepared command with the parameters marshaled
+);
+
+static TPM_RC
+TSS_SubmitPreparedCmd(
+    TSS_DEVICE         *tpm,        // IN
+    TSS_PREPARED_CMD   *preparedCmd // IN/OUT: Prepared command with the parameters marshaled
+);
+
+static TPM_RC
+TSS_ExecuteCmd(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode,       // IN: Command code
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: On input contains complete command buffer
+                                    //     On output contains response buffer
+);
+
+// Hands the command built in 'cmdCtx' to the TPM as the pending command of 'tpm'. The
+// context stays checked out until the command is completed with TSS_CompleteCmdAsync().
+static TPM_RC
+TSS_SubmitPendingCmd(
+    TSS_DEVICE      *tpm,           // IN/OUT
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: On input contains initialized parameter buffer
+                                    //     On output contains complete command buffer
+);
+
+// TRUE if 'cmdCode' is the command pending on 'tpm'
+static BOOL
+TSS_IsCmdPending(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode        // IN: Command code
+);
+
+// Every command checks out a context from the TPM device pool in BEGIN_CMD(), and
+// returns it in END_CMD(). Failures after BEGIN_CMD() must leave via TSS_ABORT_CMD()
+// so that the context is always released.
 #define BEGIN_CMD()  \
     TPM_RC           cmdResult = TPM_RC_SUCCESS;                            \
-    TSS_CMD_CONTEXT *cmdCtx = &CmdCtx;                                      \
-    INT32            sizeParamBuf = sizeof(cmdCtx->ParamBuffer);            \
-    BYTE            *paramBuf = cmdCtx->ParamBuffer;                        \
+    TSS_CMD_CONTEXT *cmdCtx = TSS_AcquireCmdContext(tpm);                   \
+    INT32            sizeParamBuf;                                          \
+    BYTE            *paramBuf;                                              \
+    if (cmdCtx == NULL)                                                     \
+        return TPM_RC_FAILURE;                                              \
+    sizeParamBuf = TSS_MAX_CMD_PARAMS_SIZE;                                 \
+    paramBuf = TSS_CMD_PARAMS(cmdCtx);                                      \
     (void)sizeParamBuf;                                                     \
     (void)paramBuf;                                                         \
     cmdCtx->ParamSize = 0
 
 #define END_CMD()  \
+end_cmd:                                                                    \
+    TSS_ReleaseCmdContext(tpm, cmdCtx);                                     \
+    return cmdResult
+
+// Prepared commands use their own context, which already contains the command header
+#define BEGIN_PREPARED_CMD(preparedCmd)  \
+    TPM_RC           cmdResult = TPM_RC_SUCCESS;                            \
+    TSS_CMD_CONTEXT *cmdCtx = &(preparedCmd)->CmdCtx;                       \
+    INT32            sizeParamBuf = TSS_MAX_CMD_PARAMS_SIZE;                \
+    BYTE            *paramBuf = TSS_CMD_PARAMS(cmdCtx);                     \
+    cmdCtx->ParamSize = 0
+
+#define END_PREPARED_CMD()  \
+end_cmd:                                                                    \
+    return cmdResult
+
+#define DISPATCH_PREPARED_CMD(preparedCmd) \
+    cmdResult = TSS_DispatchPreparedCmd(tpm, preparedCmd);                  \
+    if (cmdResult != TPM_RC_SUCCESS)                                        \
+        goto end_cmd;
+
+#define SUBMIT_PREPARED_CMD(preparedCmd) \
+    cmdResult = TSS_SubmitPreparedCmd(tpm, preparedCmd);                    \
+    if (cmdResult != TPM_RC_SUCCESS)                                        \
+        goto end_cmd;
+
+// Asynchronous commands start like the other commands with BEGIN_CMD(), but keep their
+// context as the pending command of the device until the matching completion parses
+// the response. The context is only released by END_SUBMIT_CMD() if the submission failed.
+#define SUBMIT_CMD(cmdName, pHandles, numHandles, pSessions, numSessions) \
+    cmdResult = TSS_SubmitPendingCmd(tpm, TPM_CC_##cmdName,                     \
+                                     pHandles, numHandles, pSessions, numSessions, \
+                                     cmdCtx);                                   \
+    if (cmdResult != TPM_RC_SUCCESS)                                            \
+        goto end_cmd;
+
+#define END_SUBMIT_CMD()  \
+end_cmd:                                                                    \
+    if (cmdResult != TPM_RC_SUCCESS)                                        \
+        TSS_ReleaseCmdContext(tpm, cmdCtx);                                 \
+    return cmdResult
+
+// Returns TSS_E_TPM_PENDING, keeping the command pending, until the response arrives
+#define BEGIN_COMPLETE_CMD(cmdName)  \
+    TSS_CMD_CONTEXT *cmdCtx = tpm->PendingCmdCtx;                           \
+    TPM_RC           cmdResult = TSS_CompleteCmdAsync(tpm, TPM_CC_##cmdName, cmdCtx); \
+    if (cmdResult == TSS_E_TPM_PENDING)                                     \
+        return cmdResult;                                                   \
+    if (cmdResult != TPM_RC_SUCCESS)                                        \
+        goto end_cmd
+
+#define END_COMPLETE_CMD()  \
+end_cmd:                                                                    \
+    tpm->PendingCmdCtx = NULL;                                              \
+    TSS_ReleaseCmdContext(tpm, cmdCtx);                                     \
     return cmdResult
 
+#define TSS_ABORT_CMD(rc) \
+{                                                                           \
+    cmdResult = rc;                                                         \
+    goto end_cmd;                                                           \
+}
+
 #define DISPATCH_CMD(cmdName, pHandles, numHandles, pSessions, numSessions) \
     cmdResult = TSS_DispatchCmd(tpm, TPM_CC_##cmdName,                          \
                                 pHandles, numHandles, pSessions, numSessions,   \
                                 cmdCtx);                                        \
     if (cmdResult != TPM_RC_SUCCESS)                                            \
-        return cmdResult;
+        goto end_cmd;
 
 // Standard TPM marshaling macros forcefully cast their first argument to the
 // corresponding pointer type, which hides potential errors when a value type is used
@@ -112,32 +502,78 @@ TSS_DispatchCmd(
     cmdCtx->ParamSize += Type##_Marshal(pValue, &paramBuf, &sizeParamBuf);  \
 }
 
+// Marshals a parameter of variable size only if all of it fits in the rest of the
+// parameter buffer. An oversized parameter fails the command before any of it is written.
+#define TSS_MARSHAL_SIZED(Type, pValue) \
+{                                                                           \
+    TSS_CHECK_PTR(pValue)                                                   \
+    if (TPM_MARSHAL_SIZE(Type, pValue) > sizeParamBuf)                      \
+    {                                                                       \
+        LogError("%s parameter exceeds the command buffer.", #Type);        \
+        TSS_ABORT_CMD(TPM_RC_COMMAND_SIZE);                                 \
+    }                                                                       \
+    cmdCtx->ParamSize += Type##_Marshal(pValue, &paramBuf, &sizeParamBuf);  \
+}
+
 #define TSS_MARSHAL_OPT2B(Type, pValue) \
     if (pValue != NULL)                 \
         TSS_MARSHAL(Type, pValue)       \
     else                                \
         TSS_MARSHAL(UINT16, &NullSize)
 
+// Marshals a TPM2B directly from the caller's buffer, without an intermediate
+// TPM2B structure.
+#define TSS_MARSHAL_BYTES(pData, dataSize) \
+{                                                                           \
+    UINT16  size2B = (UINT16)(dataSize);                                    \
+    if ((INT32)sizeof(UINT16) + size2B > sizeParamBuf)                      \
+    {                                                                       \
+        LogError("Data of %u bytes exceeds the command buffer.", size2B);   \
+        TSS_ABORT_CMD(TPM_RC_COMMAND_SIZE);                                 \
+    }                                                                       \
+    TSS_MARSHAL(UINT16, &size2B);                                           \
+    if (size2B > 0)                                                         \
+        cmdCtx->ParamSize += BYTE_Array_Marshal(pData, &paramBuf, &sizeParamBuf, size2B); \
+}
+
 #define TSS_UNMARSHAL(Type, pValue) \
 {                                                                                   \
     if (   Type##_Unmarshal(pValue, &cmdCtx->RespBufPtr, (INT32*)&cmdCtx->RespBytesLeft)    \
         != TPM_RC_SUCCESS)                                                          \
-        return TPM_RC_INSUFFICIENT;                                                 \
+        TSS_ABORT_CMD(TPM_RC_INSUFFICIENT);                                         \
 }
 
+// Outputs the caller passed NULL for are skipped over without being decoded
 #define TSS_UNMARSHAL_OPT(Type, pValue) \
-    if (!(pValue)) {                        \
-        Type  val;                          \
-        TSS_UNMARSHAL(Type, &val);          \
-    }                                       \
-    else                                    \
+    if (!(pValue)) {                                                                \
+        if (Type##_Skip(&cmdCtx->RespBufPtr, (INT32*)&cmdCtx->RespBytesLeft)        \
+            != TPM_RC_SUCCESS)                                                      \
+            TSS_ABORT_CMD(TPM_RC_INSUFFICIENT);                                     \
+    }                                                                               \
+    else                                                                            \
         TSS_UNMARSHAL(Type, pValue)
 
 #define TSS_UNMARSHAL_FLAGGED(Type, pValue) \
 {                                                                                       \
     if (   Type##_Unmarshal(pValue, &cmdCtx->RespBufPtr, (INT32*)&cmdCtx->RespBytesLeft, TRUE)  \
         != TPM_RC_SUCCESS)                                                              \
-        return TPM_RC_INSUFFICIENT;                                                     \
+        TSS_ABORT_CMD(TPM_RC_INSUFFICIENT);                                             \
+}
+
+// Moves the response parameters that are not unmarshaled yet to the caller's buffer,
+// so that the views created by TSS_UNMARSHAL_VIEW() outlive the command context
+#define TSS_RETAIN_RESPONSE(pRespBuffer) \
+{                                                                                       \
+    memcpy((pRespBuffer)->Buffer, cmdCtx->RespBufPtr, cmdCtx->RespBytesLeft);           \
+    (pRespBuffer)->Size = cmdCtx->RespBytesLeft;                                        \
+    cmdCtx->RespBufPtr = (pRespBuffer)->Buffer;                                         \
+}
+
+#define TSS_UNMARSHAL_VIEW(pView) \
+{                                                                                       \
+    if (   TSS_UnmarshalBytesView(&cmdCtx->RespBufPtr, (INT32*)&cmdCtx->RespBytesLeft, pView) \
+        != TPM_RC_SUCCESS)                                                              \
+        TSS_ABORT_CMD(TPM_RC_INSUFFICIENT);                                             \
 }
 
 #define TSS_COPY2B(dst2b, src2b) \
@@ -198,6 +634,195 @@ static TPM_RC CleanResponseCode(TPM_RC rawResponse)
     return rawResponse & mask;
 }
 
+static TSS_CMD_CONTEXT_POOL* TSS_CreateCmdContextPool(UINT32 poolSize)
+{
+    TSS_CMD_CONTEXT_POOL* result;
+    if (poolSize == 0)
+    {
+        poolSize = TSS_DEFAULT_CMD_CTX_POOL_SIZE;
+    }
+
+    // The pool descriptor and the contexts share a single allocation. Extra cache line
+    // is reserved to align the first context.
+    if ((result = (TSS_CMD_CONTEXT_POOL*)malloc(sizeof(TSS_CMD_CONTEXT_POOL) + TSS_CACHE_LINE_SIZE + poolSize * TSS_CMD_CTX_STRIDE)) == NULL)
+    {
+        LogError("Failure allocating command context pool of size %u", poolSize);
+    }
+    else
+    {
+        uintptr_t contexts = (uintptr_t)(result + 1);
+        contexts = (contexts + TSS_CACHE_LINE_SIZE - 1) & ~((uintptr_t)TSS_CACHE_LINE_SIZE - 1);
+
+        result->Size = poolSize;
+        result->InUse = 0;
+        result->Contexts = (BYTE*)contexts;
+    }
+    return result;
+}
+
+static TSS_CMD_CONTEXT* TSS_AcquireCmdContext(TSS_DEVICE* tpm)
+{
+    TSS_CMD_CONTEXT* result;
+    if (tpm == NULL)
+    {
+        LogError("Invalid parameter tpm is NULL");
+        result = NULL;
+    }
+    else
+    {
+        TSS_CMD_CONTEXT_POOL* pool = tpm->CmdCtxPool;
+        UINT32 index = 0;
+
+        if (pool != NULL)
+        {
+            // Contexts are claimed atomically, as the device may be shared by several
+            // threads when a dispatcher is running
+            UINT32 inUse = ATOMIC_LOAD_32(&pool->InUse);
+            while (index < pool->Size)
+            {
+                if ((inUse & (1u << index)) != 0)
+                {
+                    index++;
+                }
+                else if (ATOMIC_COMPARE_EXCHANGE_32(&pool->InUse, inUse, inUse | (1u << index)))
+                {
+                    break;
+                }
+                else
+                {
+                    // Lost the race for this context. Rescan with the current state.
+                    inUse = ATOMIC_LOAD_32(&pool->InUse);
+                    index = 0;
+                }
+            }
+        }
+
+        if (pool != NULL && index < pool->Size)
+        {
+            result = (TSS_CMD_CONTEXT*)(pool->Contexts + index * TSS_CMD_CTX_STRIDE);
+        }
+        // No pool, or all of its contexts are busy
+        else if ((result = (TSS_CMD_CONTEXT*)malloc(sizeof(TSS_CMD_CONTEXT))) == NULL)
+        {
+            LogError("Failure allocating command context");
+        }
+    }
+    return result;
+}
+
+static void TSS_ReleaseCmdContext(TSS_DEVICE* tpm, TSS_CMD_CONTEXT* cmdCtx)
+{
+    TSS_CMD_CONTEXT_POOL* pool = tpm->CmdCtxPool;
+    BYTE* ctxPtr = (BYTE*)cmdCtx;
+
+    if (pool != NULL && ctxPtr >= pool->Contexts && ctxPtr < pool->Contexts + pool->Size * TSS_CMD_CTX_STRIDE)
+    {
+        ATOMIC_AND_32(&pool->InUse, ~(1u << (UINT32)((ctxPtr - pool->Contexts) / TSS_CMD_CTX_STRIDE)));
+    }
+    else
+    {
+        free(cmdCtx);
+    }
+}
+
+TPM_RC TSS_SetCmdContextPoolSize(TSS_DEVICE* tpm, UINT32 poolSize)
+{
+    TPM_RC result;
+    if (tpm == NULL)
+    {
+        LogError("Invalid parameter tpm is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if (poolSize > TSS_MAX_CMD_CTX_POOL_SIZE)
+    {
+        // The pool tracks its contexts in a 32 bit mask
+        LogError("Invalid command context pool size %u", poolSize);
+        result = TPM_RC_VALUE;
+    }
+    else if (tpm->Dispatcher != NULL)
+    {
+        // Other threads may claim a context of the pool at any time
+        LogError("Command context pool cannot be resized while the dispatcher is running");
+        result = TPM_RC_FAILURE;
+    }
+    else if (tpm->CmdCtxPool == NULL)
+    {
+        // The pool will be allocated by Initialize_TPM_Codec()
+        tpm->CmdCtxPoolSize = poolSize;
+        result = TPM_RC_SUCCESS;
+    }
+    else if (ATOMIC_LOAD_32(&tpm->CmdCtxPool->InUse) != 0)
+    {
+        LogError("Command context pool cannot be resized while a command is in progress");
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        TSS_CMD_CONTEXT_POOL* pool = TSS_CreateCmdContextPool(poolSize);
+        if (pool == NULL)
+        {
+            LogError("Failure resizing command context pool");
+            result = TPM_RC_MEMORY;
+        }
+        else
+        {
+            free(tpm->CmdCtxPool);
+            tpm->CmdCtxPool = pool;
+            tpm->CmdCtxPoolSize = poolSize;
+            result = TPM_RC_SUCCESS;
+        }
+    }
+    return result;
+}
+
+TPM_RC TSS_StartDispatcher(TSS_DEVICE* tpm)
+{
+    TPM_RC result;
+    if (tpm == NULL || tpm->tpm_comm_handle == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p", tpm);
+        result = TPM_RC_FAILURE;
+    }
+    else if (tpm->Dispatcher != NULL)
+    {
+        LogError("Dispatcher is already running");
+        result = TPM_RC_FAILURE;
+    }
+    // The fixed properties are cached once, before other threads may read them
+    else if ((result = TSS_FillFixedProperties(tpm)) != TPM_RC_SUCCESS)
+    {
+        LogError("Failure reading the fixed TPM properties");
+    }
+    else if ((tpm->VarPropsLock = Lock_Init()) == NULL)
+    {
+        LogError("Failure creating the TPM property lock");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((tpm->Dispatcher = tpm_dispatcher_create(tpm->tpm_comm_handle)) == NULL)
+    {
+        LogError("Failure creating tpm dispatcher");
+        (void)Lock_Deinit(tpm->VarPropsLock);
+        tpm->VarPropsLock = NULL;
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        result = TPM_RC_SUCCESS;
+    }
+    return result;
+}
+
+void TSS_StopDispatcher(TSS_DEVICE* tpm)
+{
+    if (tpm != NULL && tpm->Dispatcher != NULL)
+    {
+        tpm_dispatcher_destroy(tpm->Dispatcher);
+        tpm->Dispatcher = NULL;
+        (void)Lock_Deinit(tpm->VarPropsLock);
+        tpm->VarPropsLock = NULL;
+    }
+}
+
 TPM_HANDLE TSS_CreatePersistentKey(TSS_DEVICE* tpm_device, TPM_HANDLE request_handle, TSS_SESSION* sess, TPMI_DH_OBJECT hierarchy, TPM2B_PUBLIC* inPub, TPM2B_PUBLIC* outPub)
 {
     TPM_HANDLE result;
@@ -217,27 +842,25 @@ TPM_HANDLE TSS_CreatePersistentKey(TSS_DEVICE* tpm_device, TPM_HANDLE request_ha
     }
     else
     {
-        if ((tpm_result = TSS_CreatePrimary(tpm_device, sess, hierarchy, inPub, &result, outPub)) != TPM_RC_SUCCESS)
+        // Create the key, persist it and flush its transient copy in one batch
+        TSS_BATCH batch;
+        batch.NumSteps = 0;
+
+        if (TSS_BatchCreatePrimary(&batch, sess, hierarchy, inPub, outPub) != TPM_RC_SUCCESS
+            || TSS_BatchEvictControl(&batch, sess, TPM_RH_OWNER, TSS_BATCH_STEP_HANDLE(0), request_handle) != TPM_RC_SUCCESS
+            || TSS_BatchFlushContext(&batch, TSS_BATCH_STEP_HANDLE(0)) != TPM_RC_SUCCESS)
+        {
+            LogError("Failure building persistent key creation batch");
+            result = 0;
+        }
+        else if ((tpm_result = TSS_ExecuteBatch(tpm_device, &batch)) != TPM_RC_SUCCESS)
         {
-            LogError("Failed calling TSS_CreatePrimary 0x%x", tpm_result);
+            LogError("Failed creating persistent key 0x%x", tpm_result);
             result = 0;
         }
         else
         {
-            if ((tpm_result = TPM2_EvictControl(tpm_device, sess, TPM_RH_OWNER, result, request_handle)) != TPM_RC_SUCCESS)
-            {
-                LogError("Failed calling TPM2_EvictControl 0x%x", tpm_result);
-                result = 0;
-            }
-            else if ((tpm_result = TPM2_FlushContext(tpm_device, result)) != TPM_RC_SUCCESS)
-            {
-                LogError("Failed calling TPM2_FlushContext 0x%x", tpm_result);
-                result = 0;
-            }
-            else
-            {
-                result = request_handle;
-            }
+            result = request_handle;
         }
     }
     return result;
@@ -251,14 +874,42 @@ TPM_RC Initialize_TPM_Codec(TSS_DEVICE* tpm)
         LogError("Invalid parameter tpm is NULL");
         result = TPM_RC_FAILURE;
     }
+    else if (tpm->CmdCtxPoolSize > TSS_MAX_CMD_CTX_POOL_SIZE)
+    {
+        // The pool tracks its contexts in a 32 bit mask
+        LogError("Invalid command context pool size %u", tpm->CmdCtxPoolSize);
+        result = TPM_RC_VALUE;
+    }
+#ifdef USE_TPM_COMM_RUNTIME
+    else if ((tpm->tpm_comm_handle = tpm_comm_create_with_backend(tpm->CommBackend, tpm->comms_endpoint)) == NULL)
+#else
+    else if (tpm->CommBackend != NULL)
+    {
+        LogError("Selecting the tpm_comm backend requires a build with USE_TPM_COMM_RUNTIME");
+        result = TPM_RC_FAILURE;
+    }
     else if ( (tpm->tpm_comm_handle = tpm_comm_create(tpm->comms_endpoint)) == NULL)
+#endif
     {
         LogError("creating tpm_comm object");
         result = TPM_RC_FAILURE;
     }
+    else if ((tpm->CmdCtxPool = TSS_CreateCmdContextPool(tpm->CmdCtxPoolSize)) == NULL)
+    {
+        LogError("creating command context pool");
+        tpm_comm_destroy(tpm->tpm_comm_handle);
+        tpm->tpm_comm_handle = NULL;
+        result = TPM_RC_FAILURE;
+    }
     else
     {
         TPM_COMM_TYPE comm_type = tpm_comm_get_type(tpm->tpm_comm_handle);
+
+        // Properties are read from the TPM on first use
+        tpm->FixedPropsValid = FALSE;
+        tpm->VarPropsValid = FALSE;
+        tpm->PendingCmdCtx = NULL;
+
         if (comm_type == TPM_COMM_TYPE_EMULATOR)
         {
             result = TPM2_Startup(tpm, TPM_SU_CLEAR);
@@ -266,6 +917,9 @@ TPM_RC Initialize_TPM_Codec(TSS_DEVICE* tpm)
             {
                 LogError("calling TPM2_Startup %s", TSS_StatusValueName(result) );
                 tpm_comm_destroy(tpm->tpm_comm_handle);
+                tpm->tpm_comm_handle = NULL;
+                free(tpm->CmdCtxPool);
+                tpm->CmdCtxPool = NULL;
             }
             else
             {
@@ -276,10 +930,14 @@ TPM_RC Initialize_TPM_Codec(TSS_DEVICE* tpm)
         {
             result = TPM_RC_SUCCESS;
         }
-        // Clear out from previous runs
-        (void)TPM2_FlushContext(tpm, HR_POLICY_SESSION);
-        (void)TPM2_FlushContext(tpm, HR_POLICY_SESSION | 1);
-        (void)TPM2_FlushContext(tpm, HR_POLICY_SESSION | 2);
+
+        if (result == TPM_RC_SUCCESS)
+        {
+            // Clear out from previous runs
+            (void)TPM2_FlushContext(tpm, HR_POLICY_SESSION);
+            (void)TPM2_FlushContext(tpm, HR_POLICY_SESSION | 1);
+            (void)TPM2_FlushContext(tpm, HR_POLICY_SESSION | 2);
+        }
     }
     return result;
 }
@@ -288,7 +946,18 @@ void Deinit_TPM_Codec(TSS_DEVICE* tpm)
 {
     if (tpm != NULL)
     {
+        TSS_StopDispatcher(tpm);
         tpm_comm_destroy(tpm->tpm_comm_handle);
+        if (tpm->PendingCmdCtx != NULL)
+        {
+            // The response of the pending command is dropped with the connection
+            TSS_ReleaseCmdContext(tpm, tpm->PendingCmdCtx);
+            tpm->PendingCmdCtx = NULL;
+        }
+        free(tpm->CmdCtxPool);
+        tpm->CmdCtxPool = NULL;
+        tpm->FixedPropsValid = FALSE;
+        tpm->VarPropsValid = FALSE;
     }
 }
 
@@ -388,61 +1057,888 @@ UINT32 SignData(TSS_DEVICE* tpm, TSS_SESSION* sess, BYTE* tokenData, UINT32 toke
     return result;
 }
 
-TPM_RC TPM2_HMAC(
+//
+// Command bodies shared by the TPM2_XXX() commands taking a TPM2B_MAX_BUFFER and
+// the TSS_XXX() helpers taking a pointer and length. The data is marshaled straight
+// into the command buffer.
+//
+
+static TPM_RC
+TSS_HmacCmd(
     TSS_DEVICE             *tpm,                // IN/OUT
     TSS_SESSION            *session,            // IN/OUT
     TPMI_DH_OBJECT          handle,             // IN
-    TPM2B_MAX_BUFFER       *buffer,             // IN
+    BYTE                   *data,               // IN [opt]
+    UINT16                  dataSize,           // IN
     TPMI_ALG_HASH           hashAlg,            // IN
     TPM2B_DIGEST           *outHMAC             // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-    TPM_RC result;
-    if (tpm == NULL || session == NULL || buffer == NULL || outHMAC == NULL)
-    {
-        LogError("Invalid parameter specified tpm: %p, session: %p, buffer: %p, outHMAC: %p", tpm, session, buffer, outHMAC);
-        result = TPM_RC_FAILURE;
-    }
-    else
-    {
-        result = TPM_RC_SUCCESS;
-        BEGIN_CMD();
-        TSS_MARSHAL_OPT2B(TPM2B_MAX_BUFFER, buffer);
-        TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
-        DISPATCH_CMD(HMAC, &handle, 1, &session, 1);
-        TSS_UNMARSHAL(TPM2B_DIGEST, outHMAC);
-        END_CMD();
-    }
-    return result;
-}
+    BEGIN_CMD();
+    TSS_MARSHAL_BYTES(data, dataSize);
+    TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
+    DISPATCH_CMD(HMAC, &handle, 1, &session, 1);
+    TSS_UNMARSHAL(TPM2B_DIGEST, outHMAC);
+    END_CMD();
+}
+
+static TPM_RC
+TSS_HashCmd(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    BYTE                   *data,               // IN [opt]
+    UINT16                  dataSize,           // IN
+    TPMI_ALG_HASH           hashAlg,            // IN
+    TPMI_RH_HIERARCHY       hierarchy,          // IN [opt]
+    TPM2B_DIGEST           *outHash,            // OUT
+    TPMT_TK_HASHCHECK      *validation          // OUT [opt]
+)
+{
+    BEGIN_CMD();
+    TSS_MARSHAL_BYTES(data, dataSize);
+    TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
+    TSS_MARSHAL(TPMI_RH_HIERARCHY, &hierarchy);
+    DISPATCH_CMD(Hash, NULL, 0, NULL, 0);
+    TSS_UNMARSHAL(TPM2B_DIGEST, outHash);
+    TSS_UNMARSHAL_OPT(TPMT_TK_HASHCHECK, validation);
+    END_CMD();
+}
+
+static TPM_RC
+TSS_SequenceCompleteCmd(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          sequenceHandle,     // IN
+    BYTE                   *data,               // IN [opt]
+    UINT16                  dataSize,           // IN
+    TPMI_RH_HIERARCHY       hierarchy,          // IN [opt]
+    TPM2B_DIGEST           *result,             // OUT
+    TPMT_TK_HASHCHECK      *validation          // OUT [opt]
+)
+{
+    BEGIN_CMD();
+    TSS_MARSHAL_BYTES(data, dataSize);
+    TSS_MARSHAL(TPMI_RH_HIERARCHY, &hierarchy);
+    DISPATCH_CMD(SequenceComplete, &sequenceHandle, 1, &session, 1);
+    TSS_UNMARSHAL(TPM2B_DIGEST, result);
+    TSS_UNMARSHAL_OPT(TPMT_TK_HASHCHECK, validation);
+    END_CMD();
+}
+
+static TPM_RC
+TSS_SequenceUpdateCmd(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          sequenceHandle,     // IN
+    BYTE                   *data,               // IN [opt]
+    UINT16                  dataSize            // IN
+)
+{
+    BEGIN_CMD();
+    TSS_MARSHAL_BYTES(data, dataSize);
+    DISPATCH_CMD(SequenceUpdate, &sequenceHandle, 1, &session, 1);
+    END_CMD();
+}
+
+TPM_RC TPM2_HMAC(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          handle,             // IN
+    TPM2B_MAX_BUFFER       *buffer,             // IN
+    TPMI_ALG_HASH           hashAlg,            // IN
+    TPM2B_DIGEST           *outHMAC             // OUT
+)
+{
+    TPM_RC result;
+    if (tpm == NULL || session == NULL || buffer == NULL || outHMAC == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p, session: %p, buffer: %p, outHMAC: %p", tpm, session, buffer, outHMAC);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        result = TSS_HmacCmd(tpm, session, handle, buffer->t.buffer, buffer->t.size, hashAlg, outHMAC);
+    }
+    return result;
+}
+
+TPM_RC TSS_HMAC(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          handle,             // IN
+    BYTE                   *data,               // IN
+    UINT32                  dataSize,           // IN
+    TPM2B_DIGEST           *outHMAC             // OUT
+)
+{
+    TPM_RC result;
+    if (dataSize > MAX_DIGEST_BUFFER)
+    {
+        LogError("Invalid data size specified %u", dataSize);
+        result = TPM_RC_SIZE;
+    }
+    else if (tpm == NULL || session == NULL || data == NULL || outHMAC == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p, session: %p, data: %p, outHMAC: %p", tpm, session, data, outHMAC);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        result = TSS_HmacCmd(tpm, session, handle, data, (UINT16)dataSize, TPM_ALG_NULL, outHMAC);
+    }
+    return result;
+}
+
+TSS_PREPARED_CMD_HANDLE
+TSS_PrepareCommand(
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions    // IN: Number of sessions in 'sessions'
+)
+{
+    TSS_PREPARED_CMD* result;
+    if ((!handles && numHandles) || (!sessions && numSessions)
+        || numHandles < 0 || numHandles > MAX_HANDLE_NUM
+        || numSessions < 0 || numSessions > MAX_SESSION_NUM)
+    {
+        LogError("Invalid parameter specified handles: %p, numHandles: %d, sessions: %p, numSessions: %d", handles, numHandles, sessions, numSessions);
+        result = NULL;
+    }
+    else if ((result = (TSS_PREPARED_CMD*)malloc(sizeof(TSS_PREPARED_CMD))) == NULL)
+    {
+        LogError("Failure allocating prepared command");
+    }
+    else if (TSS_BuildCommandInPlace(cmdCode, handles, numHandles, sessions, numSessions,
+                                     TSS_CMD_PARAMS(&result->CmdCtx), 0, TSS_CMD_HEADER_RESERVE,
+                                     &result->CmdCtx.CmdStart, &result->HeaderSize) != TPM_RC_SUCCESS)
+    {
+        LogError("Failure building command header for command 0x%08x", cmdCode);
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->CmdCode = cmdCode;
+    }
+    return result;
+}
+
+void
+TSS_DestroyPreparedCommand(
+    TSS_PREPARED_CMD_HANDLE preparedCmd     // IN
+)
+{
+    if (preparedCmd != NULL)
+    {
+        free(preparedCmd);
+    }
+}
+
+TPM_RC
+TSS_PreparedHMAC(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_PREPARED_CMD_HANDLE preparedCmd,        // IN/OUT: Prepared TPM2_HMAC command
+    BYTE                   *data,               // IN
+    UINT32                  dataSize,           // IN
+    TPM2B_DIGEST           *outHMAC             // OUT
+)
+{
+    TPM_RC result;
+    if (dataSize > MAX_DIGEST_BUFFER)
+    {
+        LogError("Invalid data size specified %u", dataSize);
+        result = TPM_RC_SIZE;
+    }
+    else if (tpm == NULL || preparedCmd == NULL || data == NULL || outHMAC == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p, preparedCmd: %p, data: %p, outHMAC: %p", tpm, preparedCmd, data, outHMAC);
+        result = TPM_RC_FAILURE;
+    }
+    else if (preparedCmd->CmdCode != TPM_CC_HMAC)
+    {
+        LogError("Prepared command 0x%08x is not TPM2_HMAC", preparedCmd->CmdCode);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        TPMI_ALG_HASH hashAlg = TPM_ALG_NULL;
+        BEGIN_PREPARED_CMD(preparedCmd);
+        TSS_MARSHAL_BYTES(data, dataSize);
+        TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
+        DISPATCH_PREPARED_CMD(preparedCmd);
+        TSS_UNMARSHAL(TPM2B_DIGEST, outHMAC);
+        END_PREPARED_CMD();
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PreparedHMACSubmit(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_PREPARED_CMD_HANDLE preparedCmd,        // IN/OUT: Prepared TPM2_HMAC command
+    BYTE                   *data,               // IN
+    UINT32                  dataSize            // IN
+)
+{
+    TPM_RC result;
+    if (dataSize > MAX_DIGEST_BUFFER)
+    {
+        LogError("Invalid data size specified %u", dataSize);
+        result = TPM_RC_SIZE;
+    }
+    else if (tpm == NULL || preparedCmd == NULL || data == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p, preparedCmd: %p, data: %p", tpm, preparedCmd, data);
+        result = TPM_RC_FAILURE;
+    }
+    else if (preparedCmd->CmdCode != TPM_CC_HMAC)
+    {
+        LogError("Prepared command 0x%08x is not TPM2_HMAC", preparedCmd->CmdCode);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        TPMI_ALG_HASH hashAlg = TPM_ALG_NULL;
+        BEGIN_PREPARED_CMD(preparedCmd);
+        TSS_MARSHAL_BYTES(data, dataSize);
+        TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
+        SUBMIT_PREPARED_CMD(preparedCmd);
+        END_PREPARED_CMD();
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PreparedHMACComplete(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_PREPARED_CMD_HANDLE preparedCmd,        // IN/OUT: Prepared TPM2_HMAC command
+    TPM2B_DIGEST           *outHMAC             // OUT
+)
+{
+    TPM_RC result;
+    if (tpm == NULL || preparedCmd == NULL || outHMAC == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p, preparedCmd: %p, outHMAC: %p", tpm, preparedCmd, outHMAC);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        TPM_RC           cmdResult;
+        TSS_CMD_CONTEXT *cmdCtx = &preparedCmd->CmdCtx;
+
+        cmdResult = TSS_CompleteCmdAsync(tpm, preparedCmd->CmdCode, cmdCtx);
+        if (cmdResult != TPM_RC_SUCCESS)
+            goto end_cmd;
+        TSS_UNMARSHAL(TPM2B_DIGEST, outHMAC);
+        END_PREPARED_CMD();
+    }
+    return result;
+}
+
+int
+TSS_GetPollFd(
+    TSS_DEVICE             *tpm                 // IN
+)
+{
+    int result;
+    if (tpm == NULL || tpm->tpm_comm_handle == NULL)
+    {
+        LogError("Invalid parameter specified tpm: %p", tpm);
+        result = -1;
+    }
+    else
+    {
+        result = tpm_comm_get_poll_fd(tpm->tpm_comm_handle);
+    }
+    return result;
+}
+
+// Appends a step to 'batch'. Its handles may only refer to the steps already added.
+static TPM_RC
+TSS_AddBatchStep(
+    TSS_BATCH          *batch,      // IN/OUT
+    TPM_CC              cmdCode,    // IN: Command code
+    TPM_HANDLE         *handles,    // IN: Array of handles used by the command
+    INT32               numHandles, // IN: Number of handles in 'handles'
+    TSS_SESSION        *session,    // IN (opt): Authorization session
+    TSS_BATCH_STEP    **step        // OUT: The added step
+)
+{
+    TPM_RC result = TPM_RC_SUCCESS;
+    INT32 i;
+
+    *step = NULL;
+    if (TSS_GetCmdDesc(cmdCode) == NULL)
+    {
+        LogError("Unknown command code 0x%08x", cmdCode);
+        result = TPM_RC_COMMAND_CODE;
+    }
+
+    for (i = 0; i < numHandles && result == TPM_RC_SUCCESS; i++)
+    {
+        if (TSS_IS_BATCH_STEP_HANDLE(handles[i]))
+        {
+            UINT32 refStep = handles[i] & ~TSS_BATCH_HANDLE_REF;
+            const TSS_CMD_DESC* refDesc;
+
+            if (refStep >= batch->NumSteps)
+            {
+                LogError("Handle 0x%08x does not refer to an earlier step of the batch", handles[i]);
+                result = TPM_RC_FAILURE;
+            }
+            else if ((refDesc = TSS_GetCmdDesc(batch->Steps[refStep].CmdCode)) == NULL)
+            {
+                LogError("Step %u of the batch has the unknown command code 0x%08x", refStep, batch->Steps[refStep].CmdCode);
+                result = TPM_RC_COMMAND_CODE;
+            }
+            else if ((refDesc->Flags & TSS_CMD_RET_HANDLE) == 0)
+            {
+                LogError("Handle 0x%08x refers to a step of the batch not returning a handle", handles[i]);
+                result = TPM_RC_FAILURE;
+            }
+        }
+    }
+
+    if (result != TPM_RC_SUCCESS)
+    {
+        // Logged above
+    }
+    else if (batch->NumSteps == TSS_MAX_BATCH_STEPS)
+    {
+        LogError("Batch cannot contain more than %d steps", TSS_MAX_BATCH_STEPS);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        *step = &batch->Steps[batch->NumSteps++];
+        (*step)->CmdCode = cmdCode;
+        memcpy((*step)->Handles, handles, numHandles * sizeof(TPM_HANDLE));
+        (*step)->NumHandles = numHandles;
+        (*step)->Session = session;
+        (*step)->Result = TPM_RC_NOT_USED;
+        (*step)->RetHandle = TPM_RH_UNASSIGNED;
+    }
+    return result;
+}
+
+// Marshals the parameters of 'step' into 'cmdCtx'
+static TPM_RC
+TSS_MarshalBatchStep(
+    TSS_BATCH_STEP     *step,       // IN
+    TSS_CMD_CONTEXT    *cmdCtx      // IN/OUT
+)
+{
+    TPM_RC  cmdResult = TPM_RC_SUCCESS;
+    INT32   sizeParamBuf = TSS_MAX_CMD_PARAMS_SIZE;
+    BYTE   *paramBuf = TSS_CMD_PARAMS(cmdCtx);
+
+    cmdCtx->ParamSize = 0;
+    switch (step->CmdCode)
+    {
+    case TPM_CC_CreatePrimary:
+        {
+            // Same defaults as TSS_CreatePrimary()
+            TPM2B_SENSITIVE_CREATE  sensCreate = { 0 };
+            TPM2B_DATA              outsideInfo = { {0} };
+            TPML_PCR_SELECTION      creationPCR = { 0 };
+
+            TSS_MARSHAL_SIZED(TPM2B_SENSITIVE_CREATE, &sensCreate);
+            TSS_MARSHAL_SIZED(TPM2B_PUBLIC, step->Args.CreatePrimary.inPublic);
+            TSS_MARSHAL(TPM2B_DATA, &outsideInfo);
+            TSS_MARSHAL(TPML_PCR_SELECTION, &creationPCR);
+        }
+        break;
+    case TPM_CC_EvictControl:
+        TSS_MARSHAL(TPMI_DH_PERSISTENT, &step->Args.EvictControl.persistentHandle);
+        break;
+    default:
+        // The other batched commands only take handles
+        break;
+    }
+    // Jump target of TSS_MARSHAL_SIZED() failures
+end_cmd:
+    return cmdResult;
+}
+
+// Unmarshals the response parameters of 'step' from 'cmdCtx'
+static TPM_RC
+TSS_UnmarshalBatchStep(
+    TSS_BATCH_STEP     *step,       // IN/OUT
+    TSS_CMD_CONTEXT    *cmdCtx      // IN/OUT
+)
+{
+    TPM_RC cmdResult = TPM_RC_SUCCESS;
+
+    switch (step->CmdCode)
+    {
+    case TPM_CC_ReadPublic:
+        TSS_UNMARSHAL_FLAGGED(TPM2B_PUBLIC, step->Args.ReadPublic.outPublic);
+        TSS_UNMARSHAL(TPM2B_NAME, step->Args.ReadPublic.name);
+        TSS_UNMARSHAL(TPM2B_NAME, step->Args.ReadPublic.qualifiedName);
+        break;
+    case TPM_CC_CreatePrimary:
+        // The creation data, hash and ticket that follow are not returned by the batch
+        TSS_UNMARSHAL_FLAGGED(TPM2B_PUBLIC, step->Args.CreatePrimary.outPublic);
+        break;
+    default:
+        break;
+    }
+    // Jump target of TSS_UNMARSHAL() failures
+end_cmd:
+    return cmdResult;
+}
+
+TSS_BATCH_HANDLE
+TSS_CreateBatch(void)
+{
+    TSS_BATCH* result;
+    if ((result = (TSS_BATCH*)malloc(sizeof(TSS_BATCH))) == NULL)
+    {
+        LogError("Failure allocating command batch");
+    }
+    else
+    {
+        result->NumSteps = 0;
+    }
+    return result;
+}
+
+void
+TSS_DestroyBatch(
+    TSS_BATCH_HANDLE    batch       // IN
+)
+{
+    if (batch != NULL)
+    {
+        free(batch);
+    }
+}
+
+TPM_RC
+TSS_BatchReadPublic(
+    TSS_BATCH_HANDLE    batch,          // IN/OUT
+    TPMI_DH_OBJECT      objectHandle,   // IN
+    TPM2B_PUBLIC       *outPublic,      // OUT
+    TPM2B_NAME         *name,           // OUT
+    TPM2B_NAME         *qualifiedName   // OUT
+)
+{
+    TPM_RC result;
+    TSS_BATCH_STEP* step;
+    if (batch == NULL || outPublic == NULL || name == NULL || qualifiedName == NULL)
+    {
+        LogError("Invalid parameter batch: %p, outPublic: %p, name: %p, qualifiedName: %p", batch, outPublic, name, qualifiedName);
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_AddBatchStep(batch, TPM_CC_ReadPublic, &objectHandle, 1, NULL, &step)) == TPM_RC_SUCCESS)
+    {
+        step->Args.ReadPublic.outPublic = outPublic;
+        step->Args.ReadPublic.name = name;
+        step->Args.ReadPublic.qualifiedName = qualifiedName;
+    }
+    return result;
+}
+
+TPM_RC
+TSS_BatchCreatePrimary(
+    TSS_BATCH_HANDLE    batch,          // IN/OUT
+    TSS_SESSION        *sess,           // IN
+    TPMI_DH_OBJECT      hierarchy,      // IN
+    TPM2B_PUBLIC       *inPub,          // IN
+    TPM2B_PUBLIC       *outPub          // OUT
+)
+{
+    TPM_RC result;
+    TSS_BATCH_STEP* step;
+    if (batch == NULL || sess == NULL || inPub == NULL || outPub == NULL)
+    {
+        LogError("Invalid parameter batch: %p, sess: %p, inPub: %p, outPub: %p", batch, sess, inPub, outPub);
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_AddBatchStep(batch, TPM_CC_CreatePrimary, &hierarchy, 1, sess, &step)) == TPM_RC_SUCCESS)
+    {
+        step->Args.CreatePrimary.inPublic = inPub;
+        step->Args.CreatePrimary.outPublic = outPub;
+    }
+    return result;
+}
+
+TPM_RC
+TSS_BatchEvictControl(
+    TSS_BATCH_HANDLE    batch,              // IN/OUT
+    TSS_SESSION        *session,            // IN
+    TPMI_RH_PROVISION   auth,               // IN
+    TPMI_DH_OBJECT      objectHandle,       // IN
+    TPMI_DH_PERSISTENT  persistentHandle    // IN
+)
+{
+    TPM_RC result;
+    TSS_BATCH_STEP* step;
+    TPM_HANDLE handles[2];
+    handles[0] = auth;
+    handles[1] = objectHandle;
+
+    if (batch == NULL || session == NULL)
+    {
+        LogError("Invalid parameter batch: %p, session: %p", batch, session);
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_AddBatchStep(batch, TPM_CC_EvictControl, handles, 2, session, &step)) == TPM_RC_SUCCESS)
+    {
+        step->Args.EvictControl.persistentHandle = persistentHandle;
+    }
+    return result;
+}
+
+TPM_RC
+TSS_BatchFlushContext(
+    TSS_BATCH_HANDLE    batch,          // IN/OUT
+    TPMI_DH_CONTEXT     flushHandle     // IN
+)
+{
+    TPM_RC result;
+    TSS_BATCH_STEP* step;
+    if (batch == NULL)
+    {
+        LogError("Invalid parameter batch is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        result = TSS_AddBatchStep(batch, TPM_CC_FlushContext, &flushHandle, 1, NULL, &step);
+    }
+    return result;
+}
 
-TPM_RC TSS_HMAC(
-    TSS_DEVICE             *tpm,                // IN/OUT
-    TSS_SESSION            *session,            // IN/OUT
-    TPMI_DH_OBJECT          handle,             // IN
-    BYTE                   *data,               // IN
-    UINT32                  dataSize,           // IN
-    TPM2B_DIGEST           *outHMAC             // OUT
+TPM_RC
+TSS_ExecuteBatch(
+    TSS_DEVICE         *tpm,        // IN/OUT
+    TSS_BATCH_HANDLE    batch       // IN/OUT
 )
 {
     TPM_RC result;
-    if (dataSize > MAX_DIGEST_BUFFER)
+    if (tpm == NULL || batch == NULL)
     {
-        LogError("Invalid data size specified %u", dataSize);
-        result = TPM_RC_SIZE;
+        LogError("Invalid parameter tpm: %p, batch: %p", tpm, batch);
+        result = TPM_RC_FAILURE;
     }
-    else if (tpm == NULL || session == NULL || data == NULL || outHMAC == NULL)
+    else
     {
-        LogError("Invalid parameter specified tpm: %p, session: %p, data: %p, outHMAC: %p", tpm, session, data, outHMAC);
+        UINT32 i;
+        for (i = 0; i < batch->NumSteps; i++)
+        {
+            batch->Steps[i].Result = TPM_RC_NOT_USED;
+            batch->Steps[i].RetHandle = TPM_RH_UNASSIGNED;
+        }
+
+        // All steps reuse the same context, so a batch costs a single acquisition
+        BEGIN_CMD();
+        for (i = 0; i < batch->NumSteps; i++)
+        {
+            TSS_BATCH_STEP *step = &batch->Steps[i];
+            TPM_HANDLE      handles[MAX_HANDLE_NUM];
+            INT32           h;
+
+            for (h = 0; h < step->NumHandles; h++)
+            {
+                handles[h] = step->Handles[h];
+                if (TSS_IS_BATCH_STEP_HANDLE(handles[h]))
+                {
+                    handles[h] = batch->Steps[handles[h] & ~TSS_BATCH_HANDLE_REF].RetHandle;
+                }
+            }
+
+            cmdResult = TSS_MarshalBatchStep(step, cmdCtx);
+            if (cmdResult == TPM_RC_SUCCESS)
+            {
+                cmdResult = TSS_DispatchCmd(tpm, step->CmdCode, handles, step->NumHandles,
+                                            step->Session != NULL ? &step->Session : NULL,
+                                            step->Session != NULL ? 1 : 0, cmdCtx);
+            }
+            if (cmdResult == TPM_RC_SUCCESS)
+            {
+                step->RetHandle = cmdCtx->RetHandle;
+                cmdResult = TSS_UnmarshalBatchStep(step, cmdCtx);
+            }
+            step->Result = cmdResult;
+            if (cmdResult != TPM_RC_SUCCESS)
+            {
+                LogError("Batch step %u (command 0x%08x) failed 0x%x", i, step->CmdCode, cmdResult);
+                goto end_cmd;
+            }
+        }
+        END_CMD();
+    }
+    return result;
+}
+
+TPM_RC
+TSS_GetBatchStepResult(
+    TSS_BATCH_HANDLE    batch,      // IN
+    UINT32              step,       // IN: Index of the step
+    TPM_HANDLE         *retHandle   // OUT (opt): Handle returned by the step
+)
+{
+    TPM_RC result;
+    if (batch == NULL || step >= batch->NumSteps)
+    {
+        LogError("Invalid parameter batch: %p, step: %u", batch, step);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        if (retHandle != NULL)
+        {
+            *retHandle = batch->Steps[step].RetHandle;
+        }
+        result = batch->Steps[step].Result;
+    }
+    return result;
+}
+
+// Makes 'view' refer to the contents of the TPM2B marshaled at '*buffer'
+static TPM_RC
+TSS_UnmarshalBytesView(
+    BYTE           **buffer,        // IN/OUT
+    INT32           *size,          // IN/OUT
+    TSS_BYTES_VIEW  *view           // OUT
+)
+{
+    TPM_RC  result;
+    UINT16  viewSize = 0;
+
+    result = UINT16_Unmarshal(&viewSize, buffer, size);
+    if (result == TPM_RC_SUCCESS)
+    {
+        if (*size < viewSize)
+        {
+            result = TPM_RC_INSUFFICIENT;
+        }
+        else
+        {
+            view->Ptr = *buffer;
+            view->Size = viewSize;
+            *buffer += viewSize;
+            *size -= viewSize;
+        }
+    }
+    return result;
+}
+
+// Offsets of the fixed size fields of a marshaled TPMT_PUBLIC
+#define TSS_PUBLIC_TYPE_OFFSET          0
+#define TSS_PUBLIC_NAME_ALG_OFFSET      2
+#define TSS_PUBLIC_ATTRIBUTES_OFFSET    4
+#define TSS_PUBLIC_AUTH_POLICY_OFFSET   8
+
+// Points 'buffer' and 'size' at byte 'offset' of the public area of 'view'
+static TPM_RC
+TSS_PublicViewSeek(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    INT32                   offset,     // IN
+    BYTE                  **buffer,     // OUT
+    INT32                  *size        // OUT
+)
+{
+    TPM_RC result;
+    if (view == NULL || view->Area.Ptr == NULL || view->Area.Size < offset)
+    {
+        LogError("Invalid public area view: %p", view);
         result = TPM_RC_FAILURE;
     }
     else
     {
-        TPM2B_MAX_BUFFER    dataBuf;
-        dataBuf.b.size = (UINT16)dataSize;
-        MemoryCopy(dataBuf.t.buffer, data, dataSize);
-        result = TPM2_HMAC(tpm, session, handle, &dataBuf, TPM_ALG_NULL, outHMAC);
+        *buffer = (BYTE*)view->Area.Ptr + offset;
+        *size = view->Area.Size - offset;
+        result = TPM_RC_SUCCESS;
+    }
+    return result;
+}
+
+// Points 'buffer' and 'size' at the parameters field of the public area of 'view'
+static TPM_RC
+TSS_PublicViewSeekParameters(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    TPMI_ALG_PUBLIC        *type,       // OUT
+    BYTE                  **buffer,     // OUT
+    INT32                  *size        // OUT
+)
+{
+    TPM_RC          result;
+    TSS_BYTES_VIEW  authPolicy;
+
+    if ((result = TSS_PublicViewGetType(view, type)) == TPM_RC_SUCCESS &&
+        (result = TSS_PublicViewSeek(view, TSS_PUBLIC_AUTH_POLICY_OFFSET, buffer, size)) == TPM_RC_SUCCESS)
+    {
+        result = TSS_UnmarshalBytesView(buffer, size, &authPolicy);
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PublicViewGetType(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    TPMI_ALG_PUBLIC        *type        // OUT
+)
+{
+    TPM_RC  result;
+    BYTE   *buffer;
+    INT32   size;
+
+    if (type == NULL)
+    {
+        LogError("Invalid parameter type is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_PublicViewSeek(view, TSS_PUBLIC_TYPE_OFFSET, &buffer, &size)) == TPM_RC_SUCCESS)
+    {
+        result = UINT16_Unmarshal((UINT16*)type, &buffer, &size);
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PublicViewGetNameAlg(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    TPMI_ALG_HASH          *nameAlg     // OUT
+)
+{
+    TPM_RC  result;
+    BYTE   *buffer;
+    INT32   size;
+
+    if (nameAlg == NULL)
+    {
+        LogError("Invalid parameter nameAlg is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_PublicViewSeek(view, TSS_PUBLIC_NAME_ALG_OFFSET, &buffer, &size)) == TPM_RC_SUCCESS)
+    {
+        result = UINT16_Unmarshal((UINT16*)nameAlg, &buffer, &size);
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PublicViewGetAttributes(
+    const TSS_PUBLIC_VIEW  *view,               // IN
+    TPMA_OBJECT            *objectAttributes    // OUT
+)
+{
+    TPM_RC  result;
+    BYTE   *buffer;
+    INT32   size;
+    UINT32  attrs;
+
+    if (objectAttributes == NULL)
+    {
+        LogError("Invalid parameter objectAttributes is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_PublicViewSeek(view, TSS_PUBLIC_ATTRIBUTES_OFFSET, &buffer, &size)) == TPM_RC_SUCCESS &&
+             (result = UINT32_Unmarshal(&attrs, &buffer, &size)) == TPM_RC_SUCCESS)
+    {
+        *objectAttributes = ToTpmaObject(attrs);
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PublicViewGetAuthPolicy(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    TSS_BYTES_VIEW         *authPolicy  // OUT
+)
+{
+    TPM_RC  result;
+    BYTE   *buffer;
+    INT32   size;
+
+    if (authPolicy == NULL)
+    {
+        LogError("Invalid parameter authPolicy is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_PublicViewSeek(view, TSS_PUBLIC_AUTH_POLICY_OFFSET, &buffer, &size)) == TPM_RC_SUCCESS)
+    {
+        result = TSS_UnmarshalBytesView(&buffer, &size, authPolicy);
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PublicViewGetParameters(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    TPMU_PUBLIC_PARMS      *parameters  // OUT
+)
+{
+    TPM_RC          result;
+    TPMI_ALG_PUBLIC type;
+    BYTE           *buffer;
+    INT32           size;
+
+    if (parameters == NULL)
+    {
+        LogError("Invalid parameter parameters is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_PublicViewSeekParameters(view, &type, &buffer, &size)) == TPM_RC_SUCCESS)
+    {
+        result = TPMU_PUBLIC_PARMS_Unmarshal(parameters, &buffer, &size, type);
+    }
+    return result;
+}
+
+TPM_RC
+TSS_PublicViewGetUnique(
+    const TSS_PUBLIC_VIEW  *view,       // IN
+    TSS_BYTES_VIEW         *unique,     // OUT
+    TSS_BYTES_VIEW         *eccY        // OUT (opt)
+)
+{
+    TPM_RC              result;
+    TPMI_ALG_PUBLIC     type;
+    TPMU_PUBLIC_PARMS   parameters;
+    TSS_BYTES_VIEW      y;
+    BYTE               *buffer;
+    INT32               size;
+
+    if (unique == NULL)
+    {
+        LogError("Invalid parameter unique is NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else if ((result = TSS_PublicViewSeekParameters(view, &type, &buffer, &size)) == TPM_RC_SUCCESS &&
+             (result = TPMU_PUBLIC_PARMS_Unmarshal(&parameters, &buffer, &size, type)) == TPM_RC_SUCCESS)
+    {
+        switch (type)
+        {
+#if ALG_RSA
+            case TPM_ALG_RSA:
+#endif // ALG_RSA
+            case TPM_ALG_KEYEDHASH:
+            case TPM_ALG_SYMCIPHER:
+                result = TSS_UnmarshalBytesView(&buffer, &size, unique);
+                y.Ptr = NULL;
+                y.Size = 0;
+                break;
+#if ALG_ECC
+            case TPM_ALG_ECC:
+                if ((result = TSS_UnmarshalBytesView(&buffer, &size, unique)) == TPM_RC_SUCCESS)
+                {
+                    result = TSS_UnmarshalBytesView(&buffer, &size, &y);
+                }
+                break;
+#endif // ALG_ECC
+            default:
+                LogError("Unsupported public area type 0x%x", type);
+                result = TPM_RC_SELECTOR;
+                break;
+        }
+        if (result == TPM_RC_SUCCESS && eccY != NULL)
+        {
+            *eccY = y;
+        }
     }
     return result;
 }
@@ -456,14 +1952,10 @@ TSS_Hash(
     TPM2B_DIGEST           *outHash             // OUT
 )
 {
-    TPM2B_MAX_BUFFER    dataBuf;// = { (UINT16)dataSize };
-    dataBuf.t.size = (UINT16)dataSize;
-
     if (dataSize > MAX_DIGEST_BUFFER)
         return TPM_RC_SIZE;
-    MemoryCopy(dataBuf.t.buffer, data, dataSize);
 
-    return TPM2_Hash(tpm, &dataBuf, hashAlg, TPM_RH_NULL, outHash, NULL);
+    return TSS_HashCmd(tpm, data, (UINT16)dataSize, hashAlg, TPM_RH_NULL, outHash, NULL);
 }
 
 TPM_RC
@@ -501,15 +1993,9 @@ TPM2_SequenceComplete(
     TPMT_TK_HASHCHECK      *validation          // OUT [opt]
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
-    BEGIN_CMD();
-    TSS_MARSHAL_OPT2B(TPM2B_MAX_BUFFER, buffer);
-    TSS_MARSHAL(TPMI_RH_HIERARCHY, &hierarchy);
-    DISPATCH_CMD(SequenceComplete, &sequenceHandle, 1, &session, 1);
-    TSS_UNMARSHAL(TPM2B_DIGEST, result);
-    TSS_UNMARSHAL_OPT(TPMT_TK_HASHCHECK, validation);
-    END_CMD();
+    return TSS_SequenceCompleteCmd(tpm, session, sequenceHandle,
+                                   buffer ? buffer->t.buffer : NULL, buffer ? buffer->t.size : 0,
+                                   hierarchy, result, validation);
 }
 
 TPM_RC
@@ -520,12 +2006,8 @@ TPM2_SequenceUpdate(
     TPM2B_MAX_BUFFER       *buffer              // IN
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
-    BEGIN_CMD();
-    TSS_MARSHAL_OPT2B(TPM2B_MAX_BUFFER, buffer);
-    DISPATCH_CMD(SequenceUpdate, &sequenceHandle, 1, &session, 1);
-    END_CMD();
+    return TSS_SequenceUpdateCmd(tpm, session, sequenceHandle,
+                                 buffer ? buffer->t.buffer : NULL, buffer ? buffer->t.size : 0);
 }
 
 TPM_RC
@@ -539,8 +2021,6 @@ TPM2_Sign(
     TPMT_SIGNATURE         *signature           // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
     TSS_MARSHAL_OPT2B(TPM2B_DIGEST, digest);
     TSS_MARSHAL(TPMT_SIG_SCHEME, inScheme ? inScheme : &NullSigScheme);
@@ -550,6 +2030,43 @@ TPM2_Sign(
     END_CMD();
 }
 
+TPM_RC
+TPM2_SignSubmit(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          keyHandle,          // IN
+    TPM2B_DIGEST           *digest,             // IN
+    TPMT_SIG_SCHEME        *inScheme,           // IN [opt]
+    TPMT_TK_HASHCHECK      *validation          // IN [opt]
+)
+{
+    BEGIN_CMD();
+    TSS_MARSHAL_OPT2B(TPM2B_DIGEST, digest);
+    TSS_MARSHAL(TPMT_SIG_SCHEME, inScheme ? inScheme : &NullSigScheme);
+    TSS_MARSHAL(TPMT_TK_HASHCHECK, validation ? validation : &NullHashTk);
+    SUBMIT_CMD(Sign, &keyHandle, 1, &session, 1);
+    END_SUBMIT_CMD();
+}
+
+TPM_RC
+TPM2_SignComplete(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TPMT_SIGNATURE         *signature           // OUT
+)
+{
+    if (signature == NULL || !TSS_IsCmdPending(tpm, TPM_CC_Sign))
+    {
+        LogError("Invalid parameter signature: %p, or no TPM2_Sign is pending", signature);
+        return TPM_RC_FAILURE;
+    }
+    else
+    {
+        BEGIN_COMPLETE_CMD(Sign);
+        TSS_UNMARSHAL_FLAGGED(TPMT_SIGNATURE, signature);
+        END_COMPLETE_CMD();
+    }
+}
+
 TPM_RC
 TSS_SequenceComplete(
     TSS_DEVICE             *tpm,                // IN/OUT
@@ -560,15 +2077,11 @@ TSS_SequenceComplete(
     TPM2B_DIGEST           *result              // OUT
 )
 {
-    TPM2B_MAX_BUFFER    dataBuf;// = { (UINT16)dataSize };
-    dataBuf.t.size = (UINT16)dataSize;
-
     if (dataSize > MAX_DIGEST_BUFFER)
         return TPM_RC_SIZE;
-    MemoryCopy(dataBuf.t.buffer, data, dataSize);
 
-    return TPM2_SequenceComplete(tpm, session, sequenceHandle, &dataBuf, TPM_RH_NULL,
-        result, NULL);
+    return TSS_SequenceCompleteCmd(tpm, session, sequenceHandle, data, (UINT16)dataSize,
+        TPM_RH_NULL, result, NULL);
 }
 
 TPM_RC
@@ -580,14 +2093,10 @@ TSS_SequenceUpdate(
     UINT32                  dataSize            // IN
 )
 {
-    TPM2B_MAX_BUFFER    dataBuf;// = { (UINT16)dataSize };
-    dataBuf.t.size = (UINT16)dataSize;
-
     if (dataSize > MAX_DIGEST_BUFFER)
         return TPM_RC_SIZE;
-    MemoryCopy(dataBuf.t.buffer, data, dataSize);
 
-    return TPM2_SequenceUpdate(tpm, session, sequenceHandle, &dataBuf);
+    return TSS_SequenceUpdateCmd(tpm, session, sequenceHandle, data, (UINT16)dataSize);
 }
 
 TPM_RC
@@ -645,27 +2154,114 @@ TSS_StartAuthSession(
 // TSS extensions of the TPM 2.0 command interafce
 //
 
-TPM_RC TSS_CreatePwAuthSession(TPM2B_AUTH* authValue, TSS_SESSION* session)
+TPM_RC TSS_CreatePwAuthSession(TPM2B_AUTH* authValue, TSS_SESSION* session)
+{
+    TPM_RC result;
+    if (authValue == NULL || session == NULL)
+    {
+        LogError("Invalid parameter specified authValue: %p, session: %p", authValue, session);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        session->SessIn.sessionHandle = TPM_RS_PW;
+        session->SessIn.nonce.t.size = 0;
+        session->SessIn.sessionAttributes.continueSession = SET;
+        TSS_COPY2B(session->SessIn.hmac, *authValue);
+        session->SessOut.sessionAttributes.continueSession = SET;
+        result = TPM_RC_SUCCESS;
+    }
+    return result;
+}
+
+// Reads 'count' consecutive TPM properties starting from 'first' into 'values'.
+// Properties not reported by the TPM are set to TSS_BAD_PROPERTY.
+static TPM_RC TSS_ReadTpmProperties(TSS_DEVICE* tpm, TPM_PT first, UINT32 count, UINT32* values)
+{
+    TPM_RC                  result;
+    TPM_PT                  property = first;
+    TPMI_YES_NO             more;
+    TPMS_CAPABILITY_DATA    capData;
+
+    for (UINT32 i = 0; i < count; i++)
+    {
+        values[i] = TSS_BAD_PROPERTY;
+    }
+
+    do
+    {
+        TPML_TAGGED_TPM_PROPERTY   *pProps = &capData.data.tpmProperties;
+
+        more = NO;
+        result = TPM2_GetCapability(tpm, TPM_CAP_TPM_PROPERTIES, property, first + count - property, &more, &capData);
+        if (result != TPM_RC_SUCCESS || capData.capability != TPM_CAP_TPM_PROPERTIES)
+        {
+            LogError("Get Capability failure");
+            result = TPM_RC_FAILURE;
+        }
+        else if (pProps->count == 0)
+        {
+            more = NO;
+        }
+        else
+        {
+            for (UINT32 i = 0; i < pProps->count; i++)
+            {
+                TPM_PT prop = pProps->tpmProperty[i].property;
+                if (prop >= first && prop < first + count)
+                {
+                    values[prop - first] = pProps->tpmProperty[i].value;
+                }
+            }
+            // Continue after the last returned property, if the TPM has more of them
+            TPM_PT next = pProps->tpmProperty[pProps->count - 1].property + 1;
+            if (more == YES && next <= property)
+            {
+                // The TPM must make progress, or the loop would never end
+                LogError("TPM reported more properties without advancing past 0x%08x", property);
+                result = TPM_RC_FAILURE;
+            }
+            property = next;
+        }
+    } while (result == TPM_RC_SUCCESS && more == YES && property < first + count);
+
+    return result;
+}
+
+static TPM_RC TSS_FillFixedProperties(TSS_DEVICE* tpm)
+{
+    TPM_RC result;
+    if (tpm->FixedPropsValid)
+    {
+        result = TPM_RC_SUCCESS;
+    }
+    else
+    {
+        result = TSS_ReadTpmProperties(tpm, PT_FIXED, TSS_PT_FIXED_COUNT, tpm->FixedProps);
+        tpm->FixedPropsValid = (result == TPM_RC_SUCCESS);
+    }
+    return result;
+}
+
+// The variable properties are shared by the threads using the device while the
+// dispatcher is running, and are only accessed under its lock
+static void TSS_LockVarProperties(TSS_DEVICE* tpm)
 {
-    TPM_RC result;
-    if (authValue == NULL || session == NULL)
+    if (tpm->VarPropsLock != NULL)
     {
-        LogError("Invalid parameter specified authValue: %p, session: %p", authValue, session);
-        result = TPM_RC_FAILURE;
+        (void)Lock(tpm->VarPropsLock);
     }
-    else
+}
+
+static void TSS_UnlockVarProperties(TSS_DEVICE* tpm)
+{
+    if (tpm->VarPropsLock != NULL)
     {
-        session->SessIn.sessionHandle = TPM_RS_PW;
-        session->SessIn.nonce.t.size = 0;
-        session->SessIn.sessionAttributes.continueSession = SET;
-        TSS_COPY2B(session->SessIn.hmac, *authValue);
-        session->SessOut.sessionAttributes.continueSession = SET;
-        result = TPM_RC_SUCCESS;
+        (void)Unlock(tpm->VarPropsLock);
     }
-    return result;
 }
 
-UINT32 TSS_GetTpmProperty(TSS_DEVICE* tpm, TPM_PT property)
+static UINT32 TSS_QueryTpmProperty(TSS_DEVICE* tpm, TPM_PT property)
 {
     UINT32 result;
     TPMI_YES_NO                 more = NO;
@@ -698,6 +2294,69 @@ UINT32 TSS_GetTpmProperty(TSS_DEVICE* tpm, TPM_PT property)
     return result;
 }
 
+UINT32 TSS_GetTpmProperty(TSS_DEVICE* tpm, TPM_PT property)
+{
+    UINT32 result;
+    if (tpm == NULL)
+    {
+        LogError("Invalid parameter specified tpm: NULL");
+        result = TSS_BAD_PROPERTY;
+    }
+    else if (property >= PT_FIXED && property < PT_FIXED + TSS_PT_FIXED_COUNT)
+    {
+        // Fixed properties are read once for the lifetime of the device. With the
+        // dispatcher running they are already there, see TSS_StartDispatcher().
+        result = TSS_FillFixedProperties(tpm) == TPM_RC_SUCCESS ? tpm->FixedProps[property - PT_FIXED] : TSS_BAD_PROPERTY;
+    }
+    else if (property >= PT_VAR && property < PT_VAR + TSS_PT_VAR_COUNT)
+    {
+        BOOL valid;
+
+        TSS_LockVarProperties(tpm);
+        valid = tpm->VarPropsValid;
+        result = valid ? tpm->VarProps[property - PT_VAR] : TSS_BAD_PROPERTY;
+        TSS_UnlockVarProperties(tpm);
+
+        if (!valid && TSS_RefreshTpmProperties(tpm) == TPM_RC_SUCCESS)
+        {
+            TSS_LockVarProperties(tpm);
+            result = tpm->VarPropsValid ? tpm->VarProps[property - PT_VAR] : TSS_BAD_PROPERTY;
+            TSS_UnlockVarProperties(tpm);
+        }
+    }
+    else
+    {
+        result = TSS_QueryTpmProperty(tpm, property);
+    }
+    return result;
+}
+
+TPM_RC TSS_RefreshTpmProperties(TSS_DEVICE* tpm)
+{
+    TPM_RC result;
+    if (tpm == NULL)
+    {
+        LogError("Invalid parameter specified tpm: NULL");
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        UINT32 values[TSS_PT_VAR_COUNT];
+
+        // The TPM is queried outside of the lock, and the cache is replaced at once
+        result = TSS_ReadTpmProperties(tpm, PT_VAR, TSS_PT_VAR_COUNT, values);
+
+        TSS_LockVarProperties(tpm);
+        if (result == TPM_RC_SUCCESS)
+        {
+            memcpy(tpm->VarProps, values, sizeof(values));
+        }
+        tpm->VarPropsValid = (result == TPM_RC_SUCCESS);
+        TSS_UnlockVarProperties(tpm);
+    }
+    return result;
+}
+
 TPM_RC TSS_CreatePrimary(TSS_DEVICE *tpm, TSS_SESSION *sess,
     TPM_HANDLE hierarchy, TPM2B_PUBLIC *inPub,
     TPM_HANDLE *outHandle, TPM2B_PUBLIC *outPub)
@@ -744,11 +2403,9 @@ TPM2_ActivateCredential(
     sessions[0] = activateSess;
     sessions[1] = keySess;
 
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
-    TSS_MARSHAL(TPM2B_ID_OBJECT, credentialBlob);
-    TSS_MARSHAL(TPM2B_ENCRYPTED_SECRET, secret);
+    TSS_MARSHAL_SIZED(TPM2B_ID_OBJECT, credentialBlob);
+    TSS_MARSHAL_SIZED(TPM2B_ENCRYPTED_SECRET, secret);
     DISPATCH_CMD(ActivateCredential, handles, 2, sessions, 2);
     TSS_UNMARSHAL(TPM2B_DIGEST, certInfo);
     END_CMD();
@@ -770,11 +2427,9 @@ TPM2_Create(
     TPMT_TK_CREATION         *creationTicket    // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
-    TSS_MARSHAL(TPM2B_SENSITIVE_CREATE, inSensitive);
-    TSS_MARSHAL(TPM2B_PUBLIC, inPublic);
+    TSS_MARSHAL_SIZED(TPM2B_SENSITIVE_CREATE, inSensitive);
+    TSS_MARSHAL_SIZED(TPM2B_PUBLIC, inPublic);
     TSS_MARSHAL(TPM2B_DATA, outsideInfo);
     TSS_MARSHAL(TPML_PCR_SELECTION, creationPCR);
     DISPATCH_CMD(Create, &parentHandle, 1, &session, 1);
@@ -802,11 +2457,9 @@ TPM2_CreatePrimary(
     TPMT_TK_CREATION         *creationTicket    // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
-    TSS_MARSHAL(TPM2B_SENSITIVE_CREATE, inSensitive);
-    TSS_MARSHAL(TPM2B_PUBLIC, inPublic);
+    TSS_MARSHAL_SIZED(TPM2B_SENSITIVE_CREATE, inSensitive);
+    TSS_MARSHAL_SIZED(TPM2B_PUBLIC, inPublic);
     TSS_MARSHAL(TPM2B_DATA, outsideInfo);
     TSS_MARSHAL(TPML_PCR_SELECTION, creationPCR);
     DISPATCH_CMD(CreatePrimary, &primaryHandle, 1, &session, 1);
@@ -818,6 +2471,87 @@ TPM2_CreatePrimary(
     END_CMD();
 }
 
+TPM_RC
+TPM2_CreatePrimarySubmit(
+    TSS_DEVICE               *tpm,              // IN/OUT
+    TSS_SESSION              *session,          // IN/OUT
+    TPMI_DH_OBJECT            primaryHandle,    // IN
+    TPM2B_SENSITIVE_CREATE   *inSensitive,      // IN
+    TPM2B_PUBLIC             *inPublic,         // IN
+    TPM2B_DATA               *outsideInfo,      // IN
+    TPML_PCR_SELECTION       *creationPCR       // IN
+)
+{
+    BEGIN_CMD();
+    TSS_MARSHAL_SIZED(TPM2B_SENSITIVE_CREATE, inSensitive);
+    TSS_MARSHAL_SIZED(TPM2B_PUBLIC, inPublic);
+    TSS_MARSHAL(TPM2B_DATA, outsideInfo);
+    TSS_MARSHAL(TPML_PCR_SELECTION, creationPCR);
+    SUBMIT_CMD(CreatePrimary, &primaryHandle, 1, &session, 1);
+    END_SUBMIT_CMD();
+}
+
+TPM_RC
+TPM2_CreatePrimaryComplete(
+    TSS_DEVICE               *tpm,              // IN/OUT
+    TPM_HANDLE               *objectHandle,     // OUT
+    TPM2B_PUBLIC             *outPublic,        // OUT
+    TPM2B_CREATION_DATA      *creationData,     // OUT [opt]
+    TPM2B_DIGEST             *creationHash,     // OUT [opt]
+    TPMT_TK_CREATION         *creationTicket    // OUT [opt]
+)
+{
+    if (objectHandle == NULL || outPublic == NULL || !TSS_IsCmdPending(tpm, TPM_CC_CreatePrimary))
+    {
+        LogError("Invalid parameter objectHandle: %p, outPublic: %p, or no TPM2_CreatePrimary is pending", objectHandle, outPublic);
+        return TPM_RC_FAILURE;
+    }
+    else
+    {
+        BEGIN_COMPLETE_CMD(CreatePrimary);
+        *objectHandle = cmdCtx->RetHandle;
+        TSS_UNMARSHAL_FLAGGED(TPM2B_PUBLIC, outPublic);
+        TSS_UNMARSHAL_OPT(TPM2B_CREATION_DATA, creationData);
+        TSS_UNMARSHAL_OPT(TPM2B_DIGEST, creationHash);
+        TSS_UNMARSHAL_OPT(TPMT_TK_CREATION, creationTicket);
+        END_COMPLETE_CMD();
+    }
+}
+
+TPM_RC
+TPM2_CreatePrimaryView(
+    TSS_DEVICE               *tpm,              // IN/OUT
+    TSS_SESSION              *session,          // IN/OUT
+    TPMI_DH_OBJECT            primaryHandle,    // IN
+    TPM2B_SENSITIVE_CREATE   *inSensitive,      // IN
+    TPM2B_PUBLIC             *inPublic,         // IN
+    TPM2B_DATA               *outsideInfo,      // IN
+    TPML_PCR_SELECTION       *creationPCR,      // IN
+    TSS_RESP_BUFFER          *respBuffer,       // OUT
+    TPM_HANDLE               *objectHandle,     // OUT
+    TSS_PUBLIC_VIEW          *outPublic         // OUT
+)
+{
+    if (respBuffer == NULL || objectHandle == NULL || outPublic == NULL)
+    {
+        LogError("Invalid parameter respBuffer: %p, objectHandle: %p, outPublic: %p", respBuffer, objectHandle, outPublic);
+        return TPM_RC_FAILURE;
+    }
+    else
+    {
+        BEGIN_CMD();
+        TSS_MARSHAL_SIZED(TPM2B_SENSITIVE_CREATE, inSensitive);
+        TSS_MARSHAL_SIZED(TPM2B_PUBLIC, inPublic);
+        TSS_MARSHAL(TPM2B_DATA, outsideInfo);
+        TSS_MARSHAL(TPML_PCR_SELECTION, creationPCR);
+        DISPATCH_CMD(CreatePrimary, &primaryHandle, 1, &session, 1);
+        *objectHandle = cmdCtx->RetHandle;
+        TSS_RETAIN_RESPONSE(respBuffer);
+        TSS_UNMARSHAL_VIEW(&outPublic->Area);
+        END_CMD();
+    }
+}
+
 TPM_RC
 TPM2_EncryptDecrypt(
     TSS_DEVICE             *tpm,                // IN/OUT
@@ -831,13 +2565,11 @@ TPM2_EncryptDecrypt(
     TPM2B_IV               *ivOut               // OUT [opt]
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
     TSS_MARSHAL(TPMI_YES_NO, &decrypt);
     TSS_MARSHAL(TPM_ALG_ID, &cipherMode);
     TSS_MARSHAL_OPT2B(TPM2B_IV, ivIn);
-    TSS_MARSHAL(TPM2B_MAX_BUFFER, inData);
+    TSS_MARSHAL_SIZED(TPM2B_MAX_BUFFER, inData);
     DISPATCH_CMD(EncryptDecrypt, &keyHandle, 1, &session, 1);
     TSS_UNMARSHAL(TPM2B_MAX_BUFFER, outData);
     TSS_UNMARSHAL_OPT(TPM2B_IV, ivOut);
@@ -853,7 +2585,6 @@ TPM2_EvictControl(
     TPMI_DH_PERSISTENT    persistentHandle      // IN
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
     TPM_HANDLE handles[2];// = { auth , objectHandle};
     handles[0] = auth;
     handles[1] = objectHandle;
@@ -870,8 +2601,6 @@ TPM2_FlushContext(
     TPMI_DH_CONTEXT         flushHandle         // IN
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
     DISPATCH_CMD(FlushContext, &flushHandle, 1, NULL, 0);
     END_CMD();
@@ -887,8 +2616,6 @@ TPM2_GetCapability(
     TPMS_CAPABILITY_DATA   *capabilityData      // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
     TSS_MARSHAL(TPM_CAP, &capability);
     TSS_MARSHAL(UINT32, &property);
@@ -909,16 +2636,8 @@ TPM2_Hash(
     TPMT_TK_HASHCHECK      *validation          // OUT [opt]
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
-    BEGIN_CMD();
-    TSS_MARSHAL_OPT2B(TPM2B_MAX_BUFFER, data);
-    TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
-    TSS_MARSHAL(TPMI_RH_HIERARCHY, &hierarchy);
-    DISPATCH_CMD(Hash, NULL, 0, NULL, 0);
-    TSS_UNMARSHAL(TPM2B_DIGEST, outHash);
-    TSS_UNMARSHAL_OPT(TPMT_TK_HASHCHECK, validation);
-    END_CMD();
+    return TSS_HashCmd(tpm, data ? data->t.buffer : NULL, data ? data->t.size : 0,
+                       hashAlg, hierarchy, outHash, validation);
 }
 
 TPM_RC
@@ -929,8 +2648,6 @@ TPM2_HashSequenceStart(
     TPMI_DH_OBJECT         *sequenceHandle      // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-    
     BEGIN_CMD();
     TSS_MARSHAL_OPT2B(TPM2B_AUTH, auth);
     TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
@@ -949,8 +2666,6 @@ TPM2_HMAC_Start(
     TPMI_DH_OBJECT         *sequenceHandle      // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
     TSS_MARSHAL_OPT2B(TPM2B_AUTH, auth);
     TSS_MARSHAL(TPMI_ALG_HASH, &hashAlg);
@@ -972,12 +2687,10 @@ TPM2_Import(
     TPM2B_PRIVATE          *outPrivate          // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-
     BEGIN_CMD();
     TSS_MARSHAL_OPT2B(TPM2B_DATA, encryptionKey);
-    TSS_MARSHAL(TPM2B_PUBLIC, objectPublic);
-    TSS_MARSHAL(TPM2B_PRIVATE, duplicate);
+    TSS_MARSHAL_SIZED(TPM2B_PUBLIC, objectPublic);
+    TSS_MARSHAL_SIZED(TPM2B_PRIVATE, duplicate);
     TSS_MARSHAL_OPT2B(TPM2B_ENCRYPTED_SECRET, inSymSeed);
     TSS_MARSHAL(TPMT_SYM_DEF_OBJECT, symmetricAlg ? symmetricAlg : &NullSymDefObject);
     DISPATCH_CMD(Import, &parentHandle, 1, &session, 1);
@@ -985,83 +2698,290 @@ TPM2_Import(
     END_CMD();
 }
 
-TPM_RC
-TPM2_Load(
-    TSS_DEVICE             *tpm,                // IN/OUT
-    TSS_SESSION            *session,            // IN/OUT
-    TPMI_DH_OBJECT          parentHandle,       // IN
-    TPM2B_PRIVATE          *inPrivate,          // IN [opt]
-    TPM2B_PUBLIC           *inPublic,           // IN
-    TPM_HANDLE             *objectHandle,       // OUT
-    TPM2B_NAME             *name                // OUT
+TPM_RC
+TPM2_Load(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          parentHandle,       // IN
+    TPM2B_PRIVATE          *inPrivate,          // IN [opt]
+    TPM2B_PUBLIC           *inPublic,           // IN
+    TPM_HANDLE             *objectHandle,       // OUT
+    TPM2B_NAME             *name                // OUT
+)
+{
+    BEGIN_CMD();
+    TSS_MARSHAL_OPT2B(TPM2B_PRIVATE, inPrivate);
+    TSS_MARSHAL_SIZED(TPM2B_PUBLIC, inPublic);
+    DISPATCH_CMD(Load, &parentHandle, 1, &session, 1);
+    *objectHandle = cmdCtx->RetHandle;
+    TSS_UNMARSHAL_OPT(TPM2B_NAME, name);
+    END_CMD();
+}
+
+TPM_RC
+TPM2_LoadView(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_OBJECT          parentHandle,       // IN
+    TPM2B_PRIVATE          *inPrivate,          // IN [opt]
+    TPM2B_PUBLIC           *inPublic,           // IN
+    TSS_RESP_BUFFER        *respBuffer,         // OUT
+    TPM_HANDLE             *objectHandle,       // OUT
+    TSS_BYTES_VIEW         *name                // OUT
+)
+{
+    if (respBuffer == NULL || objectHandle == NULL || name == NULL)
+    {
+        LogError("Invalid parameter respBuffer: %p, objectHandle: %p, name: %p", respBuffer, objectHandle, name);
+        return TPM_RC_FAILURE;
+    }
+    else
+    {
+        BEGIN_CMD();
+        TSS_MARSHAL_OPT2B(TPM2B_PRIVATE, inPrivate);
+        TSS_MARSHAL_SIZED(TPM2B_PUBLIC, inPublic);
+        DISPATCH_CMD(Load, &parentHandle, 1, &session, 1);
+        *objectHandle = cmdCtx->RetHandle;
+        TSS_RETAIN_RESPONSE(respBuffer);
+        TSS_UNMARSHAL_VIEW(name);
+        END_CMD();
+    }
+}
+
+TPM_RC
+TPM2_PolicySecret(
+    TSS_DEVICE             *tpm,                // IN/OUT
+    TSS_SESSION            *session,            // IN/OUT
+    TPMI_DH_ENTITY          authHandle,         // IN
+    TPMI_SH_POLICY          policySession,      // IN
+    TPM2B_NONCE            *nonceTPM,           // IN [opt]
+    TPM2B_DIGEST           *cpHashA,            // IN [opt]
+    TPM2B_NONCE            *policyRef,          // IN [opt]
+    INT32                   expiration,         // IN [opt]
+    TPM2B_TIMEOUT          *timeout,            // OUT
+    TPMT_TK_AUTH           *policyTicket        // OUT [opt]
+)
+{
+    TPM_HANDLE  handles[2];// = { authHandle, policySession };
+    handles[0] = authHandle;
+    handles[1] = policySession;
+
+    BEGIN_CMD();
+    TSS_MARSHAL_OPT2B(TPM2B_NONCE, nonceTPM);
+    TSS_MARSHAL_OPT2B(TPM2B_DIGEST, cpHashA);
+    TSS_MARSHAL_OPT2B(TPM2B_NONCE, policyRef);
+    TSS_MARSHAL(INT32, &expiration);
+    DISPATCH_CMD(PolicySecret, handles, 2, &session, 1);
+    TSS_UNMARSHAL(TPM2B_TIMEOUT, timeout);
+    TSS_UNMARSHAL_OPT(TPMT_TK_AUTH, policyTicket);
+    END_CMD();
+}
+
+TPM_RC
+TPM2_ReadPublic(
+    TSS_DEVICE         *tpm,                    // IN/OUT
+    TPMI_DH_OBJECT      objectHandle,           // IN
+    TPM2B_PUBLIC       *outPublic,              // OUT
+    TPM2B_NAME         *name,                   // OUT
+    TPM2B_NAME         *qualifiedName           // OUT
+)
+{
+    if (outPublic == NULL || name == NULL || qualifiedName == NULL)
+    {
+        LogError("Invalid parameter outPublic: %p, name: %p, qualifiedName: %p", outPublic, name, qualifiedName);
+        return TPM_RC_FAILURE;
+    }
+    else
+    {
+        BEGIN_CMD();
+        DISPATCH_CMD(ReadPublic, &objectHandle, 1, NULL, 0);
+        TSS_UNMARSHAL_FLAGGED(TPM2B_PUBLIC, outPublic);
+        TSS_UNMARSHAL(TPM2B_NAME, name);
+        TSS_UNMARSHAL(TPM2B_NAME, qualifiedName);
+        END_CMD();
+    }
+}
+
+TPM_RC
+TPM2_ReadPublicView(
+    TSS_DEVICE         *tpm,                    // IN/OUT
+    TPMI_DH_OBJECT      objectHandle,           // IN
+    TSS_RESP_BUFFER    *respBuffer,             // OUT
+    TSS_PUBLIC_VIEW    *outPublic,              // OUT
+    TSS_BYTES_VIEW     *name,                   // OUT
+    TSS_BYTES_VIEW     *qualifiedName           // OUT
+)
+{
+    if (respBuffer == NULL || outPublic == NULL || name == NULL || qualifiedName == NULL)
+    {
+        LogError("Invalid parameter respBuffer: %p, outPublic: %p, name: %p, qualifiedName: %p", respBuffer, outPublic, name, qualifiedName);
+        return TPM_RC_FAILURE;
+    }
+    else
+    {
+        BEGIN_CMD();
+        DISPATCH_CMD(ReadPublic, &objectHandle, 1, NULL, 0);
+        TSS_RETAIN_RESPONSE(respBuffer);
+        TSS_UNMARSHAL_VIEW(&outPublic->Area);
+        TSS_UNMARSHAL_VIEW(name);
+        TSS_UNMARSHAL_VIEW(qualifiedName);
+        END_CMD();
+    }
+}
+
+// Resets the response part of 'cmdCtx' before a response is received into it
+static void
+TSS_ResetResponse(
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT
+)
+{
+    cmdCtx->RespBufPtr = cmdCtx->RespBuffer;
+    cmdCtx->RespParamSize = 0;
+    cmdCtx->RetHandle = TPM_RH_UNASSIGNED;
+    cmdCtx->RespSize = sizeof(cmdCtx->RespBuffer);
+}
+
+// Parses the header of the response received into 'cmdCtx'
+static TPM_RC
+TSS_ParseResponse(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode,       // IN: Command code
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: Response buffer
+)
+{
+    TPM_RC      cmdResult = TPM_RC_SUCCESS;
+    TPM_ST      tag;
+    UINT32      expectedSize = 0;
+
+    cmdCtx->RespBytesLeft = cmdCtx->RespSize;
+    tpm->LastRawResponse = TPM_RC_NOT_USED;
+
+    TSS_UNMARSHAL(TPMI_ST_COMMAND_TAG, &tag);
+    TSS_UNMARSHAL(UINT32, &expectedSize);
+    TSS_UNMARSHAL(TPM_RC, &tpm->LastRawResponse);
+
+    if (cmdCtx->RespSize != expectedSize)
+    {
+        LogError("response size is not expected size.");
+        cmdResult = TPM_RC_COMMAND_SIZE;//TSS_E_BAD_RESPONSE_LEN;
+    }
+    else
+    {
+        if (tpm->LastRawResponse == TPM_RC_SUCCESS)
+        {
+            const TSS_CMD_DESC* desc = TSS_GetCmdDesc(cmdCode);
+            if (desc != NULL && (desc->Flags & TSS_CMD_RET_HANDLE) != 0)
+            {
+                // Response buffer contains a handle returned by the TPM
+                TSS_UNMARSHAL(TPM_HANDLE, &cmdCtx->RetHandle);
+                //pAssert(cmdCtx->RetHandle != 0 && cmdCtx->RetHandle != TPM_RH_UNASSIGNED);
+                if (cmdCtx->RetHandle == 0 || cmdCtx->RetHandle == TPM_RH_UNASSIGNED)
+                {
+                    LogError("unable to unmarshal return handle.");
+                    cmdResult = TPM_RC_COMMAND_CODE;
+                }
+            }
+            if (cmdResult == TPM_RC_SUCCESS && tag == TPM_ST_SESSIONS)
+            {
+                // Response buffer contains a field specifying the size of returned parameters
+                TSS_UNMARSHAL(UINT32, &cmdCtx->RespParamSize);
+            }
+        }
+
+        if (cmdResult == TPM_RC_SUCCESS)
+        {
+            // Remove error location information from the response code, if any
+            cmdResult = CleanResponseCode(tpm->LastRawResponse);
+        }
+    }
+    // Jump target of TSS_UNMARSHAL() failures
+end_cmd:
+    return cmdResult;
+}
+
+// Sends the command built in 'cmdCtx' to the TPM and parses the response header
+static TPM_RC
+TSS_ExecuteCmd(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode,       // IN: Command code
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: On input contains complete command buffer
+                                    //     On output contains response buffer
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
+    TPM_RC      cmdResult;
+    TSS_STATUS  res;
 
-    BEGIN_CMD();
-    TSS_MARSHAL_OPT2B(TPM2B_PRIVATE, inPrivate);
-    TSS_MARSHAL(TPM2B_PUBLIC, inPublic);
-    DISPATCH_CMD(Load, &parentHandle, 1, &session, 1);
-    *objectHandle = cmdCtx->RetHandle;
-    TSS_UNMARSHAL_OPT(TPM2B_NAME, name);
-    END_CMD();
+    TSS_ResetResponse(cmdCtx);
+    res = TSS_SendCommand(tpm, cmdCtx->CmdStart, cmdCtx->CmdSize, cmdCtx->RespBuffer, (INT32*)&cmdCtx->RespSize);
+    if (res != TSS_SUCCESS)
+    {
+        LogError("Sending command to tpm %d.", res);
+        cmdResult = TPM_RC_COMMAND_CODE;
+    }
+    else
+    {
+        cmdResult = TSS_ParseResponse(tpm, cmdCode, cmdCtx);
+    }
+    return cmdResult;
 }
 
-TPM_RC
-TPM2_PolicySecret(
-    TSS_DEVICE             *tpm,                // IN/OUT
-    TSS_SESSION            *session,            // IN/OUT
-    TPMI_DH_ENTITY          authHandle,         // IN
-    TPMI_SH_POLICY          policySession,      // IN
-    TPM2B_NONCE            *nonceTPM,           // IN [opt]
-    TPM2B_DIGEST           *cpHashA,            // IN [opt]
-    TPM2B_NONCE            *policyRef,          // IN [opt]
-    INT32                   expiration,         // IN [opt]
-    TPM2B_TIMEOUT          *timeout,            // OUT
-    TPMT_TK_AUTH           *policyTicket        // OUT [opt]
+// Hands the command built in 'cmdCtx' to the TPM without waiting for the response
+static TPM_RC
+TSS_SubmitCmd(
+    TSS_DEVICE      *tpm,           // IN
+    TSS_CMD_CONTEXT *cmdCtx         // IN: Complete command buffer
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-    TPM_HANDLE  handles[2];// = { authHandle, policySession };
-    handles[0] = authHandle;
-    handles[1] = policySession;
+    TPM_RC      cmdResult;
 
-    BEGIN_CMD();
-    TSS_MARSHAL_OPT2B(TPM2B_NONCE, nonceTPM);
-    TSS_MARSHAL_OPT2B(TPM2B_DIGEST, cpHashA);
-    TSS_MARSHAL_OPT2B(TPM2B_NONCE, policyRef);
-    TSS_MARSHAL(INT32, &expiration);
-    DISPATCH_CMD(PolicySecret, handles, 2, &session, 1);
-    TSS_UNMARSHAL(TPM2B_TIMEOUT, timeout);
-    TSS_UNMARSHAL_OPT(TPMT_TK_AUTH, policyTicket);
-    END_CMD();
+    if (tpm->tpm_comm_handle == NULL || tpm->Dispatcher != NULL)
+    {
+        LogError("Asynchronous commands require a TPM device without dispatcher");
+        cmdResult = TPM_RC_FAILURE;
+    }
+    else if (tpm_comm_submit_command_async(tpm->tpm_comm_handle, cmdCtx->CmdStart, cmdCtx->CmdSize) != 0)
+    {
+        LogError("Failure submitting command to tpm.");
+        cmdResult = TPM_RC_COMMAND_CODE;
+    }
+    else
+    {
+        cmdResult = TPM_RC_SUCCESS;
+    }
+    return cmdResult;
 }
 
-TPM_RC
-TPM2_ReadPublic(
-    TSS_DEVICE         *tpm,                    // IN/OUT
-    TPMI_DH_OBJECT      objectHandle,           // IN
-    TPM2B_PUBLIC       *outPublic,              // OUT
-    TPM2B_NAME         *name,                   // OUT
-    TPM2B_NAME         *qualifiedName           // OUT
+// Builds the command header in front of the parameters marshaled into 'cmdCtx'
+static TPM_RC
+TSS_FinalizeCmd(
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: On input contains initialized parameter buffer
+                                    //     On output contains complete command buffer
 )
 {
-    if (outPublic == NULL || name == NULL || qualifiedName == NULL)
+    TPM_RC      cmdResult;
+
+    if (cmdCtx->ParamSize > TSS_MAX_CMD_PARAMS_SIZE)
     {
-        LogError("Invalid parameter outPublic: %p, name: %p, qualifiedName: %p", outPublic, name, qualifiedName);
-        return TPM_RC_FAILURE;
+        LogError("Command parameters size %u exceeds the command buffer.", cmdCtx->ParamSize);
+        cmdResult = TPM_RC_COMMAND_SIZE;
     }
     else
     {
-        TSS_CMD_CONTEXT  CmdCtx;
-
-        BEGIN_CMD();
-        DISPATCH_CMD(ReadPublic, &objectHandle, 1, NULL, 0);
-        TSS_UNMARSHAL_FLAGGED(TPM2B_PUBLIC, outPublic);
-        TSS_UNMARSHAL(TPM2B_NAME, name);
-        TSS_UNMARSHAL(TPM2B_NAME, qualifiedName);
-        END_CMD();
+        cmdResult = TSS_BuildCommandInPlace(cmdCode, handles, numHandles, sessions, numSessions,
+                                            TSS_CMD_PARAMS(cmdCtx), cmdCtx->ParamSize, TSS_CMD_HEADER_RESERVE,
+                                            &cmdCtx->CmdStart, &cmdCtx->CmdSize);
+        if (cmdResult == TPM_RC_SUCCESS && cmdCtx->CmdSize > MAX_COMMAND_BUFFER)
+        {
+            LogError("Command size %u exceeds the maximum command size.", cmdCtx->CmdSize);
+            cmdResult = TPM_RC_COMMAND_SIZE;
+        }
     }
+    return cmdResult;
 }
 
 TPM_RC
@@ -1076,88 +2996,169 @@ TSS_DispatchCmd(
                                     //     On output contains complete command and response buffers
 )
 {
-    TPM_RC result;
-    TSS_STATUS  res;
-    TPM_ST      tag;
-    UINT32      expectedSize = 0;
+    TPM_RC      cmdResult;
 
     if (tpm == NULL || cmdCtx == NULL)
     {
         LogError("Invalid paramer specified tpm: %p, cmdCtx: %p", tpm, cmdCtx);
-        result = TPM_RC_FAILURE;
+        cmdResult = TPM_RC_FAILURE;
     }
     else
     {
-        cmdCtx->RespBufPtr = cmdCtx->RespBuffer;
-        cmdCtx->RespParamSize = 0;
-        cmdCtx->RetHandle = TPM_RH_UNASSIGNED;
+        cmdResult = TSS_FinalizeCmd(cmdCode, handles, numHandles, sessions, numSessions, cmdCtx);
+        if (cmdResult == TPM_RC_SUCCESS)
+        {
+            cmdResult = TSS_ExecuteCmd(tpm, cmdCode, cmdCtx);
+        }
+    }
+    return cmdResult;
+}
 
-        cmdCtx->CmdSize = TSS_BuildCommand(cmdCode, handles, numHandles, sessions, numSessions,
-            cmdCtx->ParamBuffer, cmdCtx->ParamSize, cmdCtx->CmdBuffer, sizeof(cmdCtx->CmdBuffer));
+static TPM_RC
+TSS_CompleteCmdAsync(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode,       // IN: Command code
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: Context the command was dispatched from
+                                    //     On output contains response buffer
+)
+{
+    TPM_RC      cmdResult;
+    int         res;
 
-        cmdCtx->RespSize = sizeof(cmdCtx->RespBuffer);
-        res = TSS_SendCommand(tpm, cmdCtx->CmdBuffer, cmdCtx->CmdSize, cmdCtx->RespBuffer, (INT32*)&cmdCtx->RespSize);
-        if (res != TSS_SUCCESS)
+    if (tpm == NULL || cmdCtx == NULL || tpm->tpm_comm_handle == NULL)
+    {
+        LogError("Invalid paramer specified tpm: %p, cmdCtx: %p", tpm, cmdCtx);
+        cmdResult = TPM_RC_FAILURE;
+    }
+    else
+    {
+        TSS_ResetResponse(cmdCtx);
+        res = tpm_comm_complete_command(tpm->tpm_comm_handle, cmdCtx->RespBuffer, &cmdCtx->RespSize);
+        if (res == TPM_COMM_PENDING)
+        {
+            cmdResult = TSS_E_TPM_PENDING;
+        }
+        else if (res != 0)
         {
-            LogError("Sending command to tpm %d.", res);
-            result = TPM_RC_COMMAND_CODE;
+            LogError("Failure receiving response from tpm %d.", res);
+            cmdResult = TPM_RC_COMMAND_CODE;
         }
         else
         {
-            result = TPM_RC_SUCCESS;
+            cmdResult = TSS_ParseResponse(tpm, cmdCode, cmdCtx);
+        }
+    }
+    return cmdResult;
+}
 
-            cmdCtx->RespBytesLeft = cmdCtx->RespSize;
-            tpm->LastRawResponse = TPM_RC_NOT_USED;
+static TPM_RC
+TSS_SubmitPendingCmd(
+    TSS_DEVICE      *tpm,           // IN/OUT
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    TSS_CMD_CONTEXT *cmdCtx         // IN/OUT: On input contains initialized parameter buffer
+                                    //     On output contains complete command buffer
+)
+{
+    TPM_RC      cmdResult;
 
-            TSS_UNMARSHAL(TPMI_ST_COMMAND_TAG, &tag);
-            TSS_UNMARSHAL(UINT32, &expectedSize);
-            TSS_UNMARSHAL(TPM_RC, &tpm->LastRawResponse);
+    if (tpm->PendingCmdCtx != NULL)
+    {
+        LogError("Command 0x%08x is already pending on this TPM device", tpm->PendingCmdCode);
+        cmdResult = TPM_RC_FAILURE;
+    }
+    else
+    {
+        cmdResult = TSS_FinalizeCmd(cmdCode, handles, numHandles, sessions, numSessions, cmdCtx);
+        if (cmdResult == TPM_RC_SUCCESS)
+        {
+            cmdResult = TSS_SubmitCmd(tpm, cmdCtx);
+        }
+        if (cmdResult == TPM_RC_SUCCESS)
+        {
+            tpm->PendingCmdCtx = cmdCtx;
+            tpm->PendingCmdCode = cmdCode;
+        }
+    }
+    return cmdResult;
+}
 
-            if (cmdCtx->RespSize != expectedSize)
-            {
-                LogError("response size is not expected size.");
-                result = TPM_RC_COMMAND_SIZE;//TSS_E_BAD_RESPONSE_LEN;
-            }
-            else
-            {
-                if (tpm->LastRawResponse == TPM_RC_SUCCESS)
-                {
-                    if (cmdCode == TPM_CC_CreatePrimary
-                        || cmdCode == TPM_CC_Load
-                        || cmdCode == TPM_CC_HMAC_Start
-                        || cmdCode == TPM_CC_ContextLoad
-                        || cmdCode == TPM_CC_LoadExternal
-                        || cmdCode == TPM_CC_StartAuthSession
-                        || cmdCode == TPM_CC_HashSequenceStart
-                        || cmdCode == TPM_CC_CreateLoaded)
-                    {
-                        // Response buffer contains a handle returned by the TPM
-                        TSS_UNMARSHAL(TPM_HANDLE, &cmdCtx->RetHandle);
-                        //pAssert(cmdCtx->RetHandle != 0 && cmdCtx->RetHandle != TPM_RH_UNASSIGNED);
-                        if (cmdCtx->RetHandle == 0 || cmdCtx->RetHandle == TPM_RH_UNASSIGNED)
-                        {
-                            LogError("unable to unmarshal return handle.");
-                            result = TPM_RC_COMMAND_CODE;
-                        }
-                    }
-                    if (result == TPM_RC_SUCCESS && tag == TPM_ST_SESSIONS)
-                    {
-                        // Response buffer contains a field specifying the size of returned parameters
-                        TSS_UNMARSHAL(UINT32, &cmdCtx->RespParamSize);
-                    }
-                }
+static BOOL
+TSS_IsCmdPending(
+    TSS_DEVICE      *tpm,           // IN
+    TPM_CC           cmdCode        // IN: Command code
+)
+{
+    BOOL        result;
 
-                if (result == TPM_RC_SUCCESS)
-                {
-                    // Remove error location information from the response code, if any
-                    result = CleanResponseCode(tpm->LastRawResponse);
-                }
-            }
-        }
+    if (tpm == NULL || tpm->PendingCmdCtx == NULL || tpm->PendingCmdCode != cmdCode)
+    {
+        LogError("Command 0x%08x is not pending on tpm %p", cmdCode, tpm);
+        result = FALSE;
+    }
+    else
+    {
+        result = TRUE;
     }
     return result;
 }
 
+// Patches the command size into the prepared header
+static TPM_RC
+TSS_FinalizePreparedCmd(
+    TSS_PREPARED_CMD   *preparedCmd // IN/OUT: Prepared command with the parameters marshaled
+)
+{
+    TPM_RC              cmdResult;
+    TSS_CMD_CONTEXT    *cmdCtx = &preparedCmd->CmdCtx;
+    BYTE               *pCmdSize = cmdCtx->CmdStart + sizeof(TPM_ST);
+
+    cmdCtx->CmdSize = preparedCmd->HeaderSize + cmdCtx->ParamSize;
+    if (cmdCtx->ParamSize > TSS_MAX_CMD_PARAMS_SIZE || cmdCtx->CmdSize > MAX_COMMAND_BUFFER)
+    {
+        LogError("Command size %u exceeds the maximum command size.", cmdCtx->CmdSize);
+        cmdResult = TPM_RC_COMMAND_SIZE;
+    }
+    else
+    {
+        // The only field of the prepared header that depends on the parameters
+        UINT32_Marshal(&cmdCtx->CmdSize, &pCmdSize, NULL);
+        cmdResult = TPM_RC_SUCCESS;
+    }
+    return cmdResult;
+}
+
+static TPM_RC
+TSS_DispatchPreparedCmd(
+    TSS_DEVICE         *tpm,        // IN
+    TSS_PREPARED_CMD   *preparedCmd // IN/OUT: Prepared command with the parameters marshaled
+)
+{
+    TPM_RC cmdResult = TSS_FinalizePreparedCmd(preparedCmd);
+    if (cmdResult == TPM_RC_SUCCESS)
+    {
+        cmdResult = TSS_ExecuteCmd(tpm, preparedCmd->CmdCode, &preparedCmd->CmdCtx);
+    }
+    return cmdResult;
+}
+
+static TPM_RC
+TSS_SubmitPreparedCmd(
+    TSS_DEVICE         *tpm,        // IN
+    TSS_PREPARED_CMD   *preparedCmd // IN/OUT: Prepared command with the parameters marshaled
+)
+{
+    TPM_RC cmdResult = TSS_FinalizePreparedCmd(preparedCmd);
+    if (cmdResult == TPM_RC_SUCCESS)
+    {
+        cmdResult = TSS_SubmitCmd(tpm, &preparedCmd->CmdCtx);
+    }
+    return cmdResult;
+}
+
 TSS_STATUS
 TSS_SendCommand(
     TSS_DEVICE  *tpm,               // IN: TPM device
@@ -1181,8 +3182,17 @@ TSS_SendCommand(
     }
     else
     {
-        // Send the command to the TPM
-        if (tpm_comm_submit_command(tpm->tpm_comm_handle, cmdBuffer, cmdSize, respBuffer, (uint32_t*)respSize) != 0)
+        int commResult;
+        // Send the command to the TPM, through the dispatcher thread if there is one
+        if (tpm->Dispatcher != NULL)
+        {
+            commResult = tpm_dispatcher_execute(tpm->Dispatcher, cmdBuffer, cmdSize, respBuffer, (uint32_t*)respSize);
+        }
+        else
+        {
+            commResult = tpm_comm_submit_command(tpm->tpm_comm_handle, cmdBuffer, cmdSize, respBuffer, (uint32_t*)respSize);
+        }
+        if (commResult != 0)
         {
             LogError("submitting command to TPM Communication.");
             result = TSS_E_TPM_TRANSACTION;
@@ -1209,57 +3219,69 @@ TPMA_OBJECT ToTpmaObject(UINT32 attrs)
 // TPM commands handling
 //
 
-// Returns the size of marhaled data  in 'commandBuffer' in bytes or 0 in case of
-// failure (invalid parameters).
-UINT32
-TSS_BuildCommand(
+static BOOL
+TSS_IsValidCommand(
     TPM_CC           cmdCode,       // IN: Command code
     TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
     INT32            numHandles,    // IN: Number of handles in 'handles'
     TSS_SESSION    **sessions,      // IN (opt): Array of sessions
     INT32            numSessions,   // IN: Number of sessions in 'sessions'
     BYTE            *params,        // IN (opt): Marshaled command parameters
-    INT32            paramsSize,    // IN: Size of 'params' in bytes
-    BYTE            *cmdBuffer,     // OUT: Command buffer ready for sending to TPM
-    INT32            bufCapacity    // IN: Capacity of 'cmdBuffer' in bytes
+    INT32            paramsSize     // IN: Size of 'params' in bytes
+)
+{
+    const TSS_CMD_DESC* desc = TSS_GetCmdDesc(cmdCode);
+
+    // Each handle requiring authorization needs a session. Additional audit or
+    // encryption sessions are allowed.
+    return !(desc == NULL
+            || numHandles != desc->NumHandles
+            || numSessions < desc->NumAuthHandles || numSessions > MAX_SESSION_NUM
+            || (!handles && numHandles)
+            || (!sessions && numSessions)
+            || (!params && paramsSize));
+}
+
+// Marshals the command header, handles and authorization area of a command with
+// 'paramsSize' bytes of parameters, and advances 'cmdBuffer' past them.
+// Returns the size of the marshaled data in bytes.
+static UINT32
+TSS_MarshalCmdHeader(
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    INT32            paramsSize,    // IN: Size of the command parameters in bytes
+    BYTE           **cmdBuffer,     // IN/OUT: Command buffer
+    INT32           *bufCapacity    // IN/OUT: Capacity left in 'cmdBuffer' in bytes
 )
 {
     UINT32  cmdSize = 0;
+    UINT32  hdrSize = 0;
     BYTE   *pCmdSize = NULL;
     TPM_ST  tag = sessions ? TPM_ST_SESSIONS : TPM_ST_NO_SESSIONS;
 
-    if ((cmdCode < 0x0000011f || cmdCode > 0x00000193)
-        || (!handles && numHandles)
-        || (!sessions && numSessions)
-        || (!params && paramsSize)
-        || (bufCapacity < 0)
-        || (!cmdBuffer || (((UINT32)bufCapacity) < STD_RESPONSE_HEADER)))
-    {
-        return 0;
-    }
-
     //
     // Marshal command header
     //
 
-    cmdSize += TPMI_ST_COMMAND_TAG_Marshal(&tag, &cmdBuffer, &bufCapacity);
+    hdrSize += TPMI_ST_COMMAND_TAG_Marshal(&tag, cmdBuffer, bufCapacity);
 
     // Do not know the final size of the command buffer yet.
     // Remeber the place to marshal it, and reserve space in the command buffer.
-    pCmdSize = cmdBuffer;
-    cmdSize += UINT32_Marshal((UINT32*)&cmdSize, &cmdBuffer, &bufCapacity);
+    pCmdSize = *cmdBuffer;
+    hdrSize += UINT32_Marshal((UINT32*)&cmdSize, cmdBuffer, bufCapacity);
 
-    cmdSize += TPM_CC_Marshal(&cmdCode, &cmdBuffer, &bufCapacity);
+    hdrSize += TPM_CC_Marshal(&cmdCode, cmdBuffer, bufCapacity);
 
     //
     // Marshal handles, if any
     //
     for (int i = 0; i < numHandles; i++)
     {
-        cmdSize += TPM_HANDLE_Marshal(handles + i, &cmdBuffer, &bufCapacity);
+        hdrSize += TPM_HANDLE_Marshal(handles + i, cmdBuffer, bufCapacity);
     }
-    // cmdSize = 14
-    // bufCapacity - 4082
 
     //
     // Marshal sessions, if any
@@ -1268,45 +3290,121 @@ TSS_BuildCommand(
     {
         // Do not know the size of the authorization area yet.
         // Remeber the place to marshal it, and marshal a placeholder value for now.
-        BYTE   *pAuthSize = cmdBuffer; //t-sdks-
+        BYTE   *pAuthSize = *cmdBuffer;
         UINT32  authSize = 0;
 
-        // cmdSize - 14
-        cmdSize += UINT32_Marshal((UINT32*)&authSize, &cmdBuffer, &bufCapacity);
-        // cmdSize - 18
+        hdrSize += UINT32_Marshal((UINT32*)&authSize, cmdBuffer, bufCapacity);
 
         // Marshal the sessions
         for (int i = 0; i < numSessions; i++)
         {
-            authSize += TPMS_AUTH_COMMAND_Marshal(&sessions[i]->SessIn, &cmdBuffer, &bufCapacity);
+            authSize += TPMS_AUTH_COMMAND_Marshal(&sessions[i]->SessIn, cmdBuffer, bufCapacity);
         }
-        // CmdBuffer - zure-devices.net/devices/jebrandoDevice/n1491340412
 
         // Update total marshaled size
-        // 18 += 9;
-        cmdSize += authSize;
-        // 27
+        hdrSize += authSize;
 
         // And marshal auth area size into the reserved space
         UINT32_Marshal((UINT32*)&authSize, &pAuthSize, NULL);
-        // zure-devices.net/devices/jebrandoDevice
     }
 
+    // Finally marshal total command size into the reserved space
+    cmdSize = hdrSize + paramsSize;
+    UINT32_Marshal((UINT32*)&cmdSize, &pCmdSize, NULL);
+
+    return hdrSize;
+}
+
+// Returns the size of marhaled data  in 'commandBuffer' in bytes or 0 in case of
+// failure (invalid parameters).
+UINT32
+TSS_BuildCommand(
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    BYTE            *params,        // IN (opt): Marshaled command parameters
+    INT32            paramsSize,    // IN: Size of 'params' in bytes
+    BYTE            *cmdBuffer,     // OUT: Command buffer ready for sending to TPM
+    INT32            bufCapacity    // IN: Capacity of 'cmdBuffer' in bytes
+)
+{
+    UINT32  cmdSize;
+
+    if (!TSS_IsValidCommand(cmdCode, handles, numHandles, sessions, numSessions, params, paramsSize)
+        || (bufCapacity < 0)
+        || (!cmdBuffer || (((UINT32)bufCapacity) < STD_RESPONSE_HEADER)))
+    {
+        return 0;
+    }
+
+    cmdSize = TSS_MarshalCmdHeader(cmdCode, handles, numHandles, sessions, numSessions,
+                                   paramsSize, &cmdBuffer, &bufCapacity);
+
     //
     // Marshal parameters, if any
     //
     if (params && paramsSize)
     {
-        // 27
         cmdSize += BYTE_Array_Marshal(params, &cmdBuffer, &bufCapacity, paramsSize);
     }
 
-    // Finally marshal total command size into the reserved space
-    UINT32_Marshal((UINT32*)&cmdSize, &pCmdSize, NULL);
-
     return cmdSize;
 } // TSS_BuildCommand()
 
+// Builds the command around the parameters already marshaled at 'params' without
+// copying them. The header, handles and authorization area are marshaled into the
+// 'reservedSize' bytes preceding 'params', and then moved up so that they end
+// immediately in front of the parameters.
+TPM_RC
+TSS_BuildCommandInPlace(
+    TPM_CC           cmdCode,       // IN: Command code
+    TPM_HANDLE      *handles,       // IN (opt): Array of handles used by the command
+    INT32            numHandles,    // IN: Number of handles in 'handles'
+    TSS_SESSION    **sessions,      // IN (opt): Array of sessions
+    INT32            numSessions,   // IN: Number of sessions in 'sessions'
+    BYTE            *params,        // IN: Marshaled command parameters
+    INT32            paramsSize,    // IN: Size of 'params' in bytes
+    INT32            reservedSize,  // IN: Number of bytes available in front of 'params'
+    BYTE           **cmdBuffer,     // OUT: Beginning of the command ready for sending to TPM
+    UINT32          *cmdSize        // OUT: Size of the command in bytes
+)
+{
+    TPM_RC  result;
+
+    if (params == NULL || cmdBuffer == NULL || cmdSize == NULL || paramsSize < 0
+        || reservedSize < (INT32)STD_RESPONSE_HEADER
+        || !TSS_IsValidCommand(cmdCode, handles, numHandles, sessions, numSessions, params, paramsSize))
+    {
+        LogError("Invalid paramer specified params: %p, cmdBuffer: %p, cmdSize: %p", params, cmdBuffer, cmdSize);
+        result = TPM_RC_FAILURE;
+    }
+    else
+    {
+        BYTE   *hdrBuf = params - reservedSize;
+        INT32   hdrCapacity = reservedSize;
+        UINT32  hdrSize = TSS_MarshalCmdHeader(cmdCode, handles, numHandles, sessions, numSessions,
+                                               paramsSize, &hdrBuf, &hdrCapacity);
+        if (hdrSize > (UINT32)reservedSize)
+        {
+            LogError("Command header of %u bytes does not fit the reserved space.", hdrSize);
+            result = TPM_RC_COMMAND_SIZE;
+        }
+        else
+        {
+            *cmdBuffer = params - hdrSize;
+            if (hdrSize < (UINT32)reservedSize)
+            {
+                memmove(*cmdBuffer, params - reservedSize, hdrSize);
+            }
+            *cmdSize = hdrSize + paramsSize;
+            result = TPM_RC_SUCCESS;
+        }
+    }
+    return result;
+} // TSS_BuildCommandInPlace()
+
 // Misc TSS helpers
 // Returns names of TPM_RC and TSS_STATUS codes
 static const char* TSS_StatusValueName(UINT32 rc)
@@ -1548,6 +3646,8 @@ static const char* TSS_StatusValueName(UINT32 rc)
         return "TSS_E_TPM_TRANSACTION";
     case TSS_E_TPM_SIM_BAD_ACK:
         return "TSS_E_TPM_SIM_BAD_ACK";
+    case TSS_E_TPM_PENDING:
+        return "TSS_E_TPM_PENDING";
     case TSS_E_BAD_RESPONSE:
         return "TSS_E_BAD_RESPONSE";
     case TSS_E_BAD_RESPONSE_LEN:
@@ -1620,7 +3720,6 @@ TPM2_StartAuthSession(
     TPM2B_NONCE            *nonceTPM            // OUT
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
     TPM_HANDLE handles[2];
     handles[0] = tpmKey;
     handles[1] = bind;
@@ -1643,8 +3742,6 @@ TPM2_Startup(
     TPM_SU          startupType         // IN
 )
 {
-    TSS_CMD_CONTEXT  CmdCtx;
-    
     BEGIN_CMD();
     TSS_MARSHAL(TPM_SU, &startupType);
     DISPATCH_CMD(Startup, NULL, 0, NULL, 0);
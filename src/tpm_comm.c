@@ -0,0 +1,200 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Dispatches the tpm_comm functions to the backend of every handle, in the builds
+// with several backends (USE_TPM_COMM_RUNTIME). The default backend, used by
+// tpm_comm_create(), is set by the build with TPM_COMM_DEFAULT_BACKEND_OPS.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "umock_c/umock_c_prod.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "azure_utpm_c/tpm_comm.h"
+
+#ifndef USE_TPM_COMM_RUNTIME
+#error tpm_comm.c is only built with USE_TPM_COMM_RUNTIME
+#endif
+
+#ifndef TPM_COMM_DEFAULT_BACKEND_OPS
+#error TPM_COMM_DEFAULT_BACKEND_OPS must name the function returning the operations of the default backend
+#endif
+
+static const TPM_COMM_OPS* g_backends[TPM_COMM_MAX_BACKENDS];
+static size_t g_backend_count;
+
+// The handles of every backend start with the operations that created them
+static const TPM_COMM_OPS* get_handle_ops(TPM_COMM_HANDLE handle)
+{
+    return *(const TPM_COMM_OPS* const*)handle;
+}
+
+int tpm_comm_register_backend(const TPM_COMM_OPS* ops)
+{
+    int result;
+    if (ops == NULL || ops->name == NULL || ops->create == NULL || ops->destroy == NULL || ops->get_type == NULL || ops->submit_command == NULL)
+    {
+        LogError("Invalid argument specified ops: %p", ops);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        size_t index;
+        for (index = 0; index < g_backend_count; index++)
+        {
+            if (strcmp(g_backends[index]->name, ops->name) == 0)
+            {
+                break;
+            }
+        }
+
+        if (index == TPM_COMM_MAX_BACKENDS)
+        {
+            LogError("Failure: more than %d tpm_comm backends registered", TPM_COMM_MAX_BACKENDS);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            g_backends[index] = ops;
+            if (index == g_backend_count)
+            {
+                g_backend_count++;
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+const TPM_COMM_OPS* tpm_comm_find_backend(const char* name)
+{
+    const TPM_COMM_OPS* result = NULL;
+    if (name == NULL)
+    {
+        LogError("Invalid argument specified name: NULL");
+    }
+    else
+    {
+        for (size_t index = 0; index < g_backend_count; index++)
+        {
+            if (strcmp(g_backends[index]->name, name) == 0)
+            {
+                result = g_backends[index];
+                break;
+            }
+        }
+        if (result == NULL && strcmp(TPM_COMM_DEFAULT_BACKEND_OPS()->name, name) == 0)
+        {
+            result = TPM_COMM_DEFAULT_BACKEND_OPS();
+        }
+    }
+    return result;
+}
+
+TPM_COMM_HANDLE tpm_comm_create_with_backend(const TPM_COMM_OPS* ops, const char* endpoint)
+{
+    TPM_COMM_HANDLE result;
+    if (ops == NULL)
+    {
+        ops = TPM_COMM_DEFAULT_BACKEND_OPS();
+    }
+
+    if ((result = ops->create(endpoint)) == NULL)
+    {
+        LogError("Failure: creating %s tpm_comm handle", ops->name);
+    }
+    else
+    {
+        *(const TPM_COMM_OPS**)result = ops;
+    }
+    return result;
+}
+
+TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
+{
+    return tpm_comm_create_with_backend(NULL, endpoint);
+}
+
+void tpm_comm_destroy(TPM_COMM_HANDLE handle)
+{
+    if (handle != NULL)
+    {
+        get_handle_ops(handle)->destroy(handle);
+    }
+}
+
+TPM_COMM_TYPE tpm_comm_get_type(TPM_COMM_HANDLE handle)
+{
+    // Like the backends, answer for the default backend without a handle
+    return (handle != NULL) ? get_handle_ops(handle)->get_type(handle) : TPM_COMM_DEFAULT_BACKEND_OPS()->get_type(NULL);
+}
+
+int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("Invalid argument specified handle: NULL");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        result = get_handle_ops(handle)->submit_command(handle, cmd_bytes, bytes_len, response, resp_len);
+    }
+    return result;
+}
+
+int tpm_comm_submit_command_async(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("Invalid argument specified handle: NULL");
+        result = MU_FAILURE;
+    }
+    else if (get_handle_ops(handle)->submit_command_async == NULL)
+    {
+        LogError("The %s tpm_comm backend does not support asynchronous commands", get_handle_ops(handle)->name);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        result = get_handle_ops(handle)->submit_command_async(handle, cmd_bytes, bytes_len);
+    }
+    return result;
+}
+
+int tpm_comm_complete_command(TPM_COMM_HANDLE handle, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("Invalid argument specified handle: NULL");
+        result = MU_FAILURE;
+    }
+    else if (get_handle_ops(handle)->complete_command == NULL)
+    {
+        LogError("The %s tpm_comm backend does not support asynchronous commands", get_handle_ops(handle)->name);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        result = get_handle_ops(handle)->complete_command(handle, response, resp_len);
+    }
+    return result;
+}
+
+int tpm_comm_get_poll_fd(TPM_COMM_HANDLE handle)
+{
+    int result;
+    if (handle == NULL || get_handle_ops(handle)->get_poll_fd == NULL)
+    {
+        result = -1;
+    }
+    else
+    {
+        result = get_handle_ops(handle)->get_poll_fd(handle);
+    }
+    return result;
+}
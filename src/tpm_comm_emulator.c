@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
 #include "umock_c/umock_c_prod.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/xlogging.h"
@@ -14,6 +16,17 @@
 #include "azure_utpm_c/tpm_comm.h"
 #include "azure_utpm_c/tpm_socket_comm.h"
 
+#ifdef USE_TPM_COMM_RUNTIME
+// The functions of the backend are reached through tpm_comm_emulator_get_ops()
+#define tpm_comm_create                  tpm_comm_emulator_create
+#define tpm_comm_destroy                 tpm_comm_emulator_destroy
+#define tpm_comm_get_type                tpm_comm_emulator_get_type
+#define tpm_comm_submit_command          tpm_comm_emulator_submit_command
+#define tpm_comm_submit_command_async    tpm_comm_emulator_submit_command_async
+#define tpm_comm_complete_command        tpm_comm_emulator_complete_command
+#define tpm_comm_get_poll_fd             tpm_comm_emulator_get_poll_fd
+#endif // USE_TPM_COMM_RUNTIME
+
 #ifdef WIN32
     #include <Winsock2.h>
 #else
@@ -30,14 +43,25 @@
 #define REMOTE_SESSION_END_CMD          20
 #define MAX_DATA_RECV                   1024
 
+// Separates the command and platform socket paths of a unix endpoint
+#define UNIX_PATH_SEPARATOR             ','
+
 static const char* TPM_SIMULATOR_ADDRESS = "127.0.0.1";
 
 typedef struct TPM_COMM_INFO_TAG
 {
+    TPM_COMM_OPS_MEMBER
     TPM_SOCKET_HANDLE socket_conn;
     unsigned char* recv_bytes;
     size_t recv_length;
     char* socket_ip;
+    // Address of the platform channel, NULL when it is socket_ip or when a unix
+    // endpoint has no platform channel
+    char* platform_address;
+
+    // Command of the outstanding asynchronous submission
+    const unsigned char* pending_cmd;
+    uint32_t pending_cmd_len;
 } TPM_COMM_INFO;
 
 enum TpmSimCommands
@@ -98,7 +122,9 @@ static int power_on_simulator(TPM_COMM_INFO* tpm_comm_info)
     int result;
     TPM_SOCKET_HANDLE platform_conn;
 
-    if ((platform_conn = tpm_socket_create(tpm_comm_info->socket_ip, TPM_SIMULATOR_PLATFORM_PORT) ) == NULL)
+    const char* platform_address = tpm_comm_info->platform_address != NULL ? tpm_comm_info->platform_address : tpm_comm_info->socket_ip;
+
+    if ((platform_conn = tpm_socket_create(platform_address, TPM_SIMULATOR_PLATFORM_PORT) ) == NULL)
     {
         LogError("Failure: connecting to tpm simulator platform interface.");
         result = MU_FAILURE;
@@ -163,6 +189,14 @@ static int power_on_simulator(TPM_COMM_INFO* tpm_comm_info)
     return result;
 }
 
+// The platform channel of a TCP simulator is on the address of the command channel,
+// a unix endpoint only has one when it names its path
+static bool has_platform_channel(const TPM_COMM_INFO* tpm_comm_info)
+{
+    return tpm_comm_info->platform_address != NULL ||
+        strncmp(tpm_comm_info->socket_ip, TPM_SOCKET_UNIX_PREFIX, sizeof(TPM_SOCKET_UNIX_PREFIX) - 1) != 0;
+}
+
 static int execute_simulator_setup(TPM_COMM_INFO* tpm_comm_info)
 {
     int result;
@@ -203,7 +237,7 @@ static int execute_simulator_setup(TPM_COMM_INFO* tpm_comm_info)
         LogError("Failure ack byte from tpm is invalid.");
         result = MU_FAILURE;
     }
-    else if (power_on_simulator(tpm_comm_info) != 0)
+    else if (has_platform_channel(tpm_comm_info) && power_on_simulator(tpm_comm_info) != 0)
     {
         LogError("Failure powering on simulator.");
         result = MU_FAILURE;
@@ -215,6 +249,54 @@ static int execute_simulator_setup(TPM_COMM_INFO* tpm_comm_info)
     return result;
 }
 
+// Splits a unix endpoint, "unix:<command path>[,<platform path>]", into the addresses
+// of the command and platform sockets. The platform socket speaks the platform protocol
+// of the MS simulator, which the control channel of swtpm does not. Without a platform
+// path the simulator has to be powered on already and platform_address stays NULL.
+static int copy_unix_endpoint(TPM_COMM_INFO* tpm_comm_info, const char* endpoint)
+{
+    int result;
+    const char* separator = strchr(endpoint, UNIX_PATH_SEPARATOR);
+    size_t cmd_len = (separator != NULL) ? (size_t)(separator - endpoint) : strlen(endpoint);
+
+    if (separator != NULL && separator[1] == '\0')
+    {
+        LogError("Failure: empty platform socket path in endpoint %s", endpoint);
+        result = MU_FAILURE;
+    }
+    else if ((tpm_comm_info->socket_ip = malloc(cmd_len + 1)) == NULL)
+    {
+        LogError("Failure: allocating command socket address");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        memcpy(tpm_comm_info->socket_ip, endpoint, cmd_len);
+        tpm_comm_info->socket_ip[cmd_len] = '\0';
+        if (separator == NULL)
+        {
+            result = 0;
+        }
+        else
+        {
+            size_t platform_len = sizeof(TPM_SOCKET_UNIX_PREFIX) - 1 + strlen(separator + 1);
+            if ((tpm_comm_info->platform_address = malloc(platform_len + 1)) == NULL)
+            {
+                LogError("Failure: allocating platform socket address");
+                free(tpm_comm_info->socket_ip);
+                tpm_comm_info->socket_ip = NULL;
+                result = MU_FAILURE;
+            }
+            else
+            {
+                (void)snprintf(tpm_comm_info->platform_address, platform_len + 1, "%s%s", TPM_SOCKET_UNIX_PREFIX, separator + 1);
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
 TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
 {
     TPM_COMM_INFO* result;
@@ -226,7 +308,11 @@ TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
     {
         memset(result, 0, sizeof(TPM_COMM_INFO));
         int cpy_res;
-        if (endpoint != NULL)
+        if (endpoint != NULL && strncmp(endpoint, TPM_SOCKET_UNIX_PREFIX, sizeof(TPM_SOCKET_UNIX_PREFIX) - 1) == 0)
+        {
+            cpy_res = copy_unix_endpoint(result, endpoint);
+        }
+        else if (endpoint != NULL)
         {
             cpy_res = mallocAndStrcpy_s(&result->socket_ip, endpoint);
         }
@@ -243,6 +329,7 @@ TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
         else if ((result->socket_conn = tpm_socket_create(result->socket_ip, TPM_SIMULATOR_PORT)) == NULL)
         {
             LogError("Failure: connecting to tpm simulator.");
+            free(result->platform_address);
             free(result->socket_ip);
             free(result);
             result = NULL;
@@ -251,6 +338,7 @@ TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
         {
             LogError("Failure: connecting to tpm simulator.");
             tpm_socket_destroy(result->socket_conn);
+            free(result->platform_address);
             free(result->socket_ip);
             free(result);
             result = NULL;
@@ -265,6 +353,7 @@ void tpm_comm_destroy(TPM_COMM_HANDLE handle)
     {
         close_simulator(handle);
         tpm_socket_destroy(handle->socket_conn);
+        free(handle->platform_address);
         free(handle->socket_ip);
         free(handle);
     }
@@ -284,28 +373,31 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
         LogError("Invalid argument specified handle: %p, cmd_bytes: %p, response: %p, resp_len: %p.", handle, cmd_bytes, response, resp_len);
         result = MU_FAILURE;
     }
+    else if (handle->pending_cmd != NULL)
+    {
+        // The response of the asynchronous command would be read as the response of this one
+        LogError("An asynchronous command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
     else
     {
-        // Send to TPM
+        // Send the framing and the command to the TPM in one message
+        uint32_t send_cmd = htonl(Remote_SendCommand);
         unsigned char locality = 0;
-        if (send_sync_cmd(handle, Remote_SendCommand) != 0)
-        {
-            LogError("Failure preparing sending Remote Command");
-            result = MU_FAILURE;
-        }
-        else if (send_sync_bytes(handle, (const unsigned char*)&locality, 1) != 0)
-        {
-            LogError("Failure setting locality to TPM");
-            result = MU_FAILURE;
-        }
-        else if (send_sync_cmd(handle, bytes_len) != 0)
-        {
-            LogError("Failure writing command bit to tpm");
-            result = MU_FAILURE;
-        }
-        else if (send_sync_bytes(handle, cmd_bytes, bytes_len))
+        uint32_t net_len = htonl(bytes_len);
+        TPM_SOCKET_BUFFER cmd_buffers[4];
+        cmd_buffers[0].bytes = (const unsigned char*)&send_cmd;
+        cmd_buffers[0].length = sizeof(send_cmd);
+        cmd_buffers[1].bytes = &locality;
+        cmd_buffers[1].length = sizeof(locality);
+        cmd_buffers[2].bytes = (const unsigned char*)&net_len;
+        cmd_buffers[2].length = sizeof(net_len);
+        cmd_buffers[3].bytes = cmd_bytes;
+        cmd_buffers[3].length = bytes_len;
+
+        if (tpm_socket_send_vector(handle->socket_conn, cmd_buffers, sizeof(cmd_buffers) / sizeof(cmd_buffers[0])) != 0)
         {
-            LogError("Failure writing data to tpm");
+            LogError("Failure writing command to tpm");
             result = MU_FAILURE;
         }
         else
@@ -349,3 +441,74 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
     }
     return result;
 }
+
+int tpm_comm_submit_command_async(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len)
+{
+    int result;
+    if (handle == NULL || cmd_bytes == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, cmd_bytes: %p.", handle, cmd_bytes);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd != NULL)
+    {
+        LogError("Another command is already pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        // The simulator socket cannot be polled, so the command is executed synchronously
+        // when its response is requested.
+        handle->pending_cmd = cmd_bytes;
+        handle->pending_cmd_len = bytes_len;
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_comm_complete_command(TPM_COMM_HANDLE handle, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL || response == NULL || resp_len == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, response: %p, resp_len: %p.", handle, response, resp_len);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd == NULL)
+    {
+        LogError("No command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        const unsigned char* cmd_bytes = handle->pending_cmd;
+        handle->pending_cmd = NULL;
+        result = tpm_comm_submit_command(handle, cmd_bytes, handle->pending_cmd_len, response, resp_len);
+    }
+    return result;
+}
+
+int tpm_comm_get_poll_fd(TPM_COMM_HANDLE handle)
+{
+    (void)handle;
+    return -1;
+}
+
+#ifdef USE_TPM_COMM_RUNTIME
+static const TPM_COMM_OPS tpm_comm_emulator_ops =
+{
+    "emulator",
+    tpm_comm_create,
+    tpm_comm_destroy,
+    tpm_comm_get_type,
+    tpm_comm_submit_command,
+    tpm_comm_submit_command_async,
+    tpm_comm_complete_command,
+    tpm_comm_get_poll_fd
+};
+
+const TPM_COMM_OPS* tpm_comm_emulator_get_ops(void)
+{
+    return &tpm_comm_emulator_ops;
+}
+#endif // USE_TPM_COMM_RUNTIME
@@ -16,6 +16,7 @@
 #else // WIN32
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
 #endif // WIN32
 
 #include "umock_c/umock_c_prod.h"
@@ -26,6 +27,17 @@
 #include "azure_utpm_c/tpm_comm.h"
 #include "azure_utpm_c/tpm_socket_comm.h"
 
+#ifdef USE_TPM_COMM_RUNTIME
+// The functions of the backend are reached through tpm_comm_linux_get_ops()
+#define tpm_comm_create                  tpm_comm_linux_create
+#define tpm_comm_destroy                 tpm_comm_linux_destroy
+#define tpm_comm_get_type                tpm_comm_linux_get_type
+#define tpm_comm_submit_command          tpm_comm_linux_submit_command
+#define tpm_comm_submit_command_async    tpm_comm_linux_submit_command_async
+#define tpm_comm_complete_command        tpm_comm_linux_complete_command
+#define tpm_comm_get_poll_fd             tpm_comm_linux_get_poll_fd
+#endif // USE_TPM_COMM_RUNTIME
+
 static const char* const TPM_DEVICE_NAME = "/dev/tpm0";
 static const char* const TPM_RM_DEVICE_NAME = "/dev/tpmrm0";
 
@@ -39,8 +51,25 @@ static const char* const TPM_NEW_USERMODE_RESOURCE_MGR_32 = "/usr/lib/i386-linux
 static const char* const TPM_NEW_USERMODE_RESOURCE_MGR_ARM = "/usr/lib/arm-linux-gnueabihf/libtcti-socket.so.0";
 
 #define MIN_TPM_RESPONSE_LENGTH     10
+#define TPM_RESPONSE_TIMEOUT_MS     (5 * 60 * 1000)
 
 #define TPM_UM_RM_PORT              2323
+#define TPM_SIMULATOR_PORT          2321
+
+// Schemes of the endpoint URIs, that select a single backend instead of probing them all:
+//  device:<path>               TPM device, e.g. device:/dev/tpmrm0
+//  tcti:<name>[:<config>]      TCTI library libtss2-tcti-<name>.so initialized with
+//                              <config>, e.g. tcti:tabrmd or tcti:device:/dev/tpm0
+//  mssim:<address>[:<port>]    powered on TPM simulator, e.g. mssim:127.0.0.1:2321
+//  unix:<path>                 TPM simulator on a unix domain socket
+#define ENDPOINT_DEVICE_SCHEME      "device:"
+#define ENDPOINT_TCTI_SCHEME        "tcti:"
+#define ENDPOINT_MSSIM_SCHEME       "mssim:"
+#define ENDPOINT_SCHEME_LEN(scheme) (sizeof(scheme) - 1)
+
+#define TCTI_LIBRARY_FORMAT         "libtss2-tcti-%s.so"
+#define MAX_TCTI_LIBRARY_LEN        128
+#define MAX_MSSIM_ADDRESS_LEN       64
 
 #define REMOTE_SEND_COMMAND         8
 #define REMOTE_SESSION_END_CMD      20
@@ -59,8 +88,19 @@ typedef enum
 
 typedef struct TPM_COMM_INFO_TAG
 {
+    TPM_COMM_OPS_MEMBER
     uint32_t        timeout_value;
     TPM_CONN_INFO   conn_info;
+
+    // The TPM device was switched to O_NONBLOCK by the first asynchronous command
+    bool            non_blocking;
+    // An asynchronous command was submitted, and its response has not been collected yet
+    bool            cmd_pending;
+    // Command of the outstanding asynchronous submission on transports that
+    // cannot be polled. It is executed synchronously by tpm_comm_complete_command().
+    const unsigned char* pending_cmd;
+    uint32_t        pending_cmd_len;
+
     union
     {
         int                 tpm_device;
@@ -117,10 +157,55 @@ static int write_data_to_tpm(TPM_COMM_INFO* tpm_info, const unsigned char* tpm_b
     return result;
 }
 
+static int set_non_blocking_mode(TPM_COMM_INFO* tpm_info)
+{
+    int result;
+    int flags = fcntl(tpm_info->dev_info.tpm_device, F_GETFL, 0);
+    if (flags < 0 || fcntl(tpm_info->dev_info.tpm_device, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        LogError("Failure switching tpm to non blocking mode: %d:%s.", errno, strerror(errno));
+        result = MU_FAILURE;
+    }
+    else
+    {
+        tpm_info->non_blocking = true;
+        result = 0;
+    }
+    return result;
+}
+
+static int wait_for_tpm_response(TPM_COMM_INFO* tpm_info)
+{
+    int result;
+    struct pollfd poll_info;
+    poll_info.fd = tpm_info->dev_info.tpm_device;
+    poll_info.events = POLLIN;
+    poll_info.revents = 0;
+    if (poll(&poll_info, 1, TPM_RESPONSE_TIMEOUT_MS) <= 0)
+    {
+        LogError("Failure waiting for tpm response: %d:%s.", errno, strerror(errno));
+        result = MU_FAILURE;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
 static int read_data_from_tpm(TPM_COMM_INFO* tpm_info, unsigned char* tpm_bytes, uint32_t* bytes_len)
 {
     int result;
-    int len_read = read(tpm_info->dev_info.tpm_device, tpm_bytes, *bytes_len);
+    int len_read;
+    // In the non blocking mode the response may not be ready yet
+    if (tpm_info->non_blocking && wait_for_tpm_response(tpm_info) != 0)
+    {
+        len_read = -1;
+    }
+    else
+    {
+        len_read = read(tpm_info->dev_info.tpm_device, tpm_bytes, *bytes_len);
+    }
     if (len_read < MIN_TPM_RESPONSE_LENGTH)
     {
         LogError("Failure reading data from tpm: len: %d - %d:%s.", len_read, errno, strerror(errno));
@@ -183,56 +268,45 @@ void write_tcti_info(const TCTI_PROV_INFO *tcti_info)
     printf("TCTI config help: %s\n", tcti_info->help);
 }
 
-static void* load_abrmd(void** dylib)
+// Initializes a context of the TCTI library 'dylib' with the configuration 'cfg'
+static void* init_tcti(void** dylib, const char* tcti_name, const char* cfg)
 {
     void* tcti_ctx = NULL;
     const TCTI_PROV_INFO *tcti_info;
-    const char* abrmd_name = TPM_TABRMD_USERMODE_RESOURCE_MGR;
     size_t size = 0;
     TCTI_RC rc = 0;
 
-    *dylib = dlopen (abrmd_name, RTLD_LAZY);
-    if (!*dylib)
-    {
-        abrmd_name = TPM_ABRMD_USERMODE_RESOURCE_MGR;
-        *dylib = dlopen (abrmd_name, RTLD_LAZY);
-        if (!*dylib)
-        {
-            return NULL;
-        }
-    }
-
     get_tcti_info_fn get_tcti_info = (get_tcti_info_fn)dlsym(*dylib, "Tss2_Tcti_Info");
     if (!get_tcti_info)
     {
-        LogError("No Tss2_Tcti_Info() entry point found in %s\n", abrmd_name);
+        LogError("No Tss2_Tcti_Info() entry point found in %s\n", tcti_name);
         goto err;
     }
 
     tcti_info = get_tcti_info();
 
-    rc = tcti_info->init(NULL, &size, NULL);
+    rc = tcti_info->init(NULL, &size, cfg);
     if (rc != RC_SUCCESS) {
-        LogError("tcti_init(NULL, ...) in %s failed", abrmd_name);
+        LogError("tcti_init(NULL, ...) in %s failed", tcti_name);
         goto err;
     }
     if (size < sizeof(TCTI_CTX)) {
-        LogError("TCTI context size reported by tcti_init() in %s is too small: %lu < %lu", abrmd_name, (long unsigned int)size, (long unsigned int)sizeof(TCTI_CTX));
+        LogError("TCTI context size reported by tcti_init() in %s is too small: %lu < %lu", tcti_name, (long unsigned int)size, (long unsigned int)sizeof(TCTI_CTX));
         goto err;
     }
 
     tcti_ctx = (TCTI_HANDLE*)malloc(size);
     if (!tcti_ctx)
     {
-        LogError("load_abrmd(): malloc failed\n");
+        LogError("init_tcti(): malloc failed\n");
         goto err;
     }
 
-    rc = tcti_info->init(tcti_ctx, &size, NULL);
+    rc = tcti_info->init(tcti_ctx, &size, cfg);
     if (rc != RC_SUCCESS)
     {
         free(tcti_ctx);
-        LogError("Tss2_Tcti_Info(ctx, ...) in %s failed", abrmd_name);
+        LogError("Tss2_Tcti_Info(ctx, ...) in %s failed", tcti_name);
         goto err;
     }
 
@@ -244,6 +318,23 @@ err:
     return NULL;
 }
 
+static void* load_abrmd(void** dylib)
+{
+    const char* abrmd_name = TPM_TABRMD_USERMODE_RESOURCE_MGR;
+
+    *dylib = dlopen (abrmd_name, RTLD_LAZY);
+    if (!*dylib)
+    {
+        abrmd_name = TPM_ABRMD_USERMODE_RESOURCE_MGR;
+        *dylib = dlopen (abrmd_name, RTLD_LAZY);
+        if (!*dylib)
+        {
+            return NULL;
+        }
+    }
+    return init_tcti(dylib, abrmd_name, NULL);
+}
+
 static int tpm_usermode_resmgr_connect(TPM_COMM_INFO* handle)
 {
     bool result;
@@ -282,36 +373,173 @@ static int tpm_usermode_resmgr_connect(TPM_COMM_INFO* handle)
     return result;
 }
 
-static int send_old_um_trm_data(TPM_COMM_HANDLE handle)
+// Opens the first available of the kernel mode TPM resource manager, the raw TPM
+// device and the user mode TPM resource managers
+static int probe_tpm_connection(TPM_COMM_INFO* handle)
 {
     int result;
-    unsigned char debugMsgLevel = 0, commandSent = 1;
-    if ((handle->conn_info & TCI_OLD_UM_TRM) == 0)
+    // First check if kernel mode TPM Resource Manager is available
+    if ((handle->dev_info.tpm_device = open(TPM_RM_DEVICE_NAME, O_RDWR)) >= 0)
     {
-        // This is not an old TRM. No additional data are expected.
+        handle->conn_info = TCI_SYS_DEV | TCI_TRM;
         result = 0;
     }
-    else if (send_sync_bytes(handle, (const unsigned char*)&debugMsgLevel, 1) != 0)
+    // If not, connect to the raw TPM device
+    else if ((handle->dev_info.tpm_device = open(TPM_DEVICE_NAME, O_RDWR)) >= 0)
     {
-        LogError("Failure setting debugMsgLevel to TRM");
-        result = MU_FAILURE;
+        handle->conn_info = TCI_SYS_DEV;
+        result = 0;
     }
-    else if (send_sync_bytes(handle, (const unsigned char*)&commandSent, 1) != 0)
+    // If the system TPM device is unavalable, try connecting to the user mode TPM resource manager
+    else
     {
-        LogError("Failure setting commandSent status to TRM");
+        result = tpm_usermode_resmgr_connect(handle);
+    }
+    return result;
+}
+
+static int connect_device_endpoint(TPM_COMM_INFO* handle, const char* path)
+{
+    int result;
+    if ((handle->dev_info.tpm_device = open(path, O_RDWR)) < 0)
+    {
+        LogError("Failure: opening TPM device %s: %d:%s.", path, errno, strerror(errno));
         result = MU_FAILURE;
     }
     else
     {
+        // The kernel resource manager devices are /dev/tpmrm<n>
+        handle->conn_info = (strstr(path, "tpmrm") != NULL) ? (TCI_SYS_DEV | TCI_TRM) : TCI_SYS_DEV;
         result = 0;
     }
     return result;
 }
 
+static int connect_tcti_endpoint(TPM_COMM_INFO* handle, const char* tcti_spec)
+{
+    int result;
+    char library[MAX_TCTI_LIBRARY_LEN];
+    char name[MAX_TCTI_LIBRARY_LEN];
+    const char* cfg = strchr(tcti_spec, ':');
+    size_t name_len = (cfg != NULL) ? (size_t)(cfg - tcti_spec) : strlen(tcti_spec);
+
+    if (name_len == 0 || name_len >= sizeof(name))
+    {
+        LogError("Failure: invalid TCTI name in endpoint %s%s", ENDPOINT_TCTI_SCHEME, tcti_spec);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        memcpy(name, tcti_spec, name_len);
+        name[name_len] = '\0';
+        int lib_len = snprintf(library, sizeof(library), TCTI_LIBRARY_FORMAT, name);
+        if (lib_len < 0 || (size_t)lib_len >= sizeof(library))
+        {
+            LogError("Failure: TCTI library name too long for %s", name);
+            result = MU_FAILURE;
+        }
+        else if ((handle->dev_info.tcti.dylib = dlopen(library, RTLD_LAZY)) == NULL)
+        {
+            LogError("Failure: loading TCTI library %s", library);
+            result = MU_FAILURE;
+        }
+        else if ((handle->dev_info.tcti.ctx_handle = init_tcti(&handle->dev_info.tcti.dylib, library, (cfg != NULL) ? cfg + 1 : NULL)) == NULL)
+        {
+            LogError("Failure: initializing TCTI library %s", library);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            handle->conn_info = TCI_TCTI | TCI_TRM;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static int connect_mssim_endpoint(TPM_COMM_INFO* handle, const char* mssim_spec)
+{
+    int result;
+    char address[MAX_MSSIM_ADDRESS_LEN];
+    const char* port_spec = strchr(mssim_spec, ':');
+    size_t address_len = (port_spec != NULL) ? (size_t)(port_spec - mssim_spec) : strlen(mssim_spec);
+    unsigned long port = TPM_SIMULATOR_PORT;
+    char* port_end = NULL;
+
+    if (port_spec != NULL)
+    {
+        errno = 0;
+        port = strtoul(port_spec + 1, &port_end, 10);
+    }
+
+    if (address_len == 0 || address_len >= sizeof(address))
+    {
+        LogError("Failure: invalid simulator address in endpoint %s%s", ENDPOINT_MSSIM_SCHEME, mssim_spec);
+        result = MU_FAILURE;
+    }
+    else if (port_spec != NULL && (port_end == port_spec + 1 || *port_end != '\0' || errno != 0 || port == 0 || port > 0xFFFF))
+    {
+        LogError("Failure: invalid simulator port in endpoint %s%s", ENDPOINT_MSSIM_SCHEME, mssim_spec);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        memcpy(address, mssim_spec, address_len);
+        address[address_len] = '\0';
+        if ((handle->dev_info.socket_conn = tpm_socket_create(address, (unsigned short)port)) == NULL)
+        {
+            LogError("Failure: connecting to TPM simulator %s:%lu.", address, port);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            handle->conn_info = TCI_SOCKET;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+// Opens only the backend selected by the scheme of the endpoint URI
+static int connect_endpoint(TPM_COMM_INFO* handle, const char* endpoint)
+{
+    int result;
+    if (strncmp(endpoint, ENDPOINT_DEVICE_SCHEME, ENDPOINT_SCHEME_LEN(ENDPOINT_DEVICE_SCHEME)) == 0)
+    {
+        result = connect_device_endpoint(handle, endpoint + ENDPOINT_SCHEME_LEN(ENDPOINT_DEVICE_SCHEME));
+    }
+    else if (strncmp(endpoint, ENDPOINT_TCTI_SCHEME, ENDPOINT_SCHEME_LEN(ENDPOINT_TCTI_SCHEME)) == 0)
+    {
+        result = connect_tcti_endpoint(handle, endpoint + ENDPOINT_SCHEME_LEN(ENDPOINT_TCTI_SCHEME));
+    }
+    else if (strncmp(endpoint, ENDPOINT_MSSIM_SCHEME, ENDPOINT_SCHEME_LEN(ENDPOINT_MSSIM_SCHEME)) == 0)
+    {
+        result = connect_mssim_endpoint(handle, endpoint + ENDPOINT_SCHEME_LEN(ENDPOINT_MSSIM_SCHEME));
+    }
+    else if (strncmp(endpoint, TPM_SOCKET_UNIX_PREFIX, ENDPOINT_SCHEME_LEN(TPM_SOCKET_UNIX_PREFIX)) == 0)
+    {
+        if ((handle->dev_info.socket_conn = tpm_socket_create(endpoint, 0)) == NULL)
+        {
+            LogError("Failure: connecting to TPM simulator %s.", endpoint);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            handle->conn_info = TCI_SOCKET;
+            result = 0;
+        }
+    }
+    else
+    {
+        LogError("Failure: unsupported TPM endpoint %s", endpoint);
+        result = MU_FAILURE;
+    }
+    return result;
+}
+
 TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
 {
     TPM_COMM_INFO* result;
-    (void)endpoint;
     if ((result = malloc(sizeof(TPM_COMM_INFO))) == NULL)
     {
         LogError("Failure: malloc tpm communication info.");
@@ -319,20 +547,19 @@ TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
     else
     {
         memset(result, 0, sizeof(TPM_COMM_INFO));
-        // First check if kernel mode TPM Resource Manager is available
-        if ((result->dev_info.tpm_device = open(TPM_RM_DEVICE_NAME, O_RDWR)) >= 0)
+        // Without an endpoint, use the first backend available
+        if (endpoint == NULL || *endpoint == '\0')
         {
-            result->conn_info = TCI_SYS_DEV | TCI_TRM;
-        }
-        // If not, connect to the raw TPM device
-        else if ((result->dev_info.tpm_device = open(TPM_DEVICE_NAME, O_RDWR)) >= 0)
-        {
-            result->conn_info = TCI_SYS_DEV;
+            if (probe_tpm_connection(result) != 0)
+            {
+                LogError("Failure: connecting to the TPM device");
+                free(result);
+                result = NULL;
+            }
         }
-        // If the system TPM device is unavalable, try connecting to the user mode TPM resource manager
-        else if (tpm_usermode_resmgr_connect(result) != 0)
+        else if (connect_endpoint(result, endpoint) != 0)
         {
-            LogError("Failure: connecting to the TPM device");
+            LogError("Failure: connecting to the TPM endpoint %s", endpoint);
             free(result);
             result = NULL;
         }
@@ -377,6 +604,12 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
         LogError("Invalid argument specified handle: %p, cmd_bytes: %p, response: %p, resp_len: %p.", handle, cmd_bytes, response, resp_len);
         result = MU_FAILURE;
     }
+    else if (handle->cmd_pending)
+    {
+        // The response of the asynchronous command would be read as the response of this one
+        LogError("An asynchronous command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
     else if (*resp_len < 10)
     {
         LogError("Response buffer must be at least 10 bytes long %d", *resp_len);
@@ -435,30 +668,31 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
     }
     else if (handle->conn_info & TCI_SOCKET)
     {
+        // Send the framing and the command to the TPM in one message
+        uint32_t send_cmd = htonl(REMOTE_SEND_COMMAND);
         unsigned char locality = 0;
-        if (send_sync_cmd(handle, REMOTE_SEND_COMMAND) != 0)
+        // An old user mode TRM expects its debugMsgLevel and commandSent bytes after the locality
+        unsigned char old_trm_data[2] = { 0, 1 };
+        uint32_t net_len = htonl(bytes_len);
+        TPM_SOCKET_BUFFER cmd_buffers[5];
+        size_t buffer_count = 0;
+        cmd_buffers[buffer_count].bytes = (const unsigned char*)&send_cmd;
+        cmd_buffers[buffer_count++].length = sizeof(send_cmd);
+        cmd_buffers[buffer_count].bytes = &locality;
+        cmd_buffers[buffer_count++].length = sizeof(locality);
+        if (handle->conn_info & TCI_OLD_UM_TRM)
         {
-            LogError("Failure preparing sending Remote Command");
-            result = MU_FAILURE;
-        }
-        else if (send_sync_bytes(handle, (const unsigned char*)&locality, 1) != 0)
-        {
-            LogError("Failure setting locality to TPM");
-            result = MU_FAILURE;
-        }
-        else if (send_old_um_trm_data(handle) != 0)
-        {
-            LogError("Failure communicating with old user mode TPM");
-            result = MU_FAILURE;
-        }
-        else if (send_sync_cmd(handle, bytes_len) != 0)
-        {
-            LogError("Failure writing command bit to tpm");
-            result = MU_FAILURE;
+            cmd_buffers[buffer_count].bytes = old_trm_data;
+            cmd_buffers[buffer_count++].length = sizeof(old_trm_data);
         }
-        else if (send_sync_bytes(handle, cmd_bytes, bytes_len))
+        cmd_buffers[buffer_count].bytes = (const unsigned char*)&net_len;
+        cmd_buffers[buffer_count++].length = sizeof(net_len);
+        cmd_buffers[buffer_count].bytes = cmd_bytes;
+        cmd_buffers[buffer_count++].length = bytes_len;
+
+        if (tpm_socket_send_vector(handle->dev_info.socket_conn, cmd_buffers, buffer_count) != 0)
         {
-            LogError("Failure writing data to tpm");
+            LogError("Failure writing command to tpm");
             result = MU_FAILURE;
         }
         else
@@ -506,3 +740,125 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
     }
     return result;
 }
+
+int tpm_comm_submit_command_async(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len)
+{
+    int result;
+    if (handle == NULL || cmd_bytes == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, cmd_bytes: %p.", handle, cmd_bytes);
+        result = MU_FAILURE;
+    }
+    else if (handle->cmd_pending)
+    {
+        LogError("Another command is already pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else if (handle->conn_info & TCI_SYS_DEV)
+    {
+        // The kernel returns from write() right away in the non blocking mode, and the
+        // response is collected with read() once the device becomes readable.
+        if (!handle->non_blocking && set_non_blocking_mode(handle) != 0)
+        {
+            LogError("Failure preparing tpm for asynchronous commands");
+            result = MU_FAILURE;
+        }
+        else if (write_data_to_tpm(handle, cmd_bytes, bytes_len) != 0)
+        {
+            LogError("Failure writing command to tpm");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            handle->cmd_pending = true;
+            result = 0;
+        }
+    }
+    else
+    {
+        // The other transports have no pollable completion, so the command is
+        // executed synchronously when its response is requested.
+        handle->pending_cmd = cmd_bytes;
+        handle->pending_cmd_len = bytes_len;
+        handle->cmd_pending = true;
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_comm_complete_command(TPM_COMM_HANDLE handle, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL || response == NULL || resp_len == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, response: %p, resp_len: %p.", handle, response, resp_len);
+        result = MU_FAILURE;
+    }
+    else if (!handle->cmd_pending)
+    {
+        LogError("No command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else if (handle->conn_info & TCI_SYS_DEV)
+    {
+        int len_read = read(handle->dev_info.tpm_device, response, *resp_len);
+        if (len_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            result = TPM_COMM_PENDING;
+        }
+        else
+        {
+            handle->cmd_pending = false;
+            if (len_read < MIN_TPM_RESPONSE_LENGTH)
+            {
+                LogError("Failure reading data from tpm: len: %d - %d:%s.", len_read, errno, strerror(errno));
+                result = MU_FAILURE;
+            }
+            else
+            {
+                *resp_len = len_read;
+                result = 0;
+            }
+        }
+    }
+    else
+    {
+        handle->cmd_pending = false;
+        result = tpm_comm_submit_command(handle, handle->pending_cmd, handle->pending_cmd_len, response, resp_len);
+        handle->pending_cmd = NULL;
+    }
+    return result;
+}
+
+int tpm_comm_get_poll_fd(TPM_COMM_HANDLE handle)
+{
+    int result;
+    if (handle != NULL && (handle->conn_info & TCI_SYS_DEV))
+    {
+        result = handle->dev_info.tpm_device;
+    }
+    else
+    {
+        result = -1;
+    }
+    return result;
+}
+
+#ifdef USE_TPM_COMM_RUNTIME
+static const TPM_COMM_OPS tpm_comm_linux_ops =
+{
+    "linux",
+    tpm_comm_create,
+    tpm_comm_destroy,
+    tpm_comm_get_type,
+    tpm_comm_submit_command,
+    tpm_comm_submit_command_async,
+    tpm_comm_complete_command,
+    tpm_comm_get_poll_fd
+};
+
+const TPM_COMM_OPS* tpm_comm_linux_get_ops(void)
+{
+    return &tpm_comm_linux_ops;
+}
+#endif // USE_TPM_COMM_RUNTIME
@@ -0,0 +1,767 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "umock_c/umock_c_prod.h"
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "azure_utpm_c/tpm_comm.h"
+#include "azure_utpm_c/tpm_comm_loopback.h"
+#include "azure_utpm_c/Tpm.h"
+#include "azure_utpm_c/Marshal_fp.h"
+
+#ifdef USE_TPM_COMM_RUNTIME
+// The functions of the backend are reached through tpm_comm_loopback_get_ops()
+#define tpm_comm_create                  tpm_comm_loopback_create
+#define tpm_comm_destroy                 tpm_comm_loopback_destroy
+#define tpm_comm_get_type                tpm_comm_loopback_get_type
+#define tpm_comm_submit_command          tpm_comm_loopback_submit_command
+#define tpm_comm_submit_command_async    tpm_comm_loopback_submit_command_async
+#define tpm_comm_complete_command        tpm_comm_loopback_complete_command
+#define tpm_comm_get_poll_fd             tpm_comm_loopback_get_poll_fd
+#endif // USE_TPM_COMM_RUNTIME
+
+#ifdef WIN32
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <time.h>
+#endif
+
+#define LOOPBACK_TRANSIENT_HANDLE       (HR_TRANSIENT | 0x00000001)
+#define LOOPBACK_SEQUENCE_HANDLE        (HR_TRANSIENT | 0x00000002)
+#define LOOPBACK_INPUT_BUFFER_SIZE      1024
+#define LOOPBACK_DIGEST_SIZE            32
+#define LOOPBACK_MAX_SESSIONS           3
+
+typedef struct TPM_COMM_INFO_TAG
+{
+    TPM_COMM_OPS_MEMBER
+    TPM_LOOPBACK_RESPONDER responder;
+    void* responder_context;
+    uint32_t latency_us;
+
+    // State of the canned responses
+    bool key_present;
+    TPM2B_PUBLIC key_public;
+
+    uint32_t command_count;
+    uint64_t byte_count;
+
+    // Command of the outstanding asynchronous submission
+    const unsigned char* pending_cmd;
+    uint32_t pending_cmd_len;
+} TPM_COMM_INFO;
+
+static void init_key_public(TPM2B_PUBLIC* keyPublic)
+{
+    TPMT_PUBLIC* pub = &keyPublic->publicArea;
+
+    memset(keyPublic, 0, sizeof(*keyPublic));
+    pub->nameAlg = TPM_ALG_SHA256;
+    pub->objectAttributes.fixedTPM = SET;
+    pub->objectAttributes.fixedParent = SET;
+    pub->objectAttributes.sensitiveDataOrigin = SET;
+    pub->objectAttributes.userWithAuth = SET;
+    pub->objectAttributes.restricted = SET;
+    pub->objectAttributes.decrypt = SET;
+#if ALG_RSA
+    pub->type = TPM_ALG_RSA;
+    pub->parameters.rsaDetail.symmetric.algorithm = TPM_ALG_AES;
+    pub->parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    pub->parameters.rsaDetail.symmetric.mode.aes = TPM_ALG_CFB;
+    pub->parameters.rsaDetail.scheme.scheme = TPM_ALG_NULL;
+    pub->parameters.rsaDetail.keyBits = 2048;
+    pub->unique.rsa.t.size = 256;
+    memset(pub->unique.rsa.t.buffer, 0xC3, 256);
+#elif ALG_ECC
+    pub->type = TPM_ALG_ECC;
+    pub->parameters.eccDetail.symmetric.algorithm = TPM_ALG_AES;
+    pub->parameters.eccDetail.symmetric.keyBits.aes = 128;
+    pub->parameters.eccDetail.symmetric.mode.aes = TPM_ALG_CFB;
+    pub->parameters.eccDetail.scheme.scheme = TPM_ALG_NULL;
+    pub->parameters.eccDetail.curveID = TPM_ECC_NIST_P256;
+    pub->parameters.eccDetail.kdf.scheme = TPM_ALG_NULL;
+    pub->unique.ecc.x.t.size = 32;
+    memset(pub->unique.ecc.x.t.buffer, 0xC3, 32);
+    pub->unique.ecc.y.t.size = 32;
+    memset(pub->unique.ecc.y.t.buffer, 0x3C, 32);
+#else
+    pub->type = TPM_ALG_KEYEDHASH;
+    pub->objectAttributes.restricted = CLEAR;
+    pub->objectAttributes.decrypt = CLEAR;
+    pub->objectAttributes.sign = SET;
+    pub->parameters.keyedHashDetail.scheme.scheme = TPM_ALG_HMAC;
+    pub->parameters.keyedHashDetail.scheme.details.hmac.hashAlg = TPM_ALG_SHA256;
+    pub->unique.keyedHash.t.size = LOOPBACK_DIGEST_SIZE;
+    memset(pub->unique.keyedHash.t.buffer, 0xC3, LOOPBACK_DIGEST_SIZE);
+#endif
+}
+
+static void inject_latency(uint32_t latency_us)
+{
+#ifdef WIN32
+    Sleep((latency_us + 999) / 1000);
+#else
+    struct timespec delay;
+    delay.tv_sec = latency_us / 1000000;
+    delay.tv_nsec = (long)(latency_us % 1000000) * 1000;
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR)
+    {
+    }
+#endif
+}
+
+static UINT32 get_property_value(TPM_PT property)
+{
+    UINT32 result;
+    switch (property)
+    {
+        case TPM_PT_INPUT_BUFFER:
+            result = LOOPBACK_INPUT_BUFFER_SIZE;
+            break;
+        case TPM_PT_MAX_COMMAND_SIZE:
+        case TPM_PT_MAX_RESPONSE_SIZE:
+            result = MAX_COMMAND_SIZE;
+            break;
+        default:
+            result = property;
+            break;
+    }
+    return result;
+}
+
+static void marshal_digest(BYTE** buffer, INT32* size, UINT16 digestSize, BYTE fill)
+{
+    TPM2B_DIGEST digest;
+    digest.t.size = digestSize;
+    memset(digest.t.buffer, fill, digest.t.size);
+    (void)TPM2B_DIGEST_Marshal(&digest, buffer, size);
+}
+
+static void marshal_name(BYTE** buffer, INT32* size)
+{
+    TPM2B_NAME name;
+    name.t.size = sizeof(TPM_ALG_ID) + LOOPBACK_DIGEST_SIZE;
+    name.t.name[0] = (BYTE)(TPM_ALG_SHA256 >> 8);
+    name.t.name[1] = (BYTE)TPM_ALG_SHA256;
+    memset(&name.t.name[sizeof(TPM_ALG_ID)], 0x4E, LOOPBACK_DIGEST_SIZE);
+    (void)TPM2B_NAME_Marshal(&name, buffer, size);
+}
+
+static TPM_RC marshal_capability(BYTE* cmdParams, INT32 cmdParamsSize, BYTE** buffer, INT32* size)
+{
+    TPM_RC result;
+    TPM_CAP capability;
+    UINT32 property;
+    UINT32 propertyCount;
+
+    if (TPM_CAP_Unmarshal(&capability, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS ||
+        UINT32_Unmarshal(&property, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS ||
+        UINT32_Unmarshal(&propertyCount, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS ||
+        capability != TPM_CAP_TPM_PROPERTIES)
+    {
+        result = TPM_RC_VALUE + TPM_RC_P + TPM_RC_1;
+    }
+    else
+    {
+        TPMI_YES_NO moreData;
+        TPMS_CAPABILITY_DATA capData;
+        UINT32 index = 0;
+
+        // Report the fixed (PT_FIXED+0..46) and variable (PT_VAR+0..20) properties
+        // in ascending order, as a TPM would
+        if (propertyCount > MAX_TPM_PROPERTIES)
+        {
+            propertyCount = MAX_TPM_PROPERTIES;
+        }
+        if (property < PT_FIXED)
+        {
+            property = PT_FIXED;
+        }
+        else if (property > TPM_PT_MAX_CAP_BUFFER && property < PT_VAR)
+        {
+            property = PT_VAR;
+        }
+
+        capData.capability = TPM_CAP_TPM_PROPERTIES;
+        for (; index < propertyCount && property <= TPM_PT_AUDIT_COUNTER_1; index++)
+        {
+            capData.data.tpmProperties.tpmProperty[index].property = property;
+            capData.data.tpmProperties.tpmProperty[index].value = get_property_value(property);
+            property = (property == TPM_PT_MAX_CAP_BUFFER) ? PT_VAR : property + 1;
+        }
+        capData.data.tpmProperties.count = index;
+        moreData = (property <= TPM_PT_AUDIT_COUNTER_1) ? YES : NO;
+
+        (void)TPMI_YES_NO_Marshal(&moreData, buffer, size);
+        (void)TPMS_CAPABILITY_DATA_Marshal(&capData, buffer, size);
+        result = TPM_RC_SUCCESS;
+    }
+    return result;
+}
+
+static TPM_RC marshal_signature(BYTE* cmdParams, INT32 cmdParamsSize, BYTE** buffer, INT32* size)
+{
+    TPM_RC result;
+    TPM2B_DIGEST digest;
+    TPMT_SIG_SCHEME inScheme;
+
+    if (TPM2B_DIGEST_Unmarshal(&digest, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS ||
+        TPMT_SIG_SCHEME_Unmarshal(&inScheme, &cmdParams, &cmdParamsSize, TRUE) != TPM_RC_SUCCESS)
+    {
+        result = TPM_RC_SCHEME + TPM_RC_P + TPM_RC_2;
+    }
+    else
+    {
+        TPMT_SIGNATURE signature;
+
+        // The signature follows the requested scheme, the key of a NULL scheme is
+        // taken to be an HMAC key
+        memset(&signature, 0, sizeof(signature));
+        signature.sigAlg = inScheme.scheme;
+        switch (inScheme.scheme)
+        {
+#if ALG_RSA
+            case TPM_ALG_RSASSA:
+            case TPM_ALG_RSAPSS:
+                signature.signature.rsassa.hash = inScheme.details.any.hashAlg;
+                signature.signature.rsassa.sig.t.size = 256;
+                memset(signature.signature.rsassa.sig.t.buffer, 0x5A, 256);
+                break;
+#endif // ALG_RSA
+#if ALG_ECC
+            case TPM_ALG_ECDSA:
+                signature.signature.ecdsa.hash = inScheme.details.any.hashAlg;
+                signature.signature.ecdsa.signatureR.t.size = 32;
+                memset(signature.signature.ecdsa.signatureR.t.buffer, 0x5A, 32);
+                signature.signature.ecdsa.signatureS.t.size = 32;
+                memset(signature.signature.ecdsa.signatureS.t.buffer, 0xA5, 32);
+                break;
+#endif // ALG_ECC
+            default:
+                signature.sigAlg = TPM_ALG_HMAC;
+                signature.signature.hmac.hashAlg = TPM_ALG_SHA256;
+                memset(signature.signature.hmac.digest.sha256, 0x5A, SHA256_DIGEST_SIZE);
+                break;
+        }
+        (void)TPMT_SIGNATURE_Marshal(&signature, buffer, size);
+        result = TPM_RC_SUCCESS;
+    }
+    return result;
+}
+
+// Marshals the canned response parameters of 'cmdCode', sets the handle returned by
+// the command (if any), and returns the response code
+static TPM_RC marshal_response_params(TPM_COMM_INFO* comm_info, TPM_CC cmdCode, BYTE* cmdParams, INT32 cmdParamsSize, TPM_HANDLE* retHandle, BYTE** buffer, INT32* size)
+{
+    TPM_RC result = TPM_RC_SUCCESS;
+    switch (cmdCode)
+    {
+        case TPM_CC_GetCapability:
+            result = marshal_capability(cmdParams, cmdParamsSize, buffer, size);
+            break;
+        case TPM_CC_HMAC:
+            marshal_digest(buffer, size, LOOPBACK_DIGEST_SIZE, 0x5A);
+            break;
+        case TPM_CC_HMAC_Start:
+        case TPM_CC_HashSequenceStart:
+            *retHandle = LOOPBACK_SEQUENCE_HANDLE;
+            break;
+        case TPM_CC_SequenceComplete:
+        case TPM_CC_Hash:
+        {
+            TPMT_TK_HASHCHECK validation = { TPM_ST_HASHCHECK, TPM_RH_NULL, { { 0 } } };
+            marshal_digest(buffer, size, LOOPBACK_DIGEST_SIZE, 0x5A);
+            (void)TPMT_TK_HASHCHECK_Marshal(&validation, buffer, size);
+            break;
+        }
+        case TPM_CC_ReadPublic:
+            if (!comm_info->key_present)
+            {
+                result = TPM_RC_HANDLE | TPM_RC_H | TPM_RC_1;
+            }
+            else
+            {
+                (void)TPM2B_PUBLIC_Marshal(&comm_info->key_public, buffer, size);
+                marshal_name(buffer, size);
+                marshal_name(buffer, size);
+            }
+            break;
+        case TPM_CC_CreatePrimary:
+        {
+            TPMT_TK_CREATION ticket = { TPM_ST_CREATION, TPM_RH_OWNER, { { 0 } } };
+            TPM2B_CREATION_DATA creationData;
+
+            memset(&creationData, 0, sizeof(creationData));
+            creationData.creationData.pcrDigest.t.size = LOOPBACK_DIGEST_SIZE;
+            creationData.creationData.parentNameAlg = TPM_ALG_NULL;
+            creationData.creationData.parentName.t.size = sizeof(TPM_HANDLE);
+            creationData.creationData.parentQualifiedName.t.size = sizeof(TPM_HANDLE);
+
+            *retHandle = LOOPBACK_TRANSIENT_HANDLE;
+            (void)TPM2B_PUBLIC_Marshal(&comm_info->key_public, buffer, size);
+            (void)TPM2B_CREATION_DATA_Marshal(&creationData, buffer, size);
+            marshal_digest(buffer, size, LOOPBACK_DIGEST_SIZE, 0x33);
+            (void)TPMT_TK_CREATION_Marshal(&ticket, buffer, size);
+            break;
+        }
+        case TPM_CC_Load:
+            *retHandle = LOOPBACK_TRANSIENT_HANDLE;
+            marshal_name(buffer, size);
+            break;
+        case TPM_CC_EvictControl:
+            comm_info->key_present = true;
+            break;
+        case TPM_CC_StartAuthSession:
+        {
+            TPM2B_NONCE nonceCaller;
+            TPM2B_ENCRYPTED_SECRET salt;
+            TPM_SE sessionType;
+
+            if (TPM2B_NONCE_Unmarshal(&nonceCaller, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS ||
+                TPM2B_ENCRYPTED_SECRET_Unmarshal(&salt, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS ||
+                TPM_SE_Unmarshal(&sessionType, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS)
+            {
+                result = TPM_RC_VALUE + TPM_RC_P + TPM_RC_3;
+            }
+            else
+            {
+                // The TPM nonce has the size of the caller nonce
+                *retHandle = (sessionType == TPM_SE_HMAC) ? HMAC_SESSION_FIRST : POLICY_SESSION_FIRST;
+                marshal_digest(buffer, size, nonceCaller.t.size, 0x6E);
+            }
+            break;
+        }
+        case TPM_CC_PolicySecret:
+        {
+            TPM2B_TIMEOUT timeout;
+            TPMT_TK_AUTH ticket = { TPM_ST_AUTH_SECRET, TPM_RH_NULL, { { 0 } } };
+
+            timeout.t.size = 0;
+            (void)TPM2B_TIMEOUT_Marshal(&timeout, buffer, size);
+            (void)TPMT_TK_AUTH_Marshal(&ticket, buffer, size);
+            break;
+        }
+        case TPM_CC_ActivateCredential:
+            marshal_digest(buffer, size, LOOPBACK_DIGEST_SIZE, 0x44);
+            break;
+        case TPM_CC_Sign:
+            result = marshal_signature(cmdParams, cmdParamsSize, buffer, size);
+            break;
+        case TPM_CC_GetRandom:
+        {
+            UINT16 bytesRequested;
+            if (UINT16_Unmarshal(&bytesRequested, &cmdParams, &cmdParamsSize) != TPM_RC_SUCCESS)
+            {
+                result = TPM_RC_VALUE + TPM_RC_P + TPM_RC_1;
+            }
+            else
+            {
+                marshal_digest(buffer, size, bytesRequested < sizeof(TPMU_HA) ? bytesRequested : sizeof(TPMU_HA), 0x52);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return result;
+}
+
+// The commands answered with a handle, which marshal_response_params() sets
+static bool returns_handle(TPM_CC cmdCode)
+{
+    return cmdCode == TPM_CC_CreatePrimary || cmdCode == TPM_CC_Load ||
+        cmdCode == TPM_CC_HMAC_Start || cmdCode == TPM_CC_HashSequenceStart ||
+        cmdCode == TPM_CC_StartAuthSession;
+}
+
+static uint32_t get_handle_count(TPM_CC cmdCode)
+{
+    uint32_t result;
+    switch (cmdCode)
+    {
+        case TPM_CC_GetCapability:
+        case TPM_CC_GetRandom:
+        case TPM_CC_Hash:
+        case TPM_CC_HashSequenceStart:
+        case TPM_CC_Startup:
+            result = 0;
+            break;
+        case TPM_CC_EvictControl:
+        case TPM_CC_PolicySecret:
+        case TPM_CC_StartAuthSession:
+        case TPM_CC_ActivateCredential:
+            result = 2;
+            break;
+        default:
+            result = 1;
+            break;
+    }
+    return result;
+}
+
+// Skips the authorization area of the command and returns the number of sessions in it
+static uint32_t skip_auth_area(BYTE** cmdPtr, INT32* cmdLeft)
+{
+    uint32_t result = 0;
+    UINT32 authSize;
+
+    if (UINT32_Unmarshal(&authSize, cmdPtr, cmdLeft) == TPM_RC_SUCCESS && (INT32)authSize <= *cmdLeft)
+    {
+        BYTE* authPtr = *cmdPtr;
+        INT32 authLeft = (INT32)authSize;
+        TPMS_AUTH_COMMAND authCmd;
+
+        while (authLeft > 0 && result < LOOPBACK_MAX_SESSIONS &&
+            TPMS_AUTH_COMMAND_Unmarshal(&authCmd, &authPtr, &authLeft) == TPM_RC_SUCCESS)
+        {
+            result++;
+        }
+        *cmdPtr += authSize;
+        *cmdLeft -= (INT32)authSize;
+    }
+    return result;
+}
+
+// Answers the command with the canned response
+static int submit_canned_command(TPM_COMM_INFO* comm_info, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    BYTE* cmdPtr = (BYTE*)cmd_bytes;
+    INT32 cmdLeft = (INT32)bytes_len;
+    TPM_ST tag;
+    UINT32 cmdSize;
+    TPM_CC cmdCode;
+
+    if (UINT16_Unmarshal(&tag, &cmdPtr, &cmdLeft) != TPM_RC_SUCCESS ||
+        UINT32_Unmarshal(&cmdSize, &cmdPtr, &cmdLeft) != TPM_RC_SUCCESS ||
+        UINT32_Unmarshal(&cmdCode, &cmdPtr, &cmdLeft) != TPM_RC_SUCCESS ||
+        cmdSize != bytes_len ||
+        cmdLeft < (INT32)(get_handle_count(cmdCode) * sizeof(TPM_HANDLE)))
+    {
+        LogError("Malformed command of %u bytes", bytes_len);
+        result = MU_FAILURE;
+    }
+    else if (*resp_len < MAX_RESPONSE_SIZE)
+    {
+        LogError("Response buffer of %u bytes is smaller than the maximum response size %u", *resp_len, (uint32_t)MAX_RESPONSE_SIZE);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        BYTE* respPtr = response;
+        INT32 respLeft = (INT32)*resp_len;
+        BYTE* pRespSize;
+        BYTE* pRetHandle;
+        BYTE* pParamSize = NULL;
+        BYTE* paramStart;
+        UINT32 respSize = 0;
+        uint32_t sessionCount = 0;
+        TPM_HANDLE retHandle = 0;
+        TPM_RC rc = TPM_RC_SUCCESS;
+
+        // Skip the handles and the authorization area of the command
+        cmdPtr += get_handle_count(cmdCode) * sizeof(TPM_HANDLE);
+        cmdLeft -= (INT32)(get_handle_count(cmdCode) * sizeof(TPM_HANDLE));
+        if (tag == TPM_ST_SESSIONS)
+        {
+            sessionCount = skip_auth_area(&cmdPtr, &cmdLeft);
+        }
+
+        (void)UINT16_Marshal(&tag, &respPtr, &respLeft);
+        pRespSize = respPtr;
+        (void)UINT32_Marshal(&respSize, &respPtr, &respLeft);
+        (void)UINT32_Marshal(&rc, &respPtr, &respLeft);
+
+        // Room for the returned handle, which is known once the parameters are marshaled
+        pRetHandle = respPtr;
+        if (returns_handle(cmdCode))
+        {
+            (void)UINT32_Marshal(&retHandle, &respPtr, &respLeft);
+        }
+        if (tag == TPM_ST_SESSIONS)
+        {
+            pParamSize = respPtr;
+            (void)UINT32_Marshal(&respSize, &respPtr, &respLeft);
+        }
+
+        paramStart = respPtr;
+        rc = marshal_response_params(comm_info, cmdCode, cmdPtr, cmdLeft, &retHandle, &respPtr, &respLeft);
+        if (rc != TPM_RC_SUCCESS)
+        {
+            // Error responses consist of the header only
+            tag = TPM_ST_NO_SESSIONS;
+            respPtr = response;
+            (void)UINT16_Marshal(&tag, &respPtr, NULL);
+            respPtr = pRespSize + sizeof(UINT32);
+            (void)UINT32_Marshal(&rc, &respPtr, NULL);
+        }
+        else
+        {
+            if (returns_handle(cmdCode))
+            {
+                (void)UINT32_Marshal(&retHandle, &pRetHandle, NULL);
+            }
+
+            if (pParamSize != NULL)
+            {
+                UINT32 paramSize = (UINT32)(respPtr - paramStart);
+                TPMS_AUTH_RESPONSE authResp;
+                uint32_t index;
+
+                memset(&authResp, 0, sizeof(authResp));
+                authResp.sessionAttributes.continueSession = SET;
+
+                (void)UINT32_Marshal(&paramSize, &pParamSize, NULL);
+                for (index = 0; index < sessionCount; index++)
+                {
+                    (void)TPMS_AUTH_RESPONSE_Marshal(&authResp, &respPtr, &respLeft);
+                }
+            }
+        }
+
+        respSize = (UINT32)(respPtr - response);
+        (void)UINT32_Marshal(&respSize, &pRespSize, NULL);
+        *resp_len = respSize;
+        result = 0;
+    }
+    return result;
+}
+
+TPM_COMM_HANDLE tpm_comm_create(const char* endpoint)
+{
+    TPM_COMM_INFO* result;
+    (void)endpoint;
+    if ((result = (TPM_COMM_INFO*)malloc(sizeof(TPM_COMM_INFO))) == NULL)
+    {
+        LogError("Failure: malloc tpm_comm_info.");
+    }
+    else
+    {
+        memset(result, 0, sizeof(TPM_COMM_INFO));
+        result->key_present = true;
+        init_key_public(&result->key_public);
+    }
+    return result;
+}
+
+void tpm_comm_destroy(TPM_COMM_HANDLE handle)
+{
+    if (handle)
+    {
+        free(handle);
+    }
+}
+
+TPM_COMM_TYPE tpm_comm_get_type(TPM_COMM_HANDLE handle)
+{
+    (void)handle;
+    return TPM_COMM_TYPE_LOOPBACK;
+}
+
+int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL || cmd_bytes == NULL || response == NULL || resp_len == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, cmd_bytes: %p, response: %p, resp_len: %p.", handle, cmd_bytes, response, resp_len);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd != NULL)
+    {
+        // The response of the asynchronous command would be read as the response of this one
+        LogError("An asynchronous command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        if (handle->latency_us != 0)
+        {
+            inject_latency(handle->latency_us);
+        }
+
+        result = TPM_LOOPBACK_USE_CANNED;
+        if (handle->responder != NULL)
+        {
+            result = handle->responder(handle->responder_context, cmd_bytes, bytes_len, response, resp_len);
+        }
+        if (result == TPM_LOOPBACK_USE_CANNED)
+        {
+            result = submit_canned_command(handle, cmd_bytes, bytes_len, response, resp_len);
+        }
+
+        if (result != 0)
+        {
+            LogError("Failure answering the command of %u bytes", bytes_len);
+        }
+        else
+        {
+            handle->command_count++;
+            handle->byte_count += bytes_len + *resp_len;
+        }
+    }
+    return result;
+}
+
+int tpm_comm_submit_command_async(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len)
+{
+    int result;
+    if (handle == NULL || cmd_bytes == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, cmd_bytes: %p.", handle, cmd_bytes);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd != NULL)
+    {
+        LogError("Another command is already pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        // The command is answered when its response is requested
+        handle->pending_cmd = cmd_bytes;
+        handle->pending_cmd_len = bytes_len;
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_comm_complete_command(TPM_COMM_HANDLE handle, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL || response == NULL || resp_len == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, response: %p, resp_len: %p.", handle, response, resp_len);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd == NULL)
+    {
+        LogError("No command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        const unsigned char* cmd_bytes = handle->pending_cmd;
+        handle->pending_cmd = NULL;
+        result = tpm_comm_submit_command(handle, cmd_bytes, handle->pending_cmd_len, response, resp_len);
+    }
+    return result;
+}
+
+int tpm_comm_get_poll_fd(TPM_COMM_HANDLE handle)
+{
+    (void)handle;
+    return -1;
+}
+
+// In USE_TPM_COMM_RUNTIME builds the handle can belong to any backend, only the
+// handles of this one have the fields of TPM_COMM_INFO
+static bool is_loopback_handle(TPM_COMM_HANDLE handle)
+{
+#ifdef USE_TPM_COMM_RUNTIME
+    bool result = (handle->ops == tpm_comm_loopback_get_ops());
+    if (!result)
+    {
+        LogError("Handle %p is not a loopback tpm_comm handle.", handle);
+    }
+    return result;
+#else
+    (void)handle;
+    return true;
+#endif // USE_TPM_COMM_RUNTIME
+}
+
+int tpm_comm_loopback_set_responder(TPM_COMM_HANDLE handle, TPM_LOOPBACK_RESPONDER responder, void* context)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("Invalid argument specified handle: NULL.");
+        result = MU_FAILURE;
+    }
+    else if (!is_loopback_handle(handle))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        handle->responder = responder;
+        handle->responder_context = context;
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_comm_loopback_set_latency(TPM_COMM_HANDLE handle, uint32_t latency_us)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("Invalid argument specified handle: NULL.");
+        result = MU_FAILURE;
+    }
+    else if (!is_loopback_handle(handle))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        handle->latency_us = latency_us;
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_comm_loopback_set_key_present(TPM_COMM_HANDLE handle, bool present)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("Invalid argument specified handle: NULL.");
+        result = MU_FAILURE;
+    }
+    else if (!is_loopback_handle(handle))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        handle->key_present = present;
+        result = 0;
+    }
+    return result;
+}
+
+uint32_t tpm_comm_loopback_get_command_count(TPM_COMM_HANDLE handle)
+{
+    return (handle != NULL && is_loopback_handle(handle)) ? handle->command_count : 0;
+}
+
+uint64_t tpm_comm_loopback_get_byte_count(TPM_COMM_HANDLE handle)
+{
+    return (handle != NULL && is_loopback_handle(handle)) ? handle->byte_count : 0;
+}
+
+#ifdef USE_TPM_COMM_RUNTIME
+static const TPM_COMM_OPS tpm_comm_loopback_ops =
+{
+    "loopback",
+    tpm_comm_create,
+    tpm_comm_destroy,
+    tpm_comm_get_type,
+    tpm_comm_submit_command,
+    tpm_comm_submit_command_async,
+    tpm_comm_complete_command,
+    tpm_comm_get_poll_fd
+};
+
+const TPM_COMM_OPS* tpm_comm_loopback_get_ops(void)
+{
+    return &tpm_comm_loopback_ops;
+}
+#endif // USE_TPM_COMM_RUNTIME
@@ -12,9 +12,25 @@
 #include "azure_utpm_c/tpm_comm.h"
 #include <Tbs.h>
 
+#ifdef USE_TPM_COMM_RUNTIME
+// The functions of the backend are reached through tpm_comm_win32_get_ops()
+#define tpm_comm_create                  tpm_comm_win32_create
+#define tpm_comm_destroy                 tpm_comm_win32_destroy
+#define tpm_comm_get_type                tpm_comm_win32_get_type
+#define tpm_comm_submit_command          tpm_comm_win32_submit_command
+#define tpm_comm_submit_command_async    tpm_comm_win32_submit_command_async
+#define tpm_comm_complete_command        tpm_comm_win32_complete_command
+#define tpm_comm_get_poll_fd             tpm_comm_win32_get_poll_fd
+#endif // USE_TPM_COMM_RUNTIME
+
 typedef struct TPM_COMM_INFO_TAG
 {
+    TPM_COMM_OPS_MEMBER
     TBS_HCONTEXT tbs_context;
+
+    // Command of the outstanding asynchronous submission
+    const unsigned char* pending_cmd;
+    uint32_t pending_cmd_len;
 } TPM_COMM_INFO;
 
 static const char* get_tbsi_error_msg(TBS_RESULT tbs_res)
@@ -142,6 +158,12 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
         LogError("Invalid argument specified handle: %p, cmd_bytes: %p, response: %p, resp_len: %p.", handle, cmd_bytes, response, resp_len);
         result = MU_FAILURE;
     }
+    else if (handle->pending_cmd != NULL)
+    {
+        // The response of the asynchronous command would be read as the response of this one
+        LogError("An asynchronous command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
     else
     {
         TBS_RESULT tbs_res;
@@ -159,3 +181,74 @@ int tpm_comm_submit_command(TPM_COMM_HANDLE handle, const unsigned char* cmd_byt
     }
     return result;
 }
+
+int tpm_comm_submit_command_async(TPM_COMM_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len)
+{
+    int result;
+    if (handle == NULL || cmd_bytes == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, cmd_bytes: %p.", handle, cmd_bytes);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd != NULL)
+    {
+        LogError("Another command is already pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        // TBS commands cannot be polled, so the command is executed synchronously
+        // when its response is requested.
+        handle->pending_cmd = cmd_bytes;
+        handle->pending_cmd_len = bytes_len;
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_comm_complete_command(TPM_COMM_HANDLE handle, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    if (handle == NULL || response == NULL || resp_len == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, response: %p, resp_len: %p.", handle, response, resp_len);
+        result = MU_FAILURE;
+    }
+    else if (handle->pending_cmd == NULL)
+    {
+        LogError("No command is pending on this TPM_COMM_HANDLE");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        const unsigned char* cmd_bytes = handle->pending_cmd;
+        handle->pending_cmd = NULL;
+        result = tpm_comm_submit_command(handle, cmd_bytes, handle->pending_cmd_len, response, resp_len);
+    }
+    return result;
+}
+
+int tpm_comm_get_poll_fd(TPM_COMM_HANDLE handle)
+{
+    (void)handle;
+    return -1;
+}
+
+#ifdef USE_TPM_COMM_RUNTIME
+static const TPM_COMM_OPS tpm_comm_win32_ops =
+{
+    "win32",
+    tpm_comm_create,
+    tpm_comm_destroy,
+    tpm_comm_get_type,
+    tpm_comm_submit_command,
+    tpm_comm_submit_command_async,
+    tpm_comm_complete_command,
+    tpm_comm_get_poll_fd
+};
+
+const TPM_COMM_OPS* tpm_comm_win32_get_ops(void)
+{
+    return &tpm_comm_win32_ops;
+}
+#endif // USE_TPM_COMM_RUNTIME
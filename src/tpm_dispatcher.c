@@ -0,0 +1,301 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "umock_c/umock_c_prod.h"
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+
+#include "azure_utpm_c/CompilerDependencies.h"
+#include "azure_utpm_c/tpm_dispatcher.h"
+
+typedef struct TPM_DISPATCHER_TAG
+{
+    TPM_COMM_HANDLE comm_handle;
+    THREAD_HANDLE thread_handle;
+
+    // Intrusive MPSC queue. Producers append at 'head' with a single atomic exchange,
+    // the dispatcher thread takes requests from 'tail'. 'stub' stands in for a request
+    // while the queue is empty.
+    TPM_DISPATCH_REQUEST* head;
+    TPM_DISPATCH_REQUEST* tail;
+    TPM_DISPATCH_REQUEST stub;
+
+    // The dispatcher thread sets 'sleeping' before checking the queue one last time
+    // and waiting on 'wake_cond', so producers only take 'wake_lock' to wake it up.
+    LOCK_HANDLE wake_lock;
+    COND_HANDLE wake_cond;
+    uint32_t sleeping;
+    uint32_t stopping;
+
+    // Protects the completion of requests submitted by tpm_dispatcher_execute()
+    LOCK_HANDLE complete_lock;
+} TPM_DISPATCHER;
+
+typedef struct SYNC_REQUEST_TAG
+{
+    TPM_DISPATCHER* dispatcher;
+    COND_HANDLE complete_cond;
+    bool done;
+    int result;
+} SYNC_REQUEST;
+
+static void push_request(TPM_DISPATCHER* dispatcher, TPM_DISPATCH_REQUEST* request)
+{
+    TPM_DISPATCH_REQUEST* prev;
+
+    request->next = NULL;
+    prev = (TPM_DISPATCH_REQUEST*)ATOMIC_EXCHANGE_PTR(&dispatcher->head, request);
+    // Until 'prev' is linked to 'request', the dispatcher thread sees the queue ending at 'prev'
+    (void)ATOMIC_EXCHANGE_PTR(&prev->next, request);
+}
+
+// Only called on the dispatcher thread
+static TPM_DISPATCH_REQUEST* pop_request(TPM_DISPATCHER* dispatcher)
+{
+    TPM_DISPATCH_REQUEST* result = NULL;
+    TPM_DISPATCH_REQUEST* tail = dispatcher->tail;
+    TPM_DISPATCH_REQUEST* next = (TPM_DISPATCH_REQUEST*)ATOMIC_LOAD_PTR(&tail->next);
+
+    if (tail == &dispatcher->stub && next != NULL)
+    {
+        dispatcher->tail = next;
+        tail = next;
+        next = (TPM_DISPATCH_REQUEST*)ATOMIC_LOAD_PTR(&next->next);
+    }
+
+    if (tail == &dispatcher->stub)
+    {
+        // The queue is empty
+    }
+    else if (next != NULL)
+    {
+        dispatcher->tail = next;
+        result = tail;
+    }
+    else if (tail == (TPM_DISPATCH_REQUEST*)ATOMIC_LOAD_PTR(&dispatcher->head))
+    {
+        // 'tail' is the last request. The stub is queued behind it, so that it can be unlinked.
+        push_request(dispatcher, &dispatcher->stub);
+        next = (TPM_DISPATCH_REQUEST*)ATOMIC_LOAD_PTR(&tail->next);
+        if (next != NULL)
+        {
+            dispatcher->tail = next;
+            result = tail;
+        }
+    }
+    // Otherwise a producer is inside push_request(), and its request is picked up on the next call
+    return result;
+}
+
+static bool is_queue_empty(TPM_DISPATCHER* dispatcher)
+{
+    return dispatcher->tail == &dispatcher->stub && ATOMIC_LOAD_PTR(&dispatcher->stub.next) == NULL;
+}
+
+static void wake_dispatcher_thread(TPM_DISPATCHER* dispatcher)
+{
+    (void)Lock(dispatcher->wake_lock);
+    (void)Condition_Post(dispatcher->wake_cond);
+    (void)Unlock(dispatcher->wake_lock);
+}
+
+static int dispatcher_thread(void* arg)
+{
+    TPM_DISPATCHER* dispatcher = (TPM_DISPATCHER*)arg;
+    bool running = true;
+
+    while (running)
+    {
+        TPM_DISPATCH_REQUEST* request = pop_request(dispatcher);
+        if (request != NULL)
+        {
+            int result = tpm_comm_submit_command(dispatcher->comm_handle, request->cmd_bytes, request->cmd_len, request->response, request->resp_len);
+            // 'request' belongs to the submitter again once it is completed
+            request->on_complete(request->context, result);
+        }
+        else
+        {
+            (void)Lock(dispatcher->wake_lock);
+            (void)ATOMIC_EXCHANGE_32(&dispatcher->sleeping, 1);
+            if (is_queue_empty(dispatcher))
+            {
+                if (ATOMIC_LOAD_32(&dispatcher->stopping) != 0)
+                {
+                    running = false;
+                }
+                else
+                {
+                    (void)Condition_Wait(dispatcher->wake_cond, dispatcher->wake_lock, 0);
+                }
+            }
+            (void)ATOMIC_EXCHANGE_32(&dispatcher->sleeping, 0);
+            (void)Unlock(dispatcher->wake_lock);
+        }
+    }
+    return 0;
+}
+
+static void free_sync_objects(TPM_DISPATCHER* dispatcher)
+{
+    if (dispatcher->wake_lock != NULL)
+    {
+        (void)Lock_Deinit(dispatcher->wake_lock);
+    }
+    if (dispatcher->wake_cond != NULL)
+    {
+        Condition_Deinit(dispatcher->wake_cond);
+    }
+    if (dispatcher->complete_lock != NULL)
+    {
+        (void)Lock_Deinit(dispatcher->complete_lock);
+    }
+}
+
+static void on_sync_request_complete(void* context, int result)
+{
+    SYNC_REQUEST* sync_request = (SYNC_REQUEST*)context;
+
+    (void)Lock(sync_request->dispatcher->complete_lock);
+    sync_request->result = result;
+    sync_request->done = true;
+    (void)Condition_Post(sync_request->complete_cond);
+    (void)Unlock(sync_request->dispatcher->complete_lock);
+}
+
+TPM_DISPATCHER_HANDLE tpm_dispatcher_create(TPM_COMM_HANDLE comm_handle)
+{
+    TPM_DISPATCHER* result;
+    if (comm_handle == NULL)
+    {
+        LogError("Invalid parameter specified comm_handle is NULL");
+        result = NULL;
+    }
+    else if ((result = (TPM_DISPATCHER*)malloc(sizeof(TPM_DISPATCHER))) == NULL)
+    {
+        LogError("Failure allocating tpm dispatcher");
+    }
+    else
+    {
+        memset(result, 0, sizeof(TPM_DISPATCHER));
+        result->comm_handle = comm_handle;
+        result->head = &result->stub;
+        result->tail = &result->stub;
+
+        if ((result->wake_lock = Lock_Init()) == NULL ||
+            (result->wake_cond = Condition_Init()) == NULL ||
+            (result->complete_lock = Lock_Init()) == NULL)
+        {
+            LogError("Failure creating dispatcher synchronization objects");
+            free_sync_objects(result);
+            free(result);
+            result = NULL;
+        }
+        else if (ThreadAPI_Create(&result->thread_handle, dispatcher_thread, result) != THREADAPI_OK)
+        {
+            LogError("Failure creating dispatcher thread");
+            free_sync_objects(result);
+            free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+void tpm_dispatcher_destroy(TPM_DISPATCHER_HANDLE handle)
+{
+    if (handle != NULL)
+    {
+        int thread_result;
+
+        (void)ATOMIC_EXCHANGE_32(&handle->stopping, 1);
+        wake_dispatcher_thread(handle);
+        if (ThreadAPI_Join(handle->thread_handle, &thread_result) != THREADAPI_OK)
+        {
+            LogError("Failure joining dispatcher thread");
+        }
+        free_sync_objects(handle);
+        free(handle);
+    }
+}
+
+int tpm_dispatcher_submit(TPM_DISPATCHER_HANDLE handle, TPM_DISPATCH_REQUEST* request)
+{
+    int result;
+    if (handle == NULL || request == NULL || request->cmd_bytes == NULL ||
+        request->response == NULL || request->resp_len == NULL || request->on_complete == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, request: %p.", handle, request);
+        result = MU_FAILURE;
+    }
+    else if (ATOMIC_LOAD_32(&handle->stopping) != 0)
+    {
+        LogError("Dispatcher is stopping");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        push_request(handle, request);
+        if (ATOMIC_LOAD_32(&handle->sleeping) != 0)
+        {
+            wake_dispatcher_thread(handle);
+        }
+        result = 0;
+    }
+    return result;
+}
+
+int tpm_dispatcher_execute(TPM_DISPATCHER_HANDLE handle, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len)
+{
+    int result;
+    SYNC_REQUEST sync_request;
+    TPM_DISPATCH_REQUEST request;
+
+    if (handle == NULL || cmd_bytes == NULL || response == NULL || resp_len == NULL)
+    {
+        LogError("Invalid argument specified handle: %p, cmd_bytes: %p, response: %p, resp_len: %p.", handle, cmd_bytes, response, resp_len);
+        result = MU_FAILURE;
+    }
+    else if ((sync_request.complete_cond = Condition_Init()) == NULL)
+    {
+        LogError("Failure creating completion condition");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        sync_request.dispatcher = handle;
+        sync_request.done = false;
+        sync_request.result = MU_FAILURE;
+
+        request.cmd_bytes = cmd_bytes;
+        request.cmd_len = bytes_len;
+        request.response = response;
+        request.resp_len = resp_len;
+        request.on_complete = on_sync_request_complete;
+        request.context = &sync_request;
+
+        if (tpm_dispatcher_submit(handle, &request) != 0)
+        {
+            LogError("Failure submitting command to dispatcher");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            (void)Lock(handle->complete_lock);
+            while (!sync_request.done)
+            {
+                (void)Condition_Wait(sync_request.complete_cond, handle->complete_lock, 0);
+            }
+            (void)Unlock(handle->complete_lock);
+            result = sync_request.result;
+        }
+        Condition_Deinit(sync_request.complete_cond);
+    }
+    return result;
+}
@@ -4,10 +4,10 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "umock_c/umock_c_prod.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/xlogging.h"
-#include "azure_c_shared_utility/safe_math.h"
 
 #include "azure_utpm_c/tpm_socket_comm.h"
 
@@ -18,7 +18,10 @@
 #else
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
@@ -27,13 +30,30 @@
 #define SOCKET_ERROR        -1
 #endif
 
-#define MAX_DATA_RECV                   1024
+// Platform descriptor of one buffer of a gathering send
+#ifdef WIN32
+typedef WSABUF SEND_SEGMENT;
+#define SEGMENT_BASE(segment)           ((segment).buf)
+#define SEGMENT_LENGTH(segment)         ((segment).len)
+#else
+typedef struct iovec SEND_SEGMENT;
+#define SEGMENT_BASE(segment)           ((segment).iov_base)
+#define SEGMENT_LENGTH(segment)         ((segment).iov_len)
+#endif
+
+// Capacity of the receive ring buffer, room for the largest TPM response
+#define RECV_BUFFER_SIZE                4096
 
 typedef struct TPM_SOCKET_INFO_TAG
 {
     SOCKET socket_conn;
-    unsigned char* recv_bytes;
+    bool is_tcp;
+
+    // Bytes received but not yet read: recv_length bytes starting at recv_head,
+    // wrapping around the end of recv_buffer
+    size_t recv_head;
     size_t recv_length;
+    unsigned char recv_buffer[RECV_BUFFER_SIZE];
 } TPM_SOCKET_INFO;
 
 enum TpmSimCommands
@@ -48,139 +68,143 @@ enum TpmSimCommands
     Remote_Stop = 21,
 };
 
-static int add_to_buffer(TPM_SOCKET_INFO* socket_info, const unsigned char* bytes, size_t length)
+// Copies up to 'length' buffered bytes to 'bytes' and returns the number of bytes copied
+static size_t remove_from_buffer(TPM_SOCKET_INFO* socket_info, unsigned char* bytes, size_t length)
 {
-    int result;
-    unsigned char* new_buff;
-    if (socket_info->recv_bytes == NULL)
-    {
-        new_buff = (unsigned char*)malloc(length);
-    }
-    else
-    {
-        size_t realloc_size = safe_add_size_t(socket_info->recv_length, length);
-        if (realloc_size != SIZE_MAX)
-        {
-            new_buff = (unsigned char*)realloc(socket_info->recv_bytes, realloc_size);
-        }
-        else
-        {
-            new_buff = NULL;
-        }
-    }
+    size_t result = (length < socket_info->recv_length) ? length : socket_info->recv_length;
+    size_t first = RECV_BUFFER_SIZE - socket_info->recv_head;
 
-    if (new_buff == NULL)
+    if (first >= result)
     {
-        result = MU_FAILURE;
+        memcpy(bytes, &socket_info->recv_buffer[socket_info->recv_head], result);
     }
     else
     {
-        size_t recv_length = safe_add_size_t(socket_info->recv_length, length);
-        if (recv_length != SIZE_MAX)
-        {
-            socket_info->recv_bytes = new_buff;
-            memcpy(socket_info->recv_bytes + socket_info->recv_length, bytes, length);
-            socket_info->recv_length = recv_length;
-            result = 0;
-        }
-        else
-        {
-            free(new_buff);
-            result = MU_FAILURE;
-        }
+        memcpy(bytes, &socket_info->recv_buffer[socket_info->recv_head], first);
+        memcpy(bytes + first, socket_info->recv_buffer, result - first);
     }
+    socket_info->recv_length -= result;
+
+    // Restart an empty buffer at its beginning to keep its free region contiguous
+    socket_info->recv_head = (socket_info->recv_length == 0) ? 0 : (socket_info->recv_head + result) % RECV_BUFFER_SIZE;
     return result;
 }
 
-static void remove_from_buffer(TPM_SOCKET_INFO* socket_info, size_t length)
+// Sends the segments with one system call, returning the number of bytes sent or SOCKET_ERROR
+static int send_segments(SOCKET socket_conn, SEND_SEGMENT* segments, size_t count)
 {
-    if (socket_info->recv_length == length)
+    int result;
+#ifdef WIN32
+    DWORD sent_bytes;
+    if (WSASend(socket_conn, segments, (DWORD)count, &sent_bytes, 0, NULL, NULL) != 0)
     {
-        free(socket_info->recv_bytes);
-        socket_info->recv_bytes = NULL;
-        socket_info->recv_length = 0;
+        result = SOCKET_ERROR;
     }
     else
     {
-        size_t malloc_size = safe_subtract_size_t(socket_info->recv_length, length);
-        if (malloc_size != SIZE_MAX)
-        {
-            unsigned char* new_buff = (unsigned char*)malloc(malloc_size);
-            memcpy(new_buff, &socket_info->recv_bytes[length], malloc_size);
-            free(socket_info->recv_bytes);
-            socket_info->recv_bytes = new_buff;
-            socket_info->recv_length = malloc_size;
-        }
+        result = (int)sent_bytes;
     }
+#else
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = segments;
+    msg.msg_iovlen = count;
+    result = (int)sendmsg(socket_conn, &msg, 0);
+#endif
+    return result;
 }
 
-static int send_socket_bytes(TPM_SOCKET_INFO* socket_info, const unsigned char* cmd_val, size_t byte_len)
+static int send_socket_bytes(TPM_SOCKET_INFO* socket_info, const TPM_SOCKET_BUFFER* buffers, size_t count)
 {
     int result;
+    SEND_SEGMENT segments[TPM_SOCKET_MAX_BUFFERS];
+    size_t seg_index = 0;
 
-#if SHOW_TRACE
-    printf("<- ");
-    for (size_t index = 0; index < byte_len; index++)
+    for (size_t index = 0; index < count; index++)
     {
-        printf("%x", cmd_val[index]);
-    }
-    printf("\r\n");
+#if SHOW_TRACE
+        printf("<- ");
+        for (size_t trace_index = 0; trace_index < buffers[index].length; trace_index++)
+        {
+            printf("%x", buffers[index].bytes[trace_index]);
+        }
+        printf("\r\n");
 #endif
-    int sent_bytes = 0;
-    int send_amt = (int)byte_len;
-    const char* pIterator = (const char*)cmd_val;
-    while (send_amt > 0)
+        SEGMENT_BASE(segments[index]) = (void*)buffers[index].bytes;
+        SEGMENT_LENGTH(segments[index]) = buffers[index].length;
+    }
+
+    result = 0;
+    while (seg_index < count)
     {
-        sent_bytes = send(socket_info->socket_conn, pIterator, (int)send_amt, 0);
+        int sent_bytes = send_segments(socket_info->socket_conn, &segments[seg_index], count - seg_index);
         if (sent_bytes <= 0)
         {
             LogError("Failure sending packet.");
+            result = MU_FAILURE;
             break;
         }
-        pIterator += sent_bytes;
-        send_amt -= sent_bytes;
-    }
-    if (sent_bytes < (int)byte_len)
-    {
-        LogError("sent byte amoutn is less than desired send amount.");
-        result = MU_FAILURE;
-    }
-    else
-    {
-        result = 0;
+
+        // Skip the segments sent completely and advance into a partially sent one
+        size_t remaining = (size_t)sent_bytes;
+        while (seg_index < count && remaining >= SEGMENT_LENGTH(segments[seg_index]))
+        {
+            remaining -= SEGMENT_LENGTH(segments[seg_index]);
+            seg_index++;
+        }
+        if (seg_index < count)
+        {
+            SEGMENT_BASE(segments[seg_index]) = (char*)SEGMENT_BASE(segments[seg_index]) + remaining;
+            SEGMENT_LENGTH(segments[seg_index]) -= remaining;
+        }
     }
     return result;
 }
 
+// Receives into the contiguous free region of the buffer following the buffered bytes
 static int read_socket_bytes(TPM_SOCKET_INFO* socket_info)
 {
     int result;
-    char read_data[MAX_DATA_RECV];
-    int data_len = recv(socket_info->socket_conn, read_data, MAX_DATA_RECV, 0);
-    if (data_len == -1)
+    size_t tail = (socket_info->recv_head + socket_info->recv_length) % RECV_BUFFER_SIZE;
+    size_t free_len = (tail >= socket_info->recv_head && socket_info->recv_length < RECV_BUFFER_SIZE)
+        ? RECV_BUFFER_SIZE - tail
+        : socket_info->recv_head - tail;
+    unsigned char* free_region = &socket_info->recv_buffer[tail];
+
+#ifdef TCP_QUICKACK
+    if (socket_info->is_tcp)
+    {
+        // The simulator writes the length, the body and the ack of a response separately,
+        // and with Nagle on its side each write waits for the acknowledgment of the previous
+        // one. Acknowledge immediately instead of delaying (the option is not sticky).
+        int quick_ack = 1;
+        (void)setsockopt(socket_info->socket_conn, IPPROTO_TCP, TCP_QUICKACK, &quick_ack, sizeof(quick_ack));
+    }
+#endif
+
+    int data_len = recv(socket_info->socket_conn, (char*)free_region, (int)free_len, 0);
+    if (data_len == SOCKET_ERROR)
     {
         LogError("Failure received bytes timed out.");
         result = MU_FAILURE;
     }
+    else if (data_len == 0)
+    {
+        LogError("Failure: connection closed by the tpm.");
+        result = MU_FAILURE;
+    }
     else
     {
 #if SHOW_TRACE
         printf("-> ");
-        for (size_t index = 0; index < size; index++)
+        for (int index = 0; index < data_len; index++)
         {
-            printf("%x", buffer[index]);
+            printf("%x", free_region[index]);
         }
         printf("\r\n");
 #endif
-        if (add_to_buffer(socket_info, (const unsigned char*)read_data, data_len) != 0)
-        {
-            LogError("Failure: adding bytes to buffer.");
-            result = MU_FAILURE;
-        }
-        else
-        {
-            result = 0;
-        }
+        socket_info->recv_length += (size_t)data_len;
+        result = 0;
     }
     return result;
 }
@@ -196,10 +220,85 @@ static void close_socket(SOCKET socket_obj)
 }
 
 
+static SOCKET connect_tcp(const char* address, unsigned short port)
+{
+    SOCKET result;
+    if ((result = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET)
+    {
+        LogError("Failure: connecting to tpm simulator.");
+    }
+    else
+    {
+        struct sockaddr_in SockAddr;
+        memset(&SockAddr, 0, sizeof(SockAddr));
+        SockAddr.sin_family = AF_INET;
+        SockAddr.sin_port = htons(port);
+        SockAddr.sin_addr.s_addr = inet_addr(address);
+
+        if (connect(result, (struct sockaddr*)&SockAddr, sizeof(SockAddr)) < 0)
+        {
+            LogError("Failure: connecting to tpm simulator.");
+            close_socket(result);
+            result = INVALID_SOCKET;
+        }
+        else
+        {
+            // Every message is complete when it is sent, so Nagle would only hold
+            // back its last segment until the previous one is acknowledged
+            int no_delay = 1;
+            if (setsockopt(result, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay)) != 0)
+            {
+                LogError("Failure: setting TCP_NODELAY, continuing with Nagle enabled.");
+            }
+        }
+    }
+    return result;
+}
+
+static SOCKET connect_unix(const char* path)
+{
+    SOCKET result;
+#ifdef WIN32
+    LogError("Failure: unix domain sockets are not supported, path: %s", path);
+    result = INVALID_SOCKET;
+#else
+    struct sockaddr_un SockAddr;
+    size_t path_len = strlen(path);
+    if (path_len == 0 || path_len >= sizeof(SockAddr.sun_path))
+    {
+        LogError("Failure: invalid unix domain socket path: %s", path);
+        result = INVALID_SOCKET;
+    }
+    else if ((result = socket(AF_UNIX, SOCK_STREAM, 0)) == INVALID_SOCKET)
+    {
+        LogError("Failure: connecting to tpm simulator.");
+    }
+    else
+    {
+        memset(&SockAddr, 0, sizeof(SockAddr));
+        SockAddr.sun_family = AF_UNIX;
+        memcpy(SockAddr.sun_path, path, path_len + 1);
+
+        if (connect(result, (struct sockaddr*)&SockAddr, sizeof(SockAddr)) < 0)
+        {
+            LogError("Failure: connecting to tpm simulator at %s.", path);
+            close_socket(result);
+            result = INVALID_SOCKET;
+        }
+    }
+#endif
+    return result;
+}
+
 TPM_SOCKET_HANDLE tpm_socket_create(const char* address, unsigned short port)
 {
     TPM_SOCKET_INFO* result;
-    if ((result = malloc(sizeof(TPM_SOCKET_INFO))) == NULL)
+    if (address == NULL)
+    {
+        LogError("Invalid argument specified address: NULL");
+        result = NULL;
+    }
+    else if ((result = malloc(sizeof(TPM_SOCKET_INFO))) == NULL)
     {
         LogError("Failure: malloc socket communication info.");
     }
@@ -212,27 +311,20 @@ TPM_SOCKET_HANDLE tpm_socket_create(const char* address, unsigned short port)
 
         memset(result, 0, sizeof(TPM_SOCKET_INFO));
 
-        if ((result->socket_conn = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET)
+        if (strncmp(address, TPM_SOCKET_UNIX_PREFIX, sizeof(TPM_SOCKET_UNIX_PREFIX) - 1) == 0)
         {
-            LogError("Failure: connecting to tpm simulator.");
-            free(result);
-            result = NULL;
+            result->socket_conn = connect_unix(address + sizeof(TPM_SOCKET_UNIX_PREFIX) - 1);
         }
         else
         {
-            struct sockaddr_in SockAddr;
-            memset(&SockAddr, 0, sizeof(SockAddr));
-            SockAddr.sin_family = AF_INET;
-            SockAddr.sin_port = htons(port);
-            SockAddr.sin_addr.s_addr = inet_addr(address);
+            result->socket_conn = connect_tcp(address, port);
+            result->is_tcp = true;
+        }
 
-            if (connect(result->socket_conn, (struct sockaddr*)&SockAddr, sizeof(SockAddr)) < 0)
-            {
-                LogError("Failure: connecting to tpm simulator.");
-                close_socket(result->socket_conn);
-                free(result);
-                result = NULL;
-            }
+        if (result->socket_conn == INVALID_SOCKET)
+        {
+            free(result);
+            result = NULL;
         }
     }
     return result;
@@ -243,7 +335,6 @@ void tpm_socket_destroy(TPM_SOCKET_HANDLE handle)
     if (handle)
     {
         close_socket(handle->socket_conn);
-        free(handle->recv_bytes);
         free(handle);
     }
 }
@@ -258,26 +349,18 @@ int tpm_socket_read(TPM_SOCKET_HANDLE handle, unsigned char* tpm_bytes, uint32_t
     }
     else
     {
-        // Do we have enough bytes cached
-        result = MU_FAILURE;
-        for (size_t index = 0; index < 2; index++)
+        // Copy out the buffered bytes, receiving more until the read is satisfied
+        size_t copied = remove_from_buffer(handle, tpm_bytes, bytes_len);
+        result = 0;
+        while (copied < bytes_len)
         {
-            if (handle->recv_length >= bytes_len)
+            if (read_socket_bytes(handle) != 0)
             {
-                memcpy(tpm_bytes, handle->recv_bytes, bytes_len);
-                remove_from_buffer(handle, bytes_len);
-                result = 0;
+                LogError("Failure reading socket bytes.");
+                result = MU_FAILURE;
                 break;
             }
-            else
-            {
-                if (read_socket_bytes(handle))
-                {
-                    LogError("Failure reading socket bytes.");
-                    result = MU_FAILURE;
-                    break;
-                }
-            }
+            copied += remove_from_buffer(handle, tpm_bytes + copied, bytes_len - copied);
         }
     }
     return result;
@@ -293,7 +376,41 @@ int tpm_socket_send(TPM_SOCKET_HANDLE handle, const unsigned char* tpm_bytes, ui
     }
     else
     {
-        result = send_socket_bytes(handle, tpm_bytes, bytes_len);
+        TPM_SOCKET_BUFFER buffer;
+        buffer.bytes = tpm_bytes;
+        buffer.length = bytes_len;
+        result = send_socket_bytes(handle, &buffer, 1);
+    }
+    return result;
+}
+
+int tpm_socket_send_vector(TPM_SOCKET_HANDLE handle, const TPM_SOCKET_BUFFER* buffers, size_t count)
+{
+    int result;
+    if (handle == NULL || buffers == NULL || count == 0 || count > TPM_SOCKET_MAX_BUFFERS)
+    {
+        LogError("Invalid argument specified handle: %p, buffers: %p, count: %zu", handle, buffers, count);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        size_t index;
+        for (index = 0; index < count; index++)
+        {
+            if (buffers[index].bytes == NULL && buffers[index].length > 0)
+            {
+                break;
+            }
+        }
+        if (index < count)
+        {
+            LogError("Invalid buffer %zu specified", index);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            result = send_socket_bytes(handle, buffers, count);
+        }
     }
     return result;
 }
@@ -0,0 +1,403 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_stdint.h"
+#include "umock_c/umock_c_negative_tests.h"
+#include "azure_macro_utils/macro_utils.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "umock_c/umock_c_prod.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_utpm_c/tpm_dispatcher.h"
+#undef ENABLE_MOCKS
+
+#include "azure_utpm_c/tpm_codec.h"
+#include "azure_utpm_c/tpm_comm_loopback.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_KEY_HANDLE             (TPMI_DH_OBJECT)0x81000100
+#define TEST_TRANSIENT_HANDLE       (TPM_HANDLE)(HR_TRANSIENT | 0x00000001)
+
+static TSS_DEVICE g_tpm;
+static TSS_SESSION g_null_pw_session;
+static TPM2B_DIGEST g_digest;
+static TPM2B_SENSITIVE_CREATE g_sensitive;
+static TPM2B_PUBLIC g_primary_template;
+static TPM2B_DATA g_outside_info;
+static TPML_PCR_SELECTION g_creation_pcr;
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%s", MU_ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+}
+
+static void init_primary_template(TPM2B_PUBLIC* primaryTemplate)
+{
+    TPMT_PUBLIC* pub = &primaryTemplate->publicArea;
+
+    memset(primaryTemplate, 0, sizeof(*primaryTemplate));
+    pub->type = TPM_ALG_RSA;
+    pub->nameAlg = TPM_ALG_SHA256;
+    pub->objectAttributes = ToTpmaObject(FixedTPM | FixedParent | SensitiveDataOrigin | UserWithAuth | NoDA | Restricted | Decrypt);
+    pub->parameters.rsaDetail.symmetric.algorithm = TPM_ALG_AES;
+    pub->parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    pub->parameters.rsaDetail.symmetric.mode.aes = TPM_ALG_CFB;
+    pub->parameters.rsaDetail.scheme.scheme = TPM_ALG_NULL;
+    pub->parameters.rsaDetail.keyBits = 2048;
+}
+
+static TPM_RC submit_sign(void)
+{
+    return TPM2_SignSubmit(&g_tpm, &g_null_pw_session, TEST_KEY_HANDLE, &g_digest, NULL, NULL);
+}
+
+static TPM_RC submit_create_primary(void)
+{
+    return TPM2_CreatePrimarySubmit(&g_tpm, &g_null_pw_session, TPM_RH_OWNER, &g_sensitive, &g_primary_template, &g_outside_info, &g_creation_pcr);
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(tpm_codec_loopback_ut)
+
+    TEST_SUITE_INITIALIZE(suite_init)
+    {
+        int result;
+        TPM2B_AUTH null_auth;
+
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        (void)umock_c_init(on_umock_c_error);
+
+        result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        result = umocktypes_stdint_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_DISPATCHER_HANDLE, void*);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+
+        memset(&null_auth, 0, sizeof(null_auth));
+        result = (int)TSS_CreatePwAuthSession(&null_auth, &g_null_pw_session);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, result);
+
+        g_digest.t.size = 32;
+        memset(g_digest.t.buffer, 0x42, g_digest.t.size);
+        init_primary_template(&g_primary_template);
+    }
+
+    TEST_SUITE_CLEANUP(suite_cleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+    }
+
+    TEST_FUNCTION_INITIALIZE(method_init)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Could not acquire test serialization mutex.");
+        }
+        umock_c_reset_all_calls();
+
+        memset(&g_tpm, 0, sizeof(g_tpm));
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, Initialize_TPM_Codec(&g_tpm));
+    }
+
+    TEST_FUNCTION_CLEANUP(method_cleanup)
+    {
+        Deinit_TPM_Codec(&g_tpm);
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(TPM2_SignSubmit_TPM2_SignComplete_succeed)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        uint32_t command_count = tpm_comm_loopback_get_command_count(g_tpm.tpm_comm_handle);
+        memset(&signature, 0, sizeof(signature));
+
+        //act
+        TPM_RC submit_result = submit_sign();
+        uint32_t submitted_count = tpm_comm_loopback_get_command_count(g_tpm.tpm_comm_handle);
+        TPM_RC complete_result = TPM2_SignComplete(&g_tpm, &signature);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, complete_result);
+        // The loopback backend answers the command when its response is requested
+        ASSERT_ARE_EQUAL(uint32_t, command_count, submitted_count);
+        ASSERT_ARE_EQUAL(uint32_t, command_count + 1, tpm_comm_loopback_get_command_count(g_tpm.tpm_comm_handle));
+        ASSERT_ARE_EQUAL(int, TPM_ALG_HMAC, signature.sigAlg);
+        ASSERT_ARE_EQUAL(int, TPM_ALG_SHA256, signature.signature.hmac.hashAlg);
+        ASSERT_IS_NULL(g_tpm.PendingCmdCtx);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_SignSubmit_rsassa_scheme_succeed)
+    {
+        TPMT_SIG_SCHEME scheme;
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        scheme.scheme = TPM_ALG_RSASSA;
+        scheme.details.rsassa.hashAlg = TPM_ALG_SHA256;
+        memset(&signature, 0, sizeof(signature));
+
+        //act
+        TPM_RC submit_result = TPM2_SignSubmit(&g_tpm, &g_null_pw_session, TEST_KEY_HANDLE, &g_digest, &scheme, NULL);
+        TPM_RC complete_result = TPM2_SignComplete(&g_tpm, &signature);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, complete_result);
+        ASSERT_ARE_EQUAL(int, TPM_ALG_RSASSA, signature.sigAlg);
+        ASSERT_ARE_EQUAL(int, 256, signature.signature.rsassa.sig.t.size);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_CreatePrimarySubmit_TPM2_CreatePrimaryComplete_succeed)
+    {
+        TPM_HANDLE object_handle = 0;
+        TPM2B_PUBLIC out_public;
+        TPM2B_CREATION_DATA creation_data;
+        TPM2B_DIGEST creation_hash;
+        TPMT_TK_CREATION creation_ticket;
+
+        //arrange
+        memset(&out_public, 0, sizeof(out_public));
+        memset(&creation_hash, 0, sizeof(creation_hash));
+        memset(&creation_ticket, 0, sizeof(creation_ticket));
+
+        //act
+        TPM_RC submit_result = submit_create_primary();
+        TPM_RC complete_result = TPM2_CreatePrimaryComplete(&g_tpm, &object_handle, &out_public, &creation_data, &creation_hash, &creation_ticket);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, complete_result);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_TRANSIENT_HANDLE, object_handle);
+        ASSERT_ARE_EQUAL(int, TPM_ALG_SHA256, out_public.publicArea.nameAlg);
+        ASSERT_ARE_EQUAL(int, 32, creation_hash.t.size);
+        ASSERT_ARE_EQUAL(int, TPM_ST_CREATION, creation_ticket.tag);
+        ASSERT_IS_NULL(g_tpm.PendingCmdCtx);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_CreatePrimaryComplete_no_creation_outputs_succeed)
+    {
+        TPM_HANDLE object_handle = 0;
+        TPM2B_PUBLIC out_public;
+
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_create_primary());
+
+        //act
+        TPM_RC result = TPM2_CreatePrimaryComplete(&g_tpm, &object_handle, &out_public, NULL, NULL, NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_TRANSIENT_HANDLE, object_handle);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_CreatePrimarySubmit_while_pending_fail)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+
+        //act
+        TPM_RC result = submit_create_primary();
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, TPM_RC_SUCCESS, result);
+        // The pending command is not affected
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, TPM2_SignComplete(&g_tpm, &signature));
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_SignSubmit_while_pending_fail)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+
+        //act
+        TPM_RC result = submit_sign();
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, TPM2_SignComplete(&g_tpm, &signature));
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_FlushContext_sign_pending_fail)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+
+        //act
+        TPM_RC result = TPM2_FlushContext(&g_tpm, TEST_TRANSIENT_HANDLE);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, TPM2_SignComplete(&g_tpm, &signature));
+        ASSERT_ARE_EQUAL(int, TPM_ALG_HMAC, signature.sigAlg);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_SignComplete_not_submitted_fail)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+
+        //act
+        TPM_RC result = TPM2_SignComplete(&g_tpm, &signature);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_FAILURE, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_CreatePrimaryComplete_sign_pending_fail)
+    {
+        TPM_HANDLE object_handle;
+        TPM2B_PUBLIC out_public;
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+
+        //act
+        TPM_RC result = TPM2_CreatePrimaryComplete(&g_tpm, &object_handle, &out_public, NULL, NULL, NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_FAILURE, result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, TPM2_SignComplete(&g_tpm, &signature));
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_SignComplete_signature_NULL_fail)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+
+        //act
+        TPM_RC result = TPM2_SignComplete(&g_tpm, NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_FAILURE, result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, TPM2_SignComplete(&g_tpm, &signature));
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_SignComplete_context_released_succeed)
+    {
+        TPMT_SIGNATURE signature;
+
+        //arrange
+        Deinit_TPM_Codec(&g_tpm);
+        memset(&g_tpm, 0, sizeof(g_tpm));
+        g_tpm.CmdCtxPoolSize = 1;
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, Initialize_TPM_Codec(&g_tpm));
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, TPM2_SignComplete(&g_tpm, &signature));
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC submit_result = submit_sign();
+        TPM_RC complete_result = TPM2_SignComplete(&g_tpm, &signature);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_result);
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, complete_result);
+        // The only context of the pool is reused instead of allocating one
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(Deinit_TPM_Codec_command_pending_succeed)
+    {
+        //arrange
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, submit_sign());
+
+        //act
+        Deinit_TPM_Codec(&g_tpm);
+
+        //assert
+        ASSERT_IS_NULL(g_tpm.PendingCmdCtx);
+
+        //cleanup
+        memset(&g_tpm, 0, sizeof(g_tpm));
+        ASSERT_ARE_EQUAL(int, TPM_RC_SUCCESS, Initialize_TPM_Codec(&g_tpm));
+    }
+
+END_TEST_SUITE(tpm_codec_loopback_ut)
@@ -39,6 +39,8 @@ static void* my_gballoc_realloc(void* ptr, size_t size)
 #include "umock_c/umock_c_prod.h"
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_utpm_c/tpm_comm.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_utpm_c/tpm_dispatcher.h"
 #include "azure_utpm_c/TpmTypes.h"
 #include "azure_utpm_c/Memory_fp.h"
 #include "azure_utpm_c/Marshal_fp.h"
@@ -56,6 +58,8 @@ extern "C"
 
 #define TEST_COMM_HANDLE        (TPM_COMM_HANDLE)0x123456
 #define TEST_TPMI_DH_OBJECT     (TPMI_DH_OBJECT)0x223456
+#define TEST_DISPATCHER_HANDLE  (TPM_DISPATCHER_HANDLE)0x323456
+#define TEST_LOCK_HANDLE        (LOCK_HANDLE)0x423456
 
 static const UINT32 TPM_20_HANDLE = HR_PERSISTENT | 0x00010001;
 
@@ -112,6 +116,9 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
 
         REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_HANDLE, void*);
         REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_TYPE, int);
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_DISPATCHER_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(LOCK_RESULT, int);
         REGISTER_UMOCK_ALIAS_TYPE(BOOL, int);
         REGISTER_UMOCK_ALIAS_TYPE(TPM_RC, uint32_t);
 
@@ -190,7 +197,7 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
         STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(TPMT_TK_AUTH_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMT_TK_Skip(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     }
 
     static void setup_tss_start_auth_session_mocks(void)
@@ -232,6 +239,84 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
             .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
     }
 
+    static void setup_create_key_batch_mocks(void)
+    {
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = TPM_RC_SUCCESS;
+        TPMI_ST_COMMAND_TAG tag = TPM_ST_NO_SESSIONS;
+        TPM_HANDLE obj_handle = TRANSIENT_FIRST;
+
+        // TPM2_CreatePrimary
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, NULL, NULL));
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Marshal(IGNORED_PTR_ARG, NULL, NULL));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_DATA_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPML_PCR_SELECTION_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&tag, sizeof(tag));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&obj_handle, sizeof(obj_handle));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+        // TPM2_EvictControl of the returned handle
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+
+        // TPM2_FlushContext of the returned handle
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+    }
+
+    static void setup_get_capability_more_mocks(TPMS_CAPABILITY_DATA* cap_data, TPMI_YES_NO more)
+    {
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+        STRICT_EXPECTED_CALL(TPMI_YES_NO_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&more, sizeof(more));
+        STRICT_EXPECTED_CALL(TPMS_CAPABILITY_DATA_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(cap_data, sizeof(*cap_data));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    }
+
+    static void setup_get_capability_mocks(TPMS_CAPABILITY_DATA* cap_data)
+    {
+        setup_get_capability_more_mocks(cap_data, NO);
+    }
+
     TEST_FUNCTION(TSS_CreatePwAuthSession_auth_value_NULL_fail)
     {
         //arrange
@@ -298,6 +383,24 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         //cleanup
     }
 
+    TEST_FUNCTION(Initialize_TPM_Codec_pool_size_too_big_fail)
+    {
+        //arrange
+        TSS_DEVICE tpm_device = { 0 };
+        tpm_device.CmdCtxPoolSize = TSS_MAX_CMD_CTX_POOL_SIZE + 1;
+
+        //act
+        TPM_RC result = Initialize_TPM_Codec(&tpm_device);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_VALUE, result);
+        ASSERT_IS_NULL(tpm_device.tpm_comm_handle);
+        ASSERT_IS_NULL(tpm_device.CmdCtxPool);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
     TEST_FUNCTION(Initialize_TPM_Codec_emulator_succeed)
     {
         //arrange
@@ -306,6 +409,7 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         uint32_t raw_resp = 4096;
 
         STRICT_EXPECTED_CALL(tpm_comm_create(IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
         STRICT_EXPECTED_CALL(tpm_comm_get_type(IGNORED_PTR_ARG)).SetReturn(TPM_COMM_TYPE_EMULATOR);
         STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
@@ -375,6 +479,7 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         uint32_t raw_resp = 4096;
 
         STRICT_EXPECTED_CALL(tpm_comm_create(IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
         STRICT_EXPECTED_CALL(tpm_comm_get_type(IGNORED_PTR_ARG)).SetReturn(TPM_COMM_TYPE_EMULATOR);
         STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
@@ -391,6 +496,7 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         umock_c_reset_all_calls();
 
         STRICT_EXPECTED_CALL(tpm_comm_destroy(IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
         //act
         Deinit_TPM_Codec(&tpm_device);
@@ -414,127 +520,99 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_create_persistent_key_success)
+    TEST_FUNCTION(TSS_SetCmdContextPoolSize_tss_device_NULL_fail)
     {
         //arrange
-        TSS_SESSION session = { 0 };
-        TSS_DEVICE tss_dev = { 0 };
-        TPM_HANDLE request_handle = TPM_20_HANDLE;
-        TPMI_DH_OBJECT hierarchy = TPM_RH_ENDORSEMENT;
-        TPM2B_PUBLIC inPub = tpm_public_value;
-        TPM2B_PUBLIC outPub;
-
-        (void)Initialize_TPM_Codec(&tss_dev);
-        umock_c_reset_all_calls();
-
-        uint32_t expected_size = 4096;
-        uint32_t raw_resp = 4096;
-
-        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
-        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
-        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
         //act
-        TPM_HANDLE handle = TSS_CreatePersistentKey(&tss_dev, request_handle, &session, hierarchy, &inPub, &outPub);
+        TPM_RC result = TSS_SetCmdContextPoolSize(NULL, 4);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, 0, handle);
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
-        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TSS_StartAuthSession_tss_device_NULL_fail)
+    TEST_FUNCTION(TSS_SetCmdContextPoolSize_size_too_big_fail)
     {
         //arrange
-        TPMA_SESSION sess_attrib = { 1 };
-        TSS_SESSION session;
+        TSS_DEVICE tss_dev = { 0 };
 
         //act
-        TPM_RC result = TSS_StartAuthSession(NULL, TPM_SE_POLICY, TPM_ALG_SHA256, sess_attrib, &session);
+        TPM_RC result = TSS_SetCmdContextPoolSize(&tss_dev, TSS_MAX_CMD_CTX_POOL_SIZE + 1);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_VALUE, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_StartAuthSession_tss_session_NULL_fail)
+    TEST_FUNCTION(TSS_SetCmdContextPoolSize_dispatcher_running_fail)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TPMA_SESSION sess_attrib = { 1 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.Dispatcher = TEST_DISPATCHER_HANDLE;
 
         //act
-        TPM_RC result = TSS_StartAuthSession(&tss_dev, TPM_SE_POLICY, TPM_ALG_SHA256, sess_attrib, NULL);
+        TPM_RC result = TSS_SetCmdContextPoolSize(&tss_dev, 4);
 
         //assert
         ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, 0, tss_dev.CmdCtxPoolSize);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_StartAuthSession_succeed)
+    TEST_FUNCTION(TSS_SetCmdContextPoolSize_not_initialized_succeed)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TPMA_SESSION sess_attrib = { 1 };
-        TSS_SESSION session;
-
-        (void)Initialize_TPM_Codec(&tss_dev);
-        umock_c_reset_all_calls();
-
-        setup_tss_start_auth_session_mocks();
 
         //act
-        TPM_RC result = TSS_StartAuthSession(&tss_dev, TPM_SE_POLICY, TPM_ALG_SHA256, sess_attrib, &session);
+        TPM_RC result = TSS_SetCmdContextPoolSize(&tss_dev, 4);
 
         //assert
         ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, 4, tss_dev.CmdCtxPoolSize);
+        ASSERT_IS_NULL(tss_dev.CmdCtxPool);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
-        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TSS_PolicySecret_tss_sesssion_NULL_fail)
+    TEST_FUNCTION(TSS_SetCmdContextPoolSize_initialized_succeed)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
+
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
         //act
-        TPM_RC result = TSS_PolicySecret(&tss_dev, NULL, TPM_RH_ENDORSEMENT, &session, NULL, 0);
+        TPM_RC result = TSS_SetCmdContextPoolSize(&tss_dev, 4);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_NOT_NULL(tss_dev.CmdCtxPool);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
+        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TSS_PolicySecret_policy_sesssion_NULL_fail)
+    TEST_FUNCTION(TSS_StartDispatcher_tss_device_NULL_fail)
     {
         //arrange
-        TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
 
         //act
-        TPM_RC result = TSS_PolicySecret(&tss_dev, &session, TPM_RH_ENDORSEMENT, NULL, NULL, 0);
+        TPM_RC result = TSS_StartDispatcher(NULL);
 
         //assert
         ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
@@ -543,274 +621,1626 @@ BEGIN_TEST_SUITE(tpm_codec_ut)
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_PolicySecret_succeed)
+    TEST_FUNCTION(TSS_StartDispatcher_fixed_properties_fail)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session = { 0 };
-
-        (void)Initialize_TPM_Codec(&tss_dev);
-        umock_c_reset_all_calls();
+        TPMS_CAPABILITY_DATA cap_data = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        cap_data.capability = TPM_CAP_ALGS;
 
-        setup_tss_policy_secret_mocks();
+        setup_get_capability_mocks(&cap_data);
 
         //act
-        TPM_RC result = TSS_PolicySecret(&tss_dev, &session, TPM_RH_ENDORSEMENT, &session, NULL, 0);
+        TPM_RC result = TSS_StartDispatcher(&tss_dev);
 
         //assert
-        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_FALSE(tss_dev.FixedPropsValid);
+        ASSERT_IS_NULL(tss_dev.Dispatcher);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
-        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TPM2_ReadPublic_tss_device_NULL_fail)
+    TEST_FUNCTION(TSS_StartDispatcher_lock_fail)
     {
         //arrange
-        TPM_HANDLE request_handle = HR_PERSISTENT;
-        TPM2B_PUBLIC tpm_public;
-        TPM2B_NAME tpm_name;
-        TPM2B_NAME qualified_name;
+        TSS_DEVICE tss_dev = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.FixedPropsValid = TRUE;
+
+        STRICT_EXPECTED_CALL(Lock_Init()).SetReturn(NULL);
 
         //act
-        TPM_RC result = TPM2_ReadPublic(NULL, request_handle, &tpm_public, &tpm_name, &qualified_name);
+        TPM_RC result = TSS_StartDispatcher(&tss_dev);
 
         //assert
         ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_NULL(tss_dev.Dispatcher);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TPM2_ReadPublic_tpm_public_NULL_fail)
+    TEST_FUNCTION(TSS_StartDispatcher_create_fail)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TPM_HANDLE request_handle = HR_PERSISTENT;
-        TPM2B_NAME tpm_name;
-        TPM2B_NAME qualified_name;
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.FixedPropsValid = TRUE;
+
+        STRICT_EXPECTED_CALL(Lock_Init()).SetReturn(TEST_LOCK_HANDLE);
+        STRICT_EXPECTED_CALL(tpm_dispatcher_create(TEST_COMM_HANDLE)).SetReturn(NULL);
+        STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
 
         //act
-        TPM_RC result = TPM2_ReadPublic(&tss_dev, request_handle, NULL, &tpm_name, &qualified_name);
+        TPM_RC result = TSS_StartDispatcher(&tss_dev);
 
         //assert
         ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_NULL(tss_dev.Dispatcher);
+        ASSERT_IS_NULL(tss_dev.VarPropsLock);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TPM2_ReadPublic_succeed)
+    TEST_FUNCTION(TSS_StartDispatcher_succeed)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TPM_HANDLE request_handle = HR_PERSISTENT;
-        TPM2B_PUBLIC tpm_public;
-        TPM2B_NAME tpm_name;
-        TPM2B_NAME qualified_name;
-
         tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.FixedPropsValid = TRUE;
 
-        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        setup_dispatch_cmd_mocks();
-        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(Lock_Init()).SetReturn(TEST_LOCK_HANDLE);
+        STRICT_EXPECTED_CALL(tpm_dispatcher_create(TEST_COMM_HANDLE)).SetReturn(TEST_DISPATCHER_HANDLE);
 
         //act
-        TPM_RC result = TPM2_ReadPublic(&tss_dev, request_handle, &tpm_public, &tpm_name, &qualified_name);
+        TPM_RC result = TSS_StartDispatcher(&tss_dev);
 
         //assert
         ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(void_ptr, TEST_DISPATCHER_HANDLE, tss_dev.Dispatcher);
+        ASSERT_ARE_EQUAL(void_ptr, TEST_LOCK_HANDLE, tss_dev.VarPropsLock);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_HMAC_tss_device_NULL_Fail)
+    TEST_FUNCTION(TSS_StartDispatcher_reads_fixed_properties_succeed)
     {
         //arrange
-        TSS_SESSION session;
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        BYTE bt_data[10];
-        UINT32 data_len = 10;
-        TPM2B_DIGEST hmac;
+        TSS_DEVICE tss_dev = { 0 };
+        TPMS_CAPABILITY_DATA cap_data = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        cap_data.capability = TPM_CAP_TPM_PROPERTIES;
+        cap_data.data.tpmProperties.count = 1;
+        cap_data.data.tpmProperties.tpmProperty[0].property = TPM_PT_INPUT_BUFFER;
+        cap_data.data.tpmProperties.tpmProperty[0].value = 1024;
 
+        setup_get_capability_mocks(&cap_data);
+        STRICT_EXPECTED_CALL(Lock_Init()).SetReturn(TEST_LOCK_HANDLE);
+        STRICT_EXPECTED_CALL(tpm_dispatcher_create(TEST_COMM_HANDLE)).SetReturn(TEST_DISPATCHER_HANDLE);
 
         //act
-        TPM_RC result = TSS_HMAC(NULL, &session, handle, bt_data, data_len, &hmac);
+        TPM_RC result = TSS_StartDispatcher(&tss_dev);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_TRUE(tss_dev.FixedPropsValid);
+        // Served from the cache without a TPM command
+        ASSERT_ARE_EQUAL(uint32_t, 1024, TSS_GetTpmProperty(&tss_dev, TPM_PT_INPUT_BUFFER));
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_HMAC_tss_session_NULL_Fail)
+    TEST_FUNCTION(TSS_StopDispatcher_succeed)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        BYTE bt_data[10];
-        UINT32 data_len = 10;
-        TPM2B_DIGEST hmac;
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.Dispatcher = TEST_DISPATCHER_HANDLE;
+        tss_dev.VarPropsLock = TEST_LOCK_HANDLE;
+
+        STRICT_EXPECTED_CALL(tpm_dispatcher_destroy(TEST_DISPATCHER_HANDLE));
+        STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
 
         //act
-        TPM_RC result = TSS_HMAC(&tss_dev, NULL, handle, bt_data, data_len, &hmac);
+        TSS_StopDispatcher(&tss_dev);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_NULL(tss_dev.Dispatcher);
+        ASSERT_IS_NULL(tss_dev.VarPropsLock);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_HMAC_data_byte_NULL_Fail)
+    TEST_FUNCTION(TPM2_ReadPublic_dispatcher_succeed)
     {
         //arrange
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        UINT32 data_len = 10;
-        TPM2B_DIGEST hmac;
+        TPM2B_PUBLIC outPublic;
+        TPM2B_NAME name;
+        TPM2B_NAME qualifiedName;
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = 4096;
 
         tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.Dispatcher = TEST_DISPATCHER_HANDLE;
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_dispatcher_execute(TEST_DISPATCHER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
         //act
-        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, NULL, data_len, &hmac);
+        TPM_RC result = TPM2_ReadPublic(&tss_dev, HR_PERSISTENT, &outPublic, &name, &qualifiedName);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
     }
 
-    TEST_FUNCTION(TSS_HMAC_outHMAC_NULL_Fail)
+    TEST_FUNCTION(TSS_create_persistent_key_success)
     {
         //arrange
+        TSS_SESSION session = { 0 };
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        BYTE bt_data[10];
-        UINT32 data_len = 10;
+        TPM_HANDLE request_handle = TPM_20_HANDLE;
+        TPMI_DH_OBJECT hierarchy = TPM_RH_ENDORSEMENT;
+        TPM2B_PUBLIC inPub = tpm_public_value;
+        TPM2B_PUBLIC outPub;
 
-        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
+
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = 4096;
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
         //act
-        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, bt_data, data_len, NULL);
+        TPM_HANDLE handle = TSS_CreatePersistentKey(&tss_dev, request_handle, &session, hierarchy, &inPub, &outPub);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_NOT_EQUAL(uint32_t, 0, handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
+        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TSS_HMAC_byte_len_too_big_Fail)
+    TEST_FUNCTION(TSS_create_persistent_key_create_succeed)
     {
         //arrange
+        TSS_SESSION session = { 0 };
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        BYTE bt_data[10];
-        UINT32 data_len = MAX_DIGEST_BUFFER + 1;
-        TPM2B_DIGEST hmac;
+        TPM_HANDLE request_handle = TPM_20_HANDLE;
+        TPMI_DH_OBJECT hierarchy = TPM_RH_ENDORSEMENT;
+        TPM2B_PUBLIC inPub = tpm_public_value;
+        TPM2B_PUBLIC outPub;
 
-        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
+
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = TPM_RC_HANDLE;
+
+        // TPM2_ReadPublic reports that the persistent key does not exist
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+        setup_create_key_batch_mocks();
 
         //act
-        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, bt_data, data_len, &hmac);
+        TPM_HANDLE handle = TSS_CreatePersistentKey(&tss_dev, request_handle, &session, hierarchy, &inPub, &outPub);
 
         //assert
-        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, request_handle, handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
+        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TSS_HMAC_succeed)
+    TEST_FUNCTION(TSS_create_persistent_key_public_exceeds_command_buffer_fail)
     {
         //arrange
+        TSS_SESSION session = { 0 };
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        BYTE bt_data[10];
-        UINT32 data_len = 10;
-        TPM2B_DIGEST hmac;
-
-        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        TPM_HANDLE request_handle = TPM_20_HANDLE;
+        TPMI_DH_OBJECT hierarchy = TPM_RH_ENDORSEMENT;
+        TPM2B_PUBLIC inPub = tpm_public_value;
+        TPM2B_PUBLIC outPub;
 
-        STRICT_EXPECTED_CALL(MemoryCopy(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
 
-        // TSS_MARSHAL_OPT2B
-        STRICT_EXPECTED_CALL(TPM2B_MAX_BUFFER_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = TPM_RC_HANDLE;
 
-        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        // TPM2_ReadPublic reports that the persistent key does not exist
         STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
 
-        STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        setup_dispatch_cmd_mocks();
-        STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        // The batched TPM2_CreatePrimary fails before anything is sent
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, NULL, NULL));
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Marshal(IGNORED_PTR_ARG, NULL, NULL))
+            .SetReturn(TSS_MAX_RESPONSE_SIZE);
 
         //act
-        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, bt_data, data_len, &hmac);
+        TPM_HANDLE handle = TSS_CreatePersistentKey(&tss_dev, request_handle, &session, hierarchy, &inPub, &outPub);
 
         //assert
-        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, 0, handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
+        Deinit_TPM_Codec(&tss_dev);
     }
 
-    TEST_FUNCTION(TPM2_HMAC_succeed)
+    TEST_FUNCTION(TSS_CreatePrimary_skips_discarded_outputs_succeed)
     {
         //arrange
+        TSS_SESSION session = { 0 };
         TSS_DEVICE tss_dev = { 0 };
-        TSS_SESSION session;
-        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
-        BYTE bt_data[10];
-        TPM2B_MAX_BUFFER dataBuf;
-        dataBuf.b.size = 10;
-        MemoryCopy(dataBuf.t.buffer, bt_data, 10);
-        TPM2B_DIGEST hmac;
-        umock_c_reset_all_calls();
-
-        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        TPM2B_PUBLIC inPub = tpm_public_value;
+        TPM2B_PUBLIC outPub;
+        TPM_HANDLE obj_handle;
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = TPM_RC_SUCCESS;
+        TPMI_ST_COMMAND_TAG tag = TPM_ST_NO_SESSIONS;
+        TPM_HANDLE ret_handle = TRANSIENT_FIRST;
 
-        STRICT_EXPECTED_CALL(TPM2B_MAX_BUFFER_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, NULL, NULL));
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Marshal(IGNORED_PTR_ARG, NULL, NULL));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_DATA_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPML_PCR_SELECTION_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-
         STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        setup_dispatch_cmd_mocks();
-        STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&tag, sizeof(tag));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&ret_handle, sizeof(ret_handle));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_CREATION_DATA_Skip(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_Skip(IGNORED_PTR_ARG, IGNORED_PTR_ARG, sizeof(TPMU_HA)));
+        STRICT_EXPECTED_CALL(TPMT_TK_Skip(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
         //act
-        TPM_RC result = TPM2_HMAC(&tss_dev, &session, handle, &dataBuf, TPM_ALG_NULL, &hmac);
+        TPM_RC result = TSS_CreatePrimary(&tss_dev, &session, TPM_RH_ENDORSEMENT, &inPub, &obj_handle, &outPub);
 
         //assert
-        //ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
-        (void)result;
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TRANSIENT_FIRST, obj_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        Deinit_TPM_Codec(&tss_dev);
+    }
+
+    TEST_FUNCTION(TSS_CreatePrimary_public_exceeds_command_buffer_fail)
+    {
+        //arrange
+        TSS_SESSION session = { 0 };
+        TSS_DEVICE tss_dev = { 0 };
+        TPM2B_PUBLIC inPub = tpm_public_value;
+        TPM2B_PUBLIC outPub;
+        TPM_HANDLE obj_handle;
+
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, NULL, NULL));
+        STRICT_EXPECTED_CALL(TPM2B_SENSITIVE_CREATE_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Marshal(IGNORED_PTR_ARG, NULL, NULL))
+            .SetReturn(TSS_MAX_RESPONSE_SIZE);
+
+        //act
+        TPM_RC result = TSS_CreatePrimary(&tss_dev, &session, TPM_RH_ENDORSEMENT, &inPub, &obj_handle, &outPub);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_COMMAND_SIZE, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        Deinit_TPM_Codec(&tss_dev);
+    }
+
+    TEST_FUNCTION(TSS_StartAuthSession_tss_device_NULL_fail)
+    {
+        //arrange
+        TPMA_SESSION sess_attrib = { 1 };
+        TSS_SESSION session;
+
+        //act
+        TPM_RC result = TSS_StartAuthSession(NULL, TPM_SE_POLICY, TPM_ALG_SHA256, sess_attrib, &session);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_StartAuthSession_tss_session_NULL_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMA_SESSION sess_attrib = { 1 };
+
+        //act
+        TPM_RC result = TSS_StartAuthSession(&tss_dev, TPM_SE_POLICY, TPM_ALG_SHA256, sess_attrib, NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_StartAuthSession_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMA_SESSION sess_attrib = { 1 };
+        TSS_SESSION session;
+
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
+
+        setup_tss_start_auth_session_mocks();
+
+        //act
+        TPM_RC result = TSS_StartAuthSession(&tss_dev, TPM_SE_POLICY, TPM_ALG_SHA256, sess_attrib, &session);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        Deinit_TPM_Codec(&tss_dev);
+    }
+
+    TEST_FUNCTION(TSS_PolicySecret_tss_sesssion_NULL_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+
+        //act
+        TPM_RC result = TSS_PolicySecret(&tss_dev, NULL, TPM_RH_ENDORSEMENT, &session, NULL, 0);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PolicySecret_policy_sesssion_NULL_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+
+        //act
+        TPM_RC result = TSS_PolicySecret(&tss_dev, &session, TPM_RH_ENDORSEMENT, NULL, NULL, 0);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PolicySecret_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session = { 0 };
+
+        (void)Initialize_TPM_Codec(&tss_dev);
+        umock_c_reset_all_calls();
+
+        setup_tss_policy_secret_mocks();
+
+        //act
+        TPM_RC result = TSS_PolicySecret(&tss_dev, &session, TPM_RH_ENDORSEMENT, &session, NULL, 0);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        Deinit_TPM_Codec(&tss_dev);
+    }
+
+    TEST_FUNCTION(TPM2_ReadPublic_tss_device_NULL_fail)
+    {
+        //arrange
+        TPM_HANDLE request_handle = HR_PERSISTENT;
+        TPM2B_PUBLIC tpm_public;
+        TPM2B_NAME tpm_name;
+        TPM2B_NAME qualified_name;
+
+        //act
+        TPM_RC result = TPM2_ReadPublic(NULL, request_handle, &tpm_public, &tpm_name, &qualified_name);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_ReadPublic_tpm_public_NULL_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPM_HANDLE request_handle = HR_PERSISTENT;
+        TPM2B_NAME tpm_name;
+        TPM2B_NAME qualified_name;
+
+        //act
+        TPM_RC result = TPM2_ReadPublic(&tss_dev, request_handle, NULL, &tpm_name, &qualified_name);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_ReadPublic_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPM_HANDLE request_handle = HR_PERSISTENT;
+        TPM2B_PUBLIC tpm_public;
+        TPM2B_NAME tpm_name;
+        TPM2B_NAME qualified_name;
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        // No command context pool, so the context is allocated per command
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+        STRICT_EXPECTED_CALL(TPM2B_PUBLIC_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPM2B_NAME_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TPM2_ReadPublic(&tss_dev, request_handle, &tpm_public, &tpm_name, &qualified_name);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_HMAC_tss_device_NULL_Fail)
+    {
+        //arrange
+        TSS_SESSION session;
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        BYTE bt_data[10];
+        UINT32 data_len = 10;
+        TPM2B_DIGEST hmac;
+
+
+        //act
+        TPM_RC result = TSS_HMAC(NULL, &session, handle, bt_data, data_len, &hmac);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_HMAC_tss_session_NULL_Fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        BYTE bt_data[10];
+        UINT32 data_len = 10;
+        TPM2B_DIGEST hmac;
+
+        //act
+        TPM_RC result = TSS_HMAC(&tss_dev, NULL, handle, bt_data, data_len, &hmac);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_HMAC_data_byte_NULL_Fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        UINT32 data_len = 10;
+        TPM2B_DIGEST hmac;
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        //act
+        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, NULL, data_len, &hmac);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_HMAC_outHMAC_NULL_Fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        BYTE bt_data[10];
+        UINT32 data_len = 10;
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        //act
+        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, bt_data, data_len, NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_HMAC_byte_len_too_big_Fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        BYTE bt_data[10];
+        UINT32 data_len = MAX_DIGEST_BUFFER + 1;
+        TPM2B_DIGEST hmac;
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        //act
+        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, bt_data, data_len, &hmac);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_ReadPublicView_resp_buffer_NULL_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_PUBLIC_VIEW tpm_public;
+        TSS_BYTES_VIEW tpm_name;
+        TSS_BYTES_VIEW qualified_name;
+
+        //act
+        TPM_RC result = TPM2_ReadPublicView(&tss_dev, HR_PERSISTENT, NULL, &tpm_public, &tpm_name, &qualified_name);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_ReadPublicView_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_RESP_BUFFER resp_buffer;
+        TSS_PUBLIC_VIEW tpm_public;
+        TSS_BYTES_VIEW tpm_name;
+        TSS_BYTES_VIEW qualified_name;
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+        // The public area and names are not unmarshaled, only their sizes
+        STRICT_EXPECTED_CALL(UINT16_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TPM2_ReadPublicView(&tss_dev, HR_PERSISTENT, &resp_buffer, &tpm_public, &tpm_name, &qualified_name);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_TRUE(tpm_public.Area.Ptr == resp_buffer.Buffer);
+        ASSERT_IS_TRUE(tpm_name.Ptr == resp_buffer.Buffer);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PublicViewGetType_view_NULL_fail)
+    {
+        //arrange
+        TPMI_ALG_PUBLIC type;
+
+        //act
+        TPM_RC result = TSS_PublicViewGetType(NULL, &type);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PublicViewGetUnique_rsa_succeed)
+    {
+        //arrange
+        BYTE public_area[64] = { 0 };
+        TSS_PUBLIC_VIEW view;
+        TSS_BYTES_VIEW unique;
+        TSS_BYTES_VIEW ecc_y;
+        TPMI_ALG_PUBLIC type = TPM_ALG_RSA;
+
+        view.Area.Ptr = public_area;
+        view.Area.Size = sizeof(public_area);
+
+        STRICT_EXPECTED_CALL(UINT16_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&type, sizeof(type));
+        STRICT_EXPECTED_CALL(UINT16_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMU_PUBLIC_PARMS_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, TPM_ALG_RSA));
+        STRICT_EXPECTED_CALL(UINT16_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TSS_PublicViewGetUnique(&view, &unique, &ecc_y);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_IS_TRUE(unique.Ptr == public_area + 8);
+        ASSERT_ARE_EQUAL(int, 0, ecc_y.Size);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_HMAC_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        BYTE bt_data[10];
+        UINT32 data_len = 10;
+        TPM2B_DIGEST hmac;
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        // TSS_MARSHAL_BYTES
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(BYTE_Array_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+        STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TSS_HMAC(&tss_dev, &session, handle, bt_data, data_len, &hmac);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2_HMAC_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session;
+        TPMI_DH_OBJECT handle = TEST_TPMI_DH_OBJECT;
+        BYTE bt_data[10];
+        TPM2B_MAX_BUFFER dataBuf;
+        dataBuf.b.size = 10;
+        MemoryCopy(dataBuf.t.buffer, bt_data, 10);
+        TPM2B_DIGEST hmac;
+        umock_c_reset_all_calls();
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(BYTE_Array_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+        STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TPM2_HMAC(&tss_dev, &session, handle, &dataBuf, TPM_ALG_NULL, &hmac);
+
+        //assert
+        //ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        (void)result;
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BuildCommandInPlace_params_NULL_fail)
+    {
+        //arrange
+        BYTE* cmd_start = NULL;
+        UINT32 cmd_size = 0;
+
+        //act
+        TPM_RC result = TSS_BuildCommandInPlace(TPM_CC_ReadPublic, NULL, 0, NULL, 0, NULL, 0, 64, &cmd_start, &cmd_size);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BuildCommandInPlace_reserved_size_too_small_fail)
+    {
+        //arrange
+        BYTE cmd_buffer[64];
+        BYTE* cmd_start = NULL;
+        UINT32 cmd_size = 0;
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+
+        //act
+        TPM_RC result = TSS_BuildCommandInPlace(TPM_CC_ReadPublic, &handle, 1, NULL, 0, cmd_buffer + 4, 0, 4, &cmd_start, &cmd_size);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BuildCommandInPlace_unassigned_command_fail)
+    {
+        //arrange
+        BYTE cmd_buffer[64];
+        BYTE* cmd_start = NULL;
+        UINT32 cmd_size = 0;
+
+        //act
+        TPM_RC result = TSS_BuildCommandInPlace((TPM_CC)0x00000123, NULL, 0, NULL, 0, cmd_buffer + 32, 0, 32, &cmd_start, &cmd_size);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BuildCommandInPlace_wrong_handle_count_fail)
+    {
+        //arrange
+        BYTE cmd_buffer[64];
+        BYTE* cmd_start = NULL;
+        UINT32 cmd_size = 0;
+        TPM_HANDLE handles[2] = { TEST_TPMI_DH_OBJECT, TEST_TPMI_DH_OBJECT };
+
+        //act
+        TPM_RC result = TSS_BuildCommandInPlace(TPM_CC_ReadPublic, handles, 2, NULL, 0, cmd_buffer + 32, 0, 32, &cmd_start, &cmd_size);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BuildCommandInPlace_missing_session_fail)
+    {
+        //arrange
+        BYTE cmd_buffer[64];
+        BYTE* cmd_start = NULL;
+        UINT32 cmd_size = 0;
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+
+        //act
+        TPM_RC result = TSS_BuildCommandInPlace(TPM_CC_HMAC, &handle, 1, NULL, 0, cmd_buffer + 32, 0, 32, &cmd_start, &cmd_size);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BuildCommandInPlace_succeed)
+    {
+        //arrange
+        BYTE cmd_buffer[64];
+        BYTE* cmd_start = NULL;
+        UINT32 cmd_size = 0;
+        TPM_HANDLE handle = HR_PERSISTENT;
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TSS_BuildCommandInPlace(TPM_CC_ReadPublic, &handle, 1, NULL, 0, cmd_buffer + 32, 16, 32, &cmd_start, &cmd_size);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(void_ptr, cmd_buffer + 32, cmd_start);
+        ASSERT_ARE_EQUAL(uint32_t, 16, cmd_size);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PrepareCommand_handles_NULL_fail)
+    {
+        //arrange
+        TSS_SESSION session;
+        TSS_SESSION* sessions[] = { &session };
+
+        //act
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, NULL, 1, sessions, 1);
+
+        //assert
+        ASSERT_IS_NULL(prepared_cmd);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PrepareCommand_succeed)
+    {
+        //arrange
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_SESSION session;
+        TSS_SESSION* sessions[] = { &session };
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMS_AUTH_COMMAND_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        //act
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+
+        //assert
+        ASSERT_IS_NOT_NULL(prepared_cmd);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_DestroyPreparedCommand_succeed)
+    {
+        //arrange
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_SESSION session;
+        TSS_SESSION* sessions[] = { &session };
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TSS_DestroyPreparedCommand(prepared_cmd);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMAC_prepared_cmd_NULL_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        BYTE bt_data[10] = { 0 };
+        TPM2B_DIGEST hmac;
+
+        //act
+        TPM_RC result = TSS_PreparedHMAC(&tss_dev, NULL, bt_data, sizeof(bt_data), &hmac);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMAC_wrong_command_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        BYTE bt_data[10] = { 0 };
+        TPM2B_DIGEST hmac;
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_ReadPublic, &handle, 1, NULL, 0);
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_PreparedHMAC(&tss_dev, prepared_cmd, bt_data, sizeof(bt_data), &hmac);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMAC_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        BYTE bt_data[10] = { 0 };
+        TPM2B_DIGEST hmac;
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_SESSION session;
+        TSS_SESSION* sessions[] = { &session };
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+        umock_c_reset_all_calls();
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        // TSS_MARSHAL_BYTES
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(BYTE_Array_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        // Command size patched into the prepared header
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        setup_dispatch_cmd_mocks();
+        STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TSS_PreparedHMAC(&tss_dev, prepared_cmd, bt_data, sizeof(bt_data), &hmac);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMACSubmit_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        BYTE bt_data[10] = { 0 };
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_SESSION session;
+        TSS_SESSION* sessions[] = { &session };
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+        umock_c_reset_all_calls();
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(BYTE_Array_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command_async(TEST_COMM_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+        //act
+        TPM_RC result = TSS_PreparedHMACSubmit(&tss_dev, prepared_cmd, bt_data, sizeof(bt_data));
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMACSubmit_submit_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        BYTE bt_data[10] = { 0 };
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_SESSION session = { 0 };
+        TSS_SESSION* sessions[] = { &session };
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+        umock_c_reset_all_calls();
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(BYTE_Array_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command_async(TEST_COMM_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG)).SetReturn(__LINE__);
+
+        //act
+        TPM_RC result = TSS_PreparedHMACSubmit(&tss_dev, prepared_cmd, bt_data, sizeof(bt_data));
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMACComplete_pending_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPM2B_DIGEST hmac;
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        TSS_SESSION session = { 0 };
+        TSS_SESSION* sessions[] = { &session };
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+        umock_c_reset_all_calls();
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(tpm_comm_complete_command(TEST_COMM_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG)).SetReturn(TPM_COMM_PENDING);
+
+        //act
+        TPM_RC result = TSS_PreparedHMACComplete(&tss_dev, prepared_cmd, &hmac);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TSS_E_TPM_PENDING, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_PreparedHMACComplete_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPM2B_DIGEST hmac;
+        TPM_HANDLE handle = TEST_TPMI_DH_OBJECT;
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = 4096;
+        TSS_SESSION session = { 0 };
+        TSS_SESSION* sessions[] = { &session };
+        TSS_PREPARED_CMD_HANDLE prepared_cmd = TSS_PrepareCommand(TPM_CC_HMAC, &handle, 1, sessions, 1);
+        umock_c_reset_all_calls();
+
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(tpm_comm_complete_command(TEST_COMM_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+        STRICT_EXPECTED_CALL(TPM2B_DIGEST_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+        //act
+        TPM_RC result = TSS_PreparedHMACComplete(&tss_dev, prepared_cmd, &hmac);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyPreparedCommand(prepared_cmd);
+    }
+
+    TEST_FUNCTION(TSS_GetPollFd_tss_device_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int result = TSS_GetPollFd(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, -1, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_GetPollFd_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+
+        STRICT_EXPECTED_CALL(tpm_comm_get_poll_fd(TEST_COMM_HANDLE)).SetReturn(11);
+
+        //act
+        int result = TSS_GetPollFd(&tss_dev);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 11, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_CreateBatch_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        //act
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+
+        //assert
+        ASSERT_IS_NOT_NULL(batch);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_DestroyBatch_succeed)
+    {
+        //arrange
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TSS_DestroyBatch(batch);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_BatchFlushContext_forward_step_handle_fail)
+    {
+        //arrange
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_BatchFlushContext(batch, TSS_BATCH_STEP_HANDLE(0));
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_BatchFlushContext_step_without_handle_fail)
+    {
+        //arrange
+        TPM2B_PUBLIC outPub;
+        TPM2B_NAME name;
+        TPM2B_NAME qName;
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        (void)TSS_BatchReadPublic(batch, TPM_20_HANDLE, &outPub, &name, &qName);
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_BatchFlushContext(batch, TSS_BATCH_STEP_HANDLE(0));
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_BatchFlushContext_created_step_handle_succeed)
+    {
+        //arrange
+        TSS_SESSION session = { 0 };
+        TPM2B_PUBLIC inPub = { 0 };
+        TPM2B_PUBLIC outPub;
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        (void)TSS_BatchCreatePrimary(batch, &session, TPM_RH_ENDORSEMENT, &inPub, &outPub);
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_BatchFlushContext(batch, TSS_BATCH_STEP_HANDLE(0));
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_BatchFlushContext_batch_full_fail)
+    {
+        //arrange
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        for (int index = 0; index < TSS_MAX_BATCH_STEPS; index++)
+        {
+            (void)TSS_BatchFlushContext(batch, TEST_TPMI_DH_OBJECT);
+        }
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_BatchFlushContext(batch, TEST_TPMI_DH_OBJECT);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_ExecuteBatch_tss_device_NULL_fail)
+    {
+        //arrange
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_ExecuteBatch(NULL, batch);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_ExecuteBatch_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TSS_SESSION session = { 0 };
+        TPM2B_PUBLIC inPub = tpm_public_value;
+        TPM2B_PUBLIC outPub;
+        TPM_HANDLE ret_handle;
+        TSS_BATCH_HANDLE batch;
+
+        (void)Initialize_TPM_Codec(&tss_dev);
+        batch = TSS_CreateBatch();
+        (void)TSS_BatchCreatePrimary(batch, &session, TPM_RH_ENDORSEMENT, &inPub, &outPub);
+        (void)TSS_BatchEvictControl(batch, &session, TPM_RH_OWNER, TSS_BATCH_STEP_HANDLE(0), TPM_20_HANDLE);
+        (void)TSS_BatchFlushContext(batch, TSS_BATCH_STEP_HANDLE(0));
+        umock_c_reset_all_calls();
+
+        setup_create_key_batch_mocks();
+
+        //act
+        TPM_RC result = TSS_ExecuteBatch(&tss_dev, batch);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, TSS_GetBatchStepResult(batch, 0, &ret_handle));
+        ASSERT_ARE_EQUAL(uint32_t, TRANSIENT_FIRST, ret_handle);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, TSS_GetBatchStepResult(batch, 2, NULL));
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+        Deinit_TPM_Codec(&tss_dev);
+    }
+
+    TEST_FUNCTION(TSS_ExecuteBatch_stops_at_first_error)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPM2B_PUBLIC outPub;
+        TPM2B_NAME name;
+        TPM2B_NAME qName;
+        TSS_BATCH_HANDLE batch;
+
+        (void)Initialize_TPM_Codec(&tss_dev);
+        batch = TSS_CreateBatch();
+        (void)TSS_BatchReadPublic(batch, TPM_20_HANDLE, &outPub, &name, &qName);
+        (void)TSS_BatchFlushContext(batch, TEST_TPMI_DH_OBJECT);
+        umock_c_reset_all_calls();
+
+        uint32_t expected_size = 4096;
+        uint32_t raw_resp = TPM_RC_HANDLE;
+
+        STRICT_EXPECTED_CALL(UINT16_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Marshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(TPMI_ST_COMMAND_TAG_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&expected_size, sizeof(expected_size));
+        STRICT_EXPECTED_CALL(UINT32_Unmarshal(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .CopyOutArgumentBuffer_target(&raw_resp, sizeof(raw_resp));
+
+        //act
+        TPM_RC result = TSS_ExecuteBatch(&tss_dev, batch);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_HANDLE, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_HANDLE, TSS_GetBatchStepResult(batch, 0, NULL));
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_NOT_USED, TSS_GetBatchStepResult(batch, 1, NULL));
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+        Deinit_TPM_Codec(&tss_dev);
+    }
+
+    TEST_FUNCTION(TSS_GetBatchStepResult_step_out_of_range_fail)
+    {
+        //arrange
+        TSS_BATCH_HANDLE batch = TSS_CreateBatch();
+        (void)TSS_BatchFlushContext(batch, TEST_TPMI_DH_OBJECT);
+        umock_c_reset_all_calls();
+
+        //act
+        TPM_RC result = TSS_GetBatchStepResult(batch, 1, NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_FAILURE, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        TSS_DestroyBatch(batch);
+    }
+
+    TEST_FUNCTION(TSS_GetTpmProperty_tss_device_NULL_fail)
+    {
+        //arrange
+
+        //act
+        UINT32 result = TSS_GetTpmProperty(NULL, TPM_PT_INPUT_BUFFER);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, (UINT32)-1, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_GetTpmProperty_fixed_property_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMS_CAPABILITY_DATA cap_data = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        cap_data.capability = TPM_CAP_TPM_PROPERTIES;
+        cap_data.data.tpmProperties.count = 2;
+        cap_data.data.tpmProperties.tpmProperty[0].property = TPM_PT_INPUT_BUFFER;
+        cap_data.data.tpmProperties.tpmProperty[0].value = 1024;
+        cap_data.data.tpmProperties.tpmProperty[1].property = TPM_PT_HR_TRANSIENT_MIN;
+        cap_data.data.tpmProperties.tpmProperty[1].value = 3;
+
+        setup_get_capability_mocks(&cap_data);
+
+        //act
+        UINT32 input_buffer = TSS_GetTpmProperty(&tss_dev, TPM_PT_INPUT_BUFFER);
+        UINT32 transient_min = TSS_GetTpmProperty(&tss_dev, TPM_PT_HR_TRANSIENT_MIN);
+        UINT32 revision = TSS_GetTpmProperty(&tss_dev, TPM_PT_REVISION);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, 1024, input_buffer);
+        ASSERT_ARE_EQUAL(uint32_t, 3, transient_min);
+        ASSERT_ARE_EQUAL(uint32_t, (UINT32)-1, revision);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_GetTpmProperty_more_data_no_progress_fail)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMS_CAPABILITY_DATA cap_data = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        cap_data.capability = TPM_CAP_TPM_PROPERTIES;
+        cap_data.data.tpmProperties.count = 1;
+        cap_data.data.tpmProperties.tpmProperty[0].property = PT_FIXED - 1;
+        cap_data.data.tpmProperties.tpmProperty[0].value = 1;
+
+        // More data is reported, but the next start would not advance
+        setup_get_capability_more_mocks(&cap_data, YES);
+
+        //act
+        UINT32 result = TSS_GetTpmProperty(&tss_dev, TPM_PT_INPUT_BUFFER);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, (UINT32)-1, result);
+        ASSERT_IS_FALSE(tss_dev.FixedPropsValid);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_RefreshTpmProperties_tss_device_NULL_fail)
+    {
+        //arrange
+
+        //act
+        TPM_RC result = TSS_RefreshTpmProperties(NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_RefreshTpmProperties_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMS_CAPABILITY_DATA cap_data = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        cap_data.capability = TPM_CAP_TPM_PROPERTIES;
+        cap_data.data.tpmProperties.count = 1;
+        cap_data.data.tpmProperties.tpmProperty[0].property = TPM_PT_LOCKOUT_COUNTER;
+        cap_data.data.tpmProperties.tpmProperty[0].value = 1;
+        setup_get_capability_mocks(&cap_data);
+        cap_data.data.tpmProperties.tpmProperty[0].value = 2;
+        setup_get_capability_mocks(&cap_data);
+
+        //act
+        UINT32 before = TSS_GetTpmProperty(&tss_dev, TPM_PT_LOCKOUT_COUNTER);
+        TPM_RC result = TSS_RefreshTpmProperties(&tss_dev);
+        UINT32 after = TSS_GetTpmProperty(&tss_dev, TPM_PT_LOCKOUT_COUNTER);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, 1, before);
+        ASSERT_ARE_EQUAL(uint32_t, 2, after);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TSS_RefreshTpmProperties_locked_succeed)
+    {
+        //arrange
+        TSS_DEVICE tss_dev = { 0 };
+        TPMS_CAPABILITY_DATA cap_data = { 0 };
+        tss_dev.tpm_comm_handle = TEST_COMM_HANDLE;
+        tss_dev.VarPropsLock = TEST_LOCK_HANDLE;
+        cap_data.capability = TPM_CAP_TPM_PROPERTIES;
+        cap_data.data.tpmProperties.count = 1;
+        cap_data.data.tpmProperties.tpmProperty[0].property = TPM_PT_LOCKOUT_COUNTER;
+        cap_data.data.tpmProperties.tpmProperty[0].value = 3;
+
+        // The TPM is queried before the cache is locked
+        setup_get_capability_mocks(&cap_data);
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+        //act
+        TPM_RC result = TSS_RefreshTpmProperties(&tss_dev);
+        UINT32 value = TSS_GetTpmProperty(&tss_dev, TPM_PT_LOCKOUT_COUNTER);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, 3, value);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         //cleanup
@@ -55,6 +55,7 @@ static void* my_gballoc_realloc(void* ptr, size_t size)
 
 static htonl_type g_htonl_value = 1;
 static const char* const TEST_SOCKET_ENDPOINT = "127.0.0.1";
+#define TEST_UNIX_ENDPOINT      "unix:/run/tpm/sim.sock"
 
 #ifdef WIN32
 MOCK_FUNCTION_WITH_CODE(WSAAPI, htonl_type, htonl, htonl_type, hostlong)
@@ -154,6 +155,8 @@ BEGIN_TEST_SUITE(tpm_comm_emulator_ut)
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_read, __LINE__);
         REGISTER_GLOBAL_MOCK_RETURN(tpm_socket_send, 0);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_send, __LINE__);
+        REGISTER_GLOBAL_MOCK_RETURN(tpm_socket_send_vector, 0);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_send_vector, __LINE__);
 }
 
     TEST_SUITE_CLEANUP(suite_cleanup)
@@ -205,24 +208,34 @@ BEGIN_TEST_SUITE(tpm_comm_emulator_ut)
         STRICT_EXPECTED_CALL(htonl(IGNORED_NUM_ARG));
     }
 
-    static void setup_comm_create_mocks(void)
+    static void setup_simulator_handshake_mocks(void)
     {
         htonl_type client_ver = 1;
         htonl_type unused = 0;
 
-        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-
-        STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(tpm_socket_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
         setup_socket_send_mocks();
         setup_socket_send_mocks();
 
         setup_socket_read_mocks(&client_ver);
         setup_socket_read_mocks(&unused);
         setup_socket_read_mocks(&unused);
+    }
+
+    static void setup_simulator_setup_mocks(const char* platform_address)
+    {
+        htonl_type unused = 0;
+
+        setup_simulator_handshake_mocks();
 
         // Power on simulator
-        STRICT_EXPECTED_CALL(tpm_socket_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        if (platform_address != NULL)
+        {
+            STRICT_EXPECTED_CALL(tpm_socket_create(platform_address, IGNORED_NUM_ARG));
+        }
+        else
+        {
+            STRICT_EXPECTED_CALL(tpm_socket_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        }
         STRICT_EXPECTED_CALL(htonl(IGNORED_NUM_ARG));
         STRICT_EXPECTED_CALL(htonl(IGNORED_NUM_ARG));
 
@@ -235,15 +248,23 @@ BEGIN_TEST_SUITE(tpm_comm_emulator_ut)
         STRICT_EXPECTED_CALL(tpm_socket_destroy(IGNORED_PTR_ARG));
     }
 
+    static void setup_comm_create_mocks(void)
+    {
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        setup_simulator_setup_mocks(NULL);
+    }
+
     static void setup_tpm_comm_submit_command_mocks(void)
     {
         htonl_type resp_len = RECV_DATA_LEN;
         htonl_type ack_cmd = 0;
 
-        setup_socket_send_mocks();
-        STRICT_EXPECTED_CALL(tpm_socket_send(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-        setup_socket_send_mocks();
-        STRICT_EXPECTED_CALL(tpm_socket_send(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(htonl(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(htonl(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_send_vector(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 4));
         setup_socket_read_mocks(&resp_len);
         STRICT_EXPECTED_CALL(tpm_socket_read(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
         setup_socket_read_mocks(&ack_cmd);
@@ -266,6 +287,61 @@ BEGIN_TEST_SUITE(tpm_comm_emulator_ut)
         tpm_comm_destroy(tpm_handle);
     }
 
+    TEST_FUNCTION(tpm_comm_create_unix_endpoint_no_power_on_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_create(TEST_UNIX_ENDPOINT, IGNORED_NUM_ARG));
+        setup_simulator_handshake_mocks();
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_UNIX_ENDPOINT);
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_unix_endpoint_platform_path_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_create(TEST_UNIX_ENDPOINT, IGNORED_NUM_ARG));
+        setup_simulator_setup_mocks("unix:/run/tpm/platform.sock");
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_UNIX_ENDPOINT ",/run/tpm/platform.sock");
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_unix_endpoint_empty_platform_path_fail)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_UNIX_ENDPOINT ",");
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
     TEST_FUNCTION(tpm_comm_create_fail)
     {
         int negativeTestsInitResult = umock_c_negative_tests_init();
@@ -314,6 +390,7 @@ BEGIN_TEST_SUITE(tpm_comm_emulator_ut)
         STRICT_EXPECTED_CALL(tpm_socket_destroy(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
         //act
         tpm_comm_destroy(tpm_handle);
@@ -397,7 +474,7 @@ BEGIN_TEST_SUITE(tpm_comm_emulator_ut)
 
         umock_c_negative_tests_snapshot();
 
-        size_t calls_cannot_fail[] = { 0, 3, 7, 10 };
+        size_t calls_cannot_fail[] = { 0, 1, 4, 7 };
 
         //act
         size_t count = umock_c_negative_tests_call_count();
@@ -148,6 +148,8 @@ BEGIN_TEST_SUITE(tpm_comm_linux_ut)
         REGISTER_GLOBAL_MOCK_RETURN(gbfiledesc_access, 0);
         REGISTER_GLOBAL_MOCK_RETURN(gbfiledesc_write, 0);
         REGISTER_GLOBAL_MOCK_RETURN(gbfiledesc_read, 0);
+        REGISTER_GLOBAL_MOCK_RETURN(gbfiledesc_fcntl, 0);
+        REGISTER_GLOBAL_MOCK_RETURN(gbfiledesc_poll, 1);
 
         REGISTER_GLOBAL_MOCK_HOOK(tpm_socket_create, my_tpm_socket_create);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_create, NULL);
@@ -156,6 +158,8 @@ BEGIN_TEST_SUITE(tpm_comm_linux_ut)
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_read, __LINE__);
         REGISTER_GLOBAL_MOCK_RETURN(tpm_socket_send, 0);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_send, __LINE__);
+        REGISTER_GLOBAL_MOCK_RETURN(tpm_socket_send_vector, 0);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_socket_send_vector, __LINE__);
     }
 
     TEST_SUITE_CLEANUP(suite_cleanup)
@@ -367,6 +371,140 @@ BEGIN_TEST_SUITE(tpm_comm_linux_ut)
         tpm_comm_destroy(tpm_handle);
     }
 
+    TEST_FUNCTION(tpm_comm_create_device_endpoint_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gbfiledesc_open("/dev/tpm0", IGNORED_NUM_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("device:/dev/tpm0");
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_device_endpoint_fail)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gbfiledesc_open("/dev/tpmrm0", IGNORED_NUM_ARG)).SetReturn(-1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("device:/dev/tpmrm0");
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_create_tcti_endpoint_loads_library_only)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(dlopen("libtss2-tcti-device.so", IGNORED_NUM_ARG)).SetReturn(NULL);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("tcti:device:/dev/tpm0");
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_create_mssim_endpoint_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_create("127.0.0.1", 2321));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("mssim:127.0.0.1");
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_mssim_endpoint_port_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_create("10.0.0.2", 2400));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("mssim:10.0.0.2:2400");
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_mssim_endpoint_invalid_port_fail)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("mssim:127.0.0.1:70000");
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_create_unix_endpoint_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(tpm_socket_create("unix:/run/swtpm/sock", IGNORED_NUM_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("unix:/run/swtpm/sock");
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_unsupported_endpoint_fail)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create("http://127.0.0.1");
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
     TEST_FUNCTION(tpm_comm_destroy_succeed)
     {
         //arrange
@@ -455,6 +593,155 @@ BEGIN_TEST_SUITE(tpm_comm_linux_ut)
         tpm_comm_destroy(tpm_handle);
     }
 
+    TEST_FUNCTION(tpm_comm_submit_command_async_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int tpm_result = tpm_comm_submit_command_async(NULL, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, tpm_result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gbfiledesc_fcntl(TEST_FD_VALUE, IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gbfiledesc_fcntl(TEST_FD_VALUE, IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(gbfiledesc_write(TEST_FD_VALUE, IGNORED_PTR_ARG, IGNORED_NUM_ARG)).SetReturn(TEMP_CMD_LENGTH);
+
+        //act
+        int tpm_result = tpm_comm_submit_command_async(tpm_handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, tpm_result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_already_pending_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        STRICT_EXPECTED_CALL(gbfiledesc_write(TEST_FD_VALUE, IGNORED_PTR_ARG, IGNORED_NUM_ARG)).SetReturn(TEMP_CMD_LENGTH);
+        (void)tpm_comm_submit_command_async(tpm_handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH);
+        umock_c_reset_all_calls();
+
+        //act
+        int tpm_result = tpm_comm_submit_command_async(tpm_handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, tpm_result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_pending_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        STRICT_EXPECTED_CALL(gbfiledesc_write(TEST_FD_VALUE, IGNORED_PTR_ARG, IGNORED_NUM_ARG)).SetReturn(TEMP_CMD_LENGTH);
+        (void)tpm_comm_submit_command_async(tpm_handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH);
+        umock_c_reset_all_calls();
+
+        //act
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        int tpm_result = tpm_comm_submit_command(tpm_handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, tpm_result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_complete_command_not_pending_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        int tpm_result = tpm_comm_complete_command(tpm_handle, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, tpm_result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_complete_command_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        STRICT_EXPECTED_CALL(gbfiledesc_write(TEST_FD_VALUE, IGNORED_PTR_ARG, IGNORED_NUM_ARG)).SetReturn(TEMP_CMD_LENGTH);
+        (void)tpm_comm_submit_command_async(tpm_handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gbfiledesc_read(TEST_FD_VALUE, IGNORED_PTR_ARG, IGNORED_NUM_ARG)).SetReturn(TEMP_CMD_LENGTH);
+
+        //act
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        int tpm_result = tpm_comm_complete_command(tpm_handle, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, tpm_result);
+        ASSERT_ARE_EQUAL(uint32_t, TEMP_CMD_LENGTH, resp_len);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_get_poll_fd_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int poll_fd = tpm_comm_get_poll_fd(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, -1, poll_fd);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_get_poll_fd_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int poll_fd = tpm_comm_get_poll_fd(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TEST_FD_VALUE, poll_fd);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
     /*TEST_FUNCTION(tpm_comm_submit_command_succees)
     {
         //arrange
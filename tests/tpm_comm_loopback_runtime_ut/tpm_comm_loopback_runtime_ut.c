@@ -0,0 +1,269 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_stdint.h"
+#include "umock_c/umock_c_negative_tests.h"
+#include "azure_macro_utils/macro_utils.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "umock_c/umock_c_prod.h"
+#undef ENABLE_MOCKS
+
+#include "azure_utpm_c/tpm_comm.h"
+#include "azure_utpm_c/tpm_comm_loopback.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_RESPONSE_SIZE      4096
+#define TEST_OTHER_FIELD_VALUE  0x5A5A5A5A
+
+// TPM2_HMAC(0x81000100, 4 bytes, TPM_ALG_SHA256) with a password session
+static const unsigned char TEST_HMAC_CMD[] =
+{
+    0x80, 0x02, 0x00, 0x00, 0x00, 0x23, 0x00, 0x00, 0x01, 0x55,
+    0x81, 0x00, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x04, 0xAA, 0xBB, 0xCC, 0xDD, 0x00, 0x0B
+};
+
+// Handle of another backend, as laid out by the backends of the library. It is
+// larger than the handle of the loopback backend, so that reading it as one is seen
+typedef struct TEST_OTHER_COMM_INFO_TAG
+{
+    TPM_COMM_OPS_MEMBER
+    uint32_t fields[256];
+} TEST_OTHER_COMM_INFO;
+
+static const TPM_COMM_OPS TEST_OTHER_OPS =
+{
+    "other", NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+static TEST_OTHER_COMM_INFO g_other_comm_info;
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%s", MU_ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+}
+
+// Creates the handle the way tpm_comm_create_with_backend() does
+static TPM_COMM_HANDLE create_loopback_handle(void)
+{
+    const TPM_COMM_OPS* ops = tpm_comm_loopback_get_ops();
+    TPM_COMM_HANDLE result = ops->create(NULL);
+    if (result != NULL)
+    {
+        *(const TPM_COMM_OPS**)result = ops;
+    }
+    return result;
+}
+
+static TPM_COMM_HANDLE get_other_handle(void)
+{
+    size_t index;
+    g_other_comm_info.ops = &TEST_OTHER_OPS;
+    for (index = 0; index < sizeof(g_other_comm_info.fields) / sizeof(g_other_comm_info.fields[0]); index++)
+    {
+        g_other_comm_info.fields[index] = TEST_OTHER_FIELD_VALUE;
+    }
+    return (TPM_COMM_HANDLE)&g_other_comm_info;
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(tpm_comm_loopback_runtime_ut)
+
+    TEST_SUITE_INITIALIZE(suite_init)
+    {
+        int result;
+
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        (void)umock_c_init(on_umock_c_error);
+
+        result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        result = umocktypes_stdint_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_HANDLE, void*);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(suite_cleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+    }
+
+    TEST_FUNCTION_INITIALIZE(method_init)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Could not acquire test serialization mutex.");
+        }
+        umock_c_reset_all_calls();
+    }
+
+    TEST_FUNCTION_CLEANUP(method_cleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_latency_loopback_handle_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = create_loopback_handle();
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_loopback_set_latency(tpm_handle, 10);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(int, 0, tpm_comm_loopback_get_ops()->submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length));
+        ASSERT_ARE_EQUAL(uint32_t, 1, tpm_comm_loopback_get_command_count(tpm_handle));
+        ASSERT_ARE_EQUAL(uint64_t, (uint64_t)(sizeof(TEST_HMAC_CMD) + length), tpm_comm_loopback_get_byte_count(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_loopback_get_ops()->destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_responder_other_backend_fail)
+    {
+        size_t index;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = get_other_handle();
+
+        //act
+        int result = tpm_comm_loopback_set_responder(tpm_handle, NULL, NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        for (index = 0; index < sizeof(g_other_comm_info.fields) / sizeof(g_other_comm_info.fields[0]); index++)
+        {
+            ASSERT_ARE_EQUAL(uint32_t, TEST_OTHER_FIELD_VALUE, g_other_comm_info.fields[index]);
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_latency_other_backend_fail)
+    {
+        size_t index;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = get_other_handle();
+
+        //act
+        int result = tpm_comm_loopback_set_latency(tpm_handle, 10);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        for (index = 0; index < sizeof(g_other_comm_info.fields) / sizeof(g_other_comm_info.fields[0]); index++)
+        {
+            ASSERT_ARE_EQUAL(uint32_t, TEST_OTHER_FIELD_VALUE, g_other_comm_info.fields[index]);
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_key_present_other_backend_fail)
+    {
+        size_t index;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = get_other_handle();
+
+        //act
+        int result = tpm_comm_loopback_set_key_present(tpm_handle, false);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        for (index = 0; index < sizeof(g_other_comm_info.fields) / sizeof(g_other_comm_info.fields[0]); index++)
+        {
+            ASSERT_ARE_EQUAL(uint32_t, TEST_OTHER_FIELD_VALUE, g_other_comm_info.fields[index]);
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_get_command_count_other_backend_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = get_other_handle();
+
+        //act
+        uint32_t result = tpm_comm_loopback_get_command_count(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_get_byte_count_other_backend_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = get_other_handle();
+
+        //act
+        uint64_t result = tpm_comm_loopback_get_byte_count(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint64_t, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+END_TEST_SUITE(tpm_comm_loopback_runtime_ut)
@@ -0,0 +1,596 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_stdint.h"
+#include "umock_c/umock_c_negative_tests.h"
+#include "azure_macro_utils/macro_utils.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "umock_c/umock_c_prod.h"
+#undef ENABLE_MOCKS
+
+#include "azure_utpm_c/tpm_comm.h"
+#include "azure_utpm_c/tpm_comm_loopback.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_RESPONSE_SIZE      4096
+
+// TPM2_GetCapability(TPM_CAP_TPM_PROPERTIES, TPM_PT_FAMILY_INDICATOR, 2)
+static const unsigned char TEST_GET_CAPABILITY_CMD[] =
+{
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x01, 0x7A,
+    0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02
+};
+#define TEST_GET_CAPABILITY_RESP_SIZE   35
+
+// TPM2_HMAC(0x81000100, 4 bytes, TPM_ALG_SHA256) with a password session
+static const unsigned char TEST_HMAC_CMD[] =
+{
+    0x80, 0x02, 0x00, 0x00, 0x00, 0x23, 0x00, 0x00, 0x01, 0x55,
+    0x81, 0x00, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x04, 0xAA, 0xBB, 0xCC, 0xDD, 0x00, 0x0B
+};
+#define TEST_HMAC_RESP_SIZE             53
+
+// TPM2_ReadPublic(0x81000001)
+static const unsigned char TEST_READ_PUBLIC_CMD[] =
+{
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x0E, 0x00, 0x00, 0x01, 0x73, 0x81, 0x00, 0x00, 0x01
+};
+
+// TPM_RC_HANDLE + TPM_RC_H + TPM_RC_1
+static const unsigned char TEST_HANDLE_ERROR_RESP[] =
+{
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x01, 0x8B
+};
+
+static const unsigned char TEST_RESPONDER_RESP[] =
+{
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00
+};
+
+static size_t g_responder_count;
+static int g_responder_result;
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+TEST_DEFINE_ENUM_TYPE(TPM_COMM_TYPE, TPM_COMM_TYPE_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(TPM_COMM_TYPE, TPM_COMM_TYPE_VALUES);
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%s", MU_ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+}
+
+static int test_responder(void* context, const unsigned char* cmd_bytes, uint32_t bytes_len, unsigned char* response, uint32_t* resp_len)
+{
+    (void)context;
+    (void)cmd_bytes;
+    (void)bytes_len;
+    g_responder_count++;
+    if (g_responder_result == 0)
+    {
+        memcpy(response, TEST_RESPONDER_RESP, sizeof(TEST_RESPONDER_RESP));
+        *resp_len = sizeof(TEST_RESPONDER_RESP);
+    }
+    return g_responder_result;
+}
+
+static uint32_t get_response_code(const unsigned char* response)
+{
+    return ((uint32_t)response[6] << 24) | ((uint32_t)response[7] << 16) | ((uint32_t)response[8] << 8) | response[9];
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(tpm_comm_loopback_ut)
+
+    TEST_SUITE_INITIALIZE(suite_init)
+    {
+        int result;
+
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        (void)umock_c_init(on_umock_c_error);
+
+        result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        result = umocktypes_stdint_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_HANDLE, void*);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(suite_cleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+    }
+
+    TEST_FUNCTION_INITIALIZE(method_init)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Could not acquire test serialization mutex.");
+        }
+        umock_c_reset_all_calls();
+
+        g_responder_count = 0;
+        g_responder_result = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(method_cleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+
+        //assert
+        ASSERT_IS_NOT_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(uint32_t, 0, tpm_comm_loopback_get_command_count(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_fail)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)).SetReturn(NULL);
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_destroy_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        tpm_comm_destroy(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_destroy_handle_NULL_succeed)
+    {
+        //arrange
+
+        //act
+        tpm_comm_destroy(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_get_type_succeed)
+    {
+        //arrange
+
+        //act
+        TPM_COMM_TYPE comm_type = tpm_comm_get_type(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(TPM_COMM_TYPE, TPM_COMM_TYPE_LOOPBACK, comm_type);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_handle_NULL_fail)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+
+        //act
+        int result = tpm_comm_submit_command(NULL, TEST_GET_CAPABILITY_CMD, sizeof(TEST_GET_CAPABILITY_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_malformed_fail)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_GET_CAPABILITY_CMD, sizeof(TEST_GET_CAPABILITY_CMD) - 1, response, &length);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(uint32_t, 0, tpm_comm_loopback_get_command_count(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_get_capability_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_GET_CAPABILITY_CMD, sizeof(TEST_GET_CAPABILITY_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_GET_CAPABILITY_RESP_SIZE, length);
+        ASSERT_ARE_EQUAL(uint32_t, 0, get_response_code(response));
+        ASSERT_ARE_EQUAL(uint32_t, 1, tpm_comm_loopback_get_command_count(tpm_handle));
+        ASSERT_ARE_EQUAL(uint64_t, sizeof(TEST_GET_CAPABILITY_CMD) + TEST_GET_CAPABILITY_RESP_SIZE, tpm_comm_loopback_get_byte_count(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_hmac_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_HMAC_RESP_SIZE, length);
+        ASSERT_ARE_EQUAL(uint32_t, 0, get_response_code(response));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_read_public_no_key_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_loopback_set_key_present(tpm_handle, false);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_READ_PUBLIC_CMD, sizeof(TEST_READ_PUBLIC_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(uint32_t, sizeof(TEST_HANDLE_ERROR_RESP), length);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(response, TEST_HANDLE_ERROR_RESP, sizeof(TEST_HANDLE_ERROR_RESP)));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_responder_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_loopback_set_responder(tpm_handle, test_responder, NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, g_responder_count);
+        ASSERT_ARE_EQUAL(uint32_t, sizeof(TEST_RESPONDER_RESP), length);
+        ASSERT_ARE_EQUAL(uint32_t, 1, tpm_comm_loopback_get_command_count(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_responder_use_canned_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_loopback_set_responder(tpm_handle, test_responder, NULL);
+        g_responder_result = TPM_LOOPBACK_USE_CANNED;
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, g_responder_count);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_HMAC_RESP_SIZE, length);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_responder_fail)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_loopback_set_responder(tpm_handle, test_responder, NULL);
+        g_responder_result = __LINE__;
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(uint32_t, 0, tpm_comm_loopback_get_command_count(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_responder_reset_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_loopback_set_responder(tpm_handle, test_responder, NULL);
+        (void)tpm_comm_loopback_set_responder(tpm_handle, NULL, NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 0, g_responder_count);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_HMAC_RESP_SIZE, length);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_responder_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int result = tpm_comm_loopback_set_responder(NULL, test_responder, NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_latency_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_loopback_set_latency(tpm_handle, 10);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(int, 0, tpm_comm_submit_command(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD), response, &length));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_latency_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int result = tpm_comm_loopback_set_latency(NULL, 10);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_loopback_set_key_present_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int result = tpm_comm_loopback_set_key_present(NULL, true);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_succeed)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command_async(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD));
+        int complete_result = tpm_comm_complete_command(tpm_handle, response, &length);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(int, 0, complete_result);
+        ASSERT_ARE_EQUAL(uint32_t, TEST_HMAC_RESP_SIZE, length);
+        ASSERT_ARE_EQUAL(int, -1, tpm_comm_get_poll_fd(tpm_handle));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_pending_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_submit_command_async(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD));
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command_async(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD));
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_pending_fail_sync)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        (void)tpm_comm_submit_command_async(tpm_handle, TEST_HMAC_CMD, sizeof(TEST_HMAC_CMD));
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_GET_CAPABILITY_CMD, sizeof(TEST_GET_CAPABILITY_CMD), response, &length);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(uint32_t, 0, tpm_comm_loopback_get_command_count(tpm_handle));
+        // The pending command still completes with its own response
+        ASSERT_ARE_EQUAL(int, 0, tpm_comm_complete_command(tpm_handle, response, &length));
+        ASSERT_ARE_EQUAL(uint32_t, TEST_HMAC_RESP_SIZE, length);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+    TEST_FUNCTION(tpm_comm_complete_command_not_pending_fail)
+    {
+        unsigned char response[TEST_RESPONSE_SIZE];
+        uint32_t length = TEST_RESPONSE_SIZE;
+
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(NULL);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_complete_command(tpm_handle, response, &length);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_comm_destroy(tpm_handle);
+    }
+
+END_TEST_SUITE(tpm_comm_loopback_ut)
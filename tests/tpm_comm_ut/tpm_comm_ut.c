@@ -0,0 +1,568 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_stdint.h"
+#include "umock_c/umock_c_negative_tests.h"
+#include "azure_macro_utils/macro_utils.h"
+
+#include "azure_utpm_c/tpm_comm.h"
+
+#define ENABLE_MOCKS
+#include "umock_c/umock_c_prod.h"
+MOCKABLE_FUNCTION(, TPM_COMM_HANDLE, test_backend_create, const char*, endpoint);
+MOCKABLE_FUNCTION(, void, test_backend_destroy, TPM_COMM_HANDLE, handle);
+MOCKABLE_FUNCTION(, TPM_COMM_TYPE, test_backend_get_type, TPM_COMM_HANDLE, handle);
+MOCKABLE_FUNCTION(, int, test_backend_submit_command, TPM_COMM_HANDLE, handle, const unsigned char*, cmd_bytes, uint32_t, bytes_len, unsigned char*, response, uint32_t*, resp_len);
+MOCKABLE_FUNCTION(, int, test_backend_submit_command_async, TPM_COMM_HANDLE, handle, const unsigned char*, cmd_bytes, uint32_t, bytes_len);
+MOCKABLE_FUNCTION(, int, test_backend_complete_command, TPM_COMM_HANDLE, handle, unsigned char*, response, uint32_t*, resp_len);
+MOCKABLE_FUNCTION(, int, test_backend_get_poll_fd, TPM_COMM_HANDLE, handle);
+MOCKABLE_FUNCTION(, TPM_COMM_HANDLE, sync_backend_create, const char*, endpoint);
+MOCKABLE_FUNCTION(, int, sync_backend_submit_command, TPM_COMM_HANDLE, handle, const unsigned char*, cmd_bytes, uint32_t, bytes_len, unsigned char*, response, uint32_t*, resp_len);
+#undef ENABLE_MOCKS
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_ENDPOINT           "test_endpoint"
+#define TEST_POLL_FD            7
+#define TEST_CMD_LENGTH         10
+
+static const unsigned char TEST_TPM_COMMAND[TEST_CMD_LENGTH] = { 0x80, 0x01, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x01, 0x44 };
+
+struct TPM_COMM_INFO_TAG
+{
+    const TPM_COMM_OPS* ops;
+};
+
+static struct TPM_COMM_INFO_TAG g_test_info;
+static struct TPM_COMM_INFO_TAG g_sync_info;
+
+// Default backend of the build, see TPM_COMM_DEFAULT_BACKEND_OPS in CMakeLists.txt
+static const TPM_COMM_OPS g_test_ops =
+{
+    "loopback",
+    test_backend_create,
+    test_backend_destroy,
+    test_backend_get_type,
+    test_backend_submit_command,
+    test_backend_submit_command_async,
+    test_backend_complete_command,
+    test_backend_get_poll_fd
+};
+
+// Backend without the optional asynchronous operations
+static const TPM_COMM_OPS g_sync_ops =
+{
+    "sync",
+    sync_backend_create,
+    test_backend_destroy,
+    test_backend_get_type,
+    sync_backend_submit_command,
+    NULL,
+    NULL,
+    NULL
+};
+
+const TPM_COMM_OPS* tpm_comm_loopback_get_ops(void)
+{
+    return &g_test_ops;
+}
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+TEST_DEFINE_ENUM_TYPE(TPM_COMM_TYPE, TPM_COMM_TYPE_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(TPM_COMM_TYPE, TPM_COMM_TYPE_VALUES);
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%s", MU_ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(tpm_comm_ut)
+
+    TEST_SUITE_INITIALIZE(suite_init)
+    {
+        int result;
+
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        (void)umock_c_init(on_umock_c_error);
+
+        result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        result = umocktypes_stdint_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_HANDLE, void*);
+
+        REGISTER_GLOBAL_MOCK_RETURN(test_backend_create, &g_test_info);
+        REGISTER_GLOBAL_MOCK_RETURN(test_backend_get_type, TPM_COMM_TYPE_LOOPBACK);
+        REGISTER_GLOBAL_MOCK_RETURN(test_backend_submit_command, 0);
+        REGISTER_GLOBAL_MOCK_RETURN(test_backend_submit_command_async, 0);
+        REGISTER_GLOBAL_MOCK_RETURN(test_backend_complete_command, 0);
+        REGISTER_GLOBAL_MOCK_RETURN(test_backend_get_poll_fd, TEST_POLL_FD);
+        REGISTER_GLOBAL_MOCK_RETURN(sync_backend_create, &g_sync_info);
+        REGISTER_GLOBAL_MOCK_RETURN(sync_backend_submit_command, 0);
+    }
+
+    TEST_SUITE_CLEANUP(suite_cleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+    }
+
+    TEST_FUNCTION_INITIALIZE(method_init)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Could not acquire test serialization mutex.");
+        }
+        umock_c_reset_all_calls();
+
+        g_test_info.ops = NULL;
+        g_sync_info.ops = NULL;
+    }
+
+    TEST_FUNCTION_CLEANUP(method_cleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(tpm_comm_create_default_backend_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(test_backend_create(TEST_ENDPOINT));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+
+        //assert
+        ASSERT_ARE_EQUAL(void_ptr, &g_test_info, tpm_handle);
+        ASSERT_ARE_EQUAL(void_ptr, &g_test_ops, g_test_info.ops);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_create_fail)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(test_backend_create(TEST_ENDPOINT)).SetReturn(NULL);
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+
+        //assert
+        ASSERT_IS_NULL(tpm_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_create_with_backend_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(sync_backend_create(TEST_ENDPOINT));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(&g_sync_ops, TEST_ENDPOINT);
+
+        //assert
+        ASSERT_ARE_EQUAL(void_ptr, &g_sync_info, tpm_handle);
+        ASSERT_ARE_EQUAL(void_ptr, &g_sync_ops, g_sync_info.ops);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_create_with_backend_ops_NULL_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(test_backend_create(NULL));
+
+        //act
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(NULL, NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(void_ptr, &g_test_info, tpm_handle);
+        ASSERT_ARE_EQUAL(void_ptr, &g_test_ops, g_test_info.ops);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_destroy_handle_NULL_succeed)
+    {
+        //arrange
+
+        //act
+        tpm_comm_destroy(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_destroy_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(&g_sync_ops, TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(test_backend_destroy(tpm_handle));
+
+        //act
+        tpm_comm_destroy(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_get_type_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(test_backend_get_type(tpm_handle)).SetReturn(TPM_COMM_TYPE_EMULATOR);
+
+        //act
+        TPM_COMM_TYPE comm_type = tpm_comm_get_type(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(TPM_COMM_TYPE, TPM_COMM_TYPE_EMULATOR, comm_type);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_get_type_handle_NULL_succeed)
+    {
+        //arrange
+        STRICT_EXPECTED_CALL(test_backend_get_type(NULL));
+
+        //act
+        TPM_COMM_TYPE comm_type = tpm_comm_get_type(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(TPM_COMM_TYPE, TPM_COMM_TYPE_LOOPBACK, comm_type);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_handle_NULL_fail)
+    {
+        //arrange
+        unsigned char response[TEST_CMD_LENGTH];
+        uint32_t resp_len = TEST_CMD_LENGTH;
+
+        //act
+        int result = tpm_comm_submit_command(NULL, TEST_TPM_COMMAND, TEST_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_succeed)
+    {
+        //arrange
+        unsigned char response[TEST_CMD_LENGTH];
+        uint32_t resp_len = TEST_CMD_LENGTH;
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(&g_sync_ops, TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(sync_backend_submit_command(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH, response, &resp_len));
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_fail)
+    {
+        //arrange
+        unsigned char response[TEST_CMD_LENGTH];
+        uint32_t resp_len = TEST_CMD_LENGTH;
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(test_backend_submit_command(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH, response, &resp_len)).SetReturn(__LINE__);
+
+        //act
+        int result = tpm_comm_submit_command(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(test_backend_submit_command_async(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH));
+
+        //act
+        int result = tpm_comm_submit_command_async(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_submit_command_async_not_supported_fail)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(&g_sync_ops, TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_submit_command_async(tpm_handle, TEST_TPM_COMMAND, TEST_CMD_LENGTH);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_complete_command_succeed)
+    {
+        //arrange
+        unsigned char response[TEST_CMD_LENGTH];
+        uint32_t resp_len = TEST_CMD_LENGTH;
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(test_backend_complete_command(tpm_handle, response, &resp_len)).SetReturn(TPM_COMM_PENDING);
+
+        //act
+        int result = tpm_comm_complete_command(tpm_handle, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TPM_COMM_PENDING, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_complete_command_not_supported_fail)
+    {
+        //arrange
+        unsigned char response[TEST_CMD_LENGTH];
+        uint32_t resp_len = TEST_CMD_LENGTH;
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(&g_sync_ops, TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_comm_complete_command(tpm_handle, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_NOT_EQUAL(int, TPM_COMM_PENDING, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_get_poll_fd_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create(TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(test_backend_get_poll_fd(tpm_handle));
+
+        //act
+        int poll_fd = tpm_comm_get_poll_fd(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, TEST_POLL_FD, poll_fd);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_get_poll_fd_not_supported_succeed)
+    {
+        //arrange
+        TPM_COMM_HANDLE tpm_handle = tpm_comm_create_with_backend(&g_sync_ops, TEST_ENDPOINT);
+        umock_c_reset_all_calls();
+
+        //act
+        int poll_fd = tpm_comm_get_poll_fd(tpm_handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, -1, poll_fd);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_register_backend_ops_NULL_fail)
+    {
+        //arrange
+
+        //act
+        int result = tpm_comm_register_backend(NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_register_backend_submit_command_NULL_fail)
+    {
+        //arrange
+        TPM_COMM_OPS invalid_ops = g_sync_ops;
+        invalid_ops.name = "invalid";
+        invalid_ops.submit_command = NULL;
+
+        //act
+        int result = tpm_comm_register_backend(&invalid_ops);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_IS_NULL(tpm_comm_find_backend("invalid"));
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_register_backend_succeed)
+    {
+        //arrange
+
+        //act
+        int result = tpm_comm_register_backend(&g_sync_ops);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(void_ptr, &g_sync_ops, tpm_comm_find_backend("sync"));
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_register_backend_same_name_succeed)
+    {
+        //arrange
+        TPM_COMM_OPS replacement_ops = g_sync_ops;
+        (void)tpm_comm_register_backend(&g_sync_ops);
+
+        //act
+        int result = tpm_comm_register_backend(&replacement_ops);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(void_ptr, &replacement_ops, tpm_comm_find_backend("sync"));
+
+        //cleanup
+        (void)tpm_comm_register_backend(&g_sync_ops);
+    }
+
+    TEST_FUNCTION(tpm_comm_find_backend_default_succeed)
+    {
+        //arrange
+
+        //act
+        const TPM_COMM_OPS* ops = tpm_comm_find_backend("loopback");
+
+        //assert
+        ASSERT_ARE_EQUAL(void_ptr, &g_test_ops, ops);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_find_backend_unknown_fail)
+    {
+        //arrange
+
+        //act
+        const TPM_COMM_OPS* ops = tpm_comm_find_backend("unknown");
+
+        //assert
+        ASSERT_IS_NULL(ops);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_find_backend_name_NULL_fail)
+    {
+        //arrange
+
+        //act
+        const TPM_COMM_OPS* ops = tpm_comm_find_backend(NULL);
+
+        //assert
+        ASSERT_IS_NULL(ops);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_comm_register_backend_too_many_fail)
+    {
+        //arrange
+        static const char* const backend_names[TPM_COMM_MAX_BACKENDS] = { "b0", "b1", "b2", "b3", "b4", "b5", "b6", "b7" };
+        static TPM_COMM_OPS backend_ops[TPM_COMM_MAX_BACKENDS];
+        TPM_COMM_OPS extra_ops = g_sync_ops;
+        int result = 0;
+        extra_ops.name = "extra";
+        for (size_t index = 0; index < TPM_COMM_MAX_BACKENDS && result == 0; index++)
+        {
+            backend_ops[index] = g_sync_ops;
+            backend_ops[index].name = backend_names[index];
+            result = tpm_comm_register_backend(&backend_ops[index]);
+        }
+
+        //act
+        result = tpm_comm_register_backend(&extra_ops);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_IS_NULL(tpm_comm_find_backend("extra"));
+
+        //cleanup
+    }
+
+END_TEST_SUITE(tpm_comm_ut)
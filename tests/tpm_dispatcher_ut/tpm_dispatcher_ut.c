@@ -0,0 +1,443 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_stdint.h"
+#include "umock_c/umock_c_negative_tests.h"
+#include "azure_macro_utils/macro_utils.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "umock_c/umock_c_prod.h"
+#include "azure_utpm_c/tpm_comm.h"
+#undef ENABLE_MOCKS
+
+#include "azure_utpm_c/tpm_dispatcher.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_COMM_HANDLE        (TPM_COMM_HANDLE)0x123456
+#define TEST_THREAD_HANDLE      (THREAD_HANDLE)0x223456
+#define TEST_LOCK_HANDLE        (LOCK_HANDLE)0x323456
+#define TEST_COND_HANDLE        (COND_HANDLE)0x423456
+#define TEMP_CMD_LENGTH         128
+
+static const unsigned char TEMP_TPM_COMMAND[TEMP_CMD_LENGTH] = { 0 };
+
+static THREAD_START_FUNC g_thread_func;
+static void* g_thread_arg;
+static size_t g_complete_count;
+static int g_complete_result;
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%s", MU_ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+}
+
+static THREADAPI_RESULT my_ThreadAPI_Create(THREAD_HANDLE* threadHandle, THREAD_START_FUNC func, void* arg)
+{
+    g_thread_func = func;
+    g_thread_arg = arg;
+    *threadHandle = TEST_THREAD_HANDLE;
+    return THREADAPI_OK;
+}
+
+// The dispatcher thread runs to completion on the test thread once it is told to stop
+static THREADAPI_RESULT my_ThreadAPI_Join(THREAD_HANDLE threadHandle, int* res)
+{
+    (void)threadHandle;
+    *res = g_thread_func(g_thread_arg);
+    return THREADAPI_OK;
+}
+
+static void test_on_complete(void* context, int result)
+{
+    (void)context;
+    g_complete_count++;
+    g_complete_result = result;
+}
+
+static void init_request(TPM_DISPATCH_REQUEST* request, unsigned char* response, uint32_t* resp_len)
+{
+    request->cmd_bytes = TEMP_TPM_COMMAND;
+    request->cmd_len = TEMP_CMD_LENGTH;
+    request->response = response;
+    request->resp_len = resp_len;
+    request->on_complete = test_on_complete;
+    request->context = NULL;
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(tpm_dispatcher_ut)
+
+    TEST_SUITE_INITIALIZE(suite_init)
+    {
+        int result;
+
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        (void)umock_c_init(on_umock_c_error);
+
+        result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        result = umocktypes_stdint_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_UMOCK_ALIAS_TYPE(TPM_COMM_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(THREAD_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(THREAD_START_FUNC, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(THREADAPI_RESULT, int);
+        REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(LOCK_RESULT, int);
+        REGISTER_UMOCK_ALIAS_TYPE(COND_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(COND_RESULT, int);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+
+        REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Create, my_ThreadAPI_Create);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(ThreadAPI_Create, THREADAPI_ERROR);
+        REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Join, my_ThreadAPI_Join);
+
+        REGISTER_GLOBAL_MOCK_RETURN(Lock_Init, TEST_LOCK_HANDLE);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock_Init, NULL);
+        REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
+        REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
+        REGISTER_GLOBAL_MOCK_RETURN(Lock_Deinit, LOCK_OK);
+
+        REGISTER_GLOBAL_MOCK_RETURN(Condition_Init, TEST_COND_HANDLE);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(Condition_Init, NULL);
+        REGISTER_GLOBAL_MOCK_RETURN(Condition_Post, COND_OK);
+        REGISTER_GLOBAL_MOCK_RETURN(Condition_Wait, COND_OK);
+
+        REGISTER_GLOBAL_MOCK_RETURN(tpm_comm_submit_command, 0);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(tpm_comm_submit_command, __LINE__);
+    }
+
+    TEST_SUITE_CLEANUP(suite_cleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+    }
+
+    TEST_FUNCTION_INITIALIZE(method_init)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Could not acquire test serialization mutex.");
+        }
+        umock_c_reset_all_calls();
+
+        g_thread_func = NULL;
+        g_thread_arg = NULL;
+        g_complete_count = 0;
+        g_complete_result = -1;
+    }
+
+    TEST_FUNCTION_CLEANUP(method_cleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    static void setup_tpm_dispatcher_create_mocks(void)
+    {
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(Lock_Init());
+        STRICT_EXPECTED_CALL(Condition_Init());
+        STRICT_EXPECTED_CALL(Lock_Init());
+        STRICT_EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_create_comm_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(NULL);
+
+        //assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_create_succeed)
+    {
+        //arrange
+        setup_tpm_dispatcher_create_mocks();
+
+        //act
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+
+        //assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_IS_NOT_NULL(g_thread_func);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_dispatcher_destroy(handle);
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_create_fail)
+    {
+        //arrange
+        int negativeTestsInitResult = umock_c_negative_tests_init();
+        ASSERT_ARE_EQUAL(int, 0, negativeTestsInitResult);
+
+        setup_tpm_dispatcher_create_mocks();
+
+        umock_c_negative_tests_snapshot();
+
+        for (size_t index = 0; index < umock_c_negative_tests_call_count(); index++)
+        {
+            umock_c_negative_tests_reset();
+            umock_c_negative_tests_fail_call(index);
+
+            char tmp_msg[64];
+            sprintf(tmp_msg, "tpm_dispatcher_create failure in test %zu/%zu", index, umock_c_negative_tests_call_count());
+
+            //act
+            TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+
+            //assert
+            ASSERT_IS_NULL(handle, tmp_msg);
+        }
+
+        //cleanup
+        umock_c_negative_tests_deinit();
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_destroy_handle_NULL_succeed)
+    {
+        //arrange
+
+        //act
+        tpm_dispatcher_destroy(NULL);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_destroy_succeed)
+    {
+        //arrange
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+        STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG));
+        // Dispatcher thread finds the queue empty and exits
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+        STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        tpm_dispatcher_destroy(handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_submit_handle_NULL_fail)
+    {
+        //arrange
+        TPM_DISPATCH_REQUEST request;
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        init_request(&request, response, &resp_len);
+
+        //act
+        int result = tpm_dispatcher_submit(NULL, &request);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_submit_on_complete_NULL_fail)
+    {
+        //arrange
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+        TPM_DISPATCH_REQUEST request;
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        init_request(&request, response, &resp_len);
+        request.on_complete = NULL;
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_dispatcher_submit(handle, &request);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_dispatcher_destroy(handle);
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_submit_succeed)
+    {
+        //arrange
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+        TPM_DISPATCH_REQUEST request;
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        init_request(&request, response, &resp_len);
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_dispatcher_submit(handle, &request);
+
+        //assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 0, g_complete_count);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_dispatcher_destroy(handle);
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_destroy_executes_queued_requests_succeed)
+    {
+        //arrange
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+        TPM_DISPATCH_REQUEST request1;
+        TPM_DISPATCH_REQUEST request2;
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        init_request(&request1, response, &resp_len);
+        init_request(&request2, response, &resp_len);
+        (void)tpm_dispatcher_submit(handle, &request1);
+        (void)tpm_dispatcher_submit(handle, &request2);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+        STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(TEST_COMM_HANDLE, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH, response, &resp_len));
+        STRICT_EXPECTED_CALL(tpm_comm_submit_command(TEST_COMM_HANDLE, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH, response, &resp_len));
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+        STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        //act
+        tpm_dispatcher_destroy(handle);
+
+        //assert
+        ASSERT_ARE_EQUAL(size_t, 2, g_complete_count);
+        ASSERT_ARE_EQUAL(int, 0, g_complete_result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_execute_handle_NULL_fail)
+    {
+        //arrange
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+
+        //act
+        int result = tpm_dispatcher_execute(NULL, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_execute_cmd_NULL_fail)
+    {
+        //arrange
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        umock_c_reset_all_calls();
+
+        //act
+        int result = tpm_dispatcher_execute(handle, NULL, TEMP_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_dispatcher_destroy(handle);
+    }
+
+    TEST_FUNCTION(tpm_dispatcher_execute_condition_fail)
+    {
+        //arrange
+        TPM_DISPATCHER_HANDLE handle = tpm_dispatcher_create(TEST_COMM_HANDLE);
+        unsigned char response[TEMP_CMD_LENGTH];
+        uint32_t resp_len = TEMP_CMD_LENGTH;
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(Condition_Init()).SetReturn(NULL);
+
+        //act
+        int result = tpm_dispatcher_execute(handle, TEMP_TPM_COMMAND, TEMP_CMD_LENGTH, response, &resp_len);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        tpm_dispatcher_destroy(handle);
+    }
+
+    END_TEST_SUITE(tpm_dispatcher_ut)
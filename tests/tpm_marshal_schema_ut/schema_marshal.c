@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Builds the table driven engine of MarshalSchema.c next to the generated functions of
+// Marshal.c, with its entry points renamed to SCHEMA_<function>, so that the test can
+// compare both implementations in one binary.
+
+#ifndef USE_MARSHAL_SCHEMA
+#define USE_MARSHAL_SCHEMA
+#endif
+
+#define TPMS_RSA_PARMS_Unmarshal             SCHEMA_TPMS_RSA_PARMS_Unmarshal
+#define TPMS_RSA_PARMS_Marshal               SCHEMA_TPMS_RSA_PARMS_Marshal
+#define TPMS_ECC_PARMS_Unmarshal             SCHEMA_TPMS_ECC_PARMS_Unmarshal
+#define TPMS_ECC_PARMS_Marshal               SCHEMA_TPMS_ECC_PARMS_Marshal
+#define TPMS_ECC_POINT_Unmarshal             SCHEMA_TPMS_ECC_POINT_Unmarshal
+#define TPMS_ECC_POINT_Marshal               SCHEMA_TPMS_ECC_POINT_Marshal
+#define TPMU_PUBLIC_PARMS_Unmarshal          SCHEMA_TPMU_PUBLIC_PARMS_Unmarshal
+#define TPMU_PUBLIC_PARMS_Marshal            SCHEMA_TPMU_PUBLIC_PARMS_Marshal
+#define TPMU_PUBLIC_ID_Unmarshal             SCHEMA_TPMU_PUBLIC_ID_Unmarshal
+#define TPMU_PUBLIC_ID_Marshal               SCHEMA_TPMU_PUBLIC_ID_Marshal
+#define TPMT_PUBLIC_Unmarshal                SCHEMA_TPMT_PUBLIC_Unmarshal
+#define TPMT_PUBLIC_Marshal                  SCHEMA_TPMT_PUBLIC_Marshal
+#define TPM2B_PUBLIC_Unmarshal               SCHEMA_TPM2B_PUBLIC_Unmarshal
+#define TPM2B_PUBLIC_Marshal                 SCHEMA_TPM2B_PUBLIC_Marshal
+#define TPMS_ALG_PROPERTY_Unmarshal          SCHEMA_TPMS_ALG_PROPERTY_Unmarshal
+#define TPMS_ALG_PROPERTY_Marshal            SCHEMA_TPMS_ALG_PROPERTY_Marshal
+#define TPMS_TAGGED_PROPERTY_Unmarshal       SCHEMA_TPMS_TAGGED_PROPERTY_Unmarshal
+#define TPMS_TAGGED_PROPERTY_Marshal         SCHEMA_TPMS_TAGGED_PROPERTY_Marshal
+#define TPML_ALG_PROPERTY_Unmarshal          SCHEMA_TPML_ALG_PROPERTY_Unmarshal
+#define TPML_ALG_PROPERTY_Marshal            SCHEMA_TPML_ALG_PROPERTY_Marshal
+#define TPML_HANDLE_Unmarshal                SCHEMA_TPML_HANDLE_Unmarshal
+#define TPML_HANDLE_Marshal                  SCHEMA_TPML_HANDLE_Marshal
+#define TPML_CCA_Unmarshal                   SCHEMA_TPML_CCA_Unmarshal
+#define TPML_CCA_Marshal                     SCHEMA_TPML_CCA_Marshal
+#define TPML_CC_Unmarshal                    SCHEMA_TPML_CC_Unmarshal
+#define TPML_CC_Marshal                      SCHEMA_TPML_CC_Marshal
+#define TPML_PCR_SELECTION_Unmarshal         SCHEMA_TPML_PCR_SELECTION_Unmarshal
+#define TPML_PCR_SELECTION_Marshal           SCHEMA_TPML_PCR_SELECTION_Marshal
+#define TPML_TAGGED_TPM_PROPERTY_Unmarshal   SCHEMA_TPML_TAGGED_TPM_PROPERTY_Unmarshal
+#define TPML_TAGGED_TPM_PROPERTY_Marshal     SCHEMA_TPML_TAGGED_TPM_PROPERTY_Marshal
+#define TPML_TAGGED_PCR_PROPERTY_Unmarshal   SCHEMA_TPML_TAGGED_PCR_PROPERTY_Unmarshal
+#define TPML_TAGGED_PCR_PROPERTY_Marshal     SCHEMA_TPML_TAGGED_PCR_PROPERTY_Marshal
+#define TPML_ECC_CURVE_Unmarshal             SCHEMA_TPML_ECC_CURVE_Unmarshal
+#define TPML_ECC_CURVE_Marshal               SCHEMA_TPML_ECC_CURVE_Marshal
+#define TPML_TAGGED_POLICY_Unmarshal         SCHEMA_TPML_TAGGED_POLICY_Unmarshal
+#define TPML_TAGGED_POLICY_Marshal           SCHEMA_TPML_TAGGED_POLICY_Marshal
+#define TPMU_CAPABILITIES_Unmarshal          SCHEMA_TPMU_CAPABILITIES_Unmarshal
+#define TPMU_CAPABILITIES_Marshal            SCHEMA_TPMU_CAPABILITIES_Marshal
+#define TPMS_CAPABILITY_DATA_Unmarshal       SCHEMA_TPMS_CAPABILITY_DATA_Unmarshal
+#define TPMS_CAPABILITY_DATA_Marshal         SCHEMA_TPMS_CAPABILITY_DATA_Marshal
+
+#include "../../src/MarshalSchema.c"
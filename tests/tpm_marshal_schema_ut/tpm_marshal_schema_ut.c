@@ -0,0 +1,613 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+// Feeds the same images to the generated functions of Marshal.c and to the table driven
+// engine of MarshalSchema.c (built by schema_marshal.c with its entry points renamed to
+// SCHEMA_*), and checks that both return the same result, consume the same bytes,
+// decode the same structure and marshal it back to the same image.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_stdint.h"
+#include "azure_macro_utils/macro_utils.h"
+
+#include "azure_utpm_c/TpmTypes.h"
+#include "azure_utpm_c/Marshal_fp.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+TPM_RC SCHEMA_TPM2B_PUBLIC_Unmarshal(TPM2B_PUBLIC *target, BYTE **buffer, INT32 *size, BOOL flag);
+UINT16 SCHEMA_TPM2B_PUBLIC_Marshal(TPM2B_PUBLIC *source, BYTE **buffer, INT32 *size);
+TPM_RC SCHEMA_TPMS_CAPABILITY_DATA_Unmarshal(TPMS_CAPABILITY_DATA *target, BYTE **buffer, INT32 *size);
+UINT16 SCHEMA_TPMS_CAPABILITY_DATA_Marshal(TPMS_CAPABILITY_DATA *source, BYTE **buffer, INT32 *size);
+#ifdef __cplusplus
+}
+#endif
+
+#define TEST_IMAGE_SIZE     1024
+
+// Storage key template with a policy and a shortened modulus
+#if         ALG_RSA
+static const BYTE TEST_RSA_PUBLIC[] =
+{
+    0x00, 0x4A,                                     // size
+    0x00, 0x01, 0x00, 0x0B, 0x00, 0x03, 0x00, 0x72, // TPM_ALG_RSA, TPM_ALG_SHA256, objectAttributes
+    0x00, 0x20,                                     // authPolicy
+    0x83, 0x71, 0x97, 0x67, 0x44, 0x84, 0xB3, 0xF8, 0x1A, 0x90, 0xCC, 0x8D, 0x46, 0xA5, 0xD7, 0x24,
+    0xFD, 0x52, 0xD7, 0x6E, 0x06, 0x52, 0x0B, 0x64, 0xF2, 0xA1, 0xDA, 0x1B, 0x33, 0x14, 0x69, 0xAA,
+    0x00, 0x06, 0x00, 0x80, 0x00, 0x43,             // AES-128-CFB
+    0x00, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, // TPM_ALG_NULL scheme, 2048 bits, default exponent
+    0x00, 0x10,                                     // unique.rsa
+    0xC3, 0x5E, 0x2B, 0x01, 0x8F, 0x44, 0x97, 0x12, 0x6D, 0xE0, 0x3A, 0xB9, 0x70, 0x25, 0x1C, 0xF4
+};
+#endif // ALG_RSA
+
+// ECC P-256 storage key
+#if         ALG_ECC
+static const BYTE TEST_ECC_PUBLIC[] =
+{
+    0x00, 0x5A,                                     // size
+    0x00, 0x23, 0x00, 0x0B, 0x00, 0x03, 0x00, 0x72, // TPM_ALG_ECC, TPM_ALG_SHA256, objectAttributes
+    0x00, 0x00,                                     // authPolicy
+    0x00, 0x06, 0x00, 0x80, 0x00, 0x43,             // AES-128-CFB
+    0x00, 0x10, 0x00, 0x03, 0x00, 0x10,             // TPM_ALG_NULL scheme, TPM_ECC_NIST_P256, TPM_ALG_NULL kdf
+    0x00, 0x20,                                     // unique.ecc.x
+    0x1E, 0x7C, 0x9D, 0x35, 0x22, 0xB0, 0x61, 0x4A, 0xF3, 0x08, 0x5D, 0xC6, 0x97, 0x2E, 0x10, 0x8B,
+    0x44, 0xDA, 0x03, 0x5F, 0xB8, 0x76, 0xE1, 0x2C, 0x0F, 0x93, 0x48, 0xA7, 0x6B, 0x14, 0xCE, 0x59,
+    0x00, 0x20,                                     // unique.ecc.y
+    0x95, 0x0B, 0x3E, 0xF1, 0x66, 0x2D, 0xC8, 0x17, 0x5A, 0xE4, 0x81, 0x39, 0xBF, 0x02, 0x7D, 0x40,
+    0xA6, 0x13, 0xDC, 0x58, 0x2F, 0x87, 0x61, 0x0E, 0xB5, 0x4C, 0x93, 0x2A, 0xF7, 0x18, 0x6E, 0xC1
+};
+#endif // ALG_ECC
+
+// HMAC key
+static const BYTE TEST_KEYEDHASH_PUBLIC[] =
+{
+    0x00, 0x30,                                     // size
+    0x00, 0x08, 0x00, 0x0B, 0x00, 0x04, 0x00, 0x72, // TPM_ALG_KEYEDHASH, TPM_ALG_SHA256, objectAttributes
+    0x00, 0x00,                                     // authPolicy
+    0x00, 0x05, 0x00, 0x0B,                         // TPM_ALG_HMAC with TPM_ALG_SHA256
+    0x00, 0x20,                                     // unique.keyedHash
+    0x6A, 0x09, 0xE6, 0x67, 0xBB, 0x67, 0xAE, 0x85, 0x3C, 0x6E, 0xF3, 0x72, 0xA5, 0x4F, 0xF5, 0x3A,
+    0x51, 0x0E, 0x52, 0x7F, 0x9B, 0x05, 0x68, 0x8C, 0x1F, 0x83, 0xD9, 0xAB, 0x5B, 0xE0, 0xCD, 0x19
+};
+
+// AES-128-CFB key
+static const BYTE TEST_SYMCIPHER_PUBLIC[] =
+{
+    0x00, 0x32,                                     // size
+    0x00, 0x25, 0x00, 0x0B, 0x00, 0x06, 0x00, 0x72, // TPM_ALG_SYMCIPHER, TPM_ALG_SHA256, objectAttributes
+    0x00, 0x00,                                     // authPolicy
+    0x00, 0x06, 0x00, 0x80, 0x00, 0x43,             // AES-128-CFB
+    0x00, 0x20,                                     // unique.sym
+    0x42, 0x8A, 0x2F, 0x98, 0x71, 0x37, 0x44, 0x91, 0xB5, 0xC0, 0xFB, 0xCF, 0xE9, 0xB5, 0xDB, 0xA5,
+    0x39, 0x56, 0xC2, 0x5B, 0x59, 0xF1, 0x11, 0xF1, 0x92, 0x3F, 0x82, 0xA4, 0xAB, 0x1C, 0x5E, 0xD5
+};
+
+// One TPMS_CAPABILITY_DATA image per TPM_CAP selector
+static const BYTE TEST_CAP_ALGS[] =
+{
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x06, 0x00, 0x00, 0x00, 0x02,             // TPM_ALG_AES: symmetric
+    0x00, 0x0B, 0x00, 0x00, 0x00, 0x04              // TPM_ALG_SHA256: hash
+};
+static const BYTE TEST_CAP_HANDLES[] =
+{
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03,
+    0x81, 0x00, 0x00, 0x01, 0x81, 0x00, 0x01, 0x00, 0x81, 0x01, 0x00, 0x01
+};
+static const BYTE TEST_CAP_COMMANDS[] =
+{
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x02, 0x00, 0x01, 0x3F,                         // TPM2_Clear: one handle
+    0x12, 0x00, 0x01, 0x31                          // TPM2_CreatePrimary: one handle, returns a handle
+};
+static const BYTE TEST_CAP_PP_COMMANDS[] =
+{
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x01, 0x1F
+};
+static const BYTE TEST_CAP_AUDIT_COMMANDS[] =
+{
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x01, 0x44, 0x00, 0x00, 0x01, 0x7F
+};
+static const BYTE TEST_CAP_PCRS[] =
+{
+    0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x04, 0x03, 0xFF, 0xFF, 0xFF,             // TPM_ALG_SHA1: all PCRs
+    0x00, 0x0B, 0x03, 0x01, 0x00, 0x80              // TPM_ALG_SHA256: PCR 0 and 23
+};
+static const BYTE TEST_CAP_TPM_PROPERTIES[] =
+{
+    0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x01, 0x00, 0x32, 0x2E, 0x30, 0x00, // TPM_PT_FAMILY_INDICATOR
+    0x00, 0x00, 0x01, 0x05, 0x00, 0x00, 0x00, 0x8A, // TPM_PT_MANUFACTURER
+    0x00, 0x00, 0x01, 0x1E, 0x00, 0x00, 0x04, 0x00  // TPM_PT_MAX_COMMAND_SIZE
+};
+static const BYTE TEST_CAP_PCR_PROPERTIES[] =
+{
+    0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x03, 0xFF, 0xFF, 0x00  // TPM_PT_PCR_SAVE
+};
+#if         ALG_ECC
+static const BYTE TEST_CAP_ECC_CURVES[] =
+{
+    0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x03, 0x00, 0x04                          // TPM_ECC_NIST_P256, TPM_ECC_NIST_P384
+};
+#endif // ALG_ECC
+static const BYTE TEST_CAP_AUTH_POLICIES[] =
+{
+    0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x01,
+    0x40, 0x00, 0x00, 0x0B, 0x00, 0x0B,             // TPM_RH_ENDORSEMENT, TPM_ALG_SHA256
+    0x83, 0x71, 0x97, 0x67, 0x44, 0x84, 0xB3, 0xF8, 0x1A, 0x90, 0xCC, 0x8D, 0x46, 0xA5, 0xD7, 0x24,
+    0xFD, 0x52, 0xD7, 0x6E, 0x06, 0x52, 0x0B, 0x64, 0xF2, 0xA1, 0xDA, 0x1B, 0x33, 0x14, 0x69, 0xAA
+};
+
+// Images that both implementations must reject
+static const BYTE TEST_CAP_UNKNOWN[] =
+{
+    0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00
+};
+static const BYTE TEST_CAP_VENDOR_PROPERTY[] =
+{
+    0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+static const BYTE TEST_CAP_HANDLES_COUNT_TOO_BIG[] =
+{
+    0x00, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
+};
+static const BYTE TEST_CAP_PCRS_SELECT_TOO_BIG[] =
+{
+    0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x0B, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+typedef struct TEST_IMAGE_TAG
+{
+    const BYTE     *bytes;
+    INT32           size;
+} TEST_IMAGE;
+
+#define TEST_IMAGE_OF(a)    { a, (INT32)sizeof(a) }
+
+static const TEST_IMAGE TEST_PUBLIC_IMAGES[] =
+{
+#if         ALG_RSA
+    TEST_IMAGE_OF(TEST_RSA_PUBLIC),
+#endif // ALG_RSA
+#if         ALG_ECC
+    TEST_IMAGE_OF(TEST_ECC_PUBLIC),
+#endif // ALG_ECC
+    TEST_IMAGE_OF(TEST_KEYEDHASH_PUBLIC),
+    TEST_IMAGE_OF(TEST_SYMCIPHER_PUBLIC)
+};
+
+static const TEST_IMAGE TEST_CAPABILITY_IMAGES[] =
+{
+    TEST_IMAGE_OF(TEST_CAP_ALGS),
+    TEST_IMAGE_OF(TEST_CAP_HANDLES),
+    TEST_IMAGE_OF(TEST_CAP_COMMANDS),
+    TEST_IMAGE_OF(TEST_CAP_PP_COMMANDS),
+    TEST_IMAGE_OF(TEST_CAP_AUDIT_COMMANDS),
+    TEST_IMAGE_OF(TEST_CAP_PCRS),
+    TEST_IMAGE_OF(TEST_CAP_TPM_PROPERTIES),
+    TEST_IMAGE_OF(TEST_CAP_PCR_PROPERTIES),
+#if         ALG_ECC
+    TEST_IMAGE_OF(TEST_CAP_ECC_CURVES),
+#endif // ALG_ECC
+    TEST_IMAGE_OF(TEST_CAP_AUTH_POLICIES)
+};
+
+#define TEST_COUNT(a)       (sizeof(a) / sizeof((a)[0]))
+
+// Large enough to be kept off the stack
+static TPM2B_PUBLIC g_generated_public;
+static TPM2B_PUBLIC g_schema_public;
+static TPMS_CAPABILITY_DATA g_generated_capability;
+static TPMS_CAPABILITY_DATA g_schema_capability;
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%s", MU_ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(tpm_marshal_schema_ut)
+
+    TEST_SUITE_INITIALIZE(suite_init)
+    {
+        int result;
+
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        (void)umock_c_init(on_umock_c_error);
+
+        result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        result = umocktypes_stdint_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+    }
+
+    TEST_SUITE_CLEANUP(suite_cleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+    }
+
+    TEST_FUNCTION_INITIALIZE(method_init)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Could not acquire test serialization mutex.");
+        }
+        umock_c_reset_all_calls();
+    }
+
+    TEST_FUNCTION_CLEANUP(method_cleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    // Unmarshals the first 'size' bytes of 'image' with both implementations and
+    // compares the outcome. A decoded structure must also marshal back to 'image'.
+    static void check_public(const BYTE *image, INT32 size, BOOL flag, TPM_RC *result)
+    {
+        BYTE generated_image[TEST_IMAGE_SIZE];
+        BYTE schema_image[TEST_IMAGE_SIZE];
+        BYTE *generated_buffer = generated_image;
+        BYTE *schema_buffer = schema_image;
+        INT32 generated_size = size;
+        INT32 schema_size = size;
+        TPM_RC schema_result;
+
+        memcpy(generated_image, image, size);
+        memcpy(schema_image, image, size);
+        memset(&g_generated_public, 0, sizeof(g_generated_public));
+        memset(&g_schema_public, 0, sizeof(g_schema_public));
+
+        *result = TPM2B_PUBLIC_Unmarshal(&g_generated_public, &generated_buffer, &generated_size, flag);
+        schema_result = SCHEMA_TPM2B_PUBLIC_Unmarshal(&g_schema_public, &schema_buffer, &schema_size, flag);
+
+        ASSERT_ARE_EQUAL(uint32_t, *result, schema_result);
+        ASSERT_ARE_EQUAL(int, generated_size, schema_size);
+        if (*result == TPM_RC_SUCCESS)
+        {
+            ASSERT_ARE_EQUAL(int, 0, memcmp(&g_generated_public, &g_schema_public, sizeof(g_generated_public)));
+
+            generated_buffer = generated_image;
+            schema_buffer = schema_image;
+            generated_size = TEST_IMAGE_SIZE;
+            schema_size = TEST_IMAGE_SIZE;
+            ASSERT_ARE_EQUAL(int, size, TPM2B_PUBLIC_Marshal(&g_generated_public, NULL, NULL));
+            ASSERT_ARE_EQUAL(int, size, SCHEMA_TPM2B_PUBLIC_Marshal(&g_schema_public, NULL, NULL));
+            ASSERT_ARE_EQUAL(int, size, TPM2B_PUBLIC_Marshal(&g_generated_public, &generated_buffer, &generated_size));
+            ASSERT_ARE_EQUAL(int, size, SCHEMA_TPM2B_PUBLIC_Marshal(&g_schema_public, &schema_buffer, &schema_size));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(image, generated_image, size));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(image, schema_image, size));
+        }
+    }
+
+    static void check_capability(const BYTE *image, INT32 size, TPM_RC *result)
+    {
+        BYTE generated_image[TEST_IMAGE_SIZE];
+        BYTE schema_image[TEST_IMAGE_SIZE];
+        BYTE *generated_buffer = generated_image;
+        BYTE *schema_buffer = schema_image;
+        INT32 generated_size = size;
+        INT32 schema_size = size;
+        TPM_RC schema_result;
+
+        memcpy(generated_image, image, size);
+        memcpy(schema_image, image, size);
+        memset(&g_generated_capability, 0, sizeof(g_generated_capability));
+        memset(&g_schema_capability, 0, sizeof(g_schema_capability));
+
+        *result = TPMS_CAPABILITY_DATA_Unmarshal(&g_generated_capability, &generated_buffer, &generated_size);
+        schema_result = SCHEMA_TPMS_CAPABILITY_DATA_Unmarshal(&g_schema_capability, &schema_buffer, &schema_size);
+
+        ASSERT_ARE_EQUAL(uint32_t, *result, schema_result);
+        ASSERT_ARE_EQUAL(int, generated_size, schema_size);
+        if (*result == TPM_RC_SUCCESS)
+        {
+            ASSERT_ARE_EQUAL(int, 0, memcmp(&g_generated_capability, &g_schema_capability, sizeof(g_generated_capability)));
+
+            generated_buffer = generated_image;
+            schema_buffer = schema_image;
+            generated_size = TEST_IMAGE_SIZE;
+            schema_size = TEST_IMAGE_SIZE;
+            ASSERT_ARE_EQUAL(int, size, TPMS_CAPABILITY_DATA_Marshal(&g_generated_capability, NULL, NULL));
+            ASSERT_ARE_EQUAL(int, size, SCHEMA_TPMS_CAPABILITY_DATA_Marshal(&g_schema_capability, NULL, NULL));
+            ASSERT_ARE_EQUAL(int, size, TPMS_CAPABILITY_DATA_Marshal(&g_generated_capability, &generated_buffer, &generated_size));
+            ASSERT_ARE_EQUAL(int, size, SCHEMA_TPMS_CAPABILITY_DATA_Marshal(&g_schema_capability, &schema_buffer, &schema_size));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(image, generated_image, size));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(image, schema_image, size));
+        }
+    }
+
+#if         ALG_RSA
+    TEST_FUNCTION(TPM2B_PUBLIC_rsa_succeed)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_public(TEST_RSA_PUBLIC, sizeof(TEST_RSA_PUBLIC), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ALG_RSA, g_schema_public.publicArea.type);
+        ASSERT_ARE_EQUAL(uint32_t, 2048, g_schema_public.publicArea.parameters.rsaDetail.keyBits);
+
+        //cleanup
+    }
+#endif // ALG_RSA
+
+#if         ALG_ECC
+    TEST_FUNCTION(TPM2B_PUBLIC_ecc_succeed)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_public(TEST_ECC_PUBLIC, sizeof(TEST_ECC_PUBLIC), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ALG_ECC, g_schema_public.publicArea.type);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ECC_NIST_P256, g_schema_public.publicArea.parameters.eccDetail.curveID);
+
+        //cleanup
+    }
+#endif // ALG_ECC
+
+    TEST_FUNCTION(TPM2B_PUBLIC_keyedhash_succeed)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_public(TEST_KEYEDHASH_PUBLIC, sizeof(TEST_KEYEDHASH_PUBLIC), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ALG_KEYEDHASH, g_schema_public.publicArea.type);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ALG_HMAC, g_schema_public.publicArea.parameters.keyedHashDetail.scheme.scheme);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2B_PUBLIC_symcipher_succeed)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_public(TEST_SYMCIPHER_PUBLIC, sizeof(TEST_SYMCIPHER_PUBLIC), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ALG_SYMCIPHER, g_schema_public.publicArea.type);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_ALG_AES, g_schema_public.publicArea.parameters.symDetail.sym.algorithm);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2B_PUBLIC_truncated_fail)
+    {
+        //arrange
+
+        //act
+        for (size_t index = 0; index < TEST_COUNT(TEST_PUBLIC_IMAGES); index++)
+        {
+            for (INT32 size = 0; size < TEST_PUBLIC_IMAGES[index].size; size++)
+            {
+                TPM_RC result;
+                check_public(TEST_PUBLIC_IMAGES[index].bytes, size, FALSE, &result);
+
+                //assert
+                ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+            }
+        }
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2B_PUBLIC_invalid_type_fail)
+    {
+        //arrange
+        BYTE image[sizeof(TEST_KEYEDHASH_PUBLIC)];
+        TPM_RC result;
+        memcpy(image, TEST_KEYEDHASH_PUBLIC, sizeof(image));
+        image[3] = 0x99;
+
+        //act
+        check_public(image, sizeof(image), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2B_PUBLIC_invalid_scheme_fail)
+    {
+        //arrange
+        BYTE image[sizeof(TEST_KEYEDHASH_PUBLIC)];
+        TPM_RC result;
+        memcpy(image, TEST_KEYEDHASH_PUBLIC, sizeof(image));
+        image[13] = 0x06;
+
+        //act
+        check_public(image, sizeof(image), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2B_PUBLIC_size_mismatch_fail)
+    {
+        //arrange
+        BYTE image[sizeof(TEST_SYMCIPHER_PUBLIC)];
+        TPM_RC result;
+        memcpy(image, TEST_SYMCIPHER_PUBLIC, sizeof(image));
+        image[1]--;
+
+        //act
+        check_public(image, sizeof(image), FALSE, &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SIZE, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPM2B_PUBLIC_empty_fail)
+    {
+        //arrange
+        static const BYTE image[] = { 0x00, 0x00 };
+        TPM_RC result;
+
+        //act
+        check_public(image, sizeof(image), TRUE, &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SIZE, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_every_capability_succeed)
+    {
+        //arrange
+
+        //act
+        for (size_t index = 0; index < TEST_COUNT(TEST_CAPABILITY_IMAGES); index++)
+        {
+            TPM_RC result;
+            check_capability(TEST_CAPABILITY_IMAGES[index].bytes, TEST_CAPABILITY_IMAGES[index].size, &result);
+
+            //assert
+            ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        }
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_tpm_properties_succeed)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_capability(TEST_CAP_TPM_PROPERTIES, sizeof(TEST_CAP_TPM_PROPERTIES), &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+        ASSERT_ARE_EQUAL(uint32_t, 3, g_schema_capability.data.tpmProperties.count);
+        ASSERT_ARE_EQUAL(uint32_t, TPM_PT_MAX_COMMAND_SIZE, g_schema_capability.data.tpmProperties.tpmProperty[2].property);
+        ASSERT_ARE_EQUAL(uint32_t, 0x400, g_schema_capability.data.tpmProperties.tpmProperty[2].value);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_truncated_fail)
+    {
+        //arrange
+
+        //act
+        for (size_t index = 0; index < TEST_COUNT(TEST_CAPABILITY_IMAGES); index++)
+        {
+            for (INT32 size = 0; size < TEST_CAPABILITY_IMAGES[index].size; size++)
+            {
+                TPM_RC result;
+                check_capability(TEST_CAPABILITY_IMAGES[index].bytes, size, &result);
+
+                //assert
+                ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+            }
+        }
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_unknown_capability_fail)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_capability(TEST_CAP_UNKNOWN, sizeof(TEST_CAP_UNKNOWN), &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_VALUE, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_vendor_property_fail)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_capability(TEST_CAP_VENDOR_PROPERTY, sizeof(TEST_CAP_VENDOR_PROPERTY), &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SELECTOR, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_count_too_big_fail)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_capability(TEST_CAP_HANDLES_COUNT_TOO_BIG, sizeof(TEST_CAP_HANDLES_COUNT_TOO_BIG), &result);
+
+        //assert
+        ASSERT_ARE_EQUAL(uint32_t, TPM_RC_SIZE, result);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(TPMS_CAPABILITY_DATA_pcr_select_too_big_fail)
+    {
+        //arrange
+        TPM_RC result;
+
+        //act
+        check_capability(TEST_CAP_PCRS_SELECT_TOO_BIG, sizeof(TEST_CAP_PCRS_SELECT_TOO_BIG), &result);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(uint32_t, TPM_RC_SUCCESS, result);
+
+        //cleanup
+    }
+
+END_TEST_SUITE(tpm_marshal_schema_ut)
@@ -51,6 +51,8 @@ extern "C"
 #endif
 
 #define BUFFER_LENGTH       10
+#define MAX_WORD_COUNT      33
+#define WORD_GUARD          0xA5A5A5A5
 
 MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
 static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
@@ -118,6 +120,30 @@ BEGIN_TEST_SUITE(tpm_memory_ut)
         return result;
     }
 
+    // Converts 'count' words read 'offset' bytes into the source buffer and checks them
+    // against the scalar conversion, and that the word after them is left untouched.
+    static void check_byte_array_to_uint32_array(size_t offset, INT32 count)
+    {
+        BYTE src[4 * MAX_WORD_COUNT + 4];
+        UINT32 target[MAX_WORD_COUNT + 1];
+        for (size_t index = 0; index < sizeof(src); index++)
+        {
+            src[index] = (BYTE)(index * 7 + 1);
+        }
+        for (size_t index = 0; index < MAX_WORD_COUNT + 1; index++)
+        {
+            target[index] = WORD_GUARD;
+        }
+
+        ByteArrayToUint32Array(target, src + offset, count);
+
+        for (INT32 index = 0; index < count; index++)
+        {
+            ASSERT_ARE_EQUAL(uint32_t, BYTE_ARRAY_TO_UINT32(src + offset + 4 * index), target[index]);
+        }
+        ASSERT_ARE_EQUAL(uint32_t, WORD_GUARD, target[count]);
+    }
+
     TEST_FUNCTION(MemoryCopy_dest_NULL_fail)
     {
         //arrange
@@ -179,4 +205,128 @@ BEGIN_TEST_SUITE(tpm_memory_ut)
         //cleanup
     }
 
+    TEST_FUNCTION(ByteArrayToUint32Array_count_0_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 0);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_1_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 1);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_3_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 3);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_4_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 4);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_5_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 5);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_15_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 15);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_16_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 16);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_17_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 17);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_count_33_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        check_byte_array_to_uint32_array(0, 33);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(ByteArrayToUint32Array_unaligned_source_succeed)
+    {
+        //arrange
+
+        //act
+        //assert
+        for (size_t offset = 1; offset < 4; offset++)
+        {
+            check_byte_array_to_uint32_array(offset, 17);
+            check_byte_array_to_uint32_array(offset, 32);
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+    }
+
 END_TEST_SUITE(tpm_memory_ut)